@@ -0,0 +1,258 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "Biquad.h"
+
+#define TWO_PI_F    6.2831853f
+
+/*******************************************************************************
+ * BIQUAD FILTER FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * Function:    biquad_init()
+ *
+ * Synopsis:    void biquad_init(bq)
+ *
+ *              BIQUAD* bq;     - Pointer to filter section
+ *
+ * Description: Set the section to pass the input through and clear the
+ *              filter state.
+ *
+ * Returns:     void
+ */
+
+void biquad_init(BIQUAD* bq)
+{
+    bq->b0     = 1.0f;
+    bq->b1     = 0.0f;
+    bq->b2     = 0.0f;
+    bq->a1     = 0.0f;
+    bq->a2     = 0.0f;
+    bq->z1     = 0.0f;
+    bq->z2     = 0.0f;
+    bq->freq   = 0.0f;
+    bq->bypass = 1;
+}
+
+/*
+ * Function:    biquad_coeffs()
+ *
+ * Synopsis:    void biquad_coeffs(bq, coeff)
+ *
+ *              BIQUAD* bq;         - Pointer to filter section
+ *              const float* coeff; - b0, b1, b2, a1, a2 with a0 = 1
+ *
+ * Description: Load the section coefficients from a table. A table of
+ *              { 1, 0, 0, 0, 0 } bypasses the section. The poles must lie
+ *              inside the unit circle, |a2| < 1 and |a1| < 1 + a2, or the
+ *              output would diverge, so a table outside that triangle is
+ *              refused and the section bypassed instead. The filter state
+ *              is left as is.
+ *
+ * Returns:     false if the table was refused as unstable.
+ */
+
+bool biquad_coeffs(BIQUAD* bq, const float* coeff)
+{
+    if (!((fabsf(coeff[4]) < 1.0f) && (fabsf(coeff[3]) < (1.0f + coeff[4]))))
+    {
+        biquad_init(bq);
+        return false;
+    }
+
+    bq->b0     = coeff[0];
+    bq->b1     = coeff[1];
+    bq->b2     = coeff[2];
+    bq->a1     = coeff[3];
+    bq->a2     = coeff[4];
+    bq->freq   = 0.0f;
+    bq->bypass = ((bq->b0 == 1.0f) && (bq->b1 == 0.0f) && (bq->b2 == 0.0f) &&
+                  (bq->a1 == 0.0f) && (bq->a2 == 0.0f)) ? 1 : 0;
+
+    return true;
+}
+
+/*
+ * Function:    biquad_lowpass()
+ *
+ * Synopsis:    void biquad_lowpass(bq, fc, q, fs)
+ *
+ *              BIQUAD* bq;     - Pointer to filter section
+ *              float fc;       - Corner frequency (Hz)
+ *              float q;        - Section Q, BIQUAD_Q_BUTTERWORTH for flat
+ *              float fs;       - Sample rate (Hz)
+ *
+ * Description: Design a second order low pass section by the bilinear
+ *              transform, with the corner prewarped. The DC gain is one.
+ *              The section is bypassed for a corner of zero or at or
+ *              above the Nyquist frequency. The filter state is left as is.
+ *
+ * Returns:     void
+ */
+
+void biquad_lowpass(BIQUAD* bq, float fc, float q, float fs)
+{
+    float w0, cw, alpha, a0;
+
+    if ((fc <= 0.0f) || (fc >= (fs * 0.5f)) || (q <= 0.0f))
+    {
+        bq->b0 = 1.0f;
+        bq->b1 = bq->b2 = bq->a1 = bq->a2 = 0.0f;
+        bq->freq   = fc;
+        bq->bypass = 1;
+        return;
+    }
+
+    w0    = TWO_PI_F * fc / fs;
+    cw    = cosf(w0);
+    alpha = sinf(w0) / (2.0f * q);
+    a0    = 1.0f / (1.0f + alpha);
+
+    bq->b1     = (1.0f - cw) * a0;
+    bq->b0     = bq->b1 * 0.5f;
+    bq->b2     = bq->b0;
+    bq->a1     = (-2.0f * cw) * a0;
+    bq->a2     = (1.0f - alpha) * a0;
+    bq->freq   = fc;
+    bq->bypass = 0;
+}
+
+/*
+ * Function:    biquad_notch()
+ *
+ * Synopsis:    void biquad_notch(bq, f0, q, fs)
+ *
+ *              BIQUAD* bq;     - Pointer to filter section
+ *              float f0;       - Notch center frequency (Hz)
+ *              float q;        - Notch Q, the -3dB width is f0/q
+ *              float fs;       - Sample rate (Hz)
+ *
+ * Description: Design a second order notch section. The gain is one at
+ *              DC and Nyquist and zero at f0. The section is bypassed for
+ *              a center of zero or at or above the Nyquist frequency. The
+ *              coefficients may be changed while the filter is running to
+ *              track a moving frequency, the filter state is left as is.
+ *
+ * Returns:     void
+ */
+
+void biquad_notch(BIQUAD* bq, float f0, float q, float fs)
+{
+    float w0, cw, alpha, a0;
+
+    if ((f0 <= 0.0f) || (f0 >= (fs * 0.5f)) || (q <= 0.0f))
+    {
+        bq->b0 = 1.0f;
+        bq->b1 = bq->b2 = bq->a1 = bq->a2 = 0.0f;
+        bq->freq   = f0;
+        bq->bypass = 1;
+        return;
+    }
+
+    w0    = TWO_PI_F * f0 / fs;
+    cw    = cosf(w0);
+    alpha = sinf(w0) / (2.0f * q);
+    a0    = 1.0f / (1.0f + alpha);
+
+    /* a2 = (1 - alpha) / (1 + alpha) taken as 2*b0 - 1, which is exact
+     * and keeps the DC gain at one for a low notch, where 1 - cos(w0)
+     * is down in the float rounding of the coefficients.
+     */
+    bq->b0     = a0;
+    bq->b1     = (-2.0f * cw) * a0;
+    bq->b2     = a0;
+    bq->a1     = bq->b1;
+    bq->a2     = (2.0f * a0) - 1.0f;
+    bq->freq   = f0;
+    bq->bypass = 0;
+}
+
+/*
+ * Function:    biquad_reset()
+ *
+ * Synopsis:    void biquad_reset(bq, x)
+ *
+ *              BIQUAD* bq;     - Pointer to filter section
+ *              float x;        - Input to settle the section at
+ *
+ * Description: Set the filter state to the steady state for a constant
+ *              input of x, so the output starts without a step.
+ *
+ * Returns:     void
+ */
+
+void biquad_reset(BIQUAD* bq, float x)
+{
+    float den = 1.0f + bq->a1 + bq->a2;
+    float y;
+
+    /* DC gain of the section, or pass through if it has none */
+    y = (den != 0.0f) ? (((bq->b0 + bq->b1 + bq->b2) / den) * x) : x;
+
+    bq->z1 = y - (bq->b0 * x);
+    bq->z2 = (bq->b2 * x) - (bq->a2 * y);
+}
+
+/*
+ * Function:    biquad_calc()
+ *
+ * Synopsis:    float biquad_calc(bq, x)
+ *
+ *              BIQUAD* bq;     - Pointer to filter section
+ *              float x;        - Input sample
+ *
+ * Description: Run one sample through the section.
+ *
+ * Returns:     The filtered output.
+ */
+
+float biquad_calc(BIQUAD* bq, float x)
+{
+    float y;
+
+    if (bq->bypass)
+        return x;
+
+    y = (bq->b0 * x) + bq->z1;
+
+    bq->z1 = ((bq->b1 * x) - (bq->a1 * y)) + bq->z2;
+    bq->z2 =  (bq->b2 * x) - (bq->a2 * y);
+
+    return y;
+}
+
+/*
+ * Function:    biquad_cascade()
+ *
+ * Synopsis:    float biquad_cascade(bq, count, x)
+ *
+ *              BIQUAD* bq;     - Pointer to first filter section
+ *              uint32_t count; - Number of sections in the cascade
+ *              float x;        - Input sample
+ *
+ * Description: Run one sample through each section of the cascade in turn.
+ *
+ * Returns:     The filtered output.
+ */
+
+float biquad_cascade(BIQUAD* bq, uint32_t count, float x)
+{
+    while (count--)
+        x = biquad_calc(bq++, x);
+
+    return x;
+}
+
+/* End-Of-File */
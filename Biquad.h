@@ -0,0 +1,50 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================ */
+
+#ifndef __BIQUAD_H__
+#define __BIQUAD_H__
+
+#define BIQUAD_COEFFS       5           /* b0, b1, b2, a1, a2 */
+
+#define BIQUAD_Q_BUTTERWORTH    0.7071068f
+
+/* Second order IIR filter section
+ *
+ * Transposed direct form II, with a0 normalized to one:
+ *
+ *   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+ *
+ * Sections are cascaded for higher orders. A bypassed section passes the
+ * input through and costs nothing to run.
+ */
+typedef struct _BIQUAD {
+    float       b0;             /* feed forward coefficients */
+    float       b1;
+    float       b2;
+    float       a1;             /* feedback coefficients     */
+    float       a2;
+    float       z1;             /* filter state              */
+    float       z2;
+    float       freq;           /* design frequency (Hz)     */
+    uint32_t    bypass;         /* pass the input through    */
+} BIQUAD;
+
+/* Biquad Function Prototypes */
+
+void biquad_init(BIQUAD* bq);
+bool biquad_coeffs(BIQUAD* bq, const float* coeff);
+void biquad_lowpass(BIQUAD* bq, float fc, float q, float fs);
+void biquad_notch(BIQUAD* bq, float f0, float q, float fs);
+void biquad_reset(BIQUAD* bq, float x);
+float biquad_calc(BIQUAD* bq, float x);
+float biquad_cascade(BIQUAD* bq, uint32_t count, float x);
+
+#endif /* __BIQUAD_H__ */
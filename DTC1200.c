@@ -93,20 +93,46 @@
 /* Global Data Items */
 
 Semaphore_Handle g_semaSPI;
-Semaphore_Handle g_semaServo;
-Semaphore_Handle g_semaTransportMode;
 
 extern IOExpander_Handle g_handleSPI1;
 extern IOExpander_Handle g_handleSPI2;
 
-#if BUTTON_INTERRUPTS != 0
 Event_Handle g_eventSPI;
+
+/* Main control loop timing (ms). The loop wakes for housekeeping, which
+ * touches no SPI, and reads the switch ports on an interrupt edge, when a
+ * change is due to settle, or on the safety poll in case an edge was lost.
+ */
+#define HOUSEKEEPING_MS     5           /* lamps and tape end sensor  */
+#define HEARTBEAT_MS        625         /* status LED blink period    */
+
+#if BUTTON_INTERRUPTS != 0
+#define SWITCH_POLL_MS      100         /* safety poll of the switches */
+#define MAIN_EVENTS         (EVT_SWITCH_ALL | EVT_EXPANDER_FLUSH)
+#else
+#define SWITCH_POLL_MS      HOUSEKEEPING_MS
+#define MAIN_EVENTS         (EVT_EXPANDER_FLUSH)
 #endif
 
+/* True once the clock tick count reaches a deadline */
+#define TICK_DUE(t, now)    ((int32_t)((now) - (t)) >= 0)
+
+/* Debounce state of an I/O expander switch port */
+typedef struct _SWITCH_DEBOUNCE {
+    uint32_t    port;           /* SWITCH_PORT_xxx index             */
+    uint32_t    edges;          /* interrupt edge count at last read */
+    uint32_t    tick;           /* clock tick the port last changed  */
+    uint32_t    settling;       /* a new state is waiting to settle  */
+    uint8_t     raw;            /* last state read from the port     */
+    uint8_t     state;          /* debounced port state              */
+} SWITCH_DEBOUNCE;
+
 /* Static Function Prototypes */
 
 Int main();
 Void MainControlTask(UArg a0, UArg a1);
+static void SwitchInit(SWITCH_DEBOUNCE* sw, uint32_t port, uint8_t bits);
+static bool SwitchDebounce(SWITCH_DEBOUNCE* sw, uint8_t bits, uint32_t now);
 
 //*****************************************************************************
 // Main Program Entry Point
@@ -148,12 +174,6 @@ Int main()
     Error_init(&eb);
     g_semaSPI = Semaphore_create(1, NULL, &eb);
 
-    Error_init(&eb);
-    g_semaServo = Semaphore_create(1, NULL, &eb);
-
-    Error_init(&eb);
-    g_semaTransportMode = Semaphore_create(1, NULL, &eb);
-
     /* Now start the main application button polling task */
 
     Error_init(&eb);
@@ -207,22 +227,85 @@ void InitPeripherals(void)
     ReadSerialNumber(g_handleI2C1, g_ui8SerialNumber);
 }
 
+//*****************************************************************************
+// Switch port debounce. A port state is accepted once it has been stable
+// for the debounce time. Each interrupt edge restarts the settle time from
+// the clock tick it happened on, not from when the port got read, so the
+// debounce doesn't depend on how often the task loop runs.
+//*****************************************************************************
+
+void SwitchInit(SWITCH_DEBOUNCE* sw, uint32_t port, uint8_t bits)
+{
+    uint32_t edge;
+
+    sw->port     = port;
+    sw->edges    = GetSwitchEdge(port, &edge);
+    sw->tick     = Clock_getTicks();
+    sw->settling = 0;
+    sw->raw      = bits;
+    sw->state    = bits;
+}
+
+bool SwitchDebounce(SWITCH_DEBOUNCE* sw, uint8_t bits, uint32_t now)
+{
+    uint32_t edge;
+    uint32_t edges = GetSwitchEdge(sw->port, &edge);
+
+    if (edges != sw->edges)
+    {
+        /* A bounce restarts the settle time even if it reads the same */
+        sw->edges = edges;
+        sw->tick  = edge;
+    }
+    else if (bits != sw->raw)
+    {
+        /* Changed without an edge, picked up by the safety poll */
+        sw->tick = now;
+    }
+
+    sw->raw = bits;
+
+    if (sw->raw == sw->state)
+    {
+        sw->settling = 0;
+        return false;
+    }
+
+    if (!TICK_DUE(sw->tick + g_sys.debounce, now))
+    {
+        sw->settling = 1;
+        return false;
+    }
+
+    sw->state    = sw->raw;
+    sw->settling = 0;
+
+    return true;
+}
+
 //*****************************************************************************
 // The main application initialization, setup and button controler task.
 //*****************************************************************************
 
 Void MainControlTask(UArg a0, UArg a1)
 {
-    uint8_t count = 0;
     uint8_t bits = 0x00;
     uint8_t temp;
     uint8_t tran_prev = 0xff;
     uint8_t mode_prev = 0xff;
     uint8_t tout_prev = 0xff;
-    uint8_t debounce_tran = 0;
-    uint8_t debounce_mode = 0;
-    uint8_t debounce_tout = 0;
     uint8_t eot_count = 0;
+    uint8_t tran_bits = 0x00;
+    uint8_t mode_bits = 0x00;
+    uint32_t now;
+    uint32_t wait = 0;
+    uint32_t events;
+    uint32_t deadline;
+    uint32_t tick_house;
+    uint32_t tick_blink;
+    uint32_t tick_poll;
+    SWITCH_DEBOUNCE tran;
+    SWITCH_DEBOUNCE mode;
     uint8_t eot_state = 0;
     int status = 0;
     IPC_MSG ipc;
@@ -328,186 +411,263 @@ Void MainControlTask(UArg a0, UArg a1)
     /* Set initial status blink LED mask */
     g_lamp_blink_mask = L_STAT1;
 
+    /* Start debouncing from the initial switch states */
+    SwitchInit(&tran, SWITCH_PORT_TRANSPORT, tout_prev);
+    SwitchInit(&mode, SWITCH_PORT_MODE, mode_prev);
+
+    tout_prev &= S_TAPEOUT;
+
+    now = Clock_getTicks();
+
+    tick_house = now;
+    tick_poll  = now;
+    tick_blink = now + HEARTBEAT_MS;
+
+    /* From here on lamp and solenoid updates made within a tick are
+     * written out together by this task on EVT_EXPANDER_FLUSH.
+     */
+    IOExpander_deferWrites(true);
+
     for(;;)
     {
-        /* Blink heartbeat LED1 on the transport interface card */
-        if (++count >= 125)
-        {
-            count = 0;
-            g_lamp_mask ^= g_lamp_blink_mask;
-        }
-
-        /* Set any new led/lamp state. We only update the LED output
-         * port if a new lamp state was selected.
+        /* Wait for a switch port interrupt edge, an output flush
+         * or the next deadline.
          */
+        events = Event_pend(g_eventSPI, Event_Id_NONE, MAIN_EVENTS, wait);
 
-        if (g_lamp_mask != g_lamp_mask_prev)
+        /* Write out any lamp and solenoid port updates */
+        if (events & EVT_EXPANDER_FLUSH)
+            IOExpander_flush();
+
+        now = Clock_getTicks();
+
+        /* Safety poll of both switch ports in case an edge was missed */
+        if (TICK_DUE(tick_poll, now))
         {
-            /* Set the new lamp state */
-            SetLamp(g_lamp_mask);
+            tick_poll = now + SWITCH_POLL_MS;
+            events |= EVT_SWITCH_ALL;
+        }
 
-            /* Don't send status 1-3 LED notifications as the STC doesn't
-             * need this and it creates lots of unneeded IPC traffic.
-             */
-            if ((g_lamp_mask_prev & L_LAMP_MASK) != (g_lamp_mask & L_LAMP_MASK))
-            {
-                /* Notify STC of the lamp mask change & current transport mode */
-                ipc.type     = IPC_TYPE_NOTIFY;
-                ipc.opcode   = OP_NOTIFY_LAMP;
-                ipc.param1.U = g_lamp_mask;
-                ipc.param2.U = (g_high_speed_flag != 0) ? 30 : 15;
+        if (tran.settling && TICK_DUE(tran.tick + g_sys.debounce, now))
+            events |= EVT_SWITCH_TRANSPORT;
 
-                IPC_Notify(&ipc, 0);
-            }
+        if (mode.settling && TICK_DUE(mode.tick + g_sys.debounce, now))
+            events |= EVT_SWITCH_MODE;
 
-            // Update the previous lamp state
-            g_lamp_mask_prev = g_lamp_mask;
-        }
+        /* Read both switch ports under one hold of the SPI bus */
+        if ((events & EVT_SWITCH_ALL) == EVT_SWITCH_ALL)
+            status = GetSwitches(&tran_bits, &mode_bits);
+        else if (events & EVT_SWITCH_TRANSPORT)
+            status = GetTransportSwitches(&tran_bits);
+        else if (events & EVT_SWITCH_MODE)
+            status = GetModeSwitches(&mode_bits);
+        else
+            status = 0;
 
-        /* Poll the transport switches to see if the tape out arm on the
-         * right hand side of the machine is triggered. If not then we
-         * continue processing polling for any transport buttons pressed.
+        /* On a failed read leave the switch states alone and poll
+         * again at the next housekeeping tick.
          */
+        if (status != 0)
+        {
+            events &= ~(EVT_SWITCH_ALL);
+            tick_poll = now + HOUSEKEEPING_MS;
+        }
 
-        GetTransportSwitches(&bits);
+        /* Read the transport switches to see if the tape out arm on the
+         * right hand side of the machine is triggered, then process any
+         * transport buttons pressed.
+         */
 
-        /* First process the tape out arm switch */
-        if ((bits & S_TAPEOUT) != tout_prev)
+        if (events & EVT_SWITCH_TRANSPORT)
         {
-            if (++debounce_tout >= g_sys.debounce)
+            if (SwitchDebounce(&tran, tran_bits, now))
             {
-                debounce_tout = 0;
+                bits = tran.state;
 
-                /* Save the new state */
-                tout_prev = (bits & S_TAPEOUT);
+                /* First process the tape out arm switch */
+                if ((bits & S_TAPEOUT) != tout_prev)
+                {
+                    /* Save the new state */
+                    tout_prev = (bits & S_TAPEOUT);
 
-                /* Set the tape out arm state */
-                g_tape_out_flag = (bits & S_TAPEOUT) ? 1 : 0;
+                    /* Set the tape out arm state */
+                    g_tape_out_flag = (bits & S_TAPEOUT) ? 1 : 0;
 
-                if (!(bits & S_TAPEOUT))
-                    bits |= S_TAPEIN;
+                    if (!(bits & S_TAPEOUT))
+                        bits |= S_TAPEIN;
 
-                /* Send the button press to transport ctrl/cmd task */
-                Mailbox_post(g_mailboxCommander, &bits, 10);
-            }
-        }
+                    /* Send the switch change to transport ctrl/cmd task */
+                    Mailbox_post(g_mailboxCommander, &bits, 10);
+                }
 
-        /* Next process the tape transport buttons */
+                /* Next process the tape transport buttons */
 
-        bits &= S_BUTTON_MASK;
+                bits &= S_BUTTON_MASK;
 
-        if (bits)
-        {
-        	temp = bits & ~(S_REC);
-
-			if (temp != tran_prev)
-			{
-				if (++debounce_tran >= g_sys.debounce)
-				{
-					debounce_tran = 0;
+                if (bits)
+                {
+                    temp = bits & ~(S_REC);
 
-					/* Debounced a button press, send it to transport task */
-					tran_prev = temp;
+                    if (temp != tran_prev)
+                    {
+                        /* Debounced a button press, send it to transport task */
+                        tran_prev = temp;
 
-					/* Send the button press to transport ctrl/cmd task */
-					Mailbox_post(g_mailboxCommander, &bits, 10);
+                        /* Send the button press to transport ctrl/cmd task */
+                        Mailbox_post(g_mailboxCommander, &bits, 10);
 
-					/* Let STC know button status change */
-					ipc.type     = IPC_TYPE_NOTIFY;
-					ipc.opcode   = OP_NOTIFY_BUTTON;
-					ipc.param1.U = bits;
-					ipc.param2.U = (g_high_speed_flag != 0) ? 30 : 15;
+                        /* Let STC know button status change */
+                        ipc.type     = IPC_TYPE_NOTIFY;
+                        ipc.opcode   = OP_NOTIFY_BUTTON;
+                        ipc.param1.U = bits;
+                        ipc.param2.U = (g_high_speed_flag != 0) ? 30 : 15;
 
-					IPC_Notify(&ipc, 0);
-				}
-			}
-        }
-        else
-        {
-        	tran_prev = 0xff;
+                        IPC_Notify(&ipc, 0);
+                    }
+                }
+                else
+                {
+                    tran_prev = 0xff;
+                }
+            }
         }
 
-        /* Poll the mode config switches to read the DIP switches on
-         * the PCB and the hi/lo speed switch on the transport control.
+        /* Read the mode config switches for the DIP switches on the
+         * PCB and the hi/lo speed switch on the transport control.
          */
 
-        GetModeSwitches(&bits);
-
-        if (bits != mode_prev)
+        if (events & EVT_SWITCH_MODE)
         {
-            if (++debounce_mode >= g_sys.debounce)
+            if (SwitchDebounce(&mode, mode_bits, now))
             {
-                debounce_mode = 0;
-
-                /* We debounced a switch change, reset and process it */
-                mode_prev = bits;
+                /* We debounced a switch change, process it */
+                mode_prev = mode.state;
 
                 /* Save the transport speed select setting */
-                g_high_speed_flag = (bits & M_HISPEED) ? 1 : 0;
+                g_high_speed_flag = (mode_prev & M_HISPEED) ? 1 : 0;
 
                 /* Save the updated DIP switch settings */
-                g_dip_switch = bits & M_DIPSW_MASK;
+                g_dip_switch = mode_prev & M_DIPSW_MASK;
 
                 g_lamp_mask_prev = 0xFF;
             }
         }
 
-        /* Poll the accessory optical tape end sensor. If the sensor
-         * is active, we issue a STOP command to halt the transport.
-         */
+        /* Housekeeping every 5ms, lamps and the tape end sensor */
 
-        if (g_sys.sysflags & SF_STOP_AT_TAPE_END)
+        if (TICK_DUE(tick_house, now))
         {
-            switch(eot_state)
+            tick_house += HOUSEKEEPING_MS;
+
+            /* Don't try to catch up after a long stall */
+            if (TICK_DUE(tick_house, now))
+                tick_house = now + HOUSEKEEPING_MS;
+
+            /* Blink heartbeat LED1 on the transport interface card */
+            if (TICK_DUE(tick_blink, now))
+            {
+                tick_blink = now + HEARTBEAT_MS;
+                g_lamp_mask ^= g_lamp_blink_mask;
+            }
+
+            /* Set any new led/lamp state. We only update the LED output
+             * port if a new lamp state was selected.
+             */
+
+            if (g_lamp_mask != g_lamp_mask_prev)
             {
-            case 0:
-                /* Look for first high edge */
-                if ((bits = GPIO_read(Board_TAPE_END)) > 0)
-                    eot_state = 1;
-                eot_count = 0;
-                break;
-
-            case 1:
-                /* If it goes low before 25 counts, then it's a glitch */
-                if ((bits = GPIO_read(Board_TAPE_END)) == 0)
+                /* Set the new lamp state */
+                SetLamp(g_lamp_mask);
+
+                /* Don't send status 1-3 LED notifications as the STC doesn't
+                 * need this and it creates lots of unneeded IPC traffic.
+                 */
+                if ((g_lamp_mask_prev & L_LAMP_MASK) != (g_lamp_mask & L_LAMP_MASK))
                 {
-                    eot_state = 0;
-                    break;
+                    /* Notify STC of the lamp mask change & current transport mode */
+                    ipc.type     = IPC_TYPE_NOTIFY;
+                    ipc.opcode   = OP_NOTIFY_LAMP;
+                    ipc.param1.U = g_lamp_mask;
+                    ipc.param2.U = (g_high_speed_flag != 0) ? 30 : 15;
+
+                    IPC_Notify(&ipc, 0);
                 }
-                /* Trigger signal been high for at least 25 samples */
-                if (++eot_count > 25)
-                    eot_state = 2;
-                break;
-
-            case 2:
-                /* Ignore EOT sensor if tape out arm is open */
-                if (g_tape_out_flag)
+
+                // Update the previous lamp state
+                g_lamp_mask_prev = g_lamp_mask;
+            }
+
+            /* Poll the accessory optical tape end sensor. If the sensor
+             * is active, we issue a STOP command to halt the transport.
+             */
+
+            if (g_sys.sysflags & SF_STOP_AT_TAPE_END)
+            {
+                switch(eot_state)
+                {
+                case 0:
+                    /* Look for first high edge */
+                    if ((bits = GPIO_read(Board_TAPE_END)) > 0)
+                        eot_state = 1;
+                    eot_count = 0;
                     break;
 
-                /* Send a STOP button press to transport ctrl/cmd task */
-                bits = S_STOP;
-                Mailbox_post(g_mailboxCommander, &bits, 10);
-
-                /* Let STC know we're at end of tape (EOT) */
-                ipc.type     = IPC_TYPE_NOTIFY;
-                ipc.opcode   = OP_NOTIFY_EOT;
-                ipc.param1.U = bits;
-                ipc.param2.U = 0;
-                IPC_Notify(&ipc, 0);
-
-                eot_state = 3;
-                break;
-
-            case 3:
-                /* Now wait for trigger to go back low on release */
-                if ((bits = GPIO_read(Board_TAPE_END)) == 0)
-                    eot_state = 0;
-                break;
+                case 1:
+                    /* If it goes low before 25 counts, then it's a glitch */
+                    if ((bits = GPIO_read(Board_TAPE_END)) == 0)
+                    {
+                        eot_state = 0;
+                        break;
+                    }
+                    /* Trigger signal been high for at least 25 samples */
+                    if (++eot_count > 25)
+                        eot_state = 2;
+                    break;
+
+                case 2:
+                    /* Ignore EOT sensor if tape out arm is open */
+                    if (g_tape_out_flag)
+                        break;
+
+                    /* Send a STOP button press to transport ctrl/cmd task */
+                    bits = S_STOP;
+                    Mailbox_post(g_mailboxCommander, &bits, 10);
+
+                    /* Let STC know we're at end of tape (EOT) */
+                    ipc.type     = IPC_TYPE_NOTIFY;
+                    ipc.opcode   = OP_NOTIFY_EOT;
+                    ipc.param1.U = bits;
+                    ipc.param2.U = 0;
+                    IPC_Notify(&ipc, 0);
+
+                    eot_state = 3;
+                    break;
+
+                case 3:
+                    /* Now wait for trigger to go back low on release */
+                    if ((bits = GPIO_read(Board_TAPE_END)) == 0)
+                        eot_state = 0;
+                    break;
+                }
             }
         }
 
-        /* delay for 5ms and loop */
-        Task_sleep(5);
+        /* Sleep until the next housekeeping, poll or settle deadline */
+
+        deadline = tick_house;
+
+        if (!TICK_DUE(tick_poll, deadline))
+            deadline = tick_poll;
+
+        if (tran.settling && !TICK_DUE(tran.tick + g_sys.debounce, deadline))
+            deadline = tran.tick + g_sys.debounce;
+
+        if (mode.settling && !TICK_DUE(mode.tick + g_sys.debounce, deadline))
+            deadline = mode.tick + g_sys.debounce;
+
+        now = Clock_getTicks();
+
+        wait = TICK_DUE(deadline, now) ? 0 : (deadline - now);
     }
 }
 
@@ -74,6 +74,7 @@
 #include "driverlib/uart.h"
 
 #include "PID.h"
+#include "Biquad.h"
 
 #include "Board.h"
 
@@ -89,8 +90,8 @@
  */
 #define FIRMWARE_VER        3           /* firmware version */
 #define FIRMWARE_REV        1        	/* firmware revision */
-#define FIRMWARE_BUILD      1           /* firmware build number */
-#define FIRMWARE_MIN_BUILD  1           /* min build req'd to force reset */
+#define FIRMWARE_BUILD      11          /* firmware build number */
+#define FIRMWARE_MIN_BUILD  11          /* min build req'd to force reset */
 
 #if (FIRMWARE_MIN_BUILD > FIRMWARE_BUILD)
 #error "DTC build option FIRMWARE_MIN_BUILD set incorrectly"
@@ -118,26 +119,33 @@
 /*** Build/Config Options **************************************************/
 
 #define DEBUG_LEVEL			0
-#define BUTTON_INTERRUPTS	0			/* 1=interrupt, 0=polled buttons */
-#define CAPDATA_SIZE		0			/* 250 = 0.5 sec of capture data */
+#define BUTTON_INTERRUPTS	1			/* 1=interrupt, 0=polled buttons */
 
-#define DEBOUNCE            6
+#define DEBOUNCE            20          /* switch settle time default (ms) */
+#define DEBOUNCE_MAX        50          /* switch settle time limit (ms)   */
 
 /*** System Structures *****************************************************/
 
-#if (CAPDATA_SIZE > 0)
-typedef struct _CAPDATA
-{
-	float dac_takeup;
-	float dac_supply;
-	float vel_takeup;
-	float vel_supply;
-	float rad_supply;
-	float rad_takeup;
-	float tape_tach;
-	float tension;
-} CAPDATA;
-#endif
+/* Shuttle PID gain schedule breakpoints */
+#define SCHED_NUM_RATIOS    3           /* supply/takeup reel radius ratios */
+#define SCHED_NUM_VELS      2           /* shuttle reel velocities          */
+
+/* Tension sensor filter sections, low pass then the two reel notches */
+#define TFILT_STAGES        3
+#define TFILT_LOWPASS_STAGE 0
+#define TFILT_SUPPLY_STAGE  1
+#define TFILT_TAKEUP_STAGE  2
+
+/* Tension sensor filter presets for SYSPARMS.tension_filter */
+#define TFILT_OFF           0           /* raw tension sensor               */
+#define TFILT_LOWPASS       1           /* low pass at tension_lp_freq      */
+#define TFILT_NOTCH         2           /* notch at each reel rotation rate */
+#define TFILT_LOWPASS_NOTCH 3           /* low pass and reel notches        */
+#define TFILT_CUSTOM        4           /* sections from tension_coeff[]    */
+#define TFILT_NUM_PRESETS   5
+
+/* Motor DAC calibration breakpoints, evenly spaced torque over 0-DAC_MAX */
+#define DAC_CAL_POINTS      17
 
 /* This structure contains runtime and program configuration data that is
  * stored and read from EEPROM. The structure size must be 4 byte aligned.
@@ -159,7 +167,7 @@ typedef struct _SYSPARMS
     int32_t rechold_settle_time;		/* record pulse length time          */
     int32_t record_pulse_time;			/* record pulse length time          */
     int32_t vel_detect_threshold;       /* vel detect threshold (10)         */
-    uint32_t debounce;					/* debounce transport buttons time   */
+    uint32_t debounce;					/* transport switch settle time (ms) */
     uint32_t sysflags;					/* global system bit flags           */
 
     /*** SOFTWARE GAIN PARAMETERS ***/
@@ -169,6 +177,24 @@ typedef struct _SYSPARMS
     float   tension_sensor_gain;        /* tension sensor gain divisor       */
     float   tension_sensor_midscale1;   /* ADC mid-scale for 1" tape         */
     float   tension_sensor_midscale2;   /* ADC mid-scale for 2" tape         */
+    float   reel_radius_tc;             /* radius estimator time const (sec) */
+    float   reel_offset_tc;             /* offset estimator time const (sec) */
+    /* tension sensor filter */
+    int32_t tension_filter;             /* TFILT_xxx filter preset           */
+    float   tension_lp_freq;            /* low pass corner frequency (Hz)    */
+    float   tension_notch_q;            /* reel notch Q, width is f0/Q       */
+    float   tension_coeff[TFILT_STAGES][BIQUAD_COEFFS]; /* TFILT_CUSTOM     */
+
+    /* motor current sense and inner torque loop */
+    float   current_scale;              /* DAC torque per current ADC count  */
+    float   current_offset;             /* current ADC count at zero torque  */
+    float   current_pgain;              /* current loop P-gain               */
+    float   current_igain;              /* current loop I-gain (per tick)    */
+    int32_t current_limit;              /* overcurrent limit (DAC), 0=off    */
+
+    /* motor DAC code for each torque breakpoint, SF_DAC_LINEARIZE */
+    float   dac_cal_supply[DAC_CAL_POINTS];
+    float   dac_cal_takeup[DAC_CAL_POINTS];
 
     /*** THREAD TAPE PARAMETERS ***/
 
@@ -180,6 +206,8 @@ typedef struct _SYSPARMS
     int32_t stop_supply_tension;       	/* supply tension level (0-DAC_MAX)  */
     int32_t stop_takeup_tension;       	/* takeup tension level (0-DAC_MAX)  */
     int32_t stop_brake_torque;   		/* stop brake torque in shuttle mode */
+    float   reel_inertia;               /* empty reel + rotor, 0=fixed brake */
+    float   pack_inertia;               /* tape pack inertia per radius^4    */
 
     /*** SHUTTLE SERVO PARAMETERS ***/
 
@@ -196,6 +224,21 @@ typedef struct _SYSPARMS
     float   shuttle_servo_pgain;       	/* P-gain */
     float   shuttle_servo_igain;       	/* I-gain */
     float   shuttle_servo_dgain;       	/* D-gain */
+    /* shuttle velocity profile limits */
+    float   shuttle_accel;              /* max accel (velocity/sec), 0=off   */
+    float   shuttle_jerk;               /* max jerk (velocity/sec^2), 0=off  */
+    /* shuttle PID gain schedule, used with SF_GAIN_SCHEDULE */
+    float   sched_ratio[SCHED_NUM_RATIOS];      /* radius ratio breakpoints */
+    float   sched_velocity[SCHED_NUM_VELS];     /* velocity breakpoints     */
+    float   sched_pgain[SCHED_NUM_RATIOS][SCHED_NUM_VELS];
+    float   sched_igain[SCHED_NUM_RATIOS][SCHED_NUM_VELS];
+    float   sched_dgain[SCHED_NUM_RATIOS][SCHED_NUM_VELS];
+    /* tape locate parameters */
+    int32_t locate_velocity;            /* max shuttle velocity to locate    */
+    int32_t locate_approach_velocity;   /* final approach velocity           */
+    int32_t locate_approach_dist;       /* final approach distance (edges)   */
+    int32_t locate_window;              /* locate complete window (edges)    */
+    float   locate_decel;               /* profile decel (edges/sec^2)       */
 
     /*** PLAY SERVO PARAMETERS ***/
 
@@ -211,6 +254,8 @@ typedef struct _SYSPARMS
     int32_t play_lo_boost_end;
     float   play_lo_boost_pgain;   		/* P-gain */
     float   play_lo_boost_igain;   		/* I-gain */
+    /* play boost torque feedforward */
+    float   play_accel_time;            /* capstan spin up time const (sec)  */
 } SYSPARMS;
 
 /* System Bit Flags for SYSPARAMS.sysflags */
@@ -220,9 +265,94 @@ typedef struct _SYSPARMS
 #define SF_BRAKES_STOP_PLAY			0x0004	/* use brakes to stop play mode */
 #define SF_ENGAGE_PINCH_ROLLER		0x0008	/* engage pinch roller at play  */
 #define SF_STOP_AT_TAPE_END         0x0010  /* stop @tape end leader detect */
+#define SF_RADIUS_BOXCAR            0x0020  /* use 1 sec avg radius/offset  */
+#define SF_GAIN_SCHEDULE            0x0040  /* shuttle PID gain schedule    */
+#define SF_REEL_IDENT               0x0080  /* use identified reel inertia  */
+#define SF_QEI_VELCAP               0x0100  /* use 10ms QEI velocity capture*/
+#define SF_TACH_ALPHABETA           0x0200  /* alpha-beta tape tach filter  */
+#define SF_CURRENT_LOOP             0x0400  /* close torque on motor current*/
+#define SF_DAC_LINEARIZE            0x0800  /* motor DAC calibration tables */
+#define SF_DAC_DITHER               0x1000  /* dither motor DAC below 1 LSB */
 
 /*** SERVO & PID LOOP DATA *************************************************/
 
+/* Recursive reel radius/offset estimate (scalar Kalman filter) */
+
+typedef struct _REELEST
+{
+    float       x;                      /* current estimate              */
+    float       p;                      /* estimate variance             */
+    float       k;                      /* last filter gain              */
+    uint32_t    valid;                  /* estimate has been seeded      */
+} REELEST;
+
+/* Reel velocity observer, tracks the QEI position at the servo rate */
+
+typedef struct _QEIOBS
+{
+    uint32_t    count;                  /* last QEI position register    */
+    float       residual;               /* observer less QEI position    */
+    float       velocity;               /* velocity estimate, edges/tick */
+    uint32_t    edge_ticks;             /* ticks since the count changed */
+    uint32_t    valid;                  /* observer has been seeded      */
+} QEIOBS;
+
+/* Online reel inertia identification (recursive least squares). The
+ * parameters share the units of the reel inertia model in SYSPARMS: DAC
+ * counts of torque and reel velocity in QEI counts per period. The two
+ * drag terms are fitted so they don't bias the inertia but aren't
+ * published, they lump the head block drag in with the reel friction.
+ */
+
+#define REEL_ID_PARMS           4       /* reel, pack, drag, drag/vel    */
+
+typedef struct _REELIDENT
+{
+    float       reel_inertia;           /* empty reel + rotor inertia    */
+    float       pack_inertia;           /* tape pack inertia per r^4     */
+    float       inertia_supply;         /* supply inertia at its radius  */
+    float       inertia_takeup;         /* takeup inertia at its radius  */
+    float       theta[REEL_ID_PARMS];   /* parameter estimate            */
+    float       p[REEL_ID_PARMS][REEL_ID_PARMS]; /* estimate covariance  */
+    float       p_max;                  /* covariance trace limit        */
+    float       torque_f;               /* filtered torque balance       */
+    float       velocity_supply_f;      /* filtered supply velocity      */
+    float       velocity_takeup_f;      /* filtered takeup velocity      */
+    float       unit_f;                 /* filtered constant regressor   */
+    float       radius_sq_f;            /* steady speed rs^2 + rt^2      */
+    float       noise;                  /* residual variance estimate    */
+    float       sigma_inertia;          /* worst relative std of inertia */
+    float       window_parms[2];        /* inertias at the start of the  */
+                                        /* steady window                 */
+    uint32_t    window;                 /* excited samples in the window */
+    uint32_t    steady_inertia;         /* inertia held over last window */
+    uint32_t    warmup;                 /* ticks since filters seeded    */
+    uint32_t    samples;                /* accelerating samples used     */
+    uint32_t    valid;                  /* inertia estimate has converged*/
+} REELIDENT;
+
+/* Shuttle velocity profile generator state */
+
+typedef struct _VPROFILE
+{
+    float       velocity;               /* profiled velocity setpoint    */
+    float       accel;                  /* current accel (velocity/sec)  */
+} VPROFILE;
+
+/* Reel motor current sense and inner torque loop. The measured current is
+ * scaled to DAC torque counts, so it compares directly with the torque the
+ * servo modes command.
+ */
+
+typedef struct _CURRENTLOOP
+{
+    float       current;                /* measured current (DAC units)  */
+    float       reference;              /* torque commanded last tick    */
+    float       iState;                 /* integrator correction (DAC)   */
+    float       cutback;                /* overcurrent torque cutback    */
+    uint32_t    overcurrent;            /* ticks over the current limit  */
+} CURRENTLOOP;
+
 /* Reel Torque Motor Servo Data */
 
 typedef struct _SERVODATA
@@ -236,13 +366,28 @@ typedef struct _SERVODATA
 	float		velocity_supply;		/* supply tach count per sample  */
 	float 		velocity_takeup;    	/* takeup tach count per sample  */
 	float		tape_tach;				/* tape roller tachometer        */
+	float		tape_accel;				/* tape roller tach per second   */
 	float		radius_takeup;			/* takeup reel reeling radius    */
     float       radius_takeup_accum;    /* takeup radius accumulator     */
 	float		radius_supply;			/* supply reel reeling radius    */
     float       radius_supply_accum;    /* supply radius accumulator     */
+    float       radius_takeup_avg;      /* 1 sec avg takeup radius       */
+    float       radius_supply_avg;      /* 1 sec avg supply radius       */
+    float       offset_null_avg;        /* 1 sec avg null offset         */
+    QEIOBS      obs_supply;             /* supply velocity observer      */
+    QEIOBS      obs_takeup;             /* takeup velocity observer      */
+    REELEST     est_radius_takeup;      /* takeup radius estimator       */
+    REELEST     est_radius_supply;      /* supply radius estimator       */
+    REELEST     est_offset;             /* null offset estimator         */
+    REELIDENT   reel_ident;             /* reel inertia identification   */
 	float		stop_torque_supply;		/* stop mode supply null         */
 	float		stop_torque_takeup;		/* stop mode takeup null         */
 	int32_t		stop_brake_state;		/* stop servo dynamic brake state*/
+    float       stop_brake_decel;       /* model brake tape decel        */
+    uint32_t    stop_brake_ticks;       /* ticks braking this stop       */
+    float       stop_velocity;          /* velocity at start of last stop*/
+    uint32_t    stop_time;              /* last stop brake time (ms)     */
+    uint32_t    stop_count;             /* dynamic stops completed       */
 	uint32_t	offset_sample_cnt;
 	float		offset_null;       		/* takeup/supply tach difference */
 	float		offset_null_accum;
@@ -252,26 +397,207 @@ typedef struct _SERVODATA
     int32_t		play_boost_end;			/* tape velocity to exit boost   */
     float		play_supply_tension;
     float		play_takeup_tension;
-    uint32_t    shuttle_velocity;
+    float       play_ref_velocity;      /* play boost reference tape speed */
+    float       play_boost_ff;          /* play boost takeup feedforward  */
+    bool        play_ff_active;         /* feedforward running this boost */
+    uint32_t    shuttle_velocity;       /* shuttle target velocity       */
+    VPROFILE    shuttle_profile;        /* shuttle velocity setpoint     */
+    float       shuttle_pgain;          /* scheduled shuttle PID gains   */
+    float       shuttle_igain;
+    float       shuttle_dgain;
+    int32_t     tape_position;          /* tape position in tach edges   */
+    int32_t     locate_target;          /* locate target position        */
+    uint32_t    locate_state;           /* LOCATE_xxx state              */
 	uint32_t	qei_takeup_error_cnt;
 	uint32_t	qei_supply_error_cnt;
     uint32_t	adc[8];					/* ADC values (tension, etc)     */
     float		tsense;					/* tension sensor value 		 */
+    float       tsense_raw;             /* tension sensor before filter  */
+    BIQUAD      tension_filter[TFILT_STAGES]; /* tension sensor filter  */
+    int32_t     tension_preset;         /* preset the filter is set for  */
+    float       tension_coeff[TFILT_STAGES][BIQUAD_COEFFS]; /* loaded    */
+    uint32_t    tension_unstable;       /* custom sections refused (bits)*/
     float		cpu_temp;				/* CPU temp included in ADC read */
     float       cpu_temp_accum;         /* CPU temp accumulator for avg  */
     uint32_t    cpu_temp_cnt;
     float		dac_takeup;				/* current takeup DAC level      */
     float		dac_supply;				/* current supply DAC level      */
+    CURRENTLOOP current_supply;         /* supply motor current loop     */
+    CURRENTLOOP current_takeup;         /* takeup motor current loop     */
+    float       dac_residue_supply;     /* DAC dither error carried over */
+    float       dac_residue_takeup;     /* DAC dither error carried over */
     uint32_t 	dac_halt_supply;		/* halt mode DAC level           */
     uint32_t	dac_halt_takeup;		/* halt mode DAC level           */
-	FPID		pid_shuttle;			/* PID for shuttle velocity ctrl */
-	FPID		pid_play;				/* PID for play mode boost stage */
+	PID_TYPE(PID_SHUTTLE_ENGINE) pid_shuttle; /* shuttle velocity ctrl PID */
+	PID_TYPE(PID_PLAY_ENGINE)    pid_play;    /* play mode boost stage PID  */
 	/*** Debug Variables ***/
 	float 		db_cv;
 	float 		db_error;
 	float		db_debug;
 } SERVODATA;
 
+/* Tape locate states, the servo loop profiles the shuttle velocity */
+
+#define LOCATE_IDLE             0       /* no locate in progress         */
+#define LOCATE_SHUTTLE          1       /* decelerating toward target    */
+#define LOCATE_APPROACH         2       /* final approach velocity       */
+#define LOCATE_DONE             3       /* at target, velocity zero      */
+
+/* Servo Loop Timing Statistics */
+
+#define SERVO_HIST_BINS         16      /* bins in each timing histogram */
+#define SERVO_HIST_PERIOD_BASE  1600    /* first period bin start (usec) */
+#define SERVO_HIST_PERIOD_WIDTH 50      /* period bin width (usec)       */
+#define SERVO_HIST_EXEC_WIDTH   50      /* exec time bin width (usec)    */
+
+typedef struct _SERVOTIMING
+{
+    uint32_t    ticks;                  /* servo ticks measured          */
+    uint32_t    overruns;               /* periods over 1.5x nominal     */
+    uint32_t    period_min;             /* min tick period (usec)        */
+    uint32_t    period_max;             /* max tick period (usec)        */
+    uint32_t    exec_min;               /* min loop exec time (usec)     */
+    uint32_t    exec_max;               /* max loop exec time (usec)     */
+    uint32_t    period_hist[SERVO_HIST_BINS];
+    uint32_t    exec_hist[SERVO_HIST_BINS];
+} SERVOTIMING;
+
+/* Servo Loop Stage Profile (CPU cycles) */
+
+#define SERVO_STAGE_TACH        0       /* tape roller tach read         */
+#define SERVO_STAGE_QEI         1       /* reel QEI velocity/direction   */
+#define SERVO_STAGE_ADC         2       /* ADC read, temp and tension    */
+#define SERVO_STAGE_RADIUS      3       /* reel radius and offset math   */
+#define SERVO_STAGE_DISPATCH    4       /* mode handler less DAC write   */
+#define SERVO_STAGE_DAC         5       /* motor DAC write               */
+#define SERVO_STAGE_TOTAL       6       /* whole servo tick              */
+
+#define SERVO_NUM_STAGES        7
+
+typedef struct _SERVOSTAGE
+{
+    uint32_t    min;                    /* min cycles                    */
+    uint32_t    max;                    /* max cycles                    */
+    uint32_t    mean;                   /* mean cycles                   */
+} SERVOSTAGE;
+
+typedef struct _SERVOPROFILE
+{
+    uint32_t    ticks;                  /* servo ticks profiled          */
+    uint32_t    cpu_freq;               /* cycle counter freq (Hz)       */
+    SERVOSTAGE  stage[SERVO_NUM_STAGES];
+    uint32_t    worst_tick;             /* tick number of the worst case */
+    uint32_t    worst_mode;             /* servo mode at the worst case  */
+    uint32_t    worst[SERVO_NUM_STAGES];/* stage cycles of worst tick    */
+} SERVOPROFILE;
+
+/* Servo Capture Buffer */
+
+#define CAP_BUF_WORDS           1024    /* capture ring size in words    */
+
+/* Capture channel bits for CAPTURE_CONFIG.channels */
+#define CAP_CH_DAC_SUPPLY       0x0001  /* supply motor DAC level        */
+#define CAP_CH_DAC_TAKEUP       0x0002  /* takeup motor DAC level        */
+#define CAP_CH_VEL_SUPPLY       0x0004  /* supply reel velocity          */
+#define CAP_CH_VEL_TAKEUP       0x0008  /* takeup reel velocity          */
+#define CAP_CH_RAD_SUPPLY       0x0010  /* supply reeling radius         */
+#define CAP_CH_RAD_TAKEUP       0x0020  /* takeup reeling radius         */
+#define CAP_CH_TAPE_TACH        0x0040  /* tape roller tach              */
+#define CAP_CH_TENSION          0x0080  /* tension sensor                */
+#define CAP_CH_VELOCITY         0x0100  /* summed reel velocity          */
+#define CAP_CH_PID_CV           0x0200  /* active PID CV output          */
+#define CAP_CH_PID_ERROR        0x0400  /* active PID error              */
+#define CAP_CH_MODE             0x0800  /* servo mode                    */
+
+#define CAP_NUM_CHANNELS        12
+#define CAP_CH_MASK             0x0FFF
+#define CAP_CH_DEFAULT          0x00FF
+
+/* Capture trigger bits for CAPTURE_CONFIG.trigger */
+#define CAP_TRIG_MODE           0x0001  /* on any servo mode change      */
+#define CAP_TRIG_TENSION_ABOVE  0x0002  /* tension rises above level     */
+#define CAP_TRIG_TENSION_BELOW  0x0004  /* tension falls below level     */
+#define CAP_TRIG_VELOCITY_ABOVE 0x0008  /* velocity rises above level    */
+#define CAP_TRIG_VELOCITY_BELOW 0x0010  /* velocity falls below level    */
+#define CAP_TRIG_MANUAL         0x0080  /* Capture_Trigger(), always on  */
+
+/* Capture states for CAPTURE_STATUS.state */
+#define CAP_STATE_IDLE          0       /* not armed                     */
+#define CAP_STATE_ARMED         1       /* recording, waiting trigger    */
+#define CAP_STATE_TRIGGERED     2       /* recording post-trigger        */
+#define CAP_STATE_DONE          3       /* capture complete, frozen      */
+
+typedef struct _CAPTURE_CONFIG
+{
+    uint32_t    channels;               /* CAP_CH_xxx channel set        */
+    uint32_t    trigger;                /* CAP_TRIG_xxx conditions       */
+    uint32_t    decimation;             /* store every Nth servo tick    */
+    uint32_t    pretrigger;             /* samples kept before trigger   */
+    float       tension_level;          /* tension trigger level         */
+    float       velocity_level;         /* velocity trigger level        */
+} CAPTURE_CONFIG;
+
+typedef struct _CAPTURE_STATUS
+{
+    uint32_t    state;                  /* CAP_STATE_xxx                 */
+    uint32_t    channels;               /* channel set captured          */
+    uint32_t    num_channels;           /* words per sample              */
+    uint32_t    capacity;               /* max samples for channel set   */
+    uint32_t    samples;                /* valid samples in buffer       */
+    uint32_t    trigger_index;          /* sample index of the trigger   */
+    uint32_t    trigger_cause;          /* CAP_TRIG_xxx that fired       */
+    uint32_t    sequence;               /* completed capture count       */
+} CAPTURE_STATUS;
+
+/* Relay Feedback Autotune */
+
+/* Loops for AUTOTUNE_CONFIG.loop */
+#define TUNE_LOOP_NONE          0
+#define TUNE_LOOP_SHUTTLE       1       /* shuttle reel velocity PID     */
+#define TUNE_LOOP_PLAY          2       /* play boost tape tach PI       */
+
+/* Tuning rules for Autotune_Gains() */
+#define TUNE_RULE_ZN_PID        0       /* Ziegler-Nichols PID           */
+#define TUNE_RULE_ZN_PI         1       /* Ziegler-Nichols PI            */
+#define TUNE_RULE_TL_PI         2       /* Tyreus-Luyben PI              */
+#define TUNE_RULE_NO_OVERSHOOT  3       /* Ziegler-Nichols no overshoot  */
+#define TUNE_NUM_RULES          4
+
+/* Autotune states for AUTOTUNE_STATUS.state */
+#define TUNE_STATE_IDLE         0       /* not running                   */
+#define TUNE_STATE_SETTLE       1       /* run up and relay bias settle  */
+#define TUNE_STATE_RELAY        2       /* relay oscillation running     */
+#define TUNE_STATE_DONE         3       /* Ku and Tu identified          */
+#define TUNE_STATE_FAILED       4       /* aborted, see fault            */
+
+/* Autotune faults for AUTOTUNE_STATUS.fault */
+#define TUNE_FAULT_NONE         0
+#define TUNE_FAULT_TIMEOUT      1       /* no result within the timeout  */
+#define TUNE_FAULT_LIMIT        2       /* overspeed, or no oscillation  */
+
+typedef struct _AUTOTUNE_CONFIG
+{
+    uint32_t    loop;                   /* TUNE_LOOP_xxx to identify     */
+    float       setpoint;               /* relay switching setpoint      */
+    float       amplitude;              /* relay amplitude (DAC)         */
+    float       hysteresis;             /* relay switching hysteresis    */
+    float       limit;                  /* max excursion above setpoint  */
+    uint32_t    cycles;                 /* oscillation cycles to average */
+    uint32_t    timeout;                /* servo ticks before giving up  */
+} AUTOTUNE_CONFIG;
+
+typedef struct _AUTOTUNE_STATUS
+{
+    uint32_t    state;                  /* TUNE_STATE_xxx                */
+    uint32_t    fault;                  /* TUNE_FAULT_xxx                */
+    uint32_t    cycles;                 /* relay cycles completed        */
+    uint32_t    ticks;                  /* servo ticks since start       */
+    float       bias;                   /* PID output held at setpoint   */
+    float       amplitude;              /* oscillation amplitude (peak)  */
+    float       ku;                     /* ultimate gain                 */
+    float       tu;                     /* ultimate period (sec)         */
+} AUTOTUNE_STATUS;
+
 /*** Macros & Function Prototypes ******************************************/
 
 /* main.c */
@@ -46,6 +46,7 @@
 #include <inc/hw_gpio.h>
 #include <inc/hw_ssi.h>
 #include <inc/hw_i2c.h>
+#include <inc/hw_adc.h>
 
 #include <driverlib/gpio.h>
 #include <driverlib/flash.h>
@@ -64,6 +65,7 @@
 #include <driverlib/udma.h>
 #include <driverlib/adc.h>
 #include <driverlib/qei.h>
+#include <driverlib/timer.h>
 
 #include "DTC1200_TivaTM4C123AE6PMI.h"
 
@@ -81,7 +83,7 @@
 #elif defined(__GNUC__)
 __attribute__ ((aligned (1024)))
 #endif
-static tDMAControlTable dmaControlTable[32];
+static tDMAControlTable dmaControlTable[64];    /* primary and alternate */
 static bool dmaInitialized = false;
 
 /* Hwi_Struct used in the initDMA Hwi_construct call */
@@ -726,14 +728,73 @@ void DTC1200_initWatchdog(void)
 
 /*
  *  ======== DTC1200_initADC ========
+ *
+ *  Sequencer 0 is triggered from TIMER2 at ADC_TRIGGER_RATE, a multiple of
+ *  the servo loop rate, with each step averaged in hardware. The uDMA moves
+ *  the results in ping-pong mode into two blocks of ADC_SEQ_PER_BLOCK
+ *  sequences each, one block per servo tick. While the uDMA fills one block
+ *  the servo loop reads the other, so it never waits on a conversion.
  */
 
 #define SAMPLE_SEQUENCER	0		/* up to 8 samples for sequencer 0 */
+#define SAMPLE_STEPS		5		/* steps in the sample sequence    */
+
+#define ADC_SEQ_PER_BLOCK	4		/* sequences per servo tick        */
+#define ADC_TRIGGER_RATE	(500 * ADC_SEQ_PER_BLOCK)	/* 2kHz trigger */
+#define ADC_HW_OVERSAMPLE	16		/* hardware average per step       */
+
+#define ADC_BLOCK_SIZE		(SAMPLE_STEPS * ADC_SEQ_PER_BLOCK)
+
+static uint32_t s_adcBlock[2][ADC_BLOCK_SIZE];
+
+/* Index of the last block filled and a count of blocks filled */
+static volatile uint32_t s_adcReady = 0;
+static volatile uint32_t s_adcCount = 0;
+
+/* Hwi_Struct used in the initADC Hwi_construct call */
+static Hwi_Struct adcHwiStruct;
+
+/*
+ *  ======== adcDmaHwi ========
+ *
+ *  The sequencer interrupt is raised when the uDMA has filled a block.
+ *  The uDMA has already moved on to the other block, so the one just
+ *  filled is handed to the servo loop and the control structure for it
+ *  is set up again for the next pass.
+ */
+static Void adcDmaHwi(UArg arg)
+{
+    uint32_t block;
+
+    ADCIntClear(ADC0_BASE, SAMPLE_SEQUENCER);
+
+    for (block=0; block < 2; block++)
+    {
+        uint32_t select = block ? UDMA_ALT_SELECT : UDMA_PRI_SELECT;
+
+        if (uDMAChannelModeGet(UDMA_CHANNEL_ADC0 | select) != UDMA_MODE_STOP)
+            continue;
+
+        s_adcReady = block;
+        s_adcCount++;
+
+        uDMAChannelTransferSet(UDMA_CHANNEL_ADC0 | select, UDMA_MODE_PINGPONG,
+                               (void *)(ADC0_BASE + ADC_O_SSFIFO0),
+                               s_adcBlock[block], ADC_BLOCK_SIZE);
+    }
+}
 
 void DTC1200_initADC(void)
 {
+    Error_Block eb;
+    Hwi_Params  hwiParams;
+
+    /* The uDMA moves the samples, make sure it's running */
+    DTC1200_initDMA();
+
 	/* The ADC0 peripheral must be enabled for use. */
     SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
 
     // Enable pin PE3 for ADC AIN0
     GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_3);
@@ -747,37 +808,81 @@ void DTC1200_initADC(void)
 	/* The ADC0 peripheral speed. */
 	//SysCtlADCSpeedSet(SYSCTL_ADCSPEED_250KSPS);
 
-	/* Enable sample sequence 0 with a processor signal trigger. Sequence 0
-	 * will do 5 samples when the processor sends a signal to start the
-	 * conversion. Each ADC module has 4 programmable sequences, sequence 0
-	 * to sequence 3. This example is arbitrarily using sequence 0.
+	/* Average 16 conversions in hardware for every step. At 1 Msps the
+	 * 5 steps take 80us, well inside the trigger period.
+	 */
+	ADCHardwareOversampleConfigure(ADC0_BASE, ADC_HW_OVERSAMPLE);
+
+	/* Enable sample sequence 0 with a timer trigger. Sequence 0 will do
+	 * 5 samples each time TIMER2 times out. Each ADC module has 4
+	 * programmable sequences, sequence 0 to sequence 3.
 	 */
-	ADCSequenceConfigure(ADC0_BASE, SAMPLE_SEQUENCER, ADC_TRIGGER_PROCESSOR, 0);
+	ADCSequenceDisable(ADC0_BASE, SAMPLE_SEQUENCER);
+	ADCSequenceConfigure(ADC0_BASE, SAMPLE_SEQUENCER, ADC_TRIGGER_TIMER, 0);
 
 	/* Configure the step sequence sources. Here we are using sample
 	 * sequence zero since it supports up to eight steps. Steps 0-3
 	 * are mapped to the four ADC input pins and step 4 is mapped.
-	 * to the internal cpu temp sensor.
+	 * to the internal cpu temp sensor. Every step requests a uDMA
+	 * transfer, so each has the interrupt enable bit set.
 	 */
 
 	/* Step[0] ADC2 - Tension Sensor Arm */
-	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 0, ADC_CTL_CH2);
+	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 0, ADC_CTL_CH2 | ADC_CTL_IE);
 	/* Step[1] ADC0 - Supply Motor Current Option */
-	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 1, ADC_CTL_CH0);
+	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 1, ADC_CTL_CH0 | ADC_CTL_IE);
 	/* Step[2] ADC1 - Takeup Motor Current Option */
-	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 2, ADC_CTL_CH1);
+	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 2, ADC_CTL_CH1 | ADC_CTL_IE);
 	/* Step[3] ADC3 - Expansion Port ADC input option */
-	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 3, ADC_CTL_CH3);
+	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 3, ADC_CTL_CH3 | ADC_CTL_IE);
 	/* Step[4] Internal CPU temperature sensor */
 	ADCSequenceStepConfigure(ADC0_BASE, SAMPLE_SEQUENCER, 4, ADC_CTL_TS | ADC_CTL_IE | ADC_CTL_END);
 
+	/* Ping-pong the FIFO into the two sample blocks, one word per request */
+    uDMAChannelAssign(UDMA_CH14_ADC0_0);
+
+    uDMAChannelAttributeDisable(UDMA_CHANNEL_ADC0,
+                                UDMA_ATTR_ALTSELECT | UDMA_ATTR_HIGH_PRIORITY |
+                                UDMA_ATTR_REQMASK | UDMA_ATTR_USEBURST);
+
+    uDMAChannelControlSet(UDMA_CHANNEL_ADC0 | UDMA_PRI_SELECT,
+                          UDMA_SIZE_32 | UDMA_SRC_INC_NONE | UDMA_DST_INC_32 | UDMA_ARB_1);
+    uDMAChannelControlSet(UDMA_CHANNEL_ADC0 | UDMA_ALT_SELECT,
+                          UDMA_SIZE_32 | UDMA_SRC_INC_NONE | UDMA_DST_INC_32 | UDMA_ARB_1);
+
+    uDMAChannelTransferSet(UDMA_CHANNEL_ADC0 | UDMA_PRI_SELECT, UDMA_MODE_PINGPONG,
+                           (void *)(ADC0_BASE + ADC_O_SSFIFO0),
+                           s_adcBlock[0], ADC_BLOCK_SIZE);
+    uDMAChannelTransferSet(UDMA_CHANNEL_ADC0 | UDMA_ALT_SELECT, UDMA_MODE_PINGPONG,
+                           (void *)(ADC0_BASE + ADC_O_SSFIFO0),
+                           s_adcBlock[1], ADC_BLOCK_SIZE);
+
+    uDMAChannelEnable(UDMA_CHANNEL_ADC0);
+
+    /* Block completion comes in on the sequencer interrupt */
+    Error_init(&eb);
+    Hwi_Params_init(&hwiParams);
+    Hwi_construct(&(adcHwiStruct), INT_ADC0SS0, adcDmaHwi, &hwiParams, &eb);
+    if (Error_check(&eb)) {
+        System_abort("Couldn't construct ADC hwi");
+    }
+
 	/* Since sample sequence 0 is now configured, it must be enabled. */
+    ADCSequenceDMAEnable(ADC0_BASE, SAMPLE_SEQUENCER);
 	ADCSequenceEnable(ADC0_BASE, SAMPLE_SEQUENCER);
 
 	/* Clear the interrupt status flag.  This is done to make sure the
 	 * interrupt flag is cleared before we sample.
 	 */
 	ADCIntClear(ADC0_BASE, SAMPLE_SEQUENCER);
+	ADCIntEnable(ADC0_BASE, SAMPLE_SEQUENCER);
+
+	/* TIMER2 triggers the sequence at a multiple of the servo rate */
+    TimerDisable(TIMER2_BASE, TIMER_A);
+    TimerConfigure(TIMER2_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(TIMER2_BASE, TIMER_A, (SysCtlClockGet() / ADC_TRIGGER_RATE) - 1);
+    TimerControlTrigger(TIMER2_BASE, TIMER_A, true);
+    TimerEnable(TIMER2_BASE, TIMER_A);
 }
 
 /*
@@ -794,23 +899,41 @@ void DTC1200_initADC(void)
  *   ulBuffer[2] = Takeup motor current reading (future option)
  *   ulBuffer[3] = Expansion port ADC reading   (future option)
  *   ulBuffer[4] = Internal CPU temperature reading.
+ *
+ * Each value is the average of the sequences in the last block filled,
+ * so this returns at once with the readings over the last servo period.
+ * Zero is returned until the first block has been filled.
  */
 
 int32_t DTC1200_readADC(uint32_t* pui32Buffer)
 {
-    /* Trigger the ADC conversion */
-    ADCProcessorTrigger(ADC0_BASE, SAMPLE_SEQUENCER);
+    uint32_t i;
+    uint32_t step;
+    uint32_t count;
+    uint32_t sum[SAMPLE_STEPS];
+    const uint32_t* block;
 
-    /* Wait for conversion to be completed */
-    while(!ADCIntStatus(ADC0_BASE, SAMPLE_SEQUENCER, false))
-    {
-    }
+    do {
+        count = s_adcCount;
 
-    /* Clear the ADC interrupt flag */
-    ADCIntClear(ADC0_BASE, SAMPLE_SEQUENCER);
+        if (!count)
+            return 0;
+
+        block = s_adcBlock[s_adcReady];
+
+        for (step=0; step < SAMPLE_STEPS; step++)
+            sum[step] = 0;
+
+        for (i=0; i < ADC_BLOCK_SIZE; i++)
+            sum[i % SAMPLE_STEPS] += block[i] & ADC_MAX;
+
+        /* Go again if the uDMA came back around to this block */
+    } while (count != s_adcCount);
+
+    for (step=0; step < SAMPLE_STEPS; step++)
+        pui32Buffer[step] = (sum[step] + (ADC_SEQ_PER_BLOCK / 2)) / ADC_SEQ_PER_BLOCK;
 
-    /* Read ADC Values and return count */
-    return ADCSequenceDataGet(ADC0_BASE, SAMPLE_SEQUENCER, pui32Buffer);
+    return SAMPLE_STEPS;
 }
 
 /* End-Of-File */
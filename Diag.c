@@ -72,10 +72,13 @@
 //#include "Utils.h"
 #include "ServoTask.h"
 #include "TransportTask.h"
+#include "ServoCapture.h"
+#include "ServoAutotune.h"
 #include "TerminalTask.h"
 #include "Diag.h"
 
 #include "IOExpander.h"
+#include "MotorDAC.h"
 #include "tty.h"
 
 /* Static Data Items */
@@ -199,7 +202,83 @@ int diag_dac_adjust(MENUITEM* mp)
 }
 
 /*
- * This ramps the DAC's on the takeup and supply reel motors.
+ * This sweeps the DAC codes on both reel motors with the brakes holding the
+ * reels, so the motors stall and the current sensed is the torque without
+ * any back-EMF. The torque measured at each code builds the calibration
+ * tables used with SF_DAC_LINEARIZE. The tables are kept in the system
+ * parameters and saved with them.
+ */
+
+#define DAC_CAL_STEPS       33          /* codes swept over 0-DAC_MAX    */
+#define DAC_CAL_SETTLE      40          /* ms at each code before reading */
+#define DAC_CAL_SAMPLES     10          /* current readings averaged     */
+
+static bool dac_calibrate(void)
+{
+    int i, n;
+    bool ok;
+    float supply[DAC_CAL_STEPS];
+    float takeup[DAC_CAL_STEPS];
+
+    /* Hold the reels so the motors stall */
+    SetTransportMask(T_BRAKE, 0);
+
+    tty_printf("Calibrating ");
+
+    for (i=0; i < DAC_CAL_STEPS; i++)
+    {
+        uint32_t code = (uint32_t)((i * DAC_MAX) / (DAC_CAL_STEPS - 1));
+
+        g_servo.dac_halt_takeup = g_servo.dac_halt_supply = code;
+
+        Task_sleep(DAC_CAL_SETTLE);
+
+        supply[i] = takeup[i] = 0.0f;
+
+        /* One current reading per servo tick */
+        for (n=0; n < DAC_CAL_SAMPLES; n++)
+        {
+            supply[i] += g_servo.current_supply.current;
+            takeup[i] += g_servo.current_takeup.current;
+            Task_sleep(2);
+        }
+
+        supply[i] /= (float)DAC_CAL_SAMPLES;
+        takeup[i] /= (float)DAC_CAL_SAMPLES;
+
+        if ((i % 4) == 0)
+            tty_printf(".");
+    }
+
+    g_servo.dac_halt_takeup = g_servo.dac_halt_supply = DAC_MIN;
+
+    ok = MotorDAC_buildCal(supply, DAC_CAL_STEPS, g_sys.dac_cal_supply) &&
+         MotorDAC_buildCal(takeup, DAC_CAL_STEPS, g_sys.dac_cal_takeup);
+
+    if (ok)
+    {
+        g_sys.sysflags |= SF_DAC_LINEARIZE;
+
+        tty_printf(" done, zero torque at %.0f/%.0f, full at %.0f/%.0f\r\n",
+                   g_sys.dac_cal_supply[0], g_sys.dac_cal_takeup[0],
+                   g_sys.dac_cal_supply[DAC_CAL_POINTS - 1],
+                   g_sys.dac_cal_takeup[DAC_CAL_POINTS - 1]);
+    }
+    else
+    {
+        tty_printf(" failed, no motor current sensed (%.0f/%.0f at full scale)\r\n",
+                   supply[DAC_CAL_STEPS - 1], takeup[DAC_CAL_STEPS - 1]);
+    }
+
+    /* Back to the ramp with the brakes released */
+    SetTransportMask(0, T_BRAKE);
+
+    return ok;
+}
+
+/*
+ * This ramps the DAC's on the takeup and supply reel motors, showing the
+ * motor current sensed at each level. 'C' runs the DAC calibration sweep.
  */
  
 int diag_dac_ramp(MENUITEM* mp)
@@ -223,11 +302,15 @@ int diag_dac_ramp(MENUITEM* mp)
 
         while(1)
         {
-            tty_printf("DAC A/B level: %-4.4u (<ESC> or 'u'=up, 'd'=down)\r\n", dac);
-
             g_servo.dac_halt_takeup = (unsigned long)dac;
             g_servo.dac_halt_supply = (unsigned long)dac;
 
+            /* Let the motor current settle at the new level */
+            Task_sleep(DAC_CAL_SETTLE);
+
+            tty_printf("DAC A/B level: %-4.4u current %4.0f/%-4.0f (<ESC>, 'u'=up, 'd'=down, 'c'=calibrate)\r\n",
+                       dac, g_servo.current_supply.current, g_servo.current_takeup.current);
+
             if (dac >= DAC_MAX)
             	dac = 0;
 
@@ -244,6 +327,11 @@ int diag_dac_ramp(MENUITEM* mp)
             	--dac;
             else if (ch == 'D')
             	dac -= 10;
+            else if (toupper(ch) == 'C')
+            {
+            	dac_calibrate();
+            	dac = DAC_MIN;
+            }
             else
             	++dac;
 
@@ -466,6 +554,331 @@ int diag_servo(MENUITEM* mp)
     return 1;
 }
 
+//*****************************************************************************
+// Relay feedback autotune of the shuttle velocity PID or the play boost PI.
+// The step response is measured with the current gains, the loop is then
+// identified with a relay experiment in FWD mode and the step repeated with
+// the gains from the selected rule. The tuned gains are only kept if they
+// are saved at the end, otherwise the current gains are put back.
+//*****************************************************************************
+
+#define TUNE_STEP_MS        4000        /* step response window (ms)     */
+#define TUNE_STEP_BAND      0.02f       /* settling band, setpoint frac  */
+#define TUNE_STOP_MS        15000       /* max wait for motion to stop   */
+
+typedef struct _STEPRESULT {
+    bool        settled;
+    uint32_t    settle_ms;              /* ms from the mode command      */
+    float       overshoot;              /* percent of the setpoint       */
+} STEPRESULT;
+
+static const char* s_tunestate[] = { "IDLE", "SETTLE", "RELAY", "DONE", "FAILED" };
+
+static const char* s_tunerule[TUNE_NUM_RULES] = {
+    "Ziegler-Nichols PID",
+    "Ziegler-Nichols PI",
+    "Tyreus-Luyben PI",
+    "Ziegler-Nichols No Overshoot"
+};
+
+static bool tune_stop(void)
+{
+    uint32_t ms;
+
+    QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_STOP, 0);
+
+    for (ms=0; ms < TUNE_STOP_MS; ms += 100)
+    {
+        Task_sleep(100);
+
+        if (Servo_IsMode(MODE_STOP) && !Servo_IsMotion())
+            return true;
+    }
+
+    return false;
+}
+
+static bool tune_step(uint32_t loop, float setpoint, STEPRESULT* res)
+{
+    uint32_t ms;
+    uint32_t last_out = 0;
+    bool ever_in = false;
+    float peak = 0.0f;
+    float pv;
+
+    if (loop == TUNE_LOOP_PLAY)
+        QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_PLAY, 0);
+    else
+        QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_FWD | M_NOSLOW, (uint16_t)setpoint);
+
+    for (ms=0; ms < TUNE_STEP_MS; ms += 10)
+    {
+        Task_sleep(10);
+
+        pv = (loop == TUNE_LOOP_PLAY) ? g_servo.tape_tach : g_servo.velocity;
+
+        if (pv > peak)
+            peak = pv;
+
+        if (fabsf(pv - setpoint) > (setpoint * TUNE_STEP_BAND))
+            last_out = ms + 10;
+        else
+            ever_in = true;
+    }
+
+    res->settled   = ever_in && (last_out < TUNE_STEP_MS);
+    res->settle_ms = last_out;
+    res->overshoot = (peak > setpoint) ? (((peak - setpoint) / setpoint) * 100.0f) : 0.0f;
+
+    return tune_stop();
+}
+
+static void tune_get_gains(uint32_t loop, float* kp, float* ki, float* kd)
+{
+    if (loop == TUNE_LOOP_PLAY)
+    {
+        *kp = g_high_speed_flag ? g_sys.play_hi_boost_pgain : g_sys.play_lo_boost_pgain;
+        *ki = g_high_speed_flag ? g_sys.play_hi_boost_igain : g_sys.play_lo_boost_igain;
+        *kd = 0.0f;
+    }
+    else
+    {
+        *kp = g_sys.shuttle_servo_pgain;
+        *ki = g_sys.shuttle_servo_igain;
+        *kd = g_sys.shuttle_servo_dgain;
+    }
+}
+
+static void tune_set_gains(uint32_t loop, float kp, float ki, float kd)
+{
+    if (loop == TUNE_LOOP_PLAY)
+    {
+        /* The play boost is a PI, no D-gain */
+        if (g_high_speed_flag)
+        {
+            g_sys.play_hi_boost_pgain = kp;
+            g_sys.play_hi_boost_igain = ki;
+        }
+        else
+        {
+            g_sys.play_lo_boost_pgain = kp;
+            g_sys.play_lo_boost_igain = ki;
+        }
+    }
+    else
+    {
+        g_sys.shuttle_servo_pgain = kp;
+        g_sys.shuttle_servo_igain = ki;
+        g_sys.shuttle_servo_dgain = kd;
+    }
+}
+
+static void tune_print_step(const char* name, STEPRESULT* before, STEPRESULT* after)
+{
+    tty_printf("%-16s", name);
+
+    if (before->settled)
+        tty_printf("%9u ms %6.2f%%", before->settle_ms, before->overshoot);
+    else
+        tty_printf("%9s    %6.2f%%", "FAIL", before->overshoot);
+
+    if (after->settled)
+        tty_printf("%9u ms %6.2f%%\r\n", after->settle_ms, after->overshoot);
+    else
+        tty_printf("%9s    %6.2f%%\r\n", "FAIL", after->overshoot);
+}
+
+int diag_autotune(MENUITEM* mp)
+{
+    int ch;
+    int i;
+    uint32_t loop;
+    uint32_t rule;
+    uint32_t sysflags;
+    float setpoint;
+    float kp, ki, kd;
+    float old_kp, old_ki, old_kd;
+    bool ok;
+    AUTOTUNE_CONFIG config;
+    AUTOTUNE_STATUS status;
+    STEPRESULT before;
+    STEPRESULT after;
+
+    tty_cls();
+    tty_printf(s_startstr, mp->menutext);
+
+    if (!Servo_IsMode(MODE_STOP) || Servo_IsMotion() || g_tape_out_flag)
+    {
+        tty_printf("%sWARNING%s - Transport must be in STOP mode with tape threaded!!\r\n",
+                   VT100_UL_ON, VT100_UL_OFF);
+        wait4continue();
+        return 1;
+    }
+
+    tty_printf("%sWARNING%s - Transport will shuttle and play tape during the test!!\r\n\n",
+               VT100_UL_ON, VT100_UL_OFF);
+
+    tty_printf("Loop: 'S'=shuttle velocity PID, 'P'=play boost PI\r\n");
+
+    while (tty_getc(&ch) == 0);
+
+    if (toupper(ch) == 'S')
+        loop = TUNE_LOOP_SHUTTLE;
+    else if (toupper(ch) == 'P')
+        loop = TUNE_LOOP_PLAY;
+    else
+        return 1;
+
+    tty_printf("\r\nRule:\r\n");
+
+    for (i=0; i < TUNE_NUM_RULES; i++)
+        tty_printf("  %d - %s\r\n", i + 1, s_tunerule[i]);
+
+    while (tty_getc(&ch) == 0);
+
+    if ((ch < '1') || (ch >= ('1' + TUNE_NUM_RULES)))
+        return 1;
+
+    rule = (uint32_t)(ch - '1');
+
+    /* Relay experiment settings for the loop */
+    memset(&config, 0, sizeof(config));
+
+    config.loop    = loop;
+    config.cycles  = 4;
+    config.timeout = 15000;
+
+    if (loop == TUNE_LOOP_PLAY)
+    {
+        setpoint = (float)(g_high_speed_flag ? g_sys.play_hi_boost_end : g_sys.play_lo_boost_end);
+
+        config.amplitude  = setpoint * 0.4f;
+        config.hysteresis = 1.0f;
+    }
+    else
+    {
+        setpoint = (float)(g_sys.shuttle_velocity / 2);
+
+        config.amplitude  = 100.0f;
+        config.hysteresis = setpoint * 0.01f;
+    }
+
+    config.setpoint = setpoint;
+    config.limit    = setpoint * 0.5f;
+
+    /* The fixed gains are tuned, suspend any gain schedule */
+    sysflags = g_sys.sysflags;
+    g_sys.sysflags &= ~SF_GAIN_SCHEDULE;
+
+    tune_get_gains(loop, &old_kp, &old_ki, &old_kd);
+
+    tty_printf("\r\n%s %s, setpoint %.0f\r\n\n", (loop == TUNE_LOOP_PLAY) ? "Play boost" : "Shuttle",
+               s_tunerule[rule], setpoint);
+
+    /* Step response with the current gains */
+    tty_printf("Step response, current gains...\r\n");
+
+    ok = tune_step(loop, setpoint, &before);
+
+    if (ok)
+    {
+        /* Identify the loop with the relay */
+        if (loop == TUNE_LOOP_PLAY)
+            Servo_ResetPlay();
+
+        Autotune_Start(&config);
+
+        QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_FWD | M_NOSLOW,
+                              (loop == TUNE_LOOP_SHUTTLE) ? (uint16_t)setpoint : 0);
+
+        while (1)
+        {
+            Autotune_GetStatus(&status);
+
+            tty_printf("\rRelay %-7s cycles %2u bias %7.1f%s",
+                       s_tunestate[status.state], status.cycles, status.bias, VT100_ERASE_EOL);
+
+            if ((status.state == TUNE_STATE_DONE) || (status.state == TUNE_STATE_FAILED))
+                break;
+
+            /* Refresh four times per second (250ms tty read timeout) */
+            if (tty_getc(&ch) && (ch == ESC))
+                break;
+        }
+
+        Autotune_Stop();
+
+        ok = tune_stop() && (status.state == TUNE_STATE_DONE);
+
+        tty_printf("\r\n\n");
+
+        if (status.state == TUNE_STATE_FAILED)
+            tty_printf("Relay test failed - %s\r\n",
+                       (status.fault == TUNE_FAULT_TIMEOUT) ? "timeout" : "overspeed or no oscillation");
+    }
+
+    if (ok)
+    {
+        Autotune_Gains(rule, status.ku, status.tu, &kp, &ki, &kd);
+
+        if (loop == TUNE_LOOP_PLAY)
+            kd = 0.0f;
+
+        tty_printf("Ku %.3f  Tu %.3f sec  Amplitude %.2f  Bias %.1f\r\n\n",
+                   status.ku, status.tu, status.amplitude, status.bias);
+
+        /* Step response with the tuned gains */
+        tune_set_gains(loop, kp, ki, kd);
+
+        tty_printf("Step response, tuned gains...\r\n\n");
+
+        ok = tune_step(loop, setpoint, &after);
+
+        tty_printf("                  Current               Tuned\r\n");
+        tty_printf("P-Gain          %16.4f %19.4f\r\n", old_kp, kp);
+        tty_printf("I-Gain          %16.4f %19.4f\r\n", old_ki, ki);
+        tty_printf("D-Gain          %16.4f %19.4f\r\n", old_kd, kd);
+        tune_print_step("Settle/Overshoot", &before, &after);
+    }
+    else
+    {
+        tune_stop();
+    }
+
+    g_sys.sysflags = sysflags;
+
+    if (ok)
+    {
+        if (sysflags & SF_GAIN_SCHEDULE)
+            tty_printf("\r\nNOTE - Gain schedule is enabled, tuned gains are used when it is off\r\n");
+
+        tty_printf("\r\nSave tuned gains? (Y/N)");
+
+        while (tty_getc(&ch) == 0);
+
+        if (toupper(ch) == 'Y')
+        {
+            int32_t rc;
+
+            if ((rc = SysParamsWrite(&g_sys)) != 0)
+                tty_printf("\r\nERROR %d : Writing Config Parameters...\r\n", rc);
+            else
+                tty_printf("\r\nConfig parameters saved...\r\n");
+
+            wait4continue();
+
+            return 1;
+        }
+    }
+
+    /* Put the current gains back */
+    tune_set_gains(loop, old_kp, old_ki, old_kd);
+
+    wait4continue();
+
+    return 1;
+}
+
 /*
  * This routine blinks the lamps sequentially for testing.
  */
@@ -475,6 +888,7 @@ int diag_lamp(MENUITEM* mp)
     int i, ch;
     int loop = 1;
     unsigned char save_mask;
+    uint8_t switches, port;
     
     tty_cls();
     tty_printf(s_startstr, mp->menutext);
@@ -485,7 +899,7 @@ int diag_lamp(MENUITEM* mp)
     {
         for (i=0; i < sizeof(s_lamp)/sizeof(BITTAB); i++)
         {
-            tty_printf("\rlamp: %s", s_lamp[i].name);
+            tty_printf("\rlamp: %-8s", s_lamp[i].name);
         
             g_lamp_mask |= s_lamp[i].bit;
 
@@ -500,6 +914,12 @@ int diag_lamp(MENUITEM* mp)
             	}
             }
 
+            /* Read back the lamp port pins after the tty wait */
+            if (GetExpanderPorts(0, &switches, &port) == 0)
+                tty_printf(" port 0x%02X", port);
+            else
+                tty_printf(" port --  ");
+
             g_lamp_mask &= ~(s_lamp[i].bit);
         }
 
@@ -513,33 +933,357 @@ int diag_lamp(MENUITEM* mp)
     return 1;
 }
 
-#if (CAPDATA_SIZE > 0)
+/*
+ * This displays the servo loop tick period and execution time histograms.
+ * The display refreshes every second until a key is pressed.
+ */
+
+int diag_servo_timing(MENUITEM* mp)
+{
+    int i;
+    int ch;
+    int count = 0;
+    SERVOTIMING timing;
+
+    tty_cls();
+
+    while (1)
+    {
+        /* Refresh about once per second (250ms tty read timeout) */
+        if ((count++ % 4) == 0)
+        {
+            Servo_GetTiming(&timing);
+
+            tty_printf(VT100_HOME);
+            tty_printf(s_startstr, mp->menutext);
+            tty_printf("Ticks %-10u Overruns %-10u ('R'=reset)%s\r\n\n",
+                       timing.ticks, timing.overruns, VT100_ERASE_EOL);
+            tty_printf("Period min/max %4u/%-4u us   Exec min/max %4u/%-4u us%s\r\n\n",
+                       (timing.ticks) ? timing.period_min : 0, timing.period_max,
+                       (timing.ticks) ? timing.exec_min : 0, timing.exec_max,
+                       VT100_ERASE_EOL);
+            tty_printf("   Period us      Count       Exec us      Count\r\n");
+
+            for (i=0; i < SERVO_HIST_BINS; i++)
+            {
+                tty_printf("  %4u-%-4u %10u     %4u-%-4u %10u%s\r\n",
+                           SERVO_HIST_PERIOD_BASE + (i * SERVO_HIST_PERIOD_WIDTH),
+                           SERVO_HIST_PERIOD_BASE + ((i + 1) * SERVO_HIST_PERIOD_WIDTH),
+                           timing.period_hist[i],
+                           i * SERVO_HIST_EXEC_WIDTH,
+                           (i + 1) * SERVO_HIST_EXEC_WIDTH,
+                           timing.exec_hist[i],
+                           VT100_ERASE_EOL);
+            }
+        }
+
+        if (tty_getc(&ch) == 0)
+            continue;
+
+        if (toupper(ch) == 'R')
+        {
+            Servo_ResetTiming();
+            count = 0;
+            continue;
+        }
+
+        break;
+    }
+
+    return 1;
+}
+
+//*****************************************************************************
+// Servo loop per stage CPU cycle profile. Shows the min/max/mean cycles
+// and time for each stage of the servo tick, and the stage breakdown of
+// the worst case tick seen. The motor DAC and I/O expander SPI counters
+// are shown below it.
+//*****************************************************************************
+
+static const char* s_stagename[SERVO_NUM_STAGES] = {
+    "Tape Tach", "Reel QEI", "ADC Read", "Radius/Offset", "Mode Dispatch",
+    "Motor DAC", "Total"
+};
+
+int diag_servo_profile(MENUITEM* mp)
+{
+    int i;
+    int ch;
+    int count = 0;
+    uint32_t mhz;
+    SERVOPROFILE profile;
+    MOTORDAC_STATS dac;
+    IOEXPANDER_STATS iox;
+
+    tty_cls();
+
+    while (1)
+    {
+        /* Refresh about once per second (250ms tty read timeout) */
+        if ((count++ % 4) == 0)
+        {
+            Servo_GetProfile(&profile);
+            MotorDAC_getStats(&dac);
+            IOExpander_getStats(&iox);
+
+            mhz = profile.cpu_freq / 1000000;
+
+            if (!mhz)
+                mhz = 1;
+
+            tty_printf(VT100_HOME);
+            tty_printf(s_startstr, mp->menutext);
+            tty_printf("Ticks %-10u CPU %u MHz ('R'=reset)%s\r\n\n",
+                       profile.ticks, mhz, VT100_ERASE_EOL);
+            tty_printf("Stage              Min     Max    Mean   Mean us   Worst%s\r\n",
+                       VT100_ERASE_EOL);
+
+            for (i=0; i < SERVO_NUM_STAGES; i++)
+            {
+                tty_printf("%-14s %7u %7u %7u %9.2f %7u%s\r\n",
+                           s_stagename[i],
+                           (profile.ticks) ? profile.stage[i].min : 0,
+                           profile.stage[i].max,
+                           profile.stage[i].mean,
+                           (float)profile.stage[i].mean / (float)mhz,
+                           profile.worst[i],
+                           VT100_ERASE_EOL);
+            }
+
+            tty_printf("\r\nWorst case tick %u in mode %u, %.2f us of %u us%s\r\n",
+                       profile.worst_tick, profile.worst_mode,
+                       (float)profile.worst[SERVO_STAGE_TOTAL] / (float)mhz,
+                       SERVO_PERIOD_USEC, VT100_ERASE_EOL);
+
+            tty_printf("\r\nMotor DAC writes %u, unchanged %u, words %u%s\r\n",
+                       dac.writes, dac.unchanged, dac.words, VT100_ERASE_EOL);
+            tty_printf("Transfer %u us, max %u us, coalesced %u, errors %u%s\r\n",
+                       dac.xfer_usec, dac.xfer_max, dac.coalesced, dac.errors,
+                       VT100_ERASE_EOL);
+
+            tty_printf("\r\nI/O expander reads %u, writes %u, updates %u, coalesced %u%s\r\n",
+                       iox.reads, iox.writes, iox.updates, iox.coalesced,
+                       VT100_ERASE_EOL);
+            tty_printf("Read %u us, max %u us, write %u us, max %u us%s\r\n",
+                       iox.read_usec, iox.read_max, iox.write_usec, iox.write_max,
+                       VT100_ERASE_EOL);
+            tty_printf("Bus time %u us, unchanged %u, errors %u%s\r\n",
+                       iox.busy_usec, iox.unchanged, iox.errors, VT100_ERASE_EOL);
+        }
+
+        if (tty_getc(&ch) == 0)
+            continue;
+
+        if (toupper(ch) == 'R')
+        {
+            Servo_ResetProfile();
+            MotorDAC_resetStats();
+            IOExpander_resetStats();
+            count = 0;
+            continue;
+        }
+
+        break;
+    }
+
+    return 1;
+}
+
+//*****************************************************************************
+// Servo capture buffer status and dump. The capture is armed with the
+// current configuration (set over IPC) and dumped as CSV once complete.
+// The servo loop keeps running throughout.
+//*****************************************************************************
+
+static const char* s_capstate[] = { "IDLE", "ARMED", "TRIGGERED", "DONE" };
+
+static const char* s_capchan[CAP_NUM_CHANNELS] = {
+    "DacSup", "DacTkup", "VelSup", "VelTkup", "RadSup", "RadTkup",
+    "Tach", "Tens", "Vel", "CV", "Err", "Mode"
+};
+
+static void dump_capture(void)
+{
+    uint32_t i, n;
+    float sample[CAP_NUM_CHANNELS];
+    CAPTURE_STATUS status;
+
+    Capture_GetStatus(&status);
+
+    tty_printf("\r\nCapture Data (Count=%u, Trigger=%u, Seq=%u)\r\n",
+               status.samples, status.trigger_index, status.sequence);
+
+    tty_printf("Sample");
+
+    for (i=0; i < CAP_NUM_CHANNELS; i++)
+    {
+        if (status.channels & (1 << i))
+            tty_printf(",%s", s_capchan[i]);
+    }
+
+    tty_printf("\r\n");
+
+    for (i=0; i < status.samples; i++)
+    {
+        uint32_t words, sequence;
+
+        /* Stop if the capture was re-armed while dumping */
+        if (Capture_Read(i, 1, sample, CAP_NUM_CHANNELS, &words, &sequence) != 1)
+            break;
+
+        if ((sequence != status.sequence) || (words != status.num_channels))
+            break;
+
+        tty_printf("%d", (int)i - (int)status.trigger_index);
+
+        for (n=0; n < status.num_channels; n++)
+            tty_printf(",%.2f", sample[n]);
+
+        tty_printf("\r\n");
+    }
+}
+
 int diag_dump_capture(MENUITEM* mp)
 {
-	long i;
+    int ch;
+    int count = 0;
+    CAPTURE_CONFIG config;
+    CAPTURE_STATUS status;
 
     tty_cls();
-    tty_printf("Capture Data (Count=%d)\r\n", g_capdata_count);
-    tty_printf("Sample, DAC-Sup, DAC-Tkup, VelSup, VelTkup, RadSup, RadTkup, Tach, Tens\r\n");
 
-    for (i=0; i < CAPDATA_SIZE; i++)
+    while (1)
     {
-    	tty_printf("%u,%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\r\n",
-   			i,
-    		(uint32_t)g_capdata[i].dac_supply,
-    		(uint32_t)g_capdata[i].dac_takeup,
-    		g_capdata[i].vel_supply,
-    		g_capdata[i].vel_takeup,
-    		g_capdata[i].rad_supply,
-    		g_capdata[i].rad_takeup,
-    		g_capdata[i].tape_tach,
-    		g_capdata[i].tension);
+        /* Refresh about once per second (250ms tty read timeout) */
+        if ((count++ % 4) == 0)
+        {
+            Capture_GetConfig(&config);
+            Capture_GetStatus(&status);
+
+            tty_printf(VT100_HOME);
+            tty_printf(s_startstr, mp->menutext);
+            tty_printf("State %-10s Samples %4u/%-4u Trigger %4u Seq %u%s\r\n\n",
+                       s_capstate[status.state & 3],
+                       status.samples, status.capacity,
+                       status.trigger_index, status.sequence,
+                       VT100_ERASE_EOL);
+            tty_printf("Channels 0x%04x  Trigger 0x%02x  Cause 0x%02x  Decimation %u  Pre-trigger %u%s\r\n",
+                       config.channels, config.trigger, status.trigger_cause,
+                       config.decimation, config.pretrigger, VT100_ERASE_EOL);
+            tty_printf("Tension level %.2f  Velocity level %.2f%s\r\n\n",
+                       config.tension_level, config.velocity_level, VT100_ERASE_EOL);
+            tty_printf("'A'=arm, 'T'=trigger, 'S'=stop, 'D'=dump%s\r\n", VT100_ERASE_EOL);
+        }
+
+        if (tty_getc(&ch) == 0)
+            continue;
+
+        switch(toupper(ch))
+        {
+        case 'A':
+            Capture_Arm();
+            break;
+
+        case 'T':
+            Capture_Trigger();
+            break;
+
+        case 'S':
+            Capture_Stop();
+            break;
+
+        case 'D':
+            dump_capture();
+            wait4continue();
+            tty_cls();
+            break;
+
+        default:
+            return 1;
+        }
+
+        count = 0;
     }
 
-    wait4continue();
+    return 1;
+}
+
+//*****************************************************************************
+// Reel radius and null offset, recursive estimates side by side with the
+// one second boxcar averages. 'B' toggles which one the servo loop uses.
+//*****************************************************************************
+
+int diag_reel_radius(MENUITEM* mp)
+{
+    int ch;
+    int count = 0;
+    UInt key;
+    float vel_supply, vel_takeup;
+    float radius_supply, radius_takeup, offset_null;
+    float avg_supply, avg_takeup, avg_offset;
+    REELEST est_supply, est_takeup, est_offset;
+
+    tty_cls();
+
+    while (1)
+    {
+        /* Refresh four times per second (250ms tty read timeout) */
+        if (count++ == 0)
+        {
+            key = Task_disable();
+            vel_supply    = g_servo.velocity_supply;
+            vel_takeup    = g_servo.velocity_takeup;
+            radius_supply = g_servo.radius_supply;
+            radius_takeup = g_servo.radius_takeup;
+            offset_null   = g_servo.offset_null;
+            avg_supply    = g_servo.radius_supply_avg;
+            avg_takeup    = g_servo.radius_takeup_avg;
+            avg_offset    = g_servo.offset_null_avg;
+            est_supply    = g_servo.est_radius_supply;
+            est_takeup    = g_servo.est_radius_takeup;
+            est_offset    = g_servo.est_offset;
+            Task_restore(key);
+
+            count = 0;
+
+            float gr = g_sys.reel_radius_gain;
+            float go = g_sys.reel_offset_gain;
+
+            tty_printf(VT100_HOME);
+            tty_printf(s_startstr, mp->menutext);
+            tty_printf("Servo using %-9s Radius TC %.3f s  Offset TC %.3f s%s\r\n\n",
+                       (g_sys.sysflags & SF_RADIUS_BOXCAR) ? "BOXCAR" : "ESTIMATOR",
+                       g_sys.reel_radius_tc, g_sys.reel_offset_tc, VT100_ERASE_EOL);
+            tty_printf("Velocity       Supply %8.1f   Takeup %8.1f%s\r\n\n",
+                       vel_supply, vel_takeup, VT100_ERASE_EOL);
+            tty_printf("               Estimator    Boxcar   Gain K    In Loop%s\r\n",
+                       VT100_ERASE_EOL);
+            tty_printf("Supply Radius  %9.3f %9.3f %8.5f %10.3f%s\r\n",
+                       est_supply.x * gr, avg_supply, est_supply.k, radius_supply,
+                       VT100_ERASE_EOL);
+            tty_printf("Takeup Radius  %9.3f %9.3f %8.5f %10.3f%s\r\n",
+                       est_takeup.x * gr, avg_takeup, est_takeup.k, radius_takeup,
+                       VT100_ERASE_EOL);
+            tty_printf("Null Offset    %9.3f %9.3f %8.5f %10.3f%s\r\n\n",
+                       est_offset.x * go, avg_offset, est_offset.k, offset_null,
+                       VT100_ERASE_EOL);
+            tty_printf("'B'=toggle boxcar/estimator%s\r\n", VT100_ERASE_EOL);
+        }
+
+        if (tty_getc(&ch) == 0)
+            continue;
+
+        if (toupper(ch) == 'B')
+        {
+            g_sys.sysflags ^= SF_RADIUS_BOXCAR;
+            count = 0;
+            continue;
+        }
+
+        break;
+    }
 
     return 1;
 }
-#endif
 
 /* end-of-file */
@@ -46,8 +46,12 @@ int diag_pinch_roller(MENUITEM* mp);
 int diag_brakes(MENUITEM* mp);
 int diag_lifters(MENUITEM* mp);
 int diag_servo(MENUITEM* mp);
+int diag_autotune(MENUITEM* mp);
 int diag_dac_ramp(MENUITEM* mp);
 int diag_dac_adjust(MENUITEM* mp);
+int diag_servo_timing(MENUITEM* mp);
+int diag_servo_profile(MENUITEM* mp);
 int diag_dump_capture(MENUITEM* mp);
+int diag_reel_radius(MENUITEM* mp);
 
 /* end-of-file */
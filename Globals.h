@@ -53,12 +53,6 @@ extern I2C_Handle g_handleI2C1;
 extern UART_Handle g_handleUartTTY;
 extern UART_Handle g_handleUartIPC;
 
-// Servo Capture Data
-#if (CAPDATA_SIZE > 0)
-extern CAPDATA g_capdata[CAPDATA_SIZE];
-extern long g_capdata_count;
-#endif
-
 /*** Global Data Items *****************************************************/
 
 extern SYSPARMS  g_sys;
@@ -45,6 +45,8 @@
 #include <xdc/runtime/System.h>
 #include <xdc/runtime/Error.h>
 #include <xdc/runtime/Gate.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
 
 /* BIOS Header files */
 #include <ti/sysbios/BIOS.h>
@@ -52,6 +54,7 @@
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Event.h>
+#include <ti/sysbios/knl/Clock.h>
 
 /* TI-RTOS Driver files */
 #include <ti/drivers/GPIO.h>
@@ -89,17 +92,22 @@ extern Event_Handle g_eventSPI;
 
 /* U5 (SSI1) : MCP23S17SO TRANSPORT SWITCHES & LAMPS */
 
-#define INT1A_MASK	(S_STOP | S_PLAY | S_REW | S_FWD | S_LDEF )
+#define INT1A_MASK	(S_BUTTON_MASK | S_SWITCH_MASK)
+#define INT2B_MASK	(M_DIPSW_MASK | M_HISPEED)
+
+/* IOCONA and IOCONB are the same register with BANK=0, so both are
+ * written the same, with the INT pins open drain to the pull-ups.
+ */
 
 static IOExpander_InitData initData_SPI1[] = {
-    { MCP_IOCONA, C_SEQOP | C_ODR},		/* Configure for byte mode, INT active low */
-    { MCP_IOCONB, C_SEQOP },			/* Configure for byte mode, INT active low */
+    { MCP_IOCONA, C_SEQOP | C_ODR},		/* Configure for byte mode, INT open drain */
+    { MCP_IOCONB, C_SEQOP | C_ODR},		/* Configure for byte mode, INT open drain */
     { MCP_IODIRA, 0xFF },	    		/* Port A - all inputs from transport switches */
     { MCP_IODIRB, 0x00 },				/* Port B - all outputs to lamp/led drivers */
     { MCP_IOPOLA, 0x40 },				/* Invert input polarity of tape-out switch */
 #if BUTTON_INTERRUPTS != 0
 	{ MCP_DEFVALA, 0x00 },				/* Default interrupt compare */
-	{ MCP_INTCONA, 0x00 },				/* Interrupt on change */
+	{ MCP_INTCONA, 0x00 },				/* Interrupt on change from last read */
 	{ MCP_GPINTENA, INT1A_MASK },		/* Interrupt enable mask */
 #endif
 };
@@ -107,11 +115,16 @@ static IOExpander_InitData initData_SPI1[] = {
 /* U8 (SSI2) : MCP23S17SO SOLENOID, CONFIG DIP SWITCH & TAPE SPEED */
 
 static IOExpander_InitData initData_SPI2[] = {
-    { MCP_IOCONA, C_SEQOP },			/* Configure for byte mode, INT active low */
-    { MCP_IOCONB, C_SEQOP | C_ODR},		/* Configure for byte mode, INT active low */
+    { MCP_IOCONA, C_SEQOP | C_ODR},		/* Configure for byte mode, INT open drain */
+    { MCP_IOCONB, C_SEQOP | C_ODR},		/* Configure for byte mode, INT open drain */
     { MCP_IODIRA, 0x00 },	    		/* Port A - solenoid and other drivers, all outputs */
     { MCP_IODIRB, 0xFF },				/* Port B - DIP switches and tape-speed switch, all inputs. */
     { MCP_IOPOLB, 0x8F },				/* Invert input polarity of DIP switches and tape-speed switch */
+#if BUTTON_INTERRUPTS != 0
+	{ MCP_DEFVALB, 0x00 },				/* Default interrupt compare */
+	{ MCP_INTCONB, 0x00 },				/* Interrupt on change from last read */
+	{ MCP_GPINTENB, INT2B_MASK },		/* Interrupt enable mask */
+#endif
 };
 
 #define NUM_OBJ		2
@@ -127,6 +140,28 @@ static IOExpander_Object IOExpanderObjects[NUM_OBJ] = {
 IOExpander_Handle g_handleSPI1;
 IOExpander_Handle g_handleSPI2;
 
+/* Clock tick of the last interrupt edge and edge count on each port */
+static volatile uint32_t s_edgeTick[SWITCH_PORT_COUNT];
+static volatile uint32_t s_edgeCount[SWITCH_PORT_COUNT];
+
+/* Output port shadow registers. The Set functions only update the shadow
+ * and the ports are written by IOExpander_flush(), so any updates made
+ * within a clock tick go out as one write per port. The latch holds the
+ * last value written, the ports reset to zero along with the expanders.
+ */
+static uint8_t s_ucTransportMask = 0;
+static uint8_t s_ucTransportLatch = 0;
+static uint8_t s_ucLampMask = 0;
+static uint8_t s_ucLampLatch = 0;
+
+static volatile bool s_deferWrites = false;
+static volatile bool s_flushPending = false;
+static Clock_Handle s_flushClock = NULL;
+
+/* SPI transfer counters and timing */
+static uint32_t s_cycles_per_usec = 1;
+static IOEXPANDER_STATS s_stats;
+
 /*****************************************************************************
  * Static Function Prototypes
  *****************************************************************************/
@@ -135,6 +170,7 @@ static IOExpander_Handle IOExpander_open(uint32_t index);
 
 #if BUTTON_INTERRUPTS != 0
 static void gpioExpanderSSI1AHwi(unsigned int index);
+static void gpioExpanderSSI2BHwi(unsigned int index);
 #endif
 
 static bool MCP23S17_write(
@@ -149,16 +185,36 @@ static bool MCP23S17_read(
     uint8_t*            pucData
     );
 
+static bool MCP23S17_readPair(
+    IOExpander_Handle   handle,
+    uint8_t             ucRegAddr,
+    uint8_t*            pucDataA,
+    uint8_t*            pucDataB
+    );
+
+static void OutputUpdate(void);
+static void FlushRetry(void);
+static Void FlushClockFxn(UArg arg);
+
 /*****************************************************************************
  * Initialize the MCP23017 I/O Expander Chips
  *****************************************************************************/
 
 void IOExpander_initialize(void)
 {
-#if BUTTON_INTERRUPTS != 0
     Error_Block eb;
+    Clock_Params clkParams;
+    Types_FreqHz freq;
+#if BUTTON_INTERRUPTS != 0
+    uint8_t dummy;
 #endif
 
+	/* Transfer times are kept in usec */
+	Timestamp_getFreq(&freq);
+	s_cycles_per_usec = (freq.lo >= 1000000) ? (freq.lo / 1000000) : 1;
+
+	memset(&s_stats, 0, sizeof(s_stats));
+
 	/* Reset low pulse to I/O expanders */
 	GPIO_write(Board_RESET_MCP, PIN_LOW);
     Task_sleep(100);
@@ -169,32 +225,78 @@ void IOExpander_initialize(void)
 	g_handleSPI1 = IOExpander_open(0);
 	g_handleSPI2 = IOExpander_open(1);
 
-#if BUTTON_INTERRUPTS != 0
-    /* Create interrupt signal event */
+    /* Create interrupt and output flush signal event */
 	Error_init(&eb);
 	g_eventSPI = Event_create(NULL, &eb);
 
+	/* One shot clock to flush output updates made within a tick */
+	Error_init(&eb);
+	Clock_Params_init(&clkParams);
+	clkParams.period    = 0;
+	clkParams.startFlag = FALSE;
+	s_flushClock = Clock_create(FlushClockFxn, 1, &clkParams, &eb);
+
+#if BUTTON_INTERRUPTS != 0
 	/* Setup the callback Hwi handler for interrupt notify pins */
     GPIO_setCallback(Board_INT1A, gpioExpanderSSI1AHwi);
-    //GPIO_setCallback(Board_INT2B, gpioExpanderSSI2BHwi);
+    GPIO_setCallback(Board_INT2B, gpioExpanderSSI2BHwi);
+
+    /* Reading the ports clears any change latched during the init */
+    GetTransportSwitches(&dummy);
+    GetModeSwitches(&dummy);
 
-    /* Enable keypad button interrupts */
+    /* Enable transport switch and mode switch interrupts */
     GPIO_enableInt(Board_INT1A);
-    //GPIO_enableInt(Board_INT2B);
+    GPIO_enableInt(Board_INT2B);
 #endif
 }
 
 /*****************************************************************************
  * U5 (SSI1) : MCP23S17SO INT HANDLER TRANSPORT SWITCHES & LAMPS
+ * U8 (SSI2) : MCP23S17SO INT HANDLER CONFIG DIP SWITCH & TAPE SPEED
+ *
+ * The INT pin falls on the first change after the port was last read and
+ * stays low until it's read again, so each read arms the next edge. The
+ * port can't be read over SPI here, the edge is timestamped for the switch
+ * debounce and the button task is signaled to read it.
  *****************************************************************************/
 
 #if BUTTON_INTERRUPTS != 0
 void gpioExpanderSSI1AHwi(unsigned int index)
 {
-	Event_post(g_eventSPI, Event_Id_00);
+	s_edgeTick[SWITCH_PORT_TRANSPORT] = Clock_getTicks();
+	++s_edgeCount[SWITCH_PORT_TRANSPORT];
+
+	Event_post(g_eventSPI, EVT_SWITCH_TRANSPORT);
+}
+
+void gpioExpanderSSI2BHwi(unsigned int index)
+{
+	s_edgeTick[SWITCH_PORT_MODE] = Clock_getTicks();
+	++s_edgeCount[SWITCH_PORT_MODE];
+
+	Event_post(g_eventSPI, EVT_SWITCH_MODE);
 }
 #endif
 
+/*****************************************************************************
+ * Returns the number of interrupt edges seen on a switch port and the
+ * clock tick of the last one.
+ *****************************************************************************/
+
+uint32_t GetSwitchEdge(uint32_t port, uint32_t* tick)
+{
+	uint32_t count;
+	UInt key = Hwi_disable();
+
+	count = s_edgeCount[port];
+	*tick = s_edgeTick[port];
+
+	Hwi_restore(key);
+
+	return count;
+}
+
 /*****************************************************************************
  * Initialize the MCP23017 I/O Expander Chips U5 on SS1 and U8 on SSI2
  *****************************************************************************/
@@ -248,42 +350,79 @@ IOExpander_Handle IOExpander_open(uint32_t index)
 }
 
 /*****************************************************************************
- * Write a register command byte to MCP23S17 expansion I/O controller.
+ * Run one SPI transaction to the MCP23S17 with chip select held low and
+ * keep the transfer time. Called with the SPI semaphore held.
  *****************************************************************************/
 
-bool MCP23S17_write(
+static bool MCP23S17_transfer(
 	IOExpander_Handle	handle,
-    uint8_t   			ucRegAddr,
-    uint8_t   			ucData
-    )
+	uint8_t*			txBuffer,
+	uint8_t*			rxBuffer,
+	size_t				count,
+	uint32_t*			pulUsec,
+	uint32_t*			pulMax
+	)
 {
-	uint8_t txBuffer[3];
-	uint8_t rxBuffer[3];
+	bool success;
+	uint32_t usec;
+	uint32_t start;
 	SPI_Transaction transaction;
 
-	txBuffer[0] = 0x40;			/* write opcode */
-	txBuffer[1] = ucRegAddr;	/* register address */
-	txBuffer[2] = ucData;		/* register data */
-
 	/* Initialize opcode transaction structure */
-	transaction.count = 3;
-	transaction.txBuf = (Ptr)&txBuffer;
-	transaction.rxBuf = (Ptr)&rxBuffer;
+	transaction.count = count;
+	transaction.txBuf = (Ptr)txBuffer;
+	transaction.rxBuf = (Ptr)rxBuffer;
+
+	start = Timestamp_get32();
 
 	/* Hold SPI chip select low */
 	GPIO_write(handle->boardCS, PIN_LOW);
 
 	/* Initiate SPI transfer of opcode */
-	if(!SPI_transfer(handle->spiHandle, &transaction))
+	success = SPI_transfer(handle->spiHandle, &transaction);
+
+	/* Release SPI chip select */
+	GPIO_write(handle->boardCS, PIN_HIGH);
+
+	usec = (Timestamp_get32() - start) / s_cycles_per_usec;
+
+	*pulUsec = usec;
+
+	if (usec > *pulMax)
+		*pulMax = usec;
+
+	s_stats.busy_usec += usec;
+
+	if (!success)
 	{
+		++s_stats.errors;
 	    System_printf("Unsuccessful master SPI transfer to MCP23S17");
-	    return false;
 	}
 
-	/* Release SPI chip select */
-	GPIO_write(handle->boardCS, PIN_HIGH);
+	return success;
+}
 
-	return true;
+/*****************************************************************************
+ * Write a register command byte to MCP23S17 expansion I/O controller.
+ *****************************************************************************/
+
+bool MCP23S17_write(
+	IOExpander_Handle	handle,
+    uint8_t   			ucRegAddr,
+    uint8_t   			ucData
+    )
+{
+	uint8_t txBuffer[3];
+	uint8_t rxBuffer[3];
+
+	txBuffer[0] = 0x40;			/* write opcode */
+	txBuffer[1] = ucRegAddr;	/* register address */
+	txBuffer[2] = ucData;		/* register data */
+
+	++s_stats.writes;
+
+	return MCP23S17_transfer(handle, txBuffer, rxBuffer, 3,
+							 &s_stats.write_usec, &s_stats.write_max);
 }
 
 /*****************************************************************************
@@ -298,29 +437,16 @@ bool MCP23S17_read(
 {
 	uint8_t txBuffer[3];
 	uint8_t rxBuffer[3];
-	SPI_Transaction transaction;
 
 	txBuffer[0] = 0x41;			/* read opcode */
 	txBuffer[1] = ucRegAddr;	/* register address */
 	txBuffer[2] = 0;			/* dummy byte */
 
-	/* Initialize opcode transaction structure */
-	transaction.count = 3;
-	transaction.txBuf = (Ptr)&txBuffer;
-	transaction.rxBuf = (Ptr)&rxBuffer;
-
-	/* Hold SPI chip select low */
-	GPIO_write(handle->boardCS, PIN_LOW);
-
-	/* Initiate SPI transfer of opcode */
-	if(!SPI_transfer(handle->spiHandle, &transaction))
-	{
-	    System_printf("Unsuccessful master SPI transfer to MCP23S17");
-	    return false;
-	}
+	++s_stats.reads;
 
-	/* Release SPI chip select */
-	GPIO_write(handle->boardCS, PIN_HIGH);
+	if (!MCP23S17_transfer(handle, txBuffer, rxBuffer, 3,
+						   &s_stats.read_usec, &s_stats.read_max))
+		return false;
 
 	/* Return the register data byte */
 	*pucData = rxBuffer[2];
@@ -328,6 +454,67 @@ bool MCP23S17_read(
 	return true;
 }
 
+/*****************************************************************************
+ * Read an A/B register pair from MCP23S17 expansion I/O controller in one
+ * transaction. The expanders run in byte mode (SEQOP set) with BANK=0, so
+ * the address pointer toggles between the A and B register of a pair on
+ * each data byte clocked out.
+ *****************************************************************************/
+
+bool MCP23S17_readPair(
+	IOExpander_Handle	handle,
+    uint8_t				ucRegAddr,
+    uint8_t*			pucDataA,
+    uint8_t*			pucDataB
+    )
+{
+	uint8_t txBuffer[4];
+	uint8_t rxBuffer[4];
+
+	txBuffer[0] = 0x41;			/* read opcode */
+	txBuffer[1] = ucRegAddr;	/* port A register address */
+	txBuffer[2] = 0;			/* dummy byte */
+	txBuffer[3] = 0;			/* dummy byte */
+
+	++s_stats.reads;
+
+	if (!MCP23S17_transfer(handle, txBuffer, rxBuffer, 4,
+						   &s_stats.read_usec, &s_stats.read_max))
+		return false;
+
+	/* Return the register data bytes */
+	*pucDataA = rxBuffer[2];
+	*pucDataB = rxBuffer[3];
+
+	return true;
+}
+
+/*****************************************************************************
+ * Read both GPIO ports of an I/O expander in a single transaction.
+ *
+ *  index 0     - U5 transport switches (A) and lamps (B)
+ *  index 1     - U8 solenoids (A) and mode switches (B)
+ *****************************************************************************/
+
+uint32_t GetExpanderPorts(uint32_t index, uint8_t* pucPortA, uint8_t* pucPortB)
+{
+	uint32_t rc = 0;
+
+	if (index >= NUM_OBJ)
+		return 1;
+
+	/* Acquire the semaphore for exclusive access */
+    if (!Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    	return 1;
+
+	if (!MCP23S17_readPair(&(IOExpanderObjects[index]), MCP_GPIOA, pucPortA, pucPortB))
+		rc = 1;
+
+	Semaphore_post(g_semaSPI);
+
+    return rc;
+}
+
 /*****************************************************************************
  * Read the transport control switches, returns any of the following bits:
  *
@@ -345,12 +532,37 @@ uint32_t GetTransportSwitches(uint8_t* pucMask)
 	uint32_t rc = 0;
 
 	/* Acquire the semaphore for exclusive access */
-    if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
-    {
-		MCP23S17_read(g_handleSPI1, MCP_GPIOA, pucMask);
+    if (!Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    	return 1;
 
-    	Semaphore_post(g_semaSPI);
-    }
+	if (!MCP23S17_read(g_handleSPI1, MCP_GPIOA, pucMask))
+		rc = 1;
+
+	Semaphore_post(g_semaSPI);
+
+    return rc;
+}
+
+/*****************************************************************************
+ * Read the transport switches and the mode switches together, under one
+ * hold of the SPI semaphore.
+ *****************************************************************************/
+
+uint32_t GetSwitches(uint8_t* pucTransport, uint8_t* pucMode)
+{
+	uint32_t rc = 0;
+
+	/* Acquire the semaphore for exclusive access */
+    if (!Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    	return 1;
+
+	if (!MCP23S17_read(g_handleSPI1, MCP_GPIOA, pucTransport))
+		rc = 1;
+
+	if (!MCP23S17_read(g_handleSPI2, MCP_GPIOB, pucMode))
+		rc = 1;
+
+	Semaphore_post(g_semaSPI);
 
     return rc;
 }
@@ -371,12 +583,13 @@ uint32_t GetModeSwitches(uint8_t* pucMask)
 	uint32_t rc = 0;
 
 	/* Acquire the semaphore for exclusive access */
-    if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
-    {
-		MCP23S17_read(g_handleSPI2, MCP_GPIOB, pucMask);
+    if (!Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    	return 1;
 
-    	Semaphore_post(g_semaSPI);
-    }
+	if (!MCP23S17_read(g_handleSPI2, MCP_GPIOB, pucMask))
+		rc = 1;
+
+	Semaphore_post(g_semaSPI);
 
     return rc;
 }
@@ -393,27 +606,21 @@ uint32_t GetModeSwitches(uint8_t* pucMask)
  *  T_RECH      - record hold bit
  *****************************************************************************/
 
-/* Current transport output state bits */
-static uint8_t s_ucTransportMask = 0;
-
 uint32_t SetTransportMask(uint8_t ucSetMask, uint8_t ucClearMask)
 {
 	uint32_t rc = 0;
+	UInt key = Hwi_disable();
 
-	/* Acquire the semaphore for exclusive access */
-    if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
-    {
-    	/* Clear any bits in the clear mask */
-    	s_ucTransportMask &= ~(ucClearMask);
+	/* Clear any bits in the clear mask */
+	s_ucTransportMask &= ~(ucClearMask);
 
-    	/* Set any bits in the set mask */
-    	s_ucTransportMask |= ucSetMask;
+	/* Set any bits in the set mask */
+	s_ucTransportMask |= ucSetMask;
 
-    	/* Set the GPIO pin mask on the MCP I/O expander */
-    	MCP23S17_write(g_handleSPI2, MCP_GPIOA, s_ucTransportMask);
+	Hwi_restore(key);
 
-    	Semaphore_post(g_semaSPI);
-    }
+	/* Set the GPIO pin mask on the MCP I/O expander */
+	OutputUpdate();
 
     return rc;
 }
@@ -455,22 +662,13 @@ bool IsTransportLifters(void)
  *  L_LED1  - diagnostic led1
  *****************************************************************************/
 
-/* Current transport output state bits */
-static uint8_t s_ucLampMask = 0;
-
 uint32_t SetLamp(uint8_t ucBitMask)
 {
 	uint32_t rc = 0;
 
-	/* Acquire the semaphore for exclusive access */
-    if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
-    {
-    	s_ucLampMask = ucBitMask;
+	s_ucLampMask = ucBitMask;
 
-    	MCP23S17_write(g_handleSPI1, MCP_GPIOB, ucBitMask);
-
-    	Semaphore_post(g_semaSPI);
-    }
+	OutputUpdate();
 
     return rc;
 }
@@ -478,20 +676,17 @@ uint32_t SetLamp(uint8_t ucBitMask)
 uint32_t SetLampMask(uint8_t ucSetMask, uint8_t ucClearMask)
 {
 	uint32_t rc = 0;
+	UInt key = Hwi_disable();
 
-	/* Acquire the semaphore for exclusive access */
-    if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
-    {
-    	/* Clear any bits in the clear mask */
-    	s_ucLampMask &= ~(ucClearMask);
+	/* Clear any bits in the clear mask */
+	s_ucLampMask &= ~(ucClearMask);
 
-    	/* Set any bits in the set mask */
-    	s_ucLampMask |= ucSetMask;
+	/* Set any bits in the set mask */
+	s_ucLampMask |= ucSetMask;
 
-    	MCP23S17_write(g_handleSPI1, MCP_GPIOB, s_ucLampMask);
+	Hwi_restore(key);
 
-    	Semaphore_post(g_semaSPI);
-    }
+	OutputUpdate();
 
     return rc;
 }
@@ -515,4 +710,148 @@ uint32_t GetLampStateMask(void)
     return (uint32_t)s_ucLampMask & 0xFF;
 }
 
+/*****************************************************************************
+ * Output port write coalescing. Until deferred writes are enabled each
+ * update is written out straight away. Once enabled the first update
+ * starts a one tick clock and any more updates before it expires just
+ * change the shadow registers. The clock posts EVT_EXPANDER_FLUSH and the
+ * main control task then calls IOExpander_flush() to write out each port
+ * that changed, solenoids first.
+ *****************************************************************************/
+
+void IOExpander_deferWrites(bool enable)
+{
+	s_deferWrites = enable;
+
+	if (!enable)
+		IOExpander_flush();
+}
+
+void OutputUpdate(void)
+{
+	bool start = false;
+	UInt key;
+
+	if (!s_deferWrites)
+	{
+		IOExpander_flush();
+		return;
+	}
+
+	key = Hwi_disable();
+
+	++s_stats.updates;
+
+	if (s_flushPending)
+	{
+		++s_stats.coalesced;
+	}
+	else
+	{
+		s_flushPending = true;
+		start = true;
+	}
+
+	Hwi_restore(key);
+
+	if (start)
+		Clock_start(s_flushClock);
+}
+
+Void FlushClockFxn(UArg arg)
+{
+	Event_post(g_eventSPI, EVT_EXPANDER_FLUSH);
+}
+
+void IOExpander_flush(void)
+{
+	bool retry = false;
+	uint8_t tran, lamp;
+	UInt key;
+
+	/* Acquire the semaphore for exclusive access, if the bus is held
+	 * up the updates are left pending and tried again next tick.
+	 */
+    if (!Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    {
+    	FlushRetry();
+    	return;
+    }
+
+    /* Take the shadow state, any update from here on flushes again */
+	key = Hwi_disable();
+	s_flushPending = false;
+	tran = s_ucTransportMask;
+	lamp = s_ucLampMask;
+	Hwi_restore(key);
+
+	if ((tran == s_ucTransportLatch) && (lamp == s_ucLampLatch))
+		++s_stats.unchanged;
+
+	/* Set the GPIO pin mask on the MCP I/O expander */
+	if (tran != s_ucTransportLatch)
+	{
+		if (MCP23S17_write(g_handleSPI2, MCP_GPIOA, tran))
+			s_ucTransportLatch = tran;
+		else
+			retry = true;
+	}
+
+	if (lamp != s_ucLampLatch)
+	{
+		if (MCP23S17_write(g_handleSPI1, MCP_GPIOB, lamp))
+			s_ucLampLatch = lamp;
+		else
+			retry = true;
+	}
+
+	Semaphore_post(g_semaSPI);
+
+	/* Try a failed write again on the next tick */
+	if (retry)
+		FlushRetry();
+}
+
+/*****************************************************************************
+ * Keep the flush pending and restart the one tick clock, so a flush that
+ * couldn't get the bus or failed a write is tried again. With writes not
+ * deferred the next update writes out everything that differs anyway.
+ *****************************************************************************/
+
+void FlushRetry(void)
+{
+	UInt key;
+
+	if (!s_deferWrites)
+		return;
+
+	key = Hwi_disable();
+	s_flushPending = true;
+	Hwi_restore(key);
+
+	Clock_start(s_flushClock);
+}
+
+/*****************************************************************************
+ * I/O expander SPI counters and transfer times
+ *****************************************************************************/
+
+void IOExpander_getStats(IOEXPANDER_STATS* stats)
+{
+    UInt key = Hwi_disable();
+
+    memcpy(stats, &s_stats, sizeof(IOEXPANDER_STATS));
+
+    Hwi_restore(key);
+}
+
+void IOExpander_resetStats(void)
+{
+    UInt key = Hwi_disable();
+
+    memset(&s_stats, 0, sizeof(IOEXPANDER_STATS));
+
+    Hwi_restore(key);
+}
+
 // End-Of-File
@@ -58,16 +58,51 @@ typedef struct IOExpander_Object {
 
 typedef IOExpander_Object *IOExpander_Handle;
 
+/* Switch input ports with interrupt-on-change */
+#define SWITCH_PORT_TRANSPORT   0       /* U5 port A, INT1A */
+#define SWITCH_PORT_MODE        1       /* U8 port B, INT2B */
+#define SWITCH_PORT_COUNT       2
+
+/* Events posted to g_eventSPI on a switch port change */
+#define EVT_SWITCH_TRANSPORT    Event_Id_00
+#define EVT_SWITCH_MODE         Event_Id_01
+#define EVT_SWITCH_ALL          (EVT_SWITCH_TRANSPORT | EVT_SWITCH_MODE)
+
+/* Event posted to g_eventSPI when output updates are due to be written */
+#define EVT_EXPANDER_FLUSH      Event_Id_02
+
+/* I/O expander SPI counters, times in usec */
+typedef struct _IOEXPANDER_STATS {
+    uint32_t    reads;                  /* register read transactions    */
+    uint32_t    writes;                 /* register write transactions   */
+    uint32_t    updates;                /* deferred output port updates  */
+    uint32_t    coalesced;              /* updates merged into a flush   */
+    uint32_t    unchanged;              /* flushes with nothing to write */
+    uint32_t    errors;                 /* failed SPI transfers          */
+    uint32_t    read_usec;              /* last read transaction time    */
+    uint32_t    read_max;               /* max read transaction time     */
+    uint32_t    write_usec;             /* last write transaction time   */
+    uint32_t    write_max;              /* max write transaction time    */
+    uint32_t    busy_usec;              /* total SPI bus time            */
+} IOEXPANDER_STATS;
+
 //*****************************************************************************
 // Function Prototypes
 //*****************************************************************************
 
 void IOExpander_initialize(void);
+void IOExpander_deferWrites(bool enable);
+void IOExpander_flush(void);
+void IOExpander_getStats(IOEXPANDER_STATS* stats);
+void IOExpander_resetStats(void);
 
 /* These functions access the I/O Expanders */
 
 uint32_t GetTransportSwitches(uint8_t* pucMask);
 uint32_t GetModeSwitches(uint8_t* pucMask);
+uint32_t GetSwitchEdge(uint32_t port, uint32_t* tick);
+uint32_t GetSwitches(uint8_t* pucTransport, uint8_t* pucMode);
+uint32_t GetExpanderPorts(uint32_t index, uint8_t* pucPortA, uint8_t* pucPortB);
 
 uint32_t SetTransportMask(uint8_t ucSetMask, uint8_t ucClearMask);
 uint8_t GetTransportMask(void);
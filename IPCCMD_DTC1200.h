@@ -20,6 +20,23 @@
 #ifndef _DTC_CONFIG_DATA_DEFINED_
 #define _DTC_CONFIG_DATA_DEFINED_
 
+/* Shuttle PID gain schedule breakpoints */
+#define DTC_SCHED_NUM_RATIOS        3       /* supply/takeup radius ratios  */
+#define DTC_SCHED_NUM_VELS          2       /* shuttle reel velocities      */
+
+/* Tension sensor filter sections and presets */
+#define DTC_TFILT_STAGES            3       /* low pass, supply, takeup     */
+#define DTC_TFILT_COEFFS            5       /* b0, b1, b2, a1, a2           */
+
+#define DTC_TFILT_OFF               0       /* raw tension sensor           */
+#define DTC_TFILT_LOWPASS           1       /* low pass at tension_lp_freq  */
+#define DTC_TFILT_NOTCH             2       /* notch at reel rotation rates */
+#define DTC_TFILT_LOWPASS_NOTCH     3       /* low pass and reel notches    */
+#define DTC_TFILT_CUSTOM            4       /* sections from tension_coeff  */
+
+/* Motor DAC calibration breakpoints */
+#define DTC_DAC_CAL_POINTS          17      /* torque over 0-DAC_MAX        */
+
 /* Configuration Parameters - MUST MATCH SYSPARMS STRUCT IN DTC1200.h */
 typedef struct _DTC_CONFIG_DATA {
     uint32_t magic;
@@ -34,7 +51,7 @@ typedef struct _DTC_CONFIG_DATA {
     int32_t rechold_settle_time;        /* record pulse length time          */
     int32_t record_pulse_time;          /* record pulse length time          */
     int32_t vel_detect_threshold;       /* vel detect threshold (10)         */
-    uint32_t debounce;                  /* debounce transport buttons time   */
+    uint32_t debounce;                  /* transport switch settle time (ms) */
     uint32_t sysflags;                  /* global system bit flags           */
     /*** SOFTWARE GAIN PARAMETERS ***/
     float   reel_radius_gain;           /* reeling radius play gain factor   */
@@ -42,6 +59,22 @@ typedef struct _DTC_CONFIG_DATA {
     float   tension_sensor_gain;        /* tension sensor gain divisor       */
     float   tension_sensor_midscale1;   /* ADC mid-scale for 1" tape         */
     float   tension_sensor_midscale2;   /* ADC mid-scale for 2" tape         */
+    float   reel_radius_tc;             /* radius estimator time const (sec) */
+    float   reel_offset_tc;             /* offset estimator time const (sec) */
+    /* tension sensor filter */
+    int32_t tension_filter;             /* DTC_TFILT_xxx filter preset       */
+    float   tension_lp_freq;            /* low pass corner frequency (Hz)    */
+    float   tension_notch_q;            /* reel notch Q, width is f0/Q       */
+    float   tension_coeff[DTC_TFILT_STAGES][DTC_TFILT_COEFFS];
+    /* motor current sense and inner torque loop */
+    float   current_scale;              /* DAC torque per current ADC count  */
+    float   current_offset;             /* current ADC count at zero torque  */
+    float   current_pgain;              /* current loop P-gain               */
+    float   current_igain;              /* current loop I-gain (per tick)    */
+    int32_t current_limit;              /* overcurrent limit (DAC), 0=off    */
+    /* motor DAC code for each torque breakpoint, DTC_SF_DAC_LINEARIZE */
+    float   dac_cal_supply[DTC_DAC_CAL_POINTS];
+    float   dac_cal_takeup[DTC_DAC_CAL_POINTS];
     /*** THREAD TAPE PARAMETERS ***/
     int32_t thread_supply_tension;      /* supply tension level (0-DAC_MAX)  */
     int32_t thread_takeup_tension;      /* takeup tension level (0-DAC_MAX)  */
@@ -49,6 +82,8 @@ typedef struct _DTC_CONFIG_DATA {
     int32_t stop_supply_tension;        /* supply tension level (0-DAC_MAX)  */
     int32_t stop_takeup_tension;        /* takeup tension level (0-DAC_MAX)  */
     int32_t stop_brake_torque;          /* stop brake torque in shuttle mode */
+    float   reel_inertia;               /* empty reel + rotor, 0=fixed brake */
+    float   pack_inertia;               /* tape pack inertia per radius^4    */
     /*** SHUTTLE SERVO PARAMETERS ***/
     int32_t shuttle_supply_tension;     /* play supply tension (0-DAC_MAX)   */
     int32_t shuttle_takeup_tension;     /* play takeup tension               */
@@ -63,6 +98,21 @@ typedef struct _DTC_CONFIG_DATA {
     float   shuttle_servo_pgain;        /* P-gain */
     float   shuttle_servo_igain;        /* I-gain */
     float   shuttle_servo_dgain;        /* D-gain */
+    /* shuttle velocity profile limits */
+    float   shuttle_accel;              /* max accel (velocity/sec), 0=off   */
+    float   shuttle_jerk;               /* max jerk (velocity/sec^2), 0=off  */
+    /* shuttle PID gain schedule, used with DTC_SF_GAIN_SCHEDULE */
+    float   sched_ratio[DTC_SCHED_NUM_RATIOS];  /* radius ratio breakpoints */
+    float   sched_velocity[DTC_SCHED_NUM_VELS]; /* velocity breakpoints     */
+    float   sched_pgain[DTC_SCHED_NUM_RATIOS][DTC_SCHED_NUM_VELS];
+    float   sched_igain[DTC_SCHED_NUM_RATIOS][DTC_SCHED_NUM_VELS];
+    float   sched_dgain[DTC_SCHED_NUM_RATIOS][DTC_SCHED_NUM_VELS];
+    /* tape locate parameters */
+    int32_t locate_velocity;            /* max shuttle velocity to locate    */
+    int32_t locate_approach_velocity;   /* final approach velocity           */
+    int32_t locate_approach_dist;       /* final approach distance (edges)   */
+    int32_t locate_window;              /* locate complete window (edges)    */
+    float   locate_decel;               /* profile decel (edges/sec^2)       */
     /*** PLAY SERVO PARAMETERS ***/
     /* play high speed boost parameters */
     int32_t play_hi_supply_tension;     /* play supply tension (0-DAC_MAX) */
@@ -76,6 +126,8 @@ typedef struct _DTC_CONFIG_DATA {
     int32_t play_lo_boost_end;
     float   play_lo_boost_pgain;        /* P-gain */
     float   play_lo_boost_igain;        /* I-gain */
+    /* play boost torque feedforward */
+    float   play_accel_time;            /* capstan spin up time const (sec)  */
 } DTC_CONFIG_DATA;
 
 /* System Bit Flags for DTC1200_CONFIG.sysflags */
@@ -84,9 +136,138 @@ typedef struct _DTC_CONFIG_DATA {
 #define DTC_SF_BRAKES_STOP_PLAY     0x0004  /* use brakes to stop play mode */
 #define DTC_SF_ENGAGE_PINCH_ROLLER  0x0008  /* engage pinch roller at play  */
 #define DTC_SF_STOP_AT_TAPE_END     0x0010  /* stop @tape end leader detect */
+#define DTC_SF_RADIUS_BOXCAR        0x0020  /* use 1 sec avg radius/offset  */
+#define DTC_SF_GAIN_SCHEDULE        0x0040  /* shuttle PID gain schedule    */
+#define DTC_SF_REEL_IDENT           0x0080  /* use identified reel inertia  */
+#define DTC_SF_QEI_VELCAP           0x0100  /* use 10ms QEI velocity capture*/
+#define DTC_SF_TACH_ALPHABETA       0x0200  /* alpha-beta tape tach filter  */
+#define DTC_SF_CURRENT_LOOP         0x0400  /* close torque on motor current*/
+#define DTC_SF_DAC_LINEARIZE        0x0800  /* motor DAC calibration tables */
+#define DTC_SF_DAC_DITHER           0x1000  /* dither motor DAC below 1 LSB */
 
 #endif /*_DTC_CONFIG_DATA_DEFINED_*/
 
+#ifndef _DTC_SERVO_TIMING_DEFINED_
+#define _DTC_SERVO_TIMING_DEFINED_
+
+#define DTC_SERVO_HIST_BINS         16      /* bins in each timing histogram */
+
+/* Servo Loop Timing - MUST MATCH SERVOTIMING STRUCT IN DTC1200.h */
+typedef struct _DTC_SERVO_TIMING {
+    uint32_t ticks;                     /* servo ticks measured              */
+    uint32_t overruns;                  /* periods over 1.5x nominal         */
+    uint32_t period_min;                /* min tick period (usec)            */
+    uint32_t period_max;                /* max tick period (usec)            */
+    uint32_t exec_min;                  /* min loop exec time (usec)         */
+    uint32_t exec_max;                  /* max loop exec time (usec)         */
+    uint32_t period_hist[DTC_SERVO_HIST_BINS];  /* 1600us + 50us per bin     */
+    uint32_t exec_hist[DTC_SERVO_HIST_BINS];    /* 0us + 50us per bin        */
+} DTC_SERVO_TIMING;
+
+#endif /*_DTC_SERVO_TIMING_DEFINED_*/
+
+#ifndef _DTC_SERVO_PROFILE_DEFINED_
+#define _DTC_SERVO_PROFILE_DEFINED_
+
+/* Servo loop stage index for DTC_SERVO_PROFILE.stage[] and worst[] */
+#define DTC_SERVO_STAGE_TACH        0       /* tape roller tach read    */
+#define DTC_SERVO_STAGE_QEI         1       /* reel QEI velocity        */
+#define DTC_SERVO_STAGE_ADC         2       /* ADC read and tension     */
+#define DTC_SERVO_STAGE_RADIUS      3       /* radius and offset math   */
+#define DTC_SERVO_STAGE_DISPATCH    4       /* mode handler less DAC    */
+#define DTC_SERVO_STAGE_DAC         5       /* motor DAC write          */
+#define DTC_SERVO_STAGE_TOTAL       6       /* whole servo tick         */
+
+#define DTC_SERVO_NUM_STAGES        7
+
+/* Stage cycle counts - MUST MATCH SERVOSTAGE STRUCT IN DTC1200.h */
+typedef struct _DTC_SERVO_STAGE {
+    uint32_t min;                       /* min cycles                        */
+    uint32_t max;                       /* max cycles                        */
+    uint32_t mean;                      /* mean cycles                       */
+} DTC_SERVO_STAGE;
+
+/* Servo Loop Profile - MUST MATCH SERVOPROFILE STRUCT IN DTC1200.h */
+typedef struct _DTC_SERVO_PROFILE {
+    uint32_t ticks;                     /* servo ticks profiled              */
+    uint32_t cpu_freq;                  /* cycle counter freq (Hz)           */
+    DTC_SERVO_STAGE stage[DTC_SERVO_NUM_STAGES];
+    uint32_t worst_tick;                /* tick number of the worst case     */
+    uint32_t worst_mode;                /* servo mode at the worst case      */
+    uint32_t worst[DTC_SERVO_NUM_STAGES];   /* stage cycles of worst tick    */
+} DTC_SERVO_PROFILE;
+
+#endif /*_DTC_SERVO_PROFILE_DEFINED_*/
+
+#ifndef _DTC_CAPTURE_DEFINED_
+#define _DTC_CAPTURE_DEFINED_
+
+/* Capture channel bits for DTC_CAPTURE_CONFIG.channels */
+#define DTC_CAP_CH_DAC_SUPPLY       0x0001  /* supply motor DAC level   */
+#define DTC_CAP_CH_DAC_TAKEUP       0x0002  /* takeup motor DAC level   */
+#define DTC_CAP_CH_VEL_SUPPLY       0x0004  /* supply reel velocity     */
+#define DTC_CAP_CH_VEL_TAKEUP       0x0008  /* takeup reel velocity     */
+#define DTC_CAP_CH_RAD_SUPPLY       0x0010  /* supply reeling radius    */
+#define DTC_CAP_CH_RAD_TAKEUP       0x0020  /* takeup reeling radius    */
+#define DTC_CAP_CH_TAPE_TACH        0x0040  /* tape roller tach         */
+#define DTC_CAP_CH_TENSION          0x0080  /* tension sensor           */
+#define DTC_CAP_CH_VELOCITY         0x0100  /* summed reel velocity     */
+#define DTC_CAP_CH_PID_CV           0x0200  /* active PID CV output     */
+#define DTC_CAP_CH_PID_ERROR        0x0400  /* active PID error         */
+#define DTC_CAP_CH_MODE             0x0800  /* servo mode               */
+
+/* Capture trigger bits for DTC_CAPTURE_CONFIG.trigger */
+#define DTC_CAP_TRIG_MODE           0x0001  /* on any servo mode change */
+#define DTC_CAP_TRIG_TENSION_ABOVE  0x0002  /* tension rises above level*/
+#define DTC_CAP_TRIG_TENSION_BELOW  0x0004  /* tension falls below level*/
+#define DTC_CAP_TRIG_VELOCITY_ABOVE 0x0008  /* velocity rises above     */
+#define DTC_CAP_TRIG_VELOCITY_BELOW 0x0010  /* velocity falls below     */
+#define DTC_CAP_TRIG_MANUAL         0x0080  /* manual trigger command   */
+
+/* Capture states for DTC_CAPTURE_STATUS.state */
+#define DTC_CAP_STATE_IDLE          0
+#define DTC_CAP_STATE_ARMED         1
+#define DTC_CAP_STATE_TRIGGERED     2
+#define DTC_CAP_STATE_DONE          3
+
+/* Capture Config - MUST MATCH CAPTURE_CONFIG STRUCT IN DTC1200.h */
+typedef struct _DTC_CAPTURE_CONFIG {
+    uint32_t channels;                  /* DTC_CAP_CH_xxx channel set        */
+    uint32_t trigger;                   /* DTC_CAP_TRIG_xxx conditions       */
+    uint32_t decimation;                /* store every Nth servo tick        */
+    uint32_t pretrigger;                /* samples kept before trigger       */
+    float    tension_level;             /* tension trigger level             */
+    float    velocity_level;            /* velocity trigger level            */
+} DTC_CAPTURE_CONFIG;
+
+/* Capture Status - MUST MATCH CAPTURE_STATUS STRUCT IN DTC1200.h */
+typedef struct _DTC_CAPTURE_STATUS {
+    uint32_t state;                     /* DTC_CAP_STATE_xxx                 */
+    uint32_t channels;                  /* channel set captured              */
+    uint32_t num_channels;              /* words per sample                  */
+    uint32_t capacity;                  /* max samples for channel set       */
+    uint32_t samples;                   /* valid samples in buffer           */
+    uint32_t trigger_index;             /* sample index of the trigger       */
+    uint32_t trigger_cause;             /* DTC_CAP_TRIG_xxx that fired       */
+    uint32_t sequence;                  /* completed capture count           */
+} DTC_CAPTURE_STATUS;
+
+#endif /*_DTC_CAPTURE_DEFINED_*/
+
+#ifndef _DTC_LOCATE_DEFINED_
+#define _DTC_LOCATE_DEFINED_
+
+/* Tape position is in tach roller edges, about 8 per inch */
+#define DTC_TACH_EDGES_PER_INCH     8
+
+/* Locate states for DTC_IPCMSG_TAPE_POSITION.locate_state */
+#define DTC_LOCATE_IDLE             0       /* no locate in progress    */
+#define DTC_LOCATE_SHUTTLE          1       /* decelerating to target   */
+#define DTC_LOCATE_APPROACH         2       /* final approach velocity  */
+#define DTC_LOCATE_DONE             3       /* at target, stopping      */
+
+#endif /*_DTC_LOCATE_DEFINED_*/
+
 /***************************************************************************/
 /*** IPC MESSAGE OP-CODE TYPES *********************************************/
 /***************************************************************************/
@@ -97,6 +278,11 @@ typedef struct _DTC_CONFIG_DATA {
 #define DTC_OP_CONFIG_GET       101         /* get configuration data      */
 #define DTC_OP_CONFIG_SET       102         /* set configuration data      */
 #define DTC_OP_TRANSPORT_CMD    200         /* transport command requests  */
+#define DTC_OP_SERVO_TIMING     300         /* get servo loop timing stats */
+#define DTC_OP_CAPTURE_CTRL     301         /* servo capture config/status */
+#define DTC_OP_CAPTURE_READ     302         /* servo capture bulk read     */
+#define DTC_OP_SERVO_PROFILE    303         /* get servo stage cycle stats */
+#define DTC_OP_TAPE_POSITION    304         /* tape position and locate    */
 
 /***************************************************************************/
 /*** IPC MESSAGE DATA STRUCTURES *******************************************/
@@ -145,6 +331,72 @@ typedef struct _DTC_IPCMSG_TRANSPORT_CMD {
     uint16_t        param2;                 /* parameter flags */
 } DTC_IPCMSG_TRANSPORT_CMD;
 
+/*** GET SERVO LOOP TIMING STATS *******************************************/
+
+typedef struct _DTC_IPCMSG_SERVO_TIMING {
+    DTC_IPCMSG_HDR  hdr;
+    int32_t         reset;                  /* 1=reset stats after reading */
+    DTC_SERVO_TIMING timing;                /* servo timing stats returned */
+} DTC_IPCMSG_SERVO_TIMING;
+
+/*** GET SERVO LOOP STAGE PROFILE *****************************************/
+
+typedef struct _DTC_IPCMSG_SERVO_PROFILE {
+    DTC_IPCMSG_HDR  hdr;
+    int32_t         reset;                  /* 1=reset stats after reading */
+    DTC_SERVO_PROFILE profile;              /* stage cycle stats returned  */
+} DTC_IPCMSG_SERVO_PROFILE;
+
+/*** SERVO CAPTURE CONTROL *************************************************/
+
+/* Capture control commands for DTC_IPCMSG_CAPTURE_CTRL.cmd */
+#define DTC_CAPTURE_STATUS_GET      0       /* return config and status only */
+#define DTC_CAPTURE_CONFIG_SET      1       /* set config, stops any capture */
+#define DTC_CAPTURE_ARM             2       /* arm the capture               */
+#define DTC_CAPTURE_TRIGGER         3       /* manual trigger                */
+#define DTC_CAPTURE_STOP            4       /* stop (disarm) the capture     */
+
+typedef struct _DTC_IPCMSG_CAPTURE_CTRL {
+    DTC_IPCMSG_HDR      hdr;
+    int32_t             cmd;                /* DTC_CAPTURE_xxx command     */
+    DTC_CAPTURE_CONFIG  config;             /* config to set and returned  */
+    DTC_CAPTURE_STATUS  status;             /* capture status returned     */
+} DTC_IPCMSG_CAPTURE_CTRL;
+
+/*** SERVO CAPTURE BULK READ ***********************************************/
+
+#define DTC_CAPTURE_READ_WORDS      64      /* max data words per message */
+
+/* Reads up to 'count' samples starting at sample 'index' (0 = oldest) from
+ * a completed capture. On return 'count' is the number of samples returned
+ * and 'data' holds them in time order, each 'num_channels' words in channel
+ * bit order. The 'sequence' changes if the buffer is re-armed so a client
+ * can detect a capture replaced while it was reading.
+ */
+typedef struct _DTC_IPCMSG_CAPTURE_READ {
+    DTC_IPCMSG_HDR      hdr;
+    uint32_t            index;              /* first sample to read        */
+    uint32_t            count;              /* samples requested/returned  */
+    uint32_t            num_channels;       /* words per sample returned   */
+    uint32_t            sequence;           /* capture sequence number     */
+    float               data[DTC_CAPTURE_READ_WORDS];
+} DTC_IPCMSG_CAPTURE_READ;
+
+/*** TAPE POSITION AND LOCATE *********************************************/
+
+/* Tape position commands for DTC_IPCMSG_TAPE_POSITION.cmd */
+#define DTC_POSITION_GET            0       /* return position only      */
+#define DTC_POSITION_SET            1       /* preset the position count */
+#define DTC_POSITION_LOCATE         2       /* locate to the position    */
+
+typedef struct _DTC_IPCMSG_TAPE_POSITION {
+    DTC_IPCMSG_HDR      hdr;
+    int32_t             cmd;                /* DTC_POSITION_xxx command    */
+    int32_t             position;           /* position to set or locate   */
+    int32_t             current;            /* current position returned   */
+    uint32_t            locate_state;       /* DTC_LOCATE_xxx returned     */
+} DTC_IPCMSG_TAPE_POSITION;
+
 /* Transport command modes */
 typedef enum DTCTransportCommand {
     DTC_Transport_STOP,                     /* transport stop mode */
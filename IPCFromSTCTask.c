@@ -71,6 +71,7 @@
 #include <file.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
@@ -81,11 +82,15 @@
 #include "ServoTask.h"
 #include "TransportTask.h"
 #include "IPCFromSTCTask.h"
+#include "ServoCapture.h"
+#include "TapeTach.h"
 #include "IPCCMD.h"
 #include "IPCCMD_DTC1200.h"
 
 
-#define RXBUFSIZ    (sizeof(SYSPARMS) + 64)
+/* Receive buffer must hold the largest request or reply message */
+#define RXBUFSIZ    (((sizeof(SYSPARMS) > sizeof(DTC_IPCMSG_CAPTURE_READ)) ? \
+                       sizeof(SYSPARMS) : sizeof(DTC_IPCMSG_CAPTURE_READ)) + 64)
 
 /* Static Function Prototypes */
 static Void IPCFromSTC_Task(UArg a0, UArg a1);
@@ -94,6 +99,11 @@ static int HandleEPROM(IPCCMD_Handle handle, DTC_IPCMSG_CONFIG_EPROM* msg);
 static int HandleConfigSet(IPCCMD_Handle handle, DTC_IPCMSG_CONFIG_SET* msg);
 static int HandleConfigGet(IPCCMD_Handle handle, DTC_IPCMSG_CONFIG_GET* msg);
 static int HandleTransportCmd(IPCCMD_Handle handle, DTC_IPCMSG_TRANSPORT_CMD* msg);
+static int HandleServoTiming(IPCCMD_Handle handle, DTC_IPCMSG_SERVO_TIMING* msg);
+static int HandleServoProfile(IPCCMD_Handle handle, DTC_IPCMSG_SERVO_PROFILE* msg);
+static int HandleCaptureCtrl(IPCCMD_Handle handle, DTC_IPCMSG_CAPTURE_CTRL* msg);
+static int HandleCaptureRead(IPCCMD_Handle handle, DTC_IPCMSG_CAPTURE_READ* msg);
+static int HandleTapePosition(IPCCMD_Handle handle, DTC_IPCMSG_TAPE_POSITION* msg);
 
 //*****************************************************************************
 // Main Program Entry Point
@@ -237,6 +247,31 @@ Void IPCFromSTC_Task(UArg a0, UArg a1)
             rc =  HandleTransportCmd(ipcHandle, (DTC_IPCMSG_TRANSPORT_CMD*)msg);
             break;
 
+        case DTC_OP_SERVO_TIMING:
+            /* Get the servo loop timing stats */
+            rc = HandleServoTiming(ipcHandle, (DTC_IPCMSG_SERVO_TIMING*)msg);
+            break;
+
+        case DTC_OP_SERVO_PROFILE:
+            /* Get the servo loop stage cycle profile */
+            rc = HandleServoProfile(ipcHandle, (DTC_IPCMSG_SERVO_PROFILE*)msg);
+            break;
+
+        case DTC_OP_CAPTURE_CTRL:
+            /* Configure, arm or get status of the servo capture */
+            rc = HandleCaptureCtrl(ipcHandle, (DTC_IPCMSG_CAPTURE_CTRL*)msg);
+            break;
+
+        case DTC_OP_CAPTURE_READ:
+            /* Read a block of servo capture samples */
+            rc = HandleCaptureRead(ipcHandle, (DTC_IPCMSG_CAPTURE_READ*)msg);
+            break;
+
+        case DTC_OP_TAPE_POSITION:
+            /* Get or preset the tape position, or locate to it */
+            rc = HandleTapePosition(ipcHandle, (DTC_IPCMSG_TAPE_POSITION*)msg);
+            break;
+
         default:
             /* Transmit a NAK error response to client */
             rc = IPCCMD_WriteNAK(ipcHandle);
@@ -431,5 +466,186 @@ int HandleTransportCmd(
     return rc;
 }
 
+//*****************************************************************************
+// This method returns the servo loop tick period and execution time stats.
+// If the reset flag is set, the stats are cleared after they are read so
+// the next request covers a fresh measurement interval.
+//*****************************************************************************
+
+int HandleServoTiming(
+        IPCCMD_Handle handle,
+        DTC_IPCMSG_SERVO_TIMING* msg
+        )
+{
+    int rc;
+    SERVOTIMING timing;
+
+    Servo_GetTiming(&timing);
+
+    if (msg->reset)
+        Servo_ResetTiming();
+
+    memcpy(&(msg->timing), &timing, sizeof(msg->timing));
+
+    /* Set length of return data */
+    msg->hdr.length = sizeof(DTC_IPCMSG_SERVO_TIMING);
+
+    /* Write timing data plus ACK back to client */
+    rc = IPCCMD_WriteMessageACK(handle, &msg->hdr);
+
+    return rc;
+}
+
+//*****************************************************************************
+// This method returns the servo loop per stage cycle count profile and the
+// worst case tick breakdown. If the reset flag is set, the profile is
+// cleared after it is read.
+//*****************************************************************************
+
+int HandleServoProfile(
+        IPCCMD_Handle handle,
+        DTC_IPCMSG_SERVO_PROFILE* msg
+        )
+{
+    int rc;
+    SERVOPROFILE profile;
+
+    Servo_GetProfile(&profile);
+
+    if (msg->reset)
+        Servo_ResetProfile();
+
+    memcpy(&(msg->profile), &profile, sizeof(msg->profile));
+
+    /* Set length of return data */
+    msg->hdr.length = sizeof(DTC_IPCMSG_SERVO_PROFILE);
+
+    /* Write profile data plus ACK back to client */
+    rc = IPCCMD_WriteMessageACK(handle, &msg->hdr);
+
+    return rc;
+}
+
+//*****************************************************************************
+// This method sets the servo capture configuration or arms, triggers or
+// stops the capture, then returns the current configuration and status.
+//*****************************************************************************
+
+int HandleCaptureCtrl(
+        IPCCMD_Handle handle,
+        DTC_IPCMSG_CAPTURE_CTRL* msg
+        )
+{
+    int rc;
+    CAPTURE_CONFIG config;
+    CAPTURE_STATUS status;
+
+    switch(msg->cmd)
+    {
+    case DTC_CAPTURE_CONFIG_SET:
+        memcpy(&config, &(msg->config), sizeof(config));
+        Capture_Configure(&config);
+        break;
+
+    case DTC_CAPTURE_ARM:
+        Capture_Arm();
+        break;
+
+    case DTC_CAPTURE_TRIGGER:
+        Capture_Trigger();
+        break;
+
+    case DTC_CAPTURE_STOP:
+        Capture_Stop();
+        break;
+
+    default:
+        break;
+    }
+
+    Capture_GetConfig(&config);
+    Capture_GetStatus(&status);
+
+    memcpy(&(msg->config), &config, sizeof(msg->config));
+    memcpy(&(msg->status), &status, sizeof(msg->status));
+
+    /* Set length of return data */
+    msg->hdr.length = sizeof(DTC_IPCMSG_CAPTURE_CTRL);
+
+    /* Write capture status plus ACK back to client */
+    rc = IPCCMD_WriteMessageACK(handle, &msg->hdr);
+
+    return rc;
+}
+
+//*****************************************************************************
+// This method returns a block of samples from a completed servo capture.
+// The servo loop keeps running, the capture is frozen once complete so the
+// data can be read out in as many blocks as needed.
+//*****************************************************************************
+
+int HandleCaptureRead(
+        IPCCMD_Handle handle,
+        DTC_IPCMSG_CAPTURE_READ* msg
+        )
+{
+    int rc;
+
+    /* Samples, channels and sequence all come from one locked read,
+     * limited to the samples that fit in the message.
+     */
+    msg->count = Capture_Read(msg->index, msg->count, msg->data, DTC_CAPTURE_READ_WORDS,
+                              &msg->num_channels, &msg->sequence);
+
+    /* Set length of return data */
+    msg->hdr.length = offsetof(DTC_IPCMSG_CAPTURE_READ, data) +
+                      (msg->count * msg->num_channels * sizeof(float));
+
+    /* Write capture data plus ACK back to client */
+    rc = IPCCMD_WriteMessageACK(handle, &msg->hdr);
+
+    return rc;
+}
+
+//*****************************************************************************
+// This method presets the tape position counter or starts a locate to an
+// absolute position, then returns the current position and locate state.
+// The locate runs asynchronously, the client polls for completion.
+//*****************************************************************************
+
+int HandleTapePosition(
+        IPCCMD_Handle handle,
+        DTC_IPCMSG_TAPE_POSITION* msg
+        )
+{
+    int rc;
+
+    switch(msg->cmd)
+    {
+    case DTC_POSITION_SET:
+        TapeTach_setPosition(msg->position);
+        break;
+
+    case DTC_POSITION_LOCATE:
+        if (!Servo_IsMode(MODE_HALT))
+            QueueTransportLocate(msg->position, 0);
+        break;
+
+    default:
+        break;
+    }
+
+    msg->current      = TapeTach_getPosition();
+    msg->locate_state = Servo_GetLocateState();
+
+    /* Set length of return data */
+    msg->hdr.length = sizeof(DTC_IPCMSG_TAPE_POSITION);
+
+    /* Write position data plus ACK back to client */
+    rc = IPCCMD_WriteMessageACK(handle, &msg->hdr);
+
+    return rc;
+}
+
 /* End-Of-File */
 
@@ -207,7 +207,7 @@ void DispatchTransportTransaction(IPC_MSG* msg, IPC_MSG* reply)
     switch(msg->opcode)
     {
     case OP_TRANSPORT_GET_MODE:                     /* return transport mode */
-        reply->param1.U = g_servo.mode;
+        reply->param1.U = Servo_GetMode();
         reply->param2.U = (g_high_speed_flag) ? 30 : 15;
         break;
 
@@ -220,6 +220,11 @@ void DispatchTransportTransaction(IPC_MSG* msg, IPC_MSG* reply)
         reply->param1.F = g_servo.tape_tach;
         reply->param2.F = 0.0f;
         break;
+
+    case OP_TRANSPORT_GET_CURRENT:                  /* return reel motor currents */
+        reply->param1.F = g_servo.current_supply.current;
+        reply->param2.F = g_servo.current_takeup.current;
+        break;
     }
 }
 
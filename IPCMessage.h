@@ -25,6 +25,7 @@
 #define OP_NOTIFY_TRANSPORT			101
 #define OP_NOTIFY_EOT               102
 #define OP_NOTIFY_LAMP              103
+#define OP_NOTIFY_STOP_TIME         104     /* param1 ms, param2 velocity */
 
 /* IPC_TYPE_CONFIG Operation codes from STC to DTC */
 #define OP_GET_SHUTTLE_VELOCITY     200
@@ -41,5 +42,6 @@
 #define OP_TRANSPORT_GET_MODE       320     /* get current transport mode */
 #define OP_TRANSPORT_GET_VELOCITY   321
 #define OP_TRANSPORT_GET_TACH       322
+#define OP_TRANSPORT_GET_CURRENT    323     /* get reel motor currents */
 
 #endif /* _IPCMESSAGE_H_ */
@@ -45,12 +45,15 @@
 #include <xdc/runtime/System.h>
 #include <xdc/runtime/Error.h>
 #include <xdc/runtime/Gate.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
 
 /* BIOS Header files */
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Mailbox.h>
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/family/arm/m3/Hwi.h>
 
 /* TI-RTOS Driver files */
 #include <ti/drivers/GPIO.h>
@@ -77,10 +80,46 @@
 #include "MotorDAC.h"
 #include "Globals.h"
 
+/* TLV5637 command words. R1 is bit 15 and R0 is bit 12 of each word. */
+#define TLV_DAC_B           0x0000      /* write DAC B and BUFFER           */
+#define TLV_BUFFER          0x1000      /* write BUFFER only                */
+#define TLV_DAC_A           0x8000      /* write DAC A, update B from BUFFER */
+#define TLV_CONTROL         0x9000      /* write CONTROL register           */
+#define TLV_REF_1024        0x0001      /* internal 1.024V reference        */
+
+/* 10-bit code in D11-D2. The amp gives full torque at the low end. */
+#define TLV_CODE(dac)       ((uint16_t)(((DAC_MAX - (dac)) & 0x3FF) << 2))
+
+#define DAC_SEQ_MAX         3           /* control, buffer, DAC A           */
+#define DAC_CODE_UNKNOWN    0xFFFFFFFF  /* latch contents not known         */
+
 static SPI_Handle g_handleSpi0 = 0;
 
+/* Word sequence being sent, one word per chip select frame */
+static uint16_t s_seqWord[DAC_SEQ_MAX];
+static uint16_t s_seqReply;
+static uint32_t s_seqCount;
+static uint32_t s_seqIndex;
+static uint32_t s_seqStart;
+static SPI_Transaction s_transaction;
+
+/* Driver state shared with the SPI callback */
+static volatile bool s_busy = false;
+static volatile bool s_pending = false;
+static bool s_control = false;
+static uint32_t s_latchA = DAC_CODE_UNKNOWN;
+static uint32_t s_latchB = DAC_CODE_UNKNOWN;
+static uint32_t s_reqA;
+static uint32_t s_reqB;
+
+static uint32_t s_cycles_per_usec = 1;
+static MOTORDAC_STATS s_stats;
+
 extern Semaphore_Handle g_semaSPI;
 
+static void MotorDAC_start(void);
+static void MotorDAC_callback(SPI_Handle handle, SPI_Transaction* transaction);
+
 //*****************************************************************************
 // Initialize and open various system peripherals we'll be using
 //*****************************************************************************
@@ -88,21 +127,36 @@ extern Semaphore_Handle g_semaSPI;
 void MotorDAC_initialize(void)
 {
 	SPI_Params spiParams;
+	Types_FreqHz freq;
 
 	/* Deassert the DAC chip select */
 	GPIO_write(Board_CS_SPI0, PIN_HIGH);
 
+	/* Transfer times are kept in usec */
+	Timestamp_getFreq(&freq);
+	s_cycles_per_usec = (freq.lo >= 1000000) ? (freq.lo / 1000000) : 1;
+
+	memset(&s_stats, 0, sizeof(s_stats));
+
+	/* Nothing is known to be in the DAC yet, the first write sends all */
+	s_busy    = false;
+	s_pending = false;
+	s_control = false;
+	s_latchA  = s_latchB = DAC_CODE_UNKNOWN;
+
 	/* Open SSI-0 to the TLV5637 DAC motor drive amp driver */
 
-	/* Moto fmt, polarity 1, phase 0 */
+	/* Moto fmt, polarity 1, phase 0. Transfers are queued to the uDMA
+	 * and complete in the callback, the servo loop doesn't wait on them.
+	 */
     SPI_Params_init(&spiParams);
 
-    spiParams.transferMode	= SPI_MODE_BLOCKING;
+    spiParams.transferMode	= SPI_MODE_CALLBACK;
     spiParams.mode 			= SPI_MASTER;
     spiParams.frameFormat 	= SPI_POL1_PHA0;
     spiParams.bitRate 		= 1000000;
 	spiParams.dataSize 		= 16;
-	spiParams.transferCallbackFxn = NULL;
+	spiParams.transferCallbackFxn = MotorDAC_callback;
 
 	g_handleSpi0 = SPI_open(Board_SPI0, &spiParams);
 
@@ -133,69 +187,297 @@ void MotorDAC_initialize(void)
 //      DAC A - is the SUPPLY motor torque level
 //      DAC B - is the TAKEUP motor torque level
 //
+// Only the words needed to move the outputs to the new codes are sent.
+// The control register is written once, and again after a failed transfer
+// leaves the DAC state unknown. The call doesn't block, if a sequence is
+// still going out the new codes are sent when it completes.
+//
 //*****************************************************************************
 
 void MotorDAC_write(float supply_dac, float takeup_dac)
 {
-	uint16_t ulWord;
-	uint16_t ulReply;
-	uint16_t ulDac;
-	bool transferOK;
-	SPI_Transaction transaction;
+    UInt key;
+
+    /* DEBUG - save current values */
+    g_servo.dac_supply = supply_dac;
+    g_servo.dac_takeup = takeup_dac;
+
+    key = Hwi_disable();
+
+    ++s_stats.writes;
+
+    s_reqA = (uint32_t)supply_dac & DAC_MAX;
+    s_reqB = (uint32_t)takeup_dac & DAC_MAX;
+
+    if (s_busy)
+    {
+        /* The callback picks up the latest codes */
+        s_pending = true;
+        ++s_stats.coalesced;
+    }
+    else
+    {
+        MotorDAC_start();
+    }
+
+    Hwi_restore(key);
+}
+
+//*****************************************************************************
+// Build the word sequence from the requested codes and start it. Called
+// with interrupts disabled, or from the SPI callback.
+//
+//      both changed    - B to BUFFER, then A updating A and B together
+//      supply changed  - A, updating B from the BUFFER it already holds
+//      takeup changed  - B and BUFFER
+//
+//*****************************************************************************
+
+static void MotorDAC_start(void)
+{
+    uint32_t n = 0;
+    bool changeA = (s_reqA != s_latchA) ? true : false;
+    bool changeB = (s_reqB != s_latchB) ? true : false;
+
+    s_pending = false;
+
+    if (!s_control)
+        s_seqWord[n++] = TLV_CONTROL | TLV_REF_1024;
+
+    if (changeA && changeB)
+    {
+        s_seqWord[n++] = TLV_BUFFER | TLV_CODE(s_reqB);
+        s_seqWord[n++] = TLV_DAC_A  | TLV_CODE(s_reqA);
+    }
+    else if (changeA)
+    {
+        s_seqWord[n++] = TLV_DAC_A  | TLV_CODE(s_reqA);
+    }
+    else if (changeB)
+    {
+        s_seqWord[n++] = TLV_DAC_B  | TLV_CODE(s_reqB);
+    }
+
+    if (!n)
+    {
+        ++s_stats.unchanged;
+        return;
+    }
+
+    /* Latched codes are taken as sent, a failure clears them */
+    s_control  = true;
+    s_latchA   = s_reqA;
+    s_latchB   = s_reqB;
+
+    s_seqCount = n;
+    s_seqIndex = 0;
+    s_seqStart = Timestamp_get32();
+    s_busy     = true;
+
+    ++s_stats.sequences;
+
+    s_transaction.count = 1;
+    s_transaction.txBuf = (Ptr)&s_seqWord[0];
+    s_transaction.rxBuf = (Ptr)&s_seqReply;
+
+    GPIO_write(Board_CS_SPI0, PIN_LOW);
+
+    if (!SPI_transfer(g_handleSpi0, &s_transaction))
+    {
+        GPIO_write(Board_CS_SPI0, PIN_HIGH);
+
+        ++s_stats.errors;
+
+        s_control = false;
+        s_latchA  = s_latchB = DAC_CODE_UNKNOWN;
+        s_busy    = false;
+    }
+}
+
+//*****************************************************************************
+// SPI transfer complete callback. Raising the chip select latches the word
+// into the DAC, then the next word of the sequence is started. At the end
+// of the sequence any codes written meanwhile are sent.
+//*****************************************************************************
+
+static void MotorDAC_callback(SPI_Handle handle, SPI_Transaction* transaction)
+{
+    uint32_t usec;
 
-    //if (Semaphore_pend(g_semaSPI, TIMEOUT_SPI))
+    GPIO_write(Board_CS_SPI0, PIN_HIGH);
+
+    if (transaction->status != SPI_TRANSFER_COMPLETED)
     {
-		/* DEBUG - save current values */
-		g_servo.dac_supply = supply_dac;
-		g_servo.dac_takeup = takeup_dac;
+        /* Resend everything on the next write */
+        ++s_stats.errors;
+
+        s_control = false;
+        s_latchA  = s_latchB = DAC_CODE_UNKNOWN;
+    }
+    else
+    {
+        ++s_stats.words;
+
+        if (++s_seqIndex < s_seqCount)
+        {
+            s_transaction.count = 1;
+            s_transaction.txBuf = (Ptr)&s_seqWord[s_seqIndex];
+            s_transaction.rxBuf = (Ptr)&s_seqReply;
+
+            GPIO_write(Board_CS_SPI0, PIN_LOW);
+
+            if (SPI_transfer(handle, &s_transaction))
+                return;
+
+            GPIO_write(Board_CS_SPI0, PIN_HIGH);
+
+            ++s_stats.errors;
 
-		uint32_t supply = (uint32_t)supply_dac;
-	    uint32_t takeup = (uint32_t)takeup_dac;
+            s_control = false;
+            s_latchA  = s_latchB = DAC_CODE_UNKNOWN;
+        }
+    }
 
-		takeup = DAC_MAX - takeup;
-		supply = DAC_MAX - supply;
+    usec = (Timestamp_get32() - s_seqStart) / s_cycles_per_usec;
 
-		/* (1) Set reference voltage to 1.024 V (CONTROL register) */
+    s_stats.xfer_usec = usec;
 
-		ulWord = (1 << 15) | (1 << 12) | 0x01;
+    if (usec > s_stats.xfer_max)
+        s_stats.xfer_max = usec;
 
-		transaction.count = 1;
-		transaction.txBuf = (Ptr)&ulWord;
-		transaction.rxBuf = (Ptr)&ulReply;
+    s_busy = false;
 
-		GPIO_write(Board_CS_SPI0, PIN_LOW);
-		transferOK = SPI_transfer(g_handleSpi0, &transaction);
-		GPIO_write(Board_CS_SPI0, PIN_HIGH);
+    if (s_pending)
+        MotorDAC_start();
+}
 
-		/* (2) Write data for DAC B to BUFFER */
+//*****************************************************************************
+// Motor DAC calibration tables. Each reel has a table of the DAC code that
+// gives the torque at DAC_CAL_POINTS breakpoints spaced evenly over 0 to
+// DAC_MAX, in the same torque units the servo loop commands. A table is
+// built from the motor current measured at a sweep of DAC codes, and
+// undoes the amp gain error, deadband and bow.
+//*****************************************************************************
 
-		ulDac  = (takeup & 0x3FF) << 2;
-		ulWord = (1 << 12) | (uint16_t)ulDac;
+void MotorDAC_initCal(float* table)
+{
+    uint32_t i;
 
-		transaction.count = 1;
-		transaction.txBuf = (Ptr)&ulWord;
-		transaction.rxBuf = (Ptr)&ulReply;
+    for (i=0; i < DAC_CAL_POINTS; i++)
+        table[i] = ((float)i * DAC_MAX_F) / (float)(DAC_CAL_POINTS - 1);
+}
 
-		GPIO_write(Board_CS_SPI0, PIN_LOW);
-		transferOK = SPI_transfer(g_handleSpi0, &transaction);
-		GPIO_write(Board_CS_SPI0, PIN_HIGH);
+//*****************************************************************************
+// Build a calibration table from the torque measured at count DAC codes
+// spaced evenly over 0 to DAC_MAX. The measured curve is taken as rising,
+// noise is held at the running peak, and inverted by linear interpolation.
+// Torque beyond the top of the sweep is reached at DAC_MAX. Returns false
+// and leaves the table alone if the sweep shows no usable response.
+//*****************************************************************************
 
-		/* (3) Write DAC A value and update DAC A & B simultaneously */
+bool MotorDAC_buildCal(const float* measured, uint32_t count, float* table)
+{
+    uint32_t i, k;
+    float lo, hi, peak;
+    float step = DAC_MAX_F / (float)(count - 1);
+    float cal[DAC_CAL_POINTS];
 
-		ulDac  = (supply & 0x3FF) << 2;
-		ulWord = (1 << 15) | (uint16_t)ulDac;
+    if (count < 2)
+        return false;
 
-		transaction.count = 1;
-		transaction.txBuf = (Ptr)&ulWord;
-		transaction.rxBuf = (Ptr)&ulReply;
+    /* Needs at least half scale torque at full scale code */
+    if (measured[count - 1] < (DAC_MAX_F * 0.5f))
+        return false;
 
-		GPIO_write(Board_CS_SPI0, PIN_LOW);
-		transferOK = SPI_transfer(g_handleSpi0, &transaction);
-		GPIO_write(Board_CS_SPI0, PIN_HIGH);
+    i    = 1;
+    peak = measured[0];
 
-		//Semaphore_post(g_semaSPI);
+    for (k=0; k < DAC_CAL_POINTS; k++)
+    {
+        float torque = ((float)k * DAC_MAX_F) / (float)(DAC_CAL_POINTS - 1);
+
+        /* Find the first code step reaching the torque */
+        while ((i < count) && (((measured[i] > peak) ? measured[i] : peak) < torque))
+        {
+            if (measured[i] > peak)
+                peak = measured[i];
+            ++i;
+        }
+
+        if (torque <= measured[0])
+        {
+            cal[k] = 0.0f;
+        }
+        else if (i >= count)
+        {
+            cal[k] = DAC_MAX_F;
+        }
+        else
+        {
+            lo = peak;
+            hi = (measured[i] > peak) ? measured[i] : peak;
+
+            cal[k] = step * ((float)(i - 1) + ((hi > lo) ? ((torque - lo) / (hi - lo)) : 1.0f));
+        }
     }
 
-    if (!transferOK)
-    	System_printf("DAC SPI write failed!\n");
+    /* Zero torque sits at the edge of any deadband, carried down from
+     * the first two breakpoints.
+     */
+    cal[0] = (2.0f * cal[1]) - cal[2];
+
+    if (cal[0] < 0.0f)
+        cal[0] = 0.0f;
+
+    memcpy(table, cal, sizeof(cal));
+
+    return true;
 }
+
+//*****************************************************************************
+// Look up the DAC code for a torque in a calibration table.
+//*****************************************************************************
+
+float MotorDAC_linearize(const float* table, float torque)
+{
+    uint32_t i;
+    float x;
+
+    if (torque <= 0.0f)
+        return table[0];
+
+    if (torque >= DAC_MAX_F)
+        return table[DAC_CAL_POINTS - 1];
+
+    x = (torque * (float)(DAC_CAL_POINTS - 1)) / DAC_MAX_F;
+    i = (uint32_t)x;
+
+    if (i >= (DAC_CAL_POINTS - 1))
+        i = DAC_CAL_POINTS - 2;
+
+    return table[i] + ((x - (float)i) * (table[i + 1] - table[i]));
+}
+
+//*****************************************************************************
+// Motor DAC driver counters
+//*****************************************************************************
+
+void MotorDAC_getStats(MOTORDAC_STATS* stats)
+{
+    UInt key = Hwi_disable();
+
+    memcpy(stats, &s_stats, sizeof(MOTORDAC_STATS));
+
+    Hwi_restore(key);
+}
+
+void MotorDAC_resetStats(void)
+{
+    UInt key = Hwi_disable();
+
+    memset(&s_stats, 0, sizeof(MOTORDAC_STATS));
+
+    Hwi_restore(key);
+}
+
+/* End-Of-File */
@@ -51,7 +51,25 @@
         dac = max;                  \
 }                                   \
 
+/* Motor DAC driver transfer counters */
+typedef struct _MOTORDAC_STATS {
+    uint32_t    writes;                 /* MotorDAC_write() calls        */
+    uint32_t    unchanged;              /* writes with no code change    */
+    uint32_t    sequences;              /* word sequences sent           */
+    uint32_t    words;                  /* SPI words sent                */
+    uint32_t    coalesced;              /* writes made while busy        */
+    uint32_t    errors;                 /* failed SPI transfers          */
+    uint32_t    xfer_usec;              /* last sequence transfer time   */
+    uint32_t    xfer_max;               /* max sequence transfer time    */
+} MOTORDAC_STATS;
+
 void MotorDAC_initialize(void);
 void MotorDAC_write(float supply_dac, float takeup_dac);
+void MotorDAC_getStats(MOTORDAC_STATS* stats);
+void MotorDAC_resetStats(void);
+
+void MotorDAC_initCal(float* table);
+bool MotorDAC_buildCal(const float* measured, uint32_t count, float* table);
+float MotorDAC_linearize(const float* table, float torque);
 
 #endif
@@ -66,6 +66,41 @@ void fpid_init(
     p->dState = 0.0f;
 }
 
+/*
+ * Function:    fpid_gains()
+ *
+ * Synopsis:    void fpid_gains(p, Kp, Ki, Kd)
+ *
+ *              PID* p;             - Pointer to PID data structure.
+ *              float Kp;           - Proportional gain
+ *              float Ki;           - Integral gain
+ *              float Kd;           - Derivative gain
+ *
+ * Description: Changes the gains of a running PID without resetting it,
+ *              for gain scheduling. The integrator holds the error sum,
+ *              so it is rescaled by the old over the new integral gain
+ *              to keep the integral term, and the CV, continuous.
+ *
+ * Returns:     void
+ */
+
+void fpid_gains(FPID* p, float Kp, float Ki, float Kd)
+{
+    if ((p->Ki > 0.0f) && (Ki > 0.0f) && (Ki != p->Ki))
+    {
+        p->iState *= p->Ki / Ki;
+
+        if (p->iState > p->iMax)
+            p->iState = p->iMax;
+        else if (p->iState < p->iMin)
+            p->iState = p->iMin;
+    }
+
+    p->Kp = Kp;
+    p->Ki = Ki;
+    p->Kd = Kd;
+}
+
 /*
  * Function:    fpid_calc()
  *
@@ -136,4 +171,474 @@ float fpid_calc(FPID* p, float setpoint, float actual)
     return cv;
 }
 
+/*******************************************************************************
+ * FIXED POINT PID FUNCTIONS
+ ******************************************************************************/
+
+/* Saturate a 64-bit intermediate to the 32-bit Q15 range */
+
+static inline int32_t q15_sat(int64_t x)
+{
+    if (x > (int64_t)INT32_MAX)
+        return INT32_MAX;
+    else if (x < (int64_t)INT32_MIN)
+        return INT32_MIN;
+
+    return (int32_t)x;
+}
+
+/*
+ * Function:    qpid_init()
+ *
+ * Synopsis:    void qpid_init(p, Kp, Ki, Kd, cvmax, cvmin, tolerance)
+ *
+ *              QPID* p;            - Pointer to PID data structure.
+ *              float Kp;           - Proportional gain
+ *              float Ki;           - Integral gain
+ *              float Kd;           - Derivative gain
+ *              float cvmax;        - Maximum CV value allowed
+ *              float cvmin;        - Minimum CV value allowed
+ *              float tolerance;    - Error tolerance
+ *
+ * Description: Same as fpid_init() for the fixed point PID. The float
+ *              gains and limits are converted to Q15, rounded to nearest.
+ *
+ * Returns:     void
+ */
+
+void qpid_init(
+    QPID*   p,
+    float   Kp,
+    float   Ki,
+    float   Kd,
+    float   cvmax,
+    float   cvmin,
+    float   tolerance
+    )
+{
+    /* maximum CV range allowed (eg, DAC max) */
+    p->iMax = PID_F_TO_Q15(cvmax);
+    p->iMin = PID_F_TO_Q15(cvmin);
+
+    /* dead-band error tolerance we'll allow */
+    p->tolerance = PID_F_TO_Q15(tolerance);
+
+    /* initialize PID variables */
+    p->Kp = PID_F_TO_Q15(Kp);     /* proportional gain */
+    p->Ki = PID_F_TO_Q15(Ki);     /* integral gain */
+    p->Kd = PID_F_TO_Q15(Kd);     /* derivative gain */
+
+    /* zero out accumulators */
+    p->error  = 0;
+
+    p->iState = 0;
+    p->dState = 0;
+}
+
+/*
+ * Function:    qpid_gains()
+ *
+ * Synopsis:    void qpid_gains(p, Kp, Ki, Kd)
+ *
+ *              QPID* p;            - Pointer to PID data structure.
+ *              float Kp;           - Proportional gain
+ *              float Ki;           - Integral gain
+ *              float Kd;           - Derivative gain
+ *
+ * Description: Fixed point version of fpid_gains(). The integrator is
+ *              rescaled in 64-bits and saturated before the usual
+ *              iMin/iMax limiting.
+ *
+ * Returns:     void
+ */
+
+void qpid_gains(QPID* p, float Kp, float Ki, float Kd)
+{
+    int32_t ki = PID_F_TO_Q15(Ki);
+
+    if ((p->Ki > 0) && (ki > 0) && (ki != p->Ki))
+    {
+        p->iState = q15_sat(((int64_t)p->iState * (int64_t)p->Ki) / (int64_t)ki);
+
+        if (p->iState > p->iMax)
+            p->iState = p->iMax;
+        else if (p->iState < p->iMin)
+            p->iState = p->iMin;
+    }
+
+    p->Kp = PID_F_TO_Q15(Kp);
+    p->Ki = ki;
+    p->Kd = PID_F_TO_Q15(Kd);
+}
+
+/*
+ * Function:    qpid_calc()
+ *
+ * Synopsis:    int32_t qpid_calc(p, setpoint, actual)
+ *
+ *              QPID* p;            - Pointer to PID data structure.
+ *              int32_t setpoint;   - Desired setpoint value (Q15).
+ *              int32_t actual;     - Actual measured value (Q15).
+ *
+ * Description: Fixed point version of fpid_calc() with the same control
+ *              law, integrator limiting and output clamping.
+ *
+ *              Saturation: the error and the integrator sum are computed
+ *              in 64-bits and saturated to 32-bits, the integrator is then
+ *              limited to iMin/iMax exactly as the float version.
+ *
+ *              Rounding: the three gain products are formed as 64-bit
+ *              Q30 values and summed without loss, then rounded once to
+ *              Q15 by adding half an LSB and shifting right (round to
+ *              nearest, ties toward +infinity). The result is clamped to
+ *              iMin/iMax, so it never wraps.
+ *
+ * Returns:     The PID output control variable (CV) value in Q15.
+ */
+
+int32_t qpid_calc(QPID* p, int32_t setpoint, int32_t actual)
+{
+    int64_t acc;
+    int32_t cv;
+
+    /* Calculate the setpoint error */
+    p->error = q15_sat((int64_t)setpoint - (int64_t)actual);
+
+    /* Calculate the integral state with appropriate limiting */
+    p->iState = q15_sat((int64_t)p->iState + (int64_t)p->error);
+
+    if (p->iState > p->iMax)
+        p->iState = p->iMax;
+    else if (p->iState < p->iMin)
+        p->iState = p->iMin;
+
+    /* Proportional plus integral terms (Q30) */
+    acc  = (int64_t)p->Kp * (int64_t)p->error;
+    acc += (int64_t)p->Ki * (int64_t)p->iState;
+
+    /* Derivative term on the setpoint, same as the float version */
+    acc -= (int64_t)p->Kd * ((int64_t)setpoint - (int64_t)p->dState);
+    p->dState = setpoint;
+
+    /* Round to nearest and scale back to Q15 */
+    cv = q15_sat((acc + (1LL << (PID_Q15_SHIFT - 1))) >> PID_Q15_SHIFT);
+
+    /* Clamp CV to allowed range if necessary */
+    if (cv < p->iMin)
+        cv = p->iMin;
+    else if (cv > p->iMax)
+        cv = p->iMax;
+
+    return cv;
+}
+
+/*******************************************************************************
+ * IMPROVED FLOATING POINT PID FUNCTIONS
+ ******************************************************************************/
+
+/* Default derivative filter Tf = Td/N and tracking time Tt = sqrt(Ti*Td),
+ * or Tt = Ti with no derivative action, from the continuous time gains.
+ */
+
+static void ipid_times(IPID* p, float* Tf, float* Tt)
+{
+    float Ti, Td;
+
+    *Tf = 0.0f;
+    *Tt = 0.0f;
+
+    if (p->Kp > 0.0f)
+    {
+        Td = p->Kd / p->Kp;
+        *Tf = Td / PID_D_FILTER_N;
+
+        if (p->Ki > 0.0f)
+        {
+            Ti = p->Kp / p->Ki;
+            *Tt = (Td > 0.0f) ? sqrtf(Ti * Td) : Ti;
+        }
+    }
+}
+
+/* Clamp the integral term to its limits */
+
+static inline float ipid_ilimit(IPID* p, float i)
+{
+    if (i > p->iMax)
+        return p->iMax;
+    else if (i < p->iMin)
+        return p->iMin;
+
+    return i;
+}
+
+/*
+ * Function:    ipid_init()
+ *
+ * Synopsis:    void ipid_init(p, Kp, Ki, Kd, cvmax, cvmin, tolerance)
+ *
+ *              IPID* p;            - Pointer to PID data structure.
+ *              float Kp;           - Proportional gain
+ *              float Ki;           - Integral gain per sample
+ *              float Kd;           - Derivative gain per sample
+ *              float cvmax;        - Maximum CV value allowed
+ *              float cvmin;        - Minimum CV value allowed
+ *              float tolerance;    - Error tolerance
+ *
+ * Description: Initializes the improved PID. The gains are given in the
+ *              same per sample units as fpid_init() so the configured
+ *              servo gains carry over unchanged. They are converted to
+ *              continuous time using PID_SAMPLE_TIME_F, after which the
+ *              sample time may be changed with ipid_setup() without
+ *              retuning. The derivative filter and the anti-windup
+ *              tracking time are set to their defaults from Ti and Td.
+ *
+ *              The integral term may use the whole CV range. Windup is
+ *              bounded by the back-calculation or conditional integration
+ *              in ipid_calc() and by ipid_track() where the caller limits
+ *              the CV further, not by holding the integral to Ki times the
+ *              CV limits as the fpid error sum clamp does.
+ *
+ * Returns:     void
+ */
+
+void ipid_init(
+    IPID*   p,
+    float   Kp,
+    float   Ki,
+    float   Kd,
+    float   cvmax,
+    float   cvmin,
+    float   tolerance
+    )
+{
+    float Ts = PID_SAMPLE_TIME_F;
+    float Tf, Tt;
+
+    /* CV output limits (eg, DAC max) */
+    p->cvMax = cvmax;
+    p->cvMin = cvmin;
+
+    /* dead-band error tolerance we'll allow */
+    p->tolerance = tolerance;
+
+    /* continuous time gains */
+    p->Kp = Kp;
+    p->Ki = Ki / Ts;
+    p->Kd = Kd * Ts;
+
+    ipid_times(p, &Tf, &Tt);
+    ipid_setup(p, Ts, Tf, Tt);
+
+    /* zero out accumulators */
+    p->error   = 0.0f;
+    p->iState  = 0.0f;
+    p->dState  = 0.0f;
+    p->pvState = 0.0f;
+    p->cv      = 0.0f;
+    p->iDelta  = 0.0f;
+    p->first   = 1;
+}
+
+/*
+ * Function:    ipid_setup()
+ *
+ * Synopsis:    void ipid_setup(p, Ts, Tf, Tt)
+ *
+ *              IPID* p;            - Pointer to PID data structure.
+ *              float Ts;           - Sample time in seconds
+ *              float Tf;           - Derivative filter time constant
+ *              float Tt;           - Anti-windup tracking time constant,
+ *                                    zero selects conditional integration.
+ *
+ * Description: Sets the sample time and filter constants and computes the
+ *              discrete coefficients and the integral term limits. The
+ *              tracking time is limited to no less than one sample so the
+ *              back-calculation is stable.
+ *
+ * Returns:     void
+ */
+
+void ipid_setup(IPID* p, float Ts, float Tf, float Tt)
+{
+    if (Tf < 0.0f)
+        Tf = 0.0f;
+
+    if ((Tt > 0.0f) && (Tt < Ts))
+        Tt = Ts;
+
+    p->Ts = Ts;
+    p->Tf = Tf;
+    p->Tt = Tt;
+
+    /* Backward difference first order derivative filter */
+    p->ad = Tf / (Tf + Ts);
+    p->bd = p->Kd / (Tf + Ts);
+
+    /* Forward Euler integrator and back-calculation gains */
+    p->bi = p->Ki * Ts;
+    p->bt = (Tt > 0.0f) ? (Ts / Tt) : 0.0f;
+
+    /* Integral term limits, the full CV range */
+    p->iMax = p->cvMax;
+    p->iMin = p->cvMin;
+}
+
+/*
+ * Function:    ipid_gains()
+ *
+ * Synopsis:    void ipid_gains(p, Kp, Ki, Kd)
+ *
+ *              IPID* p;            - Pointer to PID data structure.
+ *              float Kp;           - Proportional gain
+ *              float Ki;           - Integral gain per sample
+ *              float Kd;           - Derivative gain per sample
+ *
+ * Description: Changes the gains of a running PID without resetting it,
+ *              in the same per sample units as ipid_init(). The integral
+ *              term is held in CV units so it carries over unchanged.
+ *              The derivative filter and tracking time are recomputed from
+ *              the new gains as ipid_init() does, so a gain schedule moves
+ *              them too.
+ *
+ * Returns:     void
+ */
+
+void ipid_gains(IPID* p, float Kp, float Ki, float Kd)
+{
+    float Tf, Tt;
+
+    p->Kp = Kp;
+    p->Ki = Ki / PID_SAMPLE_TIME_F;
+    p->Kd = Kd * PID_SAMPLE_TIME_F;
+
+    ipid_times(p, &Tf, &Tt);
+    ipid_setup(p, p->Ts, Tf, Tt);
+}
+
+/*
+ * Function:    ipid_calc()
+ *
+ * Synopsis:    float ipid_calc(p, setpoint, actual)
+ *
+ *              IPID* p;            - Pointer to PID data structure.
+ *              float setpoint;     - Desired setpoint value.
+ *              float actual;       - Actual measured value from sensor.
+ *
+ * Description: Called once per sample time. The derivative term acts on
+ *              the measurement only, so setpoint steps do not kick the
+ *              output, and is low pass filtered with time constant Tf.
+ *
+ *              The current error is integrated before the output is
+ *              formed, like the fpid error sum. With back-calculation the
+ *              difference between the clamped and the unclamped output is
+ *              then fed back into the integrator with gain Ts/Tt, bleeding
+ *              it off while the output is saturated. With conditional
+ *              integration (Tt zero) the new error isn't integrated
+ *              whenever the output is saturated and the error would drive
+ *              it further into saturation.
+ *
+ * Returns:     The PID output control variable (CV) value.
+ */
+
+float ipid_calc(IPID* p, float setpoint, float actual)
+{
+    float cv;
+    float v;
+    float pTerm;
+    float iTerm;
+
+    /* No history on the first call, avoid a derivative kick */
+    if (p->first)
+    {
+        p->pvState = actual;
+        p->first = 0;
+    }
+
+    /* Calculate the setpoint error */
+    p->error = setpoint - actual;
+
+    /* Calculate the proportional term */
+    pTerm = p->Kp * p->error;
+
+    /* Filtered derivative of the measurement */
+    p->dState = (p->ad * p->dState) - (p->bd * (actual - p->pvState));
+    p->pvState = actual;
+
+    /* Integrate the current error */
+    iTerm = ipid_ilimit(p, p->iState + (p->bi * p->error));
+
+    /* Unclamped and clamped CV */
+    v = pTerm + iTerm + p->dState;
+
+    if (v > p->cvMax)
+        cv = p->cvMax;
+    else if (v < p->cvMin)
+        cv = p->cvMin;
+    else
+        cv = v;
+
+    /* Anti-windup on the integrator */
+    if (p->bt > 0.0f)
+    {
+        iTerm = ipid_ilimit(p, iTerm + (p->bt * (cv - v)));
+    }
+    else if (!((cv == v) ||
+               ((v > p->cvMax) && (p->error < 0.0f)) ||
+               ((v < p->cvMin) && (p->error > 0.0f))))
+    {
+        iTerm = p->iState;
+    }
+
+    p->iDelta = iTerm - p->iState;
+    p->iState = iTerm;
+
+    p->cv = cv;
+
+    return cv;
+}
+
+/*
+ * Function:    ipid_track()
+ *
+ * Synopsis:    void ipid_track(p, applied)
+ *
+ *              IPID* p;            - Pointer to PID data structure.
+ *              float applied;      - CV value actually applied.
+ *
+ * Description: Called after ipid_calc() when the caller had to limit the
+ *              CV further, for example where the motor DAC saturates below
+ *              the PID CV limits. The integrator is corrected as if the
+ *              PID itself had clamped to the applied value. Only a CV
+ *              reduced in magnitude is tracked, any other change made by
+ *              the caller is ignored.
+ *
+ * Returns:     void
+ */
+
+void ipid_track(IPID* p, float applied)
+{
+    float diff = applied - p->cv;
+
+    if (!(((p->cv > 0.0f) && (diff < 0.0f)) || ((p->cv < 0.0f) && (diff > 0.0f))))
+        return;
+
+    if (p->bt > 0.0f)
+    {
+        /* Back-calculate with the additional limiting */
+        p->iState += p->bt * diff;
+    }
+    else if (((diff < 0.0f) && (p->iDelta > 0.0f)) ||
+             ((diff > 0.0f) && (p->iDelta < 0.0f)))
+    {
+        /* Undo an integration that drove further into the limit */
+        p->iState -= p->iDelta;
+    }
+
+    p->iDelta = 0.0f;
+    p->iState = ipid_ilimit(p, p->iState);
+
+    p->cv = applied;
+}
+
 /* End-Of-File */
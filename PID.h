@@ -22,6 +22,14 @@
 #define PID_CV_MAX_F        (DAC_MAX_F)
 #define PID_CV_MIN_F        (-400.0f)
 
+/* Improved PID defaults. The sample time must match the servo loop
+ * period (SERVO_PERIOD_USEC). The derivative filter time constant
+ * defaults to Td/N and the anti-windup tracking time to sqrt(Ti*Td),
+ * or Ti with no derivative action.
+ */
+#define PID_SAMPLE_TIME_F   0.002f      /* servo loop period in seconds */
+#define PID_D_FILTER_N      10.0f       /* derivative filter Td/Tf      */
+
 /* Floating Point PID */
 typedef struct _FPID {
     float       error;          /* current error state   */
@@ -36,10 +44,176 @@ typedef struct _FPID {
     float       Kd;             /* Derivative gain       */
 } FPID;
 
+/* Fixed Point PID
+ *
+ * All values are signed Q15 numbers held in 32-bits, that is 16 integer
+ * and 15 fraction bits giving a range of +/-65536 with a resolution of
+ * 1/32768. Gains use the same format. See qpid_calc() for the rounding
+ * and saturation rules.
+ */
+typedef struct _QPID {
+    int32_t     error;          /* current error state   */
+    int32_t     dState;         /* Last position input   */
+    int32_t     iState;         /* Integrator state      */
+    int32_t     tolerance;      /* max tolerance allowed */
+    int32_t     iMax;           /* max integrator state  */
+    int32_t     iMin;           /* min integrator state  */
+    /* PID gain values */
+    int32_t     Kp;             /* Proportional gain     */
+    int32_t     Ki;             /* Integral gain         */
+    int32_t     Kd;             /* Derivative gain       */
+} QPID;
+
+/* Improved Floating Point PID
+ *
+ * Same inputs as the FPID, but the derivative acts on the measurement
+ * through a first order low pass filter, the integrator is limited by
+ * back-calculation (or conditional integration if Tt is zero) and the
+ * gains are held in continuous time so they do not depend on the sample
+ * time. The integrator holds the integral term in CV units over the full
+ * CV range.
+ */
+typedef struct _IPID {
+    float       error;          /* current error state      */
+    float       pvState;        /* Last measurement input   */
+    float       iState;         /* Integral term            */
+    float       dState;         /* Filtered derivative term */
+    float       tolerance;      /* max tolerance allowed    */
+    float       cvMax;          /* max CV output            */
+    float       cvMin;          /* min CV output            */
+    /* PID gain values */
+    float       Kp;             /* Proportional gain        */
+    float       Ki;             /* Integral gain (1/sec)    */
+    float       Kd;             /* Derivative gain (sec)    */
+    /* Timing */
+    float       Ts;             /* Sample time (sec)        */
+    float       Tf;             /* D filter time constant   */
+    float       Tt;             /* Windup tracking time     */
+    /* Coefficients derived by ipid_setup() */
+    float       ad;             /* D filter pole            */
+    float       bd;             /* D filter gain            */
+    float       bi;             /* Integrator gain          */
+    float       bt;             /* Tracking gain            */
+    float       iMax;           /* max integral term        */
+    float       iMin;           /* min integral term        */
+    float       cv;             /* Last CV output           */
+    float       iDelta;         /* Last integrator change   */
+    uint32_t    first;          /* no measurement history   */
+} IPID;
+
+#define PID_Q15_SHIFT       15
+#define PID_Q15_ONE         (1L << PID_Q15_SHIFT)
+
+/* Convert float to Q15 rounding to nearest (ties away from zero) and
+ * Q15 back to float. The float value must be within +/-65535.
+ */
+#define PID_F_TO_Q15(f)     ((int32_t)(((f) * (float)PID_Q15_ONE) + (((f) >= 0.0f) ? 0.5f : -0.5f)))
+#define PID_Q15_TO_F(q)     ((float)(q) * (1.0f / (float)PID_Q15_ONE))
+
 /* PID Function Prototypes */
 
 void fpid_init(FPID* p, float Kp, float Ki, float Kd, float cvmax, float cvmin, float tolerance);
 float fpid_calc(FPID* p, float setpoint, float actual);
+void fpid_gains(FPID* p, float Kp, float Ki, float Kd);
+
+void qpid_init(QPID* p, float Kp, float Ki, float Kd, float cvmax, float cvmin, float tolerance);
+int32_t qpid_calc(QPID* p, int32_t setpoint, int32_t actual);
+void qpid_gains(QPID* p, float Kp, float Ki, float Kd);
+
+void ipid_init(IPID* p, float Kp, float Ki, float Kd, float cvmax, float cvmin, float tolerance);
+void ipid_setup(IPID* p, float Ts, float Tf, float Tt);
+float ipid_calc(IPID* p, float setpoint, float actual);
+void ipid_gains(IPID* p, float Kp, float Ki, float Kd);
+void ipid_track(IPID* p, float applied);
+
+/* PID Engine Selection
+ *
+ * Each servo PID instance is built with either the floating point (fpid),
+ * the fixed point (qpid) or the improved floating point (ipid) engine,
+ * selected here at compile time. The servo code uses the PID_xxx() macros
+ * below with the engine name so it does not change with the selection.
+ * All engines take and return float values through these macros, the
+ * fixed point engine converts at the call boundary.
+ */
+
+#ifndef PID_SHUTTLE_ENGINE
+#define PID_SHUTTLE_ENGINE  fpid        /* shuttle velocity PID engine  */
+#endif
+
+#ifndef PID_PLAY_ENGINE
+#define PID_PLAY_ENGINE     fpid        /* play boost PID engine        */
+#endif
+
+#define _PID_PASTE2(a, b)   a##b
+#define _PID_PASTE(a, b)    _PID_PASTE2(a, b)
+
+#define PID_TYPE(engine)    _PID_PASTE(engine, _t)
+
+#define PID_INIT(engine, p, Kp, Ki, Kd, cvmax, cvmin, tolerance) \
+    _PID_PASTE(engine, _init)(p, Kp, Ki, Kd, cvmax, cvmin, tolerance)
+
+/* Change the gains of a running PID without a bump in the CV */
+#define PID_GAINS(engine, p, Kp, Ki, Kd) \
+    _PID_PASTE(engine, _gains)(p, Kp, Ki, Kd)
+
+#define PID_CALC(engine, p, setpoint, actual) \
+    _PID_PASTE(engine, _calcf)(p, setpoint, actual)
+
+#define PID_ERROR(engine, p) \
+    _PID_PASTE(engine, _errorf)(p)
+
+/* Report the CV actually applied after any limiting downstream of the PID
+ * (eg, the DAC clamp) so an engine with anti-windup can account for it.
+ */
+#define PID_TRACK(engine, p, applied) \
+    _PID_PASTE(engine, _trackf)(p, applied)
+
+typedef FPID fpid_t;
+typedef QPID qpid_t;
+typedef IPID ipid_t;
+
+static inline float fpid_calcf(FPID* p, float setpoint, float actual)
+{
+    return fpid_calc(p, setpoint, actual);
+}
+
+static inline float fpid_errorf(FPID* p)
+{
+    return p->error;
+}
+
+static inline void fpid_trackf(FPID* p, float applied)
+{
+}
+
+static inline float qpid_calcf(QPID* p, float setpoint, float actual)
+{
+    return PID_Q15_TO_F(qpid_calc(p, PID_F_TO_Q15(setpoint), PID_F_TO_Q15(actual)));
+}
+
+static inline float qpid_errorf(QPID* p)
+{
+    return PID_Q15_TO_F(p->error);
+}
+
+static inline void qpid_trackf(QPID* p, float applied)
+{
+}
+
+static inline float ipid_calcf(IPID* p, float setpoint, float actual)
+{
+    return ipid_calc(p, setpoint, actual);
+}
+
+static inline float ipid_errorf(IPID* p)
+{
+    return p->error;
+}
+
+static inline void ipid_trackf(IPID* p, float applied)
+{
+    ipid_track(p, applied);
+}
 
 #endif /* __PID_H__ */
 
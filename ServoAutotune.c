@@ -0,0 +1,372 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Copyright (c) 2014, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================ */
+
+#include <xdc/std.h>
+#include <xdc/cfg/global.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/Gate.h>
+
+/* BIOS Header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Mailbox.h>
+#include <ti/sysbios/knl/Task.h>
+
+/* TI-RTOS Driver files */
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/UART.h>
+
+/* Standard Headers */
+#include <file.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Project specific Headers */
+#include "DTC1200.h"
+#include "PID.h"
+#include "Globals.h"
+#include "ServoTask.h"
+#include "ServoAutotune.h"
+
+/* Relay cycles discarded while the bias converges */
+#define TUNE_DISCARD_CYCLES     3
+
+/* Relay half cycle length that steps the bias (1 sec) */
+#define TUNE_STUCK_TICKS        500
+
+#ifndef M_PI
+#define M_PI                    3.14159265358979323846
+#endif
+
+/* Static Data Items */
+
+/* The configuration and the relay state are written by other tasks only
+ * with task switching disabled, the same as the capture buffer.
+ */
+
+static AUTOTUNE_CONFIG s_config;
+
+static uint32_t s_state = TUNE_STATE_IDLE;
+static uint32_t s_fault;
+static uint32_t s_ticks;                /* ticks since start             */
+static float    s_bias;                 /* relay output bias             */
+static bool     s_relay;                /* relay has taken over the CV   */
+static bool     s_high;                 /* relay output state            */
+static uint32_t s_cycles;               /* relay cycles completed        */
+static uint32_t s_rise_tick;            /* tick of the last rising edge  */
+static uint32_t s_fall_tick;            /* tick of the last falling edge */
+static float    s_pv_max;               /* extremes over current cycle   */
+static float    s_pv_min;
+static float    s_period_sum;           /* ticks summed over the cycles  */
+static float    s_amplitude_sum;
+static float    s_amplitude;
+static float    s_ku;
+static float    s_tu;
+
+/* Static Function Prototypes */
+static void RelayCycle(void);
+
+//*****************************************************************************
+// Start an autotune experiment. The servo mode handler for the loop must
+// be running, it calls Autotune_Service() every tick and the relay takes
+// over its output from the next call.
+//*****************************************************************************
+
+void Autotune_Start(AUTOTUNE_CONFIG* config)
+{
+    UInt key = Task_disable();
+
+    s_config = *config;
+
+    if (s_config.cycles < 1)
+        s_config.cycles = 1;
+
+    if (s_config.hysteresis < 0.0f)
+        s_config.hysteresis = 0.0f;
+
+    s_fault         = TUNE_FAULT_NONE;
+    s_ticks         = 0;
+    s_bias          = 0.0f;
+    s_relay         = false;
+    s_cycles        = 0;
+    s_period_sum    = 0.0f;
+    s_amplitude_sum = 0.0f;
+    s_amplitude     = 0.0f;
+    s_ku            = 0.0f;
+    s_tu            = 0.0f;
+
+    s_state = TUNE_STATE_SETTLE;
+
+    Task_restore(key);
+}
+
+void Autotune_Stop(void)
+{
+    UInt key = Task_disable();
+
+    if ((s_state == TUNE_STATE_SETTLE) || (s_state == TUNE_STATE_RELAY))
+        s_state = TUNE_STATE_IDLE;
+
+    Task_restore(key);
+}
+
+void Autotune_GetStatus(AUTOTUNE_STATUS* status)
+{
+    UInt key = Task_disable();
+
+    status->state     = s_state;
+    status->fault     = s_fault;
+    status->cycles    = s_cycles;
+    status->ticks     = s_ticks;
+    status->bias      = s_bias;
+    status->amplitude = s_amplitude;
+    status->ku        = s_ku;
+    status->tu        = s_tu;
+
+    Task_restore(key);
+}
+
+//*****************************************************************************
+// Return the loop being identified, or TUNE_LOOP_NONE if no experiment is
+// running. Lets the mode handler select the drive for the loop under test.
+//*****************************************************************************
+
+uint32_t Autotune_Loop(void)
+{
+    if ((s_state == TUNE_STATE_SETTLE) || (s_state == TUNE_STATE_RELAY))
+        return s_config.loop;
+
+    return TUNE_LOOP_NONE;
+}
+
+//*****************************************************************************
+// Calculate the per sample PID gains for the servo PID engines from the
+// ultimate gain and period with the given tuning rule.
+//*****************************************************************************
+
+void Autotune_Gains(uint32_t rule, float ku, float tu, float* kp, float* ki, float* kd)
+{
+    float Kp;
+    float Ti;
+    float Td;
+
+    switch(rule)
+    {
+        case TUNE_RULE_ZN_PI:
+            Kp = 0.45f * ku;
+            Ti = tu / 1.2f;
+            Td = 0.0f;
+            break;
+
+        case TUNE_RULE_TL_PI:
+            Kp = ku / 3.2f;
+            Ti = tu * 2.2f;
+            Td = 0.0f;
+            break;
+
+        case TUNE_RULE_NO_OVERSHOOT:
+            Kp = 0.2f * ku;
+            Ti = tu * 0.5f;
+            Td = tu / 3.0f;
+            break;
+
+        case TUNE_RULE_ZN_PID:
+        default:
+            Kp = 0.6f * ku;
+            Ti = tu * 0.5f;
+            Td = tu * 0.125f;
+            break;
+    }
+
+    *kp = Kp;
+    *ki = (Ti > 0.0f) ? ((Kp * PID_SAMPLE_TIME_F) / Ti) : 0.0f;
+    *kd = (Kp * Td) / PID_SAMPLE_TIME_F;
+}
+
+//*****************************************************************************
+// A rising relay edge ends a cycle. The bias is corrected each cycle for
+// any difference in the high and low times, which is the load the relay
+// has to carry at the setpoint. The cycles after the discarded ones are
+// averaged and the describing function of the relay with hysteresis,
+// N(a) = 4d / (pi * sqrt(a^2 - h^2)), gives the ultimate gain.
+//*****************************************************************************
+
+static void RelayCycle(void)
+{
+    float a;
+    float h;
+    float high;
+    float low;
+
+    /* The first rising edge only marks the start of a cycle */
+    if (s_cycles++ == 0)
+        return;
+
+    high = (float)(s_fall_tick - s_rise_tick);
+    low  = (float)(s_ticks - s_fall_tick);
+
+    s_bias += s_config.amplitude * ((high - low) / (high + low));
+
+    if (s_cycles <= TUNE_DISCARD_CYCLES)
+        return;
+
+    s_state = TUNE_STATE_RELAY;
+
+    s_period_sum    += high + low;
+    s_amplitude_sum += (s_pv_max - s_pv_min) * 0.5f;
+
+    if ((s_cycles - TUNE_DISCARD_CYCLES) < s_config.cycles)
+        return;
+
+    a = s_amplitude_sum / (float)s_config.cycles;
+    h = s_config.hysteresis;
+
+    s_amplitude = a;
+    s_tu = (s_period_sum / (float)s_config.cycles) * PID_SAMPLE_TIME_F;
+
+    a = (a > h) ? sqrtf((a * a) - (h * h)) : a;
+
+    if (a > 0.0f)
+    {
+        s_ku    = (4.0f * s_config.amplitude) / ((float)M_PI * a);
+        s_state = TUNE_STATE_DONE;
+    }
+    else
+    {
+        s_fault = TUNE_FAULT_LIMIT;
+        s_state = TUNE_STATE_FAILED;
+    }
+}
+
+//*****************************************************************************
+// Called by the servo mode handler every tick with the loop it is running,
+// the process value and the CV it calculated. Returns true if the relay
+// output replaced the CV.
+//*****************************************************************************
+
+bool Autotune_Service(uint32_t loop, float pv, float* cv)
+{
+    float error;
+
+    if (loop != Autotune_Loop())
+        return false;
+
+    error = s_config.setpoint - pv;
+
+    if (++s_ticks > s_config.timeout)
+    {
+        s_fault = TUNE_FAULT_TIMEOUT;
+        s_state = TUNE_STATE_FAILED;
+        return false;
+    }
+
+    /* The PID brings the loop up to the setpoint, the relay takes over
+     * with its output low when the setpoint is first crossed.
+     */
+    if (!s_relay)
+    {
+        if (error > 0.0f)
+            return false;
+
+        s_relay     = true;
+        s_high      = false;
+        s_rise_tick = s_fall_tick = s_ticks;
+        s_pv_max    = s_pv_min = pv;
+    }
+
+    /* Once oscillating about the setpoint it must not overspeed */
+    if ((s_state == TUNE_STATE_RELAY) && (-error > s_config.limit))
+    {
+        s_fault = TUNE_FAULT_LIMIT;
+        s_state = TUNE_STATE_FAILED;
+        return false;
+    }
+
+    if (pv > s_pv_max)
+        s_pv_max = pv;
+    if (pv < s_pv_min)
+        s_pv_min = pv;
+
+    /* A relay that can't carry the load at the setpoint never switches,
+     * so walk the bias until it does.
+     */
+    if (s_high && ((s_ticks - s_rise_tick) > TUNE_STUCK_TICKS))
+    {
+        s_bias += s_config.amplitude * 0.5f;
+        s_rise_tick = s_ticks;
+    }
+    else if (!s_high && ((s_ticks - s_fall_tick) > TUNE_STUCK_TICKS))
+    {
+        s_bias -= s_config.amplitude * 0.5f;
+        s_fall_tick = s_ticks;
+    }
+
+    /* Switch the relay on the error sign with hysteresis */
+    if (s_high && (error < -s_config.hysteresis))
+    {
+        s_high = false;
+        s_fall_tick = s_ticks;
+    }
+    else if (!s_high && (error > s_config.hysteresis))
+    {
+        s_high = true;
+
+        RelayCycle();
+
+        s_rise_tick = s_ticks;
+        s_pv_max    = s_pv_min = pv;
+
+        if (Autotune_Loop() == TUNE_LOOP_NONE)
+            return false;
+    }
+
+    *cv = s_high ? (s_bias + s_config.amplitude) : (s_bias - s_config.amplitude);
+
+    return true;
+}
+
+/* End-Of-File */
@@ -0,0 +1,64 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Copyright (c) 2014, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================ */
+
+#ifndef DTC1200_SERVOAUTOTUNE_H_
+#define DTC1200_SERVOAUTOTUNE_H_
+
+/* Relay feedback autotune. Once started the servo PID runs the loop up to
+ * the first setpoint crossing, after which the PID output is replaced by
+ * bias +/- amplitude, switched on the sign of the error with hysteresis.
+ * This makes the loop oscillate at its ultimate period. The bias adapts
+ * each cycle from the difference of the relay high and low times so the
+ * oscillation stays centered on the setpoint. The amplitude and period are
+ * averaged over a number of cycles to give the ultimate gain Ku and period
+ * Tu, from which the PID gains are calculated with a TUNE_RULE_xxx rule.
+ */
+bool Autotune_Service(uint32_t loop, float pv, float* cv);
+uint32_t Autotune_Loop(void);
+
+void Autotune_Start(AUTOTUNE_CONFIG* config);
+void Autotune_Stop(void);
+void Autotune_GetStatus(AUTOTUNE_STATUS* status);
+
+void Autotune_Gains(uint32_t rule, float ku, float tu, float* kp, float* ki, float* kd);
+
+#endif
@@ -0,0 +1,441 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Copyright (c) 2014, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================ */
+
+#include <xdc/std.h>
+#include <xdc/cfg/global.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/Gate.h>
+
+/* BIOS Header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Mailbox.h>
+#include <ti/sysbios/knl/Task.h>
+
+/* TI-RTOS Driver files */
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/UART.h>
+
+/* Standard Headers */
+#include <file.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* Project specific Headers */
+#include "DTC1200.h"
+#include "Globals.h"
+#include "ServoTask.h"
+#include "ServoCapture.h"
+
+/* Static Data Items */
+
+/* The configuration and the buffer state are written by the terminal and
+ * IPC tasks only with task switching disabled, so the servo task always
+ * sees a consistent set and never has to pend on a lock.
+ */
+
+static CAPTURE_CONFIG s_config = {
+    CAP_CH_DEFAULT,                     /* channels      */
+    CAP_TRIG_MODE,                      /* trigger       */
+    1,                                  /* decimation    */
+    125,                                /* pretrigger    */
+    0.0f,                               /* tension_level */
+    0.0f                                /* velocity_level*/
+};
+
+static float    s_buf[CAP_BUF_WORDS];   /* sample ring buffer            */
+
+static uint32_t s_state = CAP_STATE_IDLE;
+static uint32_t s_words = 8;            /* words per sample              */
+static uint32_t s_capacity = CAP_BUF_WORDS / 8;
+static uint32_t s_head;                 /* next sample slot to write     */
+static uint32_t s_count;                /* valid samples in the ring     */
+static uint32_t s_post;                 /* post trigger samples to go    */
+static uint32_t s_trigger_index;
+static uint32_t s_trigger_cause;
+static uint32_t s_sequence;
+static uint32_t s_decimate;             /* ticks until the next sample   */
+static uint32_t s_manual;               /* manual trigger request        */
+
+/* Trigger detection history */
+static uint32_t s_last_mode;
+static bool     s_last_tension_above;
+static bool     s_last_tension_below;
+static bool     s_last_vel_above;
+static bool     s_last_vel_below;
+
+/* Static Function Prototypes */
+static uint32_t CountChannels(uint32_t channels);
+static uint32_t CheckTrigger(void);
+static void StoreSample(void);
+
+//*****************************************************************************
+// Count the channels selected, which is the number of words per sample.
+//*****************************************************************************
+
+static uint32_t CountChannels(uint32_t channels)
+{
+    uint32_t n = 0;
+
+    channels &= CAP_CH_MASK;
+
+    while (channels)
+    {
+        channels &= channels - 1;
+        ++n;
+    }
+
+    return n;
+}
+
+//*****************************************************************************
+// Set the capture configuration. Any capture in progress is stopped and
+// the buffer is emptied, this only resets the ring indexes.
+//*****************************************************************************
+
+void Capture_Configure(CAPTURE_CONFIG* config)
+{
+    uint32_t channels = config->channels & CAP_CH_MASK;
+
+    if (!channels)
+        channels = CAP_CH_DEFAULT;
+
+    UInt key = Task_disable();
+
+    s_config = *config;
+    s_config.channels = channels;
+
+    if (s_config.decimation < 1)
+        s_config.decimation = 1;
+
+    s_words    = CountChannels(channels);
+    s_capacity = CAP_BUF_WORDS / s_words;
+
+    if (s_config.pretrigger >= s_capacity)
+        s_config.pretrigger = s_capacity - 1;
+
+    s_state = CAP_STATE_IDLE;
+    s_count = 0;
+    s_head  = 0;
+
+    Task_restore(key);
+}
+
+void Capture_GetConfig(CAPTURE_CONFIG* config)
+{
+    UInt key = Task_disable();
+    *config = s_config;
+    Task_restore(key);
+}
+
+void Capture_GetStatus(CAPTURE_STATUS* status)
+{
+    UInt key = Task_disable();
+
+    status->state         = s_state;
+    status->channels      = s_config.channels;
+    status->num_channels  = s_words;
+    status->capacity      = s_capacity;
+    status->samples       = s_count;
+    status->trigger_index = s_trigger_index;
+    status->trigger_cause = s_trigger_cause;
+    status->sequence      = s_sequence;
+
+    Task_restore(key);
+}
+
+//*****************************************************************************
+// Arm the capture. The ring starts filling from empty on the next servo
+// tick and the trigger conditions are evaluated from then on.
+//*****************************************************************************
+
+void Capture_Arm(void)
+{
+    UInt key = Task_disable();
+
+    s_head          = 0;
+    s_count         = 0;
+    s_post          = 0;
+    s_trigger_index = 0;
+    s_trigger_cause = 0;
+    s_decimate      = 0;
+    s_manual        = 0;
+
+    /* Start trigger detection from the current conditions so only
+     * a change after arming fires the trigger.
+     */
+    s_last_mode          = g_servo.mode;
+    s_last_tension_above = (g_servo.tsense > s_config.tension_level);
+    s_last_tension_below = (g_servo.tsense < s_config.tension_level);
+    s_last_vel_above     = (g_servo.velocity > s_config.velocity_level);
+    s_last_vel_below     = (g_servo.velocity < s_config.velocity_level);
+
+    s_state = CAP_STATE_ARMED;
+
+    Task_restore(key);
+}
+
+void Capture_Trigger(void)
+{
+    s_manual = 1;
+}
+
+void Capture_Stop(void)
+{
+    UInt key = Task_disable();
+
+    if (s_state != CAP_STATE_DONE)
+        s_state = CAP_STATE_IDLE;
+
+    Task_restore(key);
+}
+
+//*****************************************************************************
+// Copy up to 'count' samples starting at sample 'index' to the caller's
+// buffer in time order, index zero being the oldest sample. Each sample is
+// 'num_channels' words in channel bit order, no more samples are copied
+// than fit in the 'words' the buffer holds. The words per sample and the
+// capture sequence are returned from the same locked section as the data,
+// so they describe the samples copied even if another task reconfigures
+// or re-arms the capture right after. Data is only available once the
+// capture is complete. Returns the number of samples copied.
+//*****************************************************************************
+
+uint32_t Capture_Read(uint32_t index, uint32_t count, float* buf, uint32_t words,
+                      uint32_t* num_channels, uint32_t* sequence)
+{
+    uint32_t i;
+    uint32_t slot;
+
+    UInt key = Task_disable();
+
+    if (num_channels)
+        *num_channels = s_words;
+
+    if (sequence)
+        *sequence = s_sequence;
+
+    if ((s_state != CAP_STATE_DONE) || (index >= s_count) || !s_words)
+    {
+        Task_restore(key);
+        return 0;
+    }
+
+    if (count > (s_count - index))
+        count = s_count - index;
+
+    if (count > (words / s_words))
+        count = words / s_words;
+
+    /* Oldest sample slot in the ring */
+    slot = (s_head + s_capacity - s_count + index) % s_capacity;
+
+    for (i=0; i < count; i++)
+    {
+        memcpy(buf, &s_buf[slot * s_words], s_words * sizeof(float));
+
+        buf += s_words;
+
+        if (++slot >= s_capacity)
+            slot = 0;
+    }
+
+    Task_restore(key);
+
+    return count;
+}
+
+//*****************************************************************************
+// Evaluate the trigger conditions. Level conditions fire on the crossing
+// so a condition that is already true when armed does not trigger.
+//*****************************************************************************
+
+static uint32_t CheckTrigger(void)
+{
+    uint32_t cause = 0;
+    uint32_t trigger = s_config.trigger;
+    bool above;
+
+    if (s_manual)
+    {
+        s_manual = 0;
+        cause |= CAP_TRIG_MANUAL;
+    }
+
+    if (g_servo.mode != s_last_mode)
+    {
+        s_last_mode = g_servo.mode;
+
+        if (trigger & CAP_TRIG_MODE)
+            cause |= CAP_TRIG_MODE;
+    }
+
+    above = (g_servo.tsense > s_config.tension_level);
+
+    if ((trigger & CAP_TRIG_TENSION_ABOVE) && above && !s_last_tension_above)
+        cause |= CAP_TRIG_TENSION_ABOVE;
+
+    s_last_tension_above = above;
+
+    above = (g_servo.tsense < s_config.tension_level);
+
+    if ((trigger & CAP_TRIG_TENSION_BELOW) && above && !s_last_tension_below)
+        cause |= CAP_TRIG_TENSION_BELOW;
+
+    s_last_tension_below = above;
+
+    above = (g_servo.velocity > s_config.velocity_level);
+
+    if ((trigger & CAP_TRIG_VELOCITY_ABOVE) && above && !s_last_vel_above)
+        cause |= CAP_TRIG_VELOCITY_ABOVE;
+
+    s_last_vel_above = above;
+
+    above = (g_servo.velocity < s_config.velocity_level);
+
+    if ((trigger & CAP_TRIG_VELOCITY_BELOW) && above && !s_last_vel_below)
+        cause |= CAP_TRIG_VELOCITY_BELOW;
+
+    s_last_vel_below = above;
+
+    return cause;
+}
+
+//*****************************************************************************
+// Store one sample of the selected channels at the ring head.
+//*****************************************************************************
+
+static void StoreSample(void)
+{
+    uint32_t channels = s_config.channels;
+    float* p = &s_buf[s_head * s_words];
+
+    if (channels & CAP_CH_DAC_SUPPLY)
+        *p++ = g_servo.dac_supply;
+    if (channels & CAP_CH_DAC_TAKEUP)
+        *p++ = g_servo.dac_takeup;
+    if (channels & CAP_CH_VEL_SUPPLY)
+        *p++ = g_servo.velocity_supply;
+    if (channels & CAP_CH_VEL_TAKEUP)
+        *p++ = g_servo.velocity_takeup;
+    if (channels & CAP_CH_RAD_SUPPLY)
+        *p++ = g_servo.radius_supply;
+    if (channels & CAP_CH_RAD_TAKEUP)
+        *p++ = g_servo.radius_takeup;
+    if (channels & CAP_CH_TAPE_TACH)
+        *p++ = g_servo.tape_tach;
+    if (channels & CAP_CH_TENSION)
+        *p++ = g_servo.tsense;
+    if (channels & CAP_CH_VELOCITY)
+        *p++ = g_servo.velocity;
+    if (channels & CAP_CH_PID_CV)
+        *p++ = g_servo.db_cv;
+    if (channels & CAP_CH_PID_ERROR)
+        *p++ = g_servo.db_error;
+    if (channels & CAP_CH_MODE)
+        *p++ = (float)g_servo.mode;
+
+    if (++s_head >= s_capacity)
+        s_head = 0;
+
+    if (s_count < s_capacity)
+        ++s_count;
+}
+
+//*****************************************************************************
+// Called by the servo task once every servo tick after the mode handler
+// has run. Only a few compares when idle or when the capture is complete.
+//*****************************************************************************
+
+void Capture_Sample(void)
+{
+    uint32_t cause;
+
+    if ((s_state != CAP_STATE_ARMED) && (s_state != CAP_STATE_TRIGGERED))
+        return;
+
+    if (s_state == CAP_STATE_ARMED)
+    {
+        if ((cause = CheckTrigger()) != 0)
+        {
+            uint32_t pre = s_count;
+
+            if (pre > s_config.pretrigger)
+                pre = s_config.pretrigger;
+
+            /* The trigger sample is stored on this tick and is the
+             * first of the post trigger samples.
+             */
+            s_trigger_index = pre;
+            s_trigger_cause = cause;
+            s_post          = s_capacity - pre;
+            s_decimate      = 0;
+            s_state         = CAP_STATE_TRIGGERED;
+        }
+    }
+
+    /* Store every decimation ticks */
+    if (s_decimate)
+    {
+        --s_decimate;
+        return;
+    }
+
+    s_decimate = s_config.decimation - 1;
+
+    StoreSample();
+
+    if (s_state == CAP_STATE_TRIGGERED)
+    {
+        if (--s_post == 0)
+        {
+            ++s_sequence;
+            s_state = CAP_STATE_DONE;
+        }
+    }
+}
+
+/* End-Of-File */
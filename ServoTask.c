@@ -45,12 +45,15 @@
 #include <xdc/runtime/System.h>
 #include <xdc/runtime/Error.h>
 #include <xdc/runtime/Gate.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
 
 /* BIOS Header files */
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Mailbox.h>
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/family/arm/m3/Hwi.h>
 
 /* TI-RTOS Driver files */
@@ -86,90 +89,230 @@
 #include "TapeTach.h"
 #include "MotorDAC.h"
 #include "ReelQEI.h"
+#include "ServoCapture.h"
+#include "ServoAutotune.h"
 
 /* Calculate the tension value from the ADC reading */
 //#define TENSION(adc)			( (0xFFF - (adc & 0xFFF)) )
 //#define TENSION_F(adc)			( (2047.0f - (float)adc) )
 
-/* External Global Data */
-extern Semaphore_Handle g_semaServo;
-extern Semaphore_Handle g_semaTransportMode;
+/* Cortex-M4 DWT cycle counter registers */
+#define CORE_DEMCR              0xE000EDFC
+#define CORE_DEMCR_TRCENA       0x01000000
+#define DWT_CTRL                0xE0001000
+#define DWT_CTRL_CYCCNTENA      0x00000001
+#define DWT_CYCCNT              0xE0001004
+
+#define CPU_CYCLES()            HWREG(DWT_CYCCNT)
+
+/* Sequence number increment for the mode request word */
+#define MODE_REQUEST_SEQ        0x100
+
+/* Locate request word, arm flag and sequence number increment */
+#define LOCATE_REQUEST_ARM      0x01
+#define LOCATE_REQUEST_SEQ      0x02
+
+/* Static Data Items */
+
+/* Requests from other tasks. Each request word has a single writer and is
+ * only ever read by the servo task, which applies it on its next tick. The
+ * servo task owns all of the servo state and never pends on a lock.
+ */
+static volatile uint32_t s_mode_request = MODE_HALT;
+static volatile uint32_t s_play_reset_request;
+static volatile uint32_t s_shuttle_reset_request;
+static volatile uint32_t s_locate_request;
+static volatile int32_t s_locate_target;
+
+/* Last requests applied by the servo task */
+static uint32_t s_mode_request_ack = MODE_HALT;
+static uint32_t s_play_reset_ack;
+static uint32_t s_shuttle_reset_ack;
+static uint32_t s_locate_ack;
+
+static Semaphore_Handle s_semaServoTick;
+static uint32_t s_cycles_per_usec;
+static uint32_t s_tick_prev;
+static volatile bool s_timing_reset;
+static SERVOTIMING s_timing;
+
+/* Per stage cycle profile */
+static volatile bool s_profile_reset;
+static SERVOPROFILE s_profile;
+static uint64_t s_profile_sum[SERVO_NUM_STAGES];
+static uint32_t s_worst_total;
+static uint32_t s_dac_cycles;
+static uint32_t s_cpu_freq;
 
 /* Static Function Prototypes */
+static Void ServoTickFxn(UArg arg);
+static void ServoTimingUpdate(uint32_t start, uint32_t end);
+static void ServoProfileUpdate(uint32_t* cycles);
+static void ServoDACWrite(float supply, float takeup);
+static void CurrentLoopReset(CURRENTLOOP* cl);
+static float CurrentLoop(CURRENTLOOP* cl, float torque);
+static float DACShape(const float* table, float* residue, float torque);
+static void ServoApplyRequests(void);
+static void ServoLocateUpdate(void);
+static void ShuttleProfileSeed(void);
+static float ShuttleProfileUpdate(void);
+static float TapeSpeed(void);
+static float QEIObserver(QEIOBS* ob, uint32_t count);
+static float TensionFilter(float tsense);
+static void TensionNotchTrack(BIQUAD* bq, float velocity, float x);
+static void ReelIdentReset(REELIDENT* id);
+static void ReelIdentPrior(REELIDENT* id);
+static void ReelIdentUpdate(REELIDENT* id, float torque, float rs, float rt);
+static float ReelIdentSigma(REELIDENT* id, float radius);
+static void ReelIdentCheck(REELIDENT* id, float rs, float rt);
+static void ServoReelIdent(void);
+static bool StopBrakeModel(float* brake_supply, float* brake_takeup);
+static bool PlayBoostFeedforward(float* ff_supply, float* ff_takeup);
+static void ResetPlayServo(void);
+static void ResetShuttleServo(void);
+static void ShuttleGainSchedule(void);
 static void Service_HaltMode(void);
 static void Service_StopMode(void);
 static void Service_PlayMode(void);
 static void Service_RewMode(void);
 static void Service_FwdMode(void);
+static void Service_PlayTune(void);
 static void Service_ThreadMode(void);
 
 /*****************************************************************************
  * SERVO MODE CONTROL INTERFACE FUNCTIONS (thread safe)
+ *
+ * These never block. Mode changes and PID resets are posted as requests
+ * that the servo task applies at the start of its next tick. The mode
+ * query functions return the most recently requested mode, so a caller
+ * sees its own mode change immediately even before the servo applies it.
+ * Only the transport controller task may request mode changes.
  *****************************************************************************/
 
 void Servo_SetMode(uint32_t mode)
 {
-    uint32_t prev_mode;
+    uint32_t seq = (s_mode_request & ~MODE_MASK) + MODE_REQUEST_SEQ;
 
-    Semaphore_pend(g_semaTransportMode, BIOS_WAIT_FOREVER);
+    /* Single word store publishes the mode and a new sequence number */
+    s_mode_request = seq | (mode & MODE_MASK);
+}
 
-    /* Only the mode number bits */
-    mode &= MODE_MASK;
+//*****************************************************************************
+// SERVO - Get current servo loop operation mode
+//*****************************************************************************
 
-    /* Get the previous mode */
-    prev_mode = g_servo.mode_prev;
+uint32_t Servo_GetMode(void)
+{
+    return s_mode_request & MODE_MASK;
+}
 
-    /* Update for previous mode state */
-    g_servo.mode_prev = g_servo.mode;
+int32_t Servo_IsMode(uint32_t mode)
+{
+    return ((s_mode_request & MODE_MASK) == (mode & MODE_MASK)) ? 1 : 0;
+}
 
-    /* Now set the new servo mode state */
-    g_servo.mode = mode;
+int32_t Servo_IsMotion(void)
+{
+    /* The motion flag is a single word written only by the servo task */
+    return (g_servo.motion) ? 1 : 0;
+}
 
-    /* Set dynamic brake state if STOP mode requested and
-     * the previous mode was PLAY, FF or REW, otherwise clear it.
-     */
-    if (mode == MODE_STOP)
-        g_servo.stop_brake_state = (prev_mode != MODE_HALT) ? 1 : 0;
+//*****************************************************************************
+// SERVO - Request the play or shuttle servo state be reset before the next
+// play or shuttle mode begins. The PID and play boost state are reset by
+// the servo task itself on its next tick.
+//*****************************************************************************
+
+void Servo_ResetPlay(void)
+{
+    s_play_reset_request = s_play_reset_request + 1;
+}
 
-    Semaphore_post(g_semaTransportMode);
+void Servo_ResetShuttle(void)
+{
+    s_shuttle_reset_request = s_shuttle_reset_request + 1;
 }
 
 //*****************************************************************************
-// SERVO - Get current servo loop operation mode
+// SERVO - Arm or cancel a tape locate. The transport controller first puts
+// the servo in FWD or REW toward the target, then arms the locate. The
+// servo profiles the shuttle velocity down to the target and reports
+// LOCATE_DONE once inside the window with the velocity set to zero. Any
+// servo mode change cancels the locate.
 //*****************************************************************************
 
-uint32_t Servo_GetMode(void)
+void Servo_Locate(int32_t target)
 {
-    uint32_t mode;
-    Semaphore_pend(g_semaTransportMode, BIOS_WAIT_FOREVER);
-    mode = g_servo.mode & MODE_MASK;
-    Semaphore_post(g_semaTransportMode);
-    return mode;
+    uint32_t seq = (s_locate_request & ~LOCATE_REQUEST_ARM) + LOCATE_REQUEST_SEQ;
+
+    /* The target is stored before the request word that publishes it */
+    s_locate_target  = target;
+    s_locate_request = seq | LOCATE_REQUEST_ARM;
 }
 
-int32_t Servo_IsMode(uint32_t mode)
+void Servo_CancelLocate(void)
 {
-    int32_t flag;
-    Semaphore_pend(g_semaTransportMode, BIOS_WAIT_FOREVER);
-    flag = ((g_servo.mode & MODE_MASK) == (mode & MODE_MASK)) ? 1 : 0;
-    Semaphore_post(g_semaTransportMode);
-    return flag;
+    s_locate_request = (s_locate_request & ~LOCATE_REQUEST_ARM) + LOCATE_REQUEST_SEQ;
 }
 
-int32_t Servo_IsMotion(void)
+uint32_t Servo_GetLocateState(void)
+{
+    /* Single word written only by the servo task */
+    return g_servo.locate_state;
+}
+
+//*****************************************************************************
+// SERVO - Servo loop tick period and execution time statistics
+//*****************************************************************************
+
+void Servo_GetTiming(SERVOTIMING* timing)
+{
+    /* Keep the servo task from updating the stats while we copy */
+    UInt key = Task_disable();
+    memcpy(timing, &s_timing, sizeof(SERVOTIMING));
+    Task_restore(key);
+}
+
+void Servo_ResetTiming(void)
+{
+    /* The servo task clears the stats on its next tick */
+    s_timing_reset = true;
+}
+
+//*****************************************************************************
+// SERVO - Servo loop per stage cycle count profile
+//*****************************************************************************
+
+void Servo_GetProfile(SERVOPROFILE* profile)
+{
+    size_t i;
+
+    /* Keep the servo task from updating the profile while we copy */
+    UInt key = Task_disable();
+
+    memcpy(profile, &s_profile, sizeof(SERVOPROFILE));
+
+    if (s_profile.ticks)
+    {
+        for (i=0; i < SERVO_NUM_STAGES; i++)
+            profile->stage[i].mean = (uint32_t)(s_profile_sum[i] / s_profile.ticks);
+    }
+
+    Task_restore(key);
+}
+
+void Servo_ResetProfile(void)
 {
-    int32_t motion;
-    Semaphore_pend(g_semaTransportMode, BIOS_WAIT_FOREVER);
-    motion = (g_servo.motion) ? 1 : 0;
-    Semaphore_post(g_semaTransportMode);
-    return motion;
+    s_profile_reset = true;
 }
 
 /*****************************************************************************
  * MAIN SERVO LOOP CONTROLLER TASK
  *
  * This is the highest priority system task for the reel motor servo loop.
- * This tick handler gets called 500 times per second for the servo loop.
+ * The loop is released 500 times per second by a periodic clock that posts
+ * the servo tick semaphore, so the sample rate does not depend on how long
+ * each pass through the loop takes.
  * The appropriate servo loop mode handler is called for each of the
  * Halt, Stop, Play, Forward and Rewind transport sevo loop modes.
  * Each transport mode of operation requires a different servo loop.
@@ -186,8 +329,537 @@ int32_t Servo_IsMotion(void)
 
 #define TEMP_AVG_COUNT          (500 * 10)  // Average over 10 seconds
 
+#define REEL_EST_TS             0.002f      // estimator sample time (sec)
+#define REEL_EST_VREF           100.0f      // reel velocity at nominal noise
+
+#define PROFILE_TS              0.002f      // profile generator sample time (sec)
+
+#define QEI_OBS_TS              0.002f      // velocity observer sample time (sec)
+#define QEI_OBS_BW              250.0f      // observer bandwidth (rad/sec)
+#define QEI_OBS_L1              (2.0f * QEI_OBS_BW * QEI_OBS_TS)
+#define QEI_OBS_L2              (QEI_OBS_BW * QEI_OBS_BW * QEI_OBS_TS * QEI_OBS_TS)
+#define QEI_OBS_SCALE           ((float)QE_TIMER_PERIOD / (80.0f * SERVO_PERIOD_USEC))
+#define QEI_OBS_STOP_TICKS      250         // ticks without an edge at rest
+
+#define TFILT_SAMPLE_RATE       (1000000.0f / (float)SERVO_PERIOD_USEC)
+#define TFILT_REV_PER_SEC       ((80000000.0f / (float)QE_TIMER_PERIOD) / (float)QE_AS5047P_EDGES)
+#define TFILT_NOTCH_MIN         0.5f        // notch bypassed below this (Hz)
+#define TFILT_NOTCH_MAX         (TFILT_SAMPLE_RATE * 0.4f)
+#define TFILT_RETUNE            0.02f       // retune notch on 2% rate change
+
+#define CURRENT_INT_MAX         (DAC_MAX_F * 0.25f) // max current loop correction
+#define CURRENT_CUT_GAIN        0.50f       // cutback per DAC count over limit
+#define CURRENT_CUT_RECOVER     2.0f        // cutback released per tick (DAC)
+
+#define REEL_ID_TC              0.100f      // regressor filter time constant (sec)
+#define REEL_ID_RADIUS_TC       2.0f        // pack area filter time constant (sec)
+#define REEL_ID_FORGET_SEC      60.0f       // RLS forgetting time constant (sec)
+#define REEL_ID_WARMUP          250         // ticks for the filters to settle
+#define REEL_ID_ACCEL_MIN       20.0f       // min reel accel that excites inertia
+#define REEL_ID_MIN_SAMPLES     500         // excited samples before it can be valid
+#define REEL_ID_NOISE_TC        2.0f        // residual variance filter (sec)
+#define REEL_ID_NOISE_MIN       1.0e-6f     // residual variance floor
+#define REEL_ID_CORR            (2.0f * REEL_ID_TC / REEL_EST_TS) // samples per independent sample
+#define REEL_ID_INERTIA_TOL     0.05f       // max relative std of a reel inertia
+#define REEL_ID_WINDOW          500         // excited samples per steady window
+#define REEL_ID_STEADY_TOL      0.03f       // max relative change over a window
+#define REEL_ID_P0_REEL         1.0f        // reel inertia prior variance
+#define REEL_ID_P0_PACK         10.0f       // pack inertia prior variance
+#define REEL_ID_P0_COULOMB      10000.0f    // coulomb drag prior variance
+#define REEL_ID_P0_VISCOUS      1.0f        // viscous drag prior variance
+
+#define PACK_INERTIA_SCALE      1.0e-6f     // pack_inertia units per radius^4
+#define STOP_BRAKE_TAPER_SEC    0.100f      // brake decel time constant at end
+#define STOP_BRAKE_HOLD_MIN     0.000f      // min hold torque fraction braking
+#define STOP_BRAKE_TENSION_MAX  1.350f      // max tension rise braking (x hold)
+
+#define LOCATE_LAG_SEC          0.250f      // shuttle velocity loop lag (sec)
+#define LOCATE_STOP_SEC         0.100f      // coast time stopping on approach
+#define LOCATE_CREEP            0.400f      // min approach velocity fraction
+
+/*****************************************************************************
+ * Scalar Kalman filter step for the reel radius and offset estimators.
+ * The process noise q sets the nominal time constant and the measurement
+ * noise r scales up as the reels slow down and the velocity ratio gets
+ * noisier, so the estimate tracks quickly in shuttle and smooths harder
+ * near the velocity detect threshold. The first measurement seeds it.
+ *****************************************************************************/
+
+static float ReelEstimate(REELEST* e, float z, float q, float r)
+{
+    if (!e->valid)
+    {
+        e->x = z;
+        e->p = r;
+        e->k = 1.0f;
+        e->valid = 1;
+        return z;
+    }
+
+    e->p += q;
+    e->k  = e->p / (e->p + r);
+    e->x += e->k * (z - e->x);
+    e->p *= (1.0f - e->k);
+
+    return e->x;
+}
+
+static float ReelEstimateQ(float tc)
+{
+    float a = (tc > REEL_EST_TS) ? (REEL_EST_TS / tc) : 1.0f;
+
+    /* Steady state gain is ~sqrt(q/r), giving tc at r = 1 */
+    return a * a;
+}
+
+/*****************************************************************************
+ * Reel velocity observer. The QEI velocity capture counts edges over a
+ * 10ms period, so four of every five servo ticks would see a stale value
+ * and the resolution near stop is a few counts. Instead the QEI position
+ * register is read every tick and a second order tracking observer is run
+ * on it, giving a velocity that is fresh and fractional at every tick.
+ * The QEI has no edge time capture, so the time since the count last
+ * changed is counted in servo ticks. No edge in n ticks bounds the speed
+ * to under one edge per n ticks, which lets the estimate decay to zero as
+ * the reel stops rather than hold its last value, and after
+ * QEI_OBS_STOP_TICKS the reel is taken to be at rest. The result is signed,
+ * positive with the position counting up, and scaled to the edges per
+ * velocity capture period the rest of the servo loop works in.
+ *****************************************************************************/
+
+static float QEIObserver(QEIOBS* ob, uint32_t count)
+{
+    int32_t delta;
+    float bound;
+
+    if (!ob->valid)
+    {
+        ob->count      = count;
+        ob->residual   = 0.0f;
+        ob->velocity   = 0.0f;
+        ob->edge_ticks = QEI_OBS_STOP_TICKS;
+        ob->valid      = 1;
+    }
+
+    /* Edges moved this tick, the position register wraps every rev */
+    delta = (int32_t)count - (int32_t)ob->count;
+
+    if (delta > (QE_AS5047P_EDGES / 2))
+        delta -= QE_AS5047P_EDGES;
+    else if (delta < -(QE_AS5047P_EDGES / 2))
+        delta += QE_AS5047P_EDGES;
+
+    ob->count = count;
+
+    /* Predict, then correct from the position error */
+    ob->residual += ob->velocity - (float)delta;
+    ob->velocity -= QEI_OBS_L2 * ob->residual;
+    ob->residual -= QEI_OBS_L1 * ob->residual;
+
+    if (delta)
+    {
+        ob->edge_ticks = 0;
+    }
+    else if (ob->edge_ticks < QEI_OBS_STOP_TICKS)
+    {
+        ++ob->edge_ticks;
+
+        /* The speed can't be over one edge in the ticks since the last */
+        bound = 1.0f / (float)ob->edge_ticks;
+
+        if (ob->velocity > bound)
+            ob->velocity = bound;
+        else if (ob->velocity < -bound)
+            ob->velocity = -bound;
+    }
+    else
+    {
+        ob->residual = 0.0f;
+        ob->velocity = 0.0f;
+    }
+
+    return ob->velocity * QEI_OBS_SCALE;
+}
+
+/*****************************************************************************
+ * Tension sensor filter. The tension arm picks up the once-around of each
+ * reel and capstan ripple, which go straight into the reel torque in every
+ * mode. The preset in g_sys.tension_filter picks the biquad sections run on
+ * the scaled sensor reading: a low pass at tension_lp_freq, a notch at the
+ * rotation rate of each reel, both, or sections loaded from tension_coeff[].
+ * The sections are set up again whenever the preset or low pass corner is
+ * changed, or a new custom table arrives, starting out settled on the
+ * current reading. A custom section with poles on or outside the unit
+ * circle would run away into the reel torque, so it is bypassed and its
+ * bit set in tension_unstable.
+ *****************************************************************************/
+
+static float TensionFilter(float tsense)
+{
+    size_t i;
+    int32_t preset = g_sys.tension_filter;
+    BIQUAD* bq = g_servo.tension_filter;
+
+    if ((preset != g_servo.tension_preset) ||
+        ((preset == TFILT_CUSTOM) &&
+         memcmp(g_servo.tension_coeff, g_sys.tension_coeff, sizeof(g_servo.tension_coeff))))
+    {
+        g_servo.tension_unstable = 0;
+
+        for (i=0; i < TFILT_STAGES; i++)
+        {
+            if (preset != TFILT_CUSTOM)
+                biquad_init(&bq[i]);
+            else if (!biquad_coeffs(&bq[i], g_sys.tension_coeff[i]))
+                g_servo.tension_unstable |= (1 << i);
+
+            biquad_reset(&bq[i], tsense);
+        }
+
+        memcpy(g_servo.tension_coeff, g_sys.tension_coeff, sizeof(g_servo.tension_coeff));
+
+        g_servo.tension_preset = preset;
+    }
+
+    if ((preset == TFILT_LOWPASS) || (preset == TFILT_LOWPASS_NOTCH))
+    {
+        if (bq[TFILT_LOWPASS_STAGE].freq != g_sys.tension_lp_freq)
+        {
+            biquad_lowpass(&bq[TFILT_LOWPASS_STAGE], g_sys.tension_lp_freq,
+                           BIQUAD_Q_BUTTERWORTH, TFILT_SAMPLE_RATE);
+            biquad_reset(&bq[TFILT_LOWPASS_STAGE], tsense);
+        }
+    }
+
+    if ((preset == TFILT_NOTCH) || (preset == TFILT_LOWPASS_NOTCH))
+    {
+        TensionNotchTrack(&bq[TFILT_SUPPLY_STAGE], g_servo.velocity_supply, tsense);
+        TensionNotchTrack(&bq[TFILT_TAKEUP_STAGE], g_servo.velocity_takeup, tsense);
+    }
+
+    return biquad_cascade(bq, TFILT_STAGES, tsense);
+}
+
+/*****************************************************************************
+ * Move a reel notch to the rotation rate of the reel. The notch is only
+ * redesigned once the rate has moved by TFILT_RETUNE, which keeps the sin
+ * and cos off most ticks. Near stop, or too fast for the sample rate, the
+ * notch is bypassed and starts out settled again when the reel comes back
+ * into range.
+ *****************************************************************************/
+
+static void TensionNotchTrack(BIQUAD* bq, float velocity, float x)
+{
+    float freq = velocity * TFILT_REV_PER_SEC;
+
+    if ((freq < TFILT_NOTCH_MIN) || (freq > TFILT_NOTCH_MAX))
+    {
+        if (!bq->bypass)
+            biquad_init(bq);
+    }
+    else if (bq->bypass)
+    {
+        biquad_notch(bq, freq, g_sys.tension_notch_q, TFILT_SAMPLE_RATE);
+        biquad_reset(bq, x);
+    }
+    else if (fabsf(freq - bq->freq) > (bq->freq * TFILT_RETUNE))
+    {
+        biquad_notch(bq, freq, g_sys.tension_notch_q, TFILT_SAMPLE_RATE);
+    }
+}
+
+/*****************************************************************************
+ * Recursive least squares identification of the reel inertia model during
+ * shuttle. For the reel winding tape in and the reel paying it out, with
+ * I = reel_inertia + pack_inertia * r^4:
+ *
+ *      dac_in  =  I_in  * accel_in  + coulomb + viscous * vel_in  + T * r_in
+ *      dac_out = -I_out * accel_out - coulomb - viscous * vel_out + T * r_out
+ *
+ * where accel and vel are the reel speed magnitudes and their rate. Taking
+ * dac_in / r_in - dac_out / r_out removes the tape tension T, which isn't
+ * known in torque units, and leaves a relation linear in the four model
+ * parameters. The balance and the velocities pass through the same first
+ * order filter and the accel is the exact derivative of the filtered reel
+ * velocity, so the coarse QEI counts are never differenced. Forgetting
+ * lets the estimate follow slow changes, but the covariance is only
+ * inflated while its trace is below the starting trace so it doesn't wind
+ * up at constant velocity when the inertia isn't being excited. The reel
+ * and pack inertia start from the configured model, which holds the split
+ * between them until shuttles over a range of pack sizes separate it.
+ *
+ * The coulomb and viscous terms are fitted only so the drag doesn't bias
+ * the inertia. The tape drag through the head block enters the balance
+ * exactly as the bearing drag does and varies with the tension, and both
+ * reels share one pair of terms, so at a steady shuttle speed they can't
+ * be separated into per reel friction and aren't published.
+ *****************************************************************************/
+
+static void ReelIdentReset(REELIDENT* id)
+{
+    memset(id, 0, sizeof(REELIDENT));
+
+    /* Start from the configured inertia model */
+    id->theta[0] = g_sys.reel_inertia;
+    id->theta[1] = g_sys.pack_inertia;
+
+    ReelIdentPrior(id);
+}
+
+static void ReelIdentPrior(REELIDENT* id)
+{
+    static const float p0[REEL_ID_PARMS] = { REEL_ID_P0_REEL, REEL_ID_P0_PACK,
+                                             REEL_ID_P0_COULOMB, REEL_ID_P0_VISCOUS };
+    int i;
+
+    memset(id->p, 0, sizeof(id->p));
+
+    id->p_max = 0.0f;
+
+    for (i=0; i < REEL_ID_PARMS; i++)
+    {
+        id->p[i][i] = p0[i];
+        id->p_max  += p0[i];
+    }
+}
+
+static void ReelIdentUpdate(REELIDENT* id, float torque, float rs, float rt)
+{
+    int i, j;
+    float a = REEL_EST_TS / REEL_ID_TC;
+    float phi[REEL_ID_PARMS];
+    float pphi[REEL_ID_PARMS];
+    float accel_s, accel_t;
+    float r3s, r3t;
+    float denom, err, lambda, trace;
+    float rsq;
+
+    /* Seed the filters at the current operating point */
+    if (!id->warmup)
+    {
+        id->torque_f = torque;
+        id->velocity_supply_f = g_servo.velocity_supply;
+        id->velocity_takeup_f = g_servo.velocity_takeup;
+        id->unit_f   = 1.0f;
+    }
+
+    /* Derivative of the filtered reel velocities */
+    accel_s = (g_servo.velocity_supply - id->velocity_supply_f) * (1.0f / REEL_ID_TC);
+    accel_t = (g_servo.velocity_takeup - id->velocity_takeup_f) * (1.0f / REEL_ID_TC);
+
+    /* The radius estimates lose their scale while the reels accelerate
+     * and the tach roller lags the tape, but keep their ratio. The tape
+     * area on the two reels is fixed, so the radii come from the ratio
+     * and rs^2 + rt^2 as measured at steady speed.
+     */
+    rsq = (rs * rs) + (rt * rt);
+
+    if (!id->radius_sq_f)
+        id->radius_sq_f = rsq;
+    else if ((fabsf(accel_s) < REEL_ID_ACCEL_MIN) && (fabsf(accel_t) < REEL_ID_ACCEL_MIN))
+        id->radius_sq_f += (REEL_EST_TS / REEL_ID_RADIUS_TC) * (rsq - id->radius_sq_f);
+
+    rsq = sqrtf(id->radius_sq_f / rsq);
+    rs *= rsq;
+    rt *= rsq;
+
+    r3s = rs * rs * rs * PACK_INERTIA_SCALE;
+    r3t = rt * rt * rt * PACK_INERTIA_SCALE;
+
+    phi[0] = (accel_s / rs) + (accel_t / rt);
+    phi[1] = (accel_s * r3s) + (accel_t * r3t);
+    phi[2] = id->unit_f * ((1.0f / rs) + (1.0f / rt));
+    phi[3] = (id->velocity_supply_f / rs) + (id->velocity_takeup_f / rt);
+
+    err = id->torque_f;
+
+    for (i=0; i < REEL_ID_PARMS; i++)
+        err -= id->theta[i] * phi[i];
+
+    id->torque_f += a * (torque - id->torque_f);
+    id->velocity_supply_f += a * (g_servo.velocity_supply - id->velocity_supply_f);
+    id->velocity_takeup_f += a * (g_servo.velocity_takeup - id->velocity_takeup_f);
+    id->unit_f   += a * (1.0f - id->unit_f);
+
+    /* Wait for the seeding transient to pass */
+    if (id->warmup < REEL_ID_WARMUP)
+    {
+        ++id->warmup;
+        return;
+    }
+
+    trace = 0.0f;
+    denom = 0.0f;
+
+    for (i=0; i < REEL_ID_PARMS; i++)
+    {
+        pphi[i] = 0.0f;
+
+        for (j=0; j < REEL_ID_PARMS; j++)
+            pphi[i] += id->p[i][j] * phi[j];
+
+        denom += phi[i] * pphi[i];
+        trace += id->p[i][i];
+    }
+
+    lambda = (trace < id->p_max) ? (1.0f - (REEL_EST_TS / REEL_ID_FORGET_SEC)) : 1.0f;
+
+    /* Residual variance, so P is the parameter covariance itself */
+    if (!id->noise)
+        id->noise = fmaxf(err * err, REEL_ID_NOISE_MIN);
+    else
+        id->noise += (REEL_EST_TS / REEL_ID_NOISE_TC) * (fmaxf(err * err, REEL_ID_NOISE_MIN) - id->noise);
+
+    denom += lambda * id->noise;
+
+    /* Gain k = P*phi/denom, then P = (P - k*phi'*P) / lambda */
+    for (i=0; i < REEL_ID_PARMS; i++)
+        id->theta[i] += (pphi[i] / denom) * err;
+
+    for (i=0; i < REEL_ID_PARMS; i++)
+    {
+        for (j=i; j < REEL_ID_PARMS; j++)
+        {
+            id->p[i][j] = (id->p[i][j] - ((pphi[i] * pphi[j]) / denom)) / lambda;
+            id->p[j][i] = id->p[i][j];
+        }
+    }
+
+    /* Rounding can leave P indefinite once it gets small, start the
+     * covariance over from the prior if it does and keep the estimate.
+     */
+    for (i=0; i < REEL_ID_PARMS; i++)
+    {
+        if (id->p[i][i] <= 0.0f)
+        {
+            ReelIdentPrior(id);
+            break;
+        }
+    }
+
+    id->reel_inertia = id->theta[0];
+    id->pack_inertia = id->theta[1];
+
+    id->inertia_supply = id->reel_inertia + (id->pack_inertia * r3s * rs);
+    id->inertia_takeup = id->reel_inertia + (id->pack_inertia * r3t * rt);
+
+    if ((fabsf(accel_s) > REEL_ID_ACCEL_MIN) || (fabsf(accel_t) > REEL_ID_ACCEL_MIN))
+    {
+        if (id->samples < REEL_ID_MIN_SAMPLES)
+            ++id->samples;
+
+        /* Steady check over each window of excited samples */
+        if (++id->window >= REEL_ID_WINDOW)
+        {
+            float* w = id->window_parms;
+
+            id->steady_inertia =
+                (fabsf(id->inertia_supply - w[0]) <= (fabsf(id->inertia_supply) * REEL_ID_STEADY_TOL)) &&
+                (fabsf(id->inertia_takeup - w[1]) <= (fabsf(id->inertia_takeup) * REEL_ID_STEADY_TOL));
+
+            w[0] = id->inertia_supply;
+            w[1] = id->inertia_takeup;
+
+            id->window = 0;
+        }
+    }
+
+    ReelIdentCheck(id, rs, rt);
+}
+
+/*****************************************************************************
+ * Relative standard deviation of the identified inertia at a reel radius,
+ * from the reel and pack inertia covariance. The regressors are filtered
+ * over REEL_ID_TC so successive samples aren't independent, and P alone
+ * would understate the variance by the samples in two time constants.
+ * Until shuttles over a range of pack sizes separate the two terms this
+ * stays large away from the radii the reels were run at.
+ *****************************************************************************/
+
+static float ReelIdentSigma(REELIDENT* id, float radius)
+{
+    float r2 = radius * radius;
+    float v = r2 * r2 * PACK_INERTIA_SCALE;
+    float inertia = id->theta[0] + (id->theta[1] * v);
+    float var = id->p[0][0] + (2.0f * v * id->p[0][1]) + (v * v * id->p[1][1]);
+
+    var *= REEL_ID_CORR;
+
+    if ((inertia <= 0.0f) || (var < 0.0f))
+        return 1.0f;
+
+    return sqrtf(var) / inertia;
+}
+
+/*****************************************************************************
+ * The inertia is valid once enough excited samples have been taken, the
+ * inertia of both reels at their radii is known to REEL_ID_INERTIA_TOL and
+ * it held steady over the last window. The flag drops again if forgetting
+ * lets the covariance grow while the reels aren't excited.
+ *****************************************************************************/
+
+static void ReelIdentCheck(REELIDENT* id, float rs, float rt)
+{
+    id->sigma_inertia = fmaxf(ReelIdentSigma(id, rs), ReelIdentSigma(id, rt));
+
+    if (id->samples < REEL_ID_MIN_SAMPLES)
+    {
+        id->valid = 0;
+        return;
+    }
+
+    /* A negative reel or pack inertia isn't physical whatever P says */
+    id->valid = (id->steady_inertia && (id->theta[0] > 0.0f) && (id->theta[1] >= 0.0f) &&
+                 (id->sigma_inertia < REEL_ID_INERTIA_TOL)) ? 1 : 0;
+}
+
+//*****************************************************************************
+// Called every servo tick after the mode handler to identify the reels in
+// FWD and REW. The DAC levels written this tick are the motor torques, the
+// tape is winding on to the takeup reel when moving forward and on to the
+// supply reel in rewind. Identification pauses in all other modes and below
+// the reel velocity the radius estimators use.
+//*****************************************************************************
+
+static void ServoReelIdent(void)
+{
+    float rs, rt;
+    float torque;
+    float veldetect = (g_high_speed_flag) ? 40.0f : 20.0f;
+
+    if (((g_servo.mode != MODE_FWD) && (g_servo.mode != MODE_REW)) ||
+        (g_servo.direction == TAPE_DIR_STOP) ||
+        (g_servo.velocity_supply < veldetect) ||
+        (g_servo.velocity_takeup < veldetect) ||
+        !g_servo.est_radius_supply.valid || !g_servo.est_radius_takeup.valid)
+    {
+        g_servo.reel_ident.warmup = 0;
+        return;
+    }
+
+    rs = g_servo.est_radius_supply.x;
+    rt = g_servo.est_radius_takeup.x;
+
+    if ((rs <= 0.0f) || (rt <= 0.0f))
+        return;
+
+    if (g_servo.direction == TAPE_DIR_FWD)
+        torque = (g_servo.dac_takeup / rt) - (g_servo.dac_supply / rs);
+    else
+        torque = (g_servo.dac_supply / rs) - (g_servo.dac_takeup / rt);
+
+    ReelIdentUpdate(&g_servo.reel_ident, torque, rs, rt);
+}
+
 Void ServoLoopTask(UArg a0, UArg a1)
 {
+    Error_Block eb;
+    Clock_Params clockParams;
+    Semaphore_Params semParams;
+    Types_FreqHz freq;
+    uint32_t start;
+    uint32_t cycles[6];
+
     static void (*jmptab[MAX_NUM_MODES])(void) = {
         Service_HaltMode,       /* 0 = MODE_HALT   */
         Service_StopMode,       /* 1 = MODE_STOP   */
@@ -208,236 +880,1235 @@ Void ServoLoopTask(UArg a0, UArg a1)
     g_servo.radius_takeup_accum = 0.0f;
     g_servo.radius_supply       = 0.0f;
     g_servo.radius_supply_accum = 0.0f;
+    g_servo.radius_takeup_avg   = 0.0f;
+    g_servo.radius_supply_avg   = 0.0f;
+    g_servo.offset_null_avg     = 0.0f;
+    g_servo.est_radius_takeup.valid = 0;
+    g_servo.est_radius_supply.valid = 0;
+    g_servo.est_offset.valid        = 0;
+    g_servo.obs_supply.valid        = 0;
+    g_servo.obs_takeup.valid        = 0;
+    g_servo.tension_preset      = -1;
+    CurrentLoopReset(&g_servo.current_supply);
+    CurrentLoopReset(&g_servo.current_takeup);
+    g_servo.dac_residue_supply  = 0.0f;
+    g_servo.dac_residue_takeup  = 0.0f;
+    ReelIdentReset(&g_servo.reel_ident);
+    g_servo.tape_position       = 0;
+    g_servo.locate_target       = 0;
+    g_servo.locate_state        = LOCATE_IDLE;
     g_servo.dac_halt_takeup     = 0;
     g_servo.dac_halt_supply     = 0;
 	g_servo.play_boost_count    = 0;
 	g_servo.cpu_temp_accum      = 0.0f;
     g_servo.cpu_temp_cnt        = 0;
 
-    /* Servo's start in halt mode! */
-    Servo_SetMode(MODE_HALT);
+    /* Initialize the QEI interface and interrupts */
+    ReelQEI_initialize();
+
+    /* Initialize tape roller tach timers and interrupt */
+    TapeTach_initialize();
+
+    /* Timestamp counts are converted to usec for the timing stats */
+    Timestamp_getFreq(&freq);
+    s_cycles_per_usec = freq.lo / 1000000;
+    s_timing_reset = true;
+
+    /* Enable the DWT cycle counter for the per stage profile */
+    BIOS_getCpuFreq(&freq);
+    s_cpu_freq = freq.lo;
+
+    HWREG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+    HWREG(DWT_CYCCNT)  = 0;
+    HWREG(DWT_CTRL)   |= DWT_CTRL_CYCCNTENA;
+    s_profile_reset = true;
+
+    /* Create the binary servo tick semaphore and the periodic clock
+     * that posts it every SERVO_TICK_PERIOD system clock ticks.
+     */
+
+    Error_init(&eb);
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    s_semaServoTick = Semaphore_create(0, &semParams, &eb);
+
+    if (s_semaServoTick == NULL)
+        System_abort("Servo tick semaphore create failed!\n");
+
+    Error_init(&eb);
+    Clock_Params_init(&clockParams);
+    clockParams.period    = SERVO_TICK_PERIOD;
+    clockParams.startFlag = TRUE;
+
+    if (Clock_create(ServoTickFxn, SERVO_TICK_PERIOD, &clockParams, &eb) == NULL)
+        System_abort("Servo tick clock create failed!\n");
+
+    /*** ENTER SERVO LOOP FOREVER ***/
+
+    while (1)
+    {
+        /* Wait for the next 500 Hz (2ms) servo tick */
+        Semaphore_pend(s_semaServoTick, BIOS_WAIT_FOREVER);
+
+        start = Timestamp_get32();
+
+        cycles[0] = CPU_CYCLES();
+        s_dac_cycles = 0;
+
+        /***********************************************************
+         * GET THE SUPPLY AND TAKEUP REEL VELOCITY AND DIRECTION
+         ***********************************************************/
+
+        /* Read the tape roller tachometer count and tape position */
+        g_servo.tape_tach = TapeTach_read();
+        g_servo.tape_accel = TapeTach_getAccel();
+        g_servo.tape_position = TapeTach_getPosition();
+
+        cycles[1] = CPU_CYCLES();
+
+        /* Track the reel positions with the velocity observers */
+        float obs_supply = QEIObserver(&g_servo.obs_supply, QEIPositionGet(QEI_BASE_SUPPLY));
+        float obs_takeup = QEIObserver(&g_servo.obs_takeup, QEIPositionGet(QEI_BASE_TAKEUP));
+
+        int32_t sdir;
+        int32_t tdir;
+
+        if (g_sys.sysflags & SF_QEI_VELCAP)
+        {
+            uint32_t supply = QEIVelocityGet(QEI_BASE_SUPPLY);
+            uint32_t takeup = QEIVelocityGet(QEI_BASE_TAKEUP);
+#if 0
+            if (!(g_dip_switch & M_DIPSW3))
+            {
+                supply = supply << 1;
+                takeup = takeup << 1;
+            }
+#endif
+            /* Read the takeup and supply reel motor velocity values */
+            g_servo.velocity_supply = (float)supply;
+            g_servo.velocity_takeup = (float)takeup;
+
+            sdir = QEIDirectionGet(QEI_BASE_SUPPLY);
+            tdir = QEIDirectionGet(QEI_BASE_TAKEUP);
+        }
+        else
+        {
+            /* The observers give the speed and direction every tick */
+            g_servo.velocity_supply = fabsf(obs_supply);
+            g_servo.velocity_takeup = fabsf(obs_takeup);
+
+            sdir = (obs_supply < 0.0f) ? -1 : 1;
+            tdir = (obs_takeup < 0.0f) ? -1 : 1;
+        }
+
+        /* Sum the two for current total reel velocity */
+        g_servo.velocity = (g_servo.velocity_supply + g_servo.velocity_takeup);
+
+        /* Set the motion active status flag */
+        g_servo.motion = (g_servo.velocity > g_sys.vel_detect_threshold) ? 1 : 0;
+
+        /* Make sure both reels are moving and moving in the same
+         * direction before changing state to avoid jitter at near
+         * stopped conditions.
+         */
+
+        if ((sdir == tdir) && g_servo.motion)
+            g_servo.direction = sdir;
+        else
+        	g_servo.direction = 0;
+
+        cycles[2] = CPU_CYCLES();
+
+        /* Read all ADC values which includes the tape tension sensor
+         * Step[0] ADC2 - Tension Sensor Arm
+         * Step[1] ADC0 - Supply Motor Current Option
+         * Step[2] ADC1 - Takeup Motor Current Option
+         * Step[3] ADC3 - Expansion Port ADC input option
+         * Step[4] Internal CPU temperature sensor
+         */
+        Board_readADC(g_servo.adc);
+
+        /* Scale the motor current sense to DAC torque counts */
+        g_servo.current_supply.current = ((float)g_servo.adc[1] - g_sys.current_offset) * g_sys.current_scale;
+        g_servo.current_takeup.current = ((float)g_servo.adc[2] - g_sys.current_offset) * g_sys.current_scale;
+
+        /* Accumulate the CPU temperature */
+
+        g_servo.cpu_temp_accum += (float)g_servo.adc[4];
+
+        ++g_servo.cpu_temp_cnt;
+
+        if (g_servo.cpu_temp_cnt >= TEMP_AVG_COUNT)
+        {
+            /* divide accumulator and store avg temp value */
+            g_servo.cpu_temp = g_servo.cpu_temp_accum * (1.0f/(float)TEMP_AVG_COUNT);
+
+            /* reset accumulator and count */
+            g_servo.cpu_temp_accum = 0.0f;
+            g_servo.cpu_temp_cnt = 0;
+        }
+
+        /* Calculate signed tension sensor value from 12-bit ADC reading. Since
+         * the ADC is 12-bit, we use 2047 as mids-cale. We allow the offset to be
+         * adjusted in software so the tension sensor can be offset for 1" tape.
+         * Mid-scale of the ADC should equate to tension sensor reading with tape
+         * under proper tension with mid pack on both reels.
+         */
+
+        float midscale;
+
+        if (g_tape_width)
+            midscale = g_sys.tension_sensor_midscale2;   /* ADC mid-scale for 2" tape */
+        else
+            midscale = g_sys.tension_sensor_midscale1;   /* ADC mid-scale for 1" tape */
+
+        /* Calculate the tension sensor position from mid-scale */
+        g_servo.tsense_raw = ((midscale - (float)g_servo.adc[0])) * g_sys.tension_sensor_gain;
+
+        /* Take out reel once-around and ripple before it reaches the torque */
+        g_servo.tsense = TensionFilter(g_servo.tsense_raw);
+
+        cycles[3] = CPU_CYCLES();
+
+        /***********************************************************
+         * BEGIN REELING RADIUS CALCULATIONS
+         ***********************************************************/
+
+        /* Calculate the servo null offset value. The servo null offset
+         * is the difference in velocity of the takeup and supply reel.
+         * The reel with more pack turns more slowly due to larger radius and
+         * visa versa. We calculate the offset as the velocity ratio of the
+         * takeup and supply reel velocity by simply dividing the two reel
+         * velocity tach values.
+         */
+
+        float delta = 0.0f;
+
+        float veldetect = (g_high_speed_flag) ? 40.0f : 20.0f;
+
+        if ((g_servo.velocity_takeup > veldetect) && (g_servo.velocity_supply > veldetect))
+        {
+            /* Calculate the current reeling radius as tape speed divided by
+             * the reel speed. Takeup and supply velocity must not be zero!
+             */
+
+            float radius_takeup = RADIUS_F(g_servo.tape_tach, g_servo.velocity_takeup);
+            float radius_supply = RADIUS_F(g_servo.tape_tach, g_servo.velocity_supply);
+
+            /* Calculate the delta factor between the two reel motor tach's */
+            if (g_servo.velocity_takeup > g_servo.velocity_supply)
+            {
+                delta = ((g_servo.velocity_takeup * OFFSET_SCALE_F) / g_servo.velocity_supply) - OFFSET_SCALE_F;
+            }
+            else if (g_servo.velocity_supply > g_servo.velocity_takeup)
+            {
+                delta = ((g_servo.velocity_supply * OFFSET_SCALE_F) / g_servo.velocity_takeup) - OFFSET_SCALE_F;
+            }
+            else
+            {
+                delta = 0.0f;
+            }
+
+            if (delta > 1000.0f)
+                delta = 1000.0f;
+
+            /* Update the recursive estimators every tick. Measurement noise
+             * is referenced to the slower reel, which has the coarser
+             * velocity count and dominates the ratio error.
+             */
+            float vmin = (g_servo.velocity_takeup < g_servo.velocity_supply) ?
+                          g_servo.velocity_takeup : g_servo.velocity_supply;
+
+            float r = REEL_EST_VREF / vmin;
+
+            r = (r > 1.0f) ? (r * r) : 1.0f;
+
+            float q_radius = ReelEstimateQ(g_sys.reel_radius_tc);
+            float q_offset = ReelEstimateQ(g_sys.reel_offset_tc);
+
+            ReelEstimate(&g_servo.est_radius_takeup, radius_takeup, q_radius, r);
+            ReelEstimate(&g_servo.est_radius_supply, radius_supply, q_radius, r);
+            ReelEstimate(&g_servo.est_offset, delta, q_offset, r);
+
+            /* Accumulate the delta for averaging over 1 second */
+            g_servo.offset_null_accum += delta;
+
+            g_servo.radius_takeup_accum += radius_takeup;
+            g_servo.radius_supply_accum += radius_supply;
+
+            ++g_servo.offset_sample_cnt;
+
+            if (g_servo.offset_sample_cnt >= OFFSET_CALC_PERIOD)
+            {
+                /* Calculate the averaged offset */
+                float offset = g_servo.offset_null_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
+
+                /* Calculate the averaged null offset value */
+                g_servo.offset_null_avg = offset * g_sys.reel_offset_gain;
+
+                /* Reset the accumulator */
+                g_servo.offset_null_accum = 0.0f;
+
+                /* Calculate the averaged reeling radius */
+                radius_takeup = g_servo.radius_takeup_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
+                radius_supply = g_servo.radius_supply_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
+
+                g_servo.radius_takeup_avg = radius_takeup * g_sys.reel_radius_gain;
+                g_servo.radius_supply_avg = radius_supply * g_sys.reel_radius_gain;
+
+                /* Reset the accumulators */
+                g_servo.radius_takeup_accum = g_servo.radius_supply_accum = 0.0f;
+
+                /* Reset the sample counter */
+                g_servo.offset_sample_cnt = 0;
+
+                /* Legacy mode publishes the one second averages */
+                if (g_sys.sysflags & SF_RADIUS_BOXCAR)
+                {
+                    g_servo.offset_null   = g_servo.offset_null_avg;
+                    g_servo.radius_takeup = g_servo.radius_takeup_avg;
+                    g_servo.radius_supply = g_servo.radius_supply_avg;
+                }
+            }
+
+            /* Otherwise publish the recursive estimates every tick */
+            if (!(g_sys.sysflags & SF_RADIUS_BOXCAR))
+            {
+                g_servo.offset_null   = g_servo.est_offset.x * g_sys.reel_offset_gain;
+                g_servo.radius_takeup = g_servo.est_radius_takeup.x * g_sys.reel_radius_gain;
+                g_servo.radius_supply = g_servo.est_radius_supply.x * g_sys.reel_radius_gain;
+            }
+
+            /* Now store the calculated offset for each reel motor that is added
+             * or subtracted to compensate the torque applied for the current
+             * reel radius offset. These values are used to adjust the torque on
+             * each reel based on the reel velocity to compensate for the constantly
+             * changing reel hub radius.
+             */
+
+            if (g_sys.reel_offset_gain <= 0.0f)
+            {
+                /* for debugging & aligning system */
+                g_servo.offset_supply = 0.0f;
+                g_servo.offset_takeup = 0.0f;
+            }
+            else
+            {
+                if (g_servo.velocity_takeup > g_servo.velocity_supply)
+                {
+                    /* TAKEUP reel is turning faster than the SUPPLY reel!
+                     * ADD to the TAKEUP reel torque.
+                     * SUBTRACT from the SUPPLLY reel torque.
+                     */
+                    g_servo.offset_supply =  (g_servo.offset_null);
+                    g_servo.offset_takeup = -(g_servo.offset_null);
+                }
+                else if (g_servo.velocity_supply > g_servo.velocity_takeup)
+                {
+                    /* SUPPLY reel is turning faster than the TAKE-UP reel!
+                     * ADD to the SUPPLY reel torque.
+                     * SUBTRACT from the TAKEUP reel torque.
+                     */
+                    g_servo.offset_supply = -(g_servo.offset_null);
+                    g_servo.offset_takeup =  (g_servo.offset_null);
+                }
+                else
+                {
+                    g_servo.offset_supply = 0.0f;
+                    g_servo.offset_takeup = 0.0f;
+                }
+            }
+        }
+
+        cycles[4] = CPU_CYCLES();
+
+        /**********************************************
+         * DISPATCH TO THE CURRENT SERVO MODE HANDLER
+         **********************************************/
+
+        /* Apply any pending PID reset and mode change requests */
+        ServoApplyRequests();
+
+        /* Profile the shuttle velocity if a locate is active */
+        if (g_servo.locate_state != LOCATE_IDLE)
+            ServoLocateUpdate();
+
+        (*jmptab[g_servo.mode])();
+
+        /* Identify the reel inertia from the shuttle torque */
+        ServoReelIdent();
+
+        /* Store a capture buffer sample if armed */
+        Capture_Sample();
+
+        cycles[5] = CPU_CYCLES();
+
+        /* Update the per stage cycle counts */
+        ServoProfileUpdate(cycles);
+
+        /* Update the tick period and execution time histograms */
+        ServoTimingUpdate(start, Timestamp_get32());
+    }
+}
+
+//*****************************************************************************
+// Periodic clock function, runs in SWI context to release the servo loop.
+//*****************************************************************************
+
+static Void ServoTickFxn(UArg arg)
+{
+    Semaphore_post(s_semaServoTick);
+}
+
+//*****************************************************************************
+// Apply PID reset and mode change requests posted by other tasks. Resets
+// are applied first since they are always requested ahead of the mode
+// change that uses them.
+//*****************************************************************************
+
+static void ServoApplyRequests(void)
+{
+    uint32_t request;
+    uint32_t mode;
+    uint32_t prev_mode;
+
+    request = s_play_reset_request;
+
+    if (request != s_play_reset_ack)
+    {
+        s_play_reset_ack = request;
+        ResetPlayServo();
+    }
+
+    request = s_shuttle_reset_request;
+
+    if (request != s_shuttle_reset_ack)
+    {
+        s_shuttle_reset_ack = request;
+        ResetShuttleServo();
+    }
+
+    request = s_mode_request;
+
+    if (request != s_mode_request_ack)
+    {
+        s_mode_request_ack = request;
+
+        /* Only the mode number bits */
+        mode = request & MODE_MASK;
+
+        /* Get the previous mode */
+        prev_mode = g_servo.mode_prev;
+
+        /* Update for previous mode state */
+        g_servo.mode_prev = g_servo.mode;
+
+        /* Now set the new servo mode state */
+        g_servo.mode = mode;
+
+        /* Set dynamic brake state if STOP mode requested and
+         * the previous mode was PLAY, FF or REW, otherwise clear it.
+         */
+        if (mode == MODE_STOP)
+        {
+            g_servo.stop_brake_state = (prev_mode != MODE_HALT) ? 1 : 0;
+
+            /* Start timing the dynamic stop */
+            g_servo.stop_brake_ticks = 0;
+            g_servo.stop_velocity    = g_servo.velocity;
+        }
+
+        /* A mode change ends any locate in progress */
+        g_servo.locate_state = LOCATE_IDLE;
+
+        /* Start the shuttle velocity profile from the current motion */
+        if ((mode == MODE_FWD) || (mode == MODE_REW))
+            ShuttleProfileSeed();
+    }
+
+    /* Locate requests follow the mode change that starts the shuttle */
+    request = s_locate_request;
+
+    if (request != s_locate_ack)
+    {
+        s_locate_ack = request;
+
+        if ((request & LOCATE_REQUEST_ARM) &&
+            ((g_servo.mode == MODE_FWD) || (g_servo.mode == MODE_REW)))
+        {
+            g_servo.locate_target = s_locate_target;
+            g_servo.locate_state  = LOCATE_SHUTTLE;
+        }
+        else
+        {
+            g_servo.locate_state  = LOCATE_IDLE;
+        }
+    }
+}
+
+//*****************************************************************************
+// Profile the shuttle velocity for a tape locate. The velocity follows a
+// constant deceleration curve, v^2 = va^2 + 2*a*d, down to the final
+// approach velocity at the approach distance, then holds the approach
+// velocity until the target window is reached. The profile is worked in
+// tach edges and converted to the shuttle reel velocity units using the
+// current reeling radius estimates, so it tracks as the packs change. Until
+// the radius estimates are valid the approach velocity is used.
+//*****************************************************************************
+
+static void ServoLocateUpdate(void)
+{
+    float velocity;
+    int32_t dist;
+
+    if ((g_servo.mode != MODE_FWD) && (g_servo.mode != MODE_REW))
+    {
+        g_servo.locate_state = LOCATE_IDLE;
+        return;
+    }
+
+    /* Distance remaining in the direction of travel */
+    dist = g_servo.locate_target - g_servo.tape_position;
+
+    if (g_servo.mode == MODE_REW)
+        dist = -dist;
+
+    /* Done early by the distance the transport coasts while stopping */
+    int32_t lead = (int32_t)(TapeSpeed() * 2.0f * LOCATE_STOP_SEC);
+
+    if ((g_servo.locate_state == LOCATE_DONE) || (dist <= ((g_sys.locate_window / 2) + lead)))
+    {
+        g_servo.locate_state = LOCATE_DONE;
+        g_servo.shuttle_velocity = 0;
+        return;
+    }
+
+    velocity = (float)g_sys.locate_approach_velocity;
+
+    if (dist <= g_sys.locate_approach_dist)
+    {
+        /* Ease off through the approach so short corrective moves
+         * don't coast past the target, with a floor to keep moving.
+         */
+        velocity *= sqrtf((float)dist / (float)g_sys.locate_approach_dist);
+
+        if (velocity < ((float)g_sys.locate_approach_velocity * LOCATE_CREEP))
+            velocity = (float)g_sys.locate_approach_velocity * LOCATE_CREEP;
+
+        g_servo.locate_state = LOCATE_APPROACH;
+    }
+    else if (g_servo.est_radius_takeup.valid && g_servo.est_radius_supply.valid)
+    {
+        /* Reel velocity units per tach edge/sec. The tach reads half the
+         * edge rate and each reel velocity is tach * 10 / radius.
+         */
+        float k = 5.0f * ((1.0f / g_servo.est_radius_supply.x) +
+                          (1.0f / g_servo.est_radius_takeup.x));
+
+        /* Allow for the shuttle loop lag at the measured tape speed */
+        float d = (float)(dist - g_sys.locate_approach_dist) -
+                  (TapeSpeed() * 2.0f * LOCATE_LAG_SEC);
+
+        if (d < 0.0f)
+            d = 0.0f;
+
+        velocity = sqrtf((velocity * velocity) + (k * k * 2.0f * g_sys.locate_decel * d));
+    }
+
+    if (velocity > (float)g_sys.locate_velocity)
+        velocity = (float)g_sys.locate_velocity;
+
+    g_servo.shuttle_velocity = (uint32_t)velocity;
+}
+
+//*****************************************************************************
+// Seed the shuttle velocity profile on entry to FWD or REW. If the tape is
+// already moving in the new direction (shuttle from play, or FWD to FWD)
+// the profile starts at the current reel velocity so there is no dip in
+// the setpoint. If it is stopped or moving the other way the profile
+// starts from zero and the PID brakes it through the direction change.
+//*****************************************************************************
+
+static void ShuttleProfileSeed(void)
+{
+    int32_t dir = (g_servo.mode == MODE_FWD) ? TAPE_DIR_FWD : TAPE_DIR_REW;
+
+    g_servo.shuttle_profile.accel = 0.0f;
+
+    if (g_servo.motion && (g_servo.direction == dir))
+        g_servo.shuttle_profile.velocity = g_servo.velocity;
+    else
+        g_servo.shuttle_profile.velocity = 0.0f;
+}
+
+//*****************************************************************************
+// Shuttle velocity profile generator. Moves the PID velocity setpoint
+// toward the shuttle target velocity with the acceleration limited to
+// g_sys.shuttle_accel and the rate of change of acceleration limited to
+// g_sys.shuttle_jerk, giving an S-curve. With no jerk limit the profile is
+// trapezoidal, and with no accel limit the setpoint steps as before.
+//
+// The target may change at any time (IPC velocity, auto-slow or locate).
+// Each tick the accel is steered toward the value that would bring it back
+// to zero exactly as the setpoint arrives at the target, so a new target
+// mid-ramp blends in without the setpoint overshooting it.
+//*****************************************************************************
+
+static float ShuttleProfileUpdate(void)
+{
+    VPROFILE* p = &g_servo.shuttle_profile;
+
+    float target = (float)g_servo.shuttle_velocity;
+    float amax   = g_sys.shuttle_accel;
+    float jerk   = g_sys.shuttle_jerk;
+    float error  = target - p->velocity;
+    float accel;
+
+    /* The locate decel curve is already shaped, follow it directly */
+    if ((g_servo.locate_state != LOCATE_IDLE) && (target <= p->velocity))
+        amax = 0.0f;
+
+    if (amax <= 0.0f)
+    {
+        p->velocity = target;
+        p->accel    = 0.0f;
+        return target;
+    }
+
+    if (jerk <= 0.0f)
+    {
+        /* Trapezoidal, full accel toward the target */
+        accel = (error >= 0.0f) ? amax : -amax;
+    }
+    else
+    {
+        /* Accel that ramps to zero at max jerk just as we arrive */
+        accel = sqrtf(2.0f * jerk * fabsf(error));
+
+        if (accel > amax)
+            accel = amax;
+
+        if (error < 0.0f)
+            accel = -accel;
+
+        /* Slew the accel no faster than the jerk limit */
+        float step = jerk * PROFILE_TS;
+
+        if (accel > (p->accel + step))
+            accel = p->accel + step;
+        else if (accel < (p->accel - step))
+            accel = p->accel - step;
+    }
+
+    p->accel = accel;
+    p->velocity += accel * PROFILE_TS;
+
+    /* Land on the target rather than step past it */
+    if (((error >= 0.0f) && (p->velocity >= target)) ||
+        ((error <= 0.0f) && (p->velocity <= target)))
+    {
+        p->velocity = target;
+        p->accel    = 0.0f;
+    }
+
+    return p->velocity;
+}
+
+//*****************************************************************************
+// Tape speed in tape tach units worked out from both reel velocities and
+// their radius estimates. Unlike the tach roller reading this follows the
+// tape right down to a stop, the tach holds its last period until it times
+// out. Falls back to the tach until the radius estimates are seeded.
+//*****************************************************************************
+
+static float TapeSpeed(void)
+{
+    if (!g_servo.est_radius_supply.valid || !g_servo.est_radius_takeup.valid)
+        return g_servo.tape_tach;
+
+    return ((g_servo.velocity_supply * g_servo.est_radius_supply.x) +
+            (g_servo.velocity_takeup * g_servo.est_radius_takeup.x)) * 0.05f;
+}
+
+//*****************************************************************************
+// Model based dynamic braking for STOP mode. Each reel's inertia is taken
+// from its reeling radius estimate, I = reel_inertia + pack_inertia * r^4,
+// in DAC counts per unit of reel velocity per second. With SF_REEL_IDENT
+// the two inertia terms identified during shuttle are used instead. For a tape decel A
+// the reel paying out needs k = I * 10 / r counts more torque per unit of
+// A and the reel winding in needs k less, which decelerates both together
+// at the stop hold tension. The hold torque on the relaxed reel limits A,
+// so the tension is also allowed to rise by up to STOP_BRAKE_TENSION_MAX
+// times the hold level, scaling both hold torques by g. The largest A is
+// found that keeps the driven reel within the brake torque and the DAC
+// range and leaves the relaxed reel STOP_BRAKE_HOLD_MIN of its hold torque.
+// The decel tapers off with the tape speed so the brake torque fades into
+// the stop hold null as motion ends. Returns false and leaves the fixed
+// brake torque if the model is disabled or no radius estimates exist yet.
+//*****************************************************************************
+
+static float ReelInertia(float radius)
+{
+    float r2 = radius * radius;
+    float inertia;
+
+    /* The identified model once it has converged and is known at this
+     * radius, if enabled.
+     */
+    if ((g_sys.sysflags & SF_REEL_IDENT) && g_servo.reel_ident.valid &&
+        (ReelIdentSigma(&g_servo.reel_ident, radius) < REEL_ID_INERTIA_TOL))
+    {
+        inertia = g_servo.reel_ident.reel_inertia +
+                  (g_servo.reel_ident.pack_inertia * PACK_INERTIA_SCALE * r2 * r2);
+
+        if (inertia > 0.0f)
+            return inertia;
+    }
+
+    return g_sys.reel_inertia + (g_sys.pack_inertia * PACK_INERTIA_SCALE * r2 * r2);
+}
+
+static bool StopBrakeModel(float* brake_supply, float* brake_takeup)
+{
+    float rs, rt;
+    float ks, kt;
+    float hold_s, hold_t;
+    float k_up, k_relax;
+    float hold_up, hold_relax;
+    float limit, g, a, accel, speed;
+
+    if (g_sys.reel_inertia <= 0.0f)
+        return false;
+
+    if (!g_servo.est_radius_supply.valid || !g_servo.est_radius_takeup.valid)
+        return false;
+
+    rs = g_servo.est_radius_supply.x;
+    rt = g_servo.est_radius_takeup.x;
+
+    if ((rs <= 0.0f) || (rt <= 0.0f))
+        return false;
+
+    /* DAC counts per unit of tape decel, reel velocity = tape * 10 / r */
+    ks = (ReelInertia(rs) * 10.0f) / rs;
+    kt = (ReelInertia(rt) * 10.0f) / rt;
+
+    hold_s = (float)g_sys.stop_supply_tension + g_servo.tsense + g_servo.offset_supply;
+    hold_t = (float)g_sys.stop_takeup_tension + g_servo.tsense + g_servo.offset_takeup;
+
+    if ((hold_s <= 0.0f) || (hold_t <= 0.0f))
+        return false;
+
+    if (g_servo.direction == TAPE_DIR_FWD)
+    {
+        /* Supply is driven harder, takeup relaxes */
+        k_up    = ks;
+        hold_up = hold_s;
+        k_relax = kt;
+        hold_relax = hold_t;
+    }
+    else if (g_servo.direction == TAPE_DIR_REW)
+    {
+        /* Takeup is driven harder, supply relaxes */
+        k_up    = kt;
+        hold_up = hold_t;
+        k_relax = ks;
+        hold_relax = hold_s;
+    }
+    else
+    {
+        return false;
+    }
+
+    /* Brake torque available on the driven reel */
+    limit = fminf((float)g_sys.stop_brake_torque, DAC_MAX_F - hold_up);
+
+    /* Tension scale where the driven and relaxed reel limits meet */
+    g = (limit + hold_up + ((STOP_BRAKE_HOLD_MIN * hold_relax * k_up) / k_relax)) /
+        (hold_up + ((hold_relax * k_up) / k_relax));
+
+    g = fmaxf(1.0f, fminf(g, STOP_BRAKE_TENSION_MAX));
+
+    /* Max decel at that tension from each reel's limit */
+    a = fminf(((g - STOP_BRAKE_HOLD_MIN) * hold_relax) / k_relax,
+              (limit - ((g - 1.0f) * hold_up)) / k_up);
+
+    if (a <= 0.0f)
+        return false;
+
+    speed = TapeSpeed();
+
+    /* Taper the decel and the tension rise to zero with the tape speed */
+    accel = fminf(a, speed * (1.0f / STOP_BRAKE_TAPER_SEC));
+    g = 1.0f + ((g - 1.0f) * (accel / a));
+
+    g_servo.stop_brake_decel = accel;
+
+    if (g_servo.direction == TAPE_DIR_FWD)
+    {
+        *brake_supply = (k_up * accel) + ((g - 1.0f) * hold_up);
+        *brake_takeup = (k_relax * accel) - ((g - 1.0f) * hold_relax);
+    }
+    else
+    {
+        *brake_takeup = (k_up * accel) + ((g - 1.0f) * hold_up);
+        *brake_supply = (k_relax * accel) - ((g - 1.0f) * hold_relax);
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+// Play boost torque feedforward. Once the pinch roller closes, the capstan
+// pulls the tape up to play speed with roughly a first order response of
+// time constant play_accel_time. A reference tape speed follows the same
+// response from the first boost tick and its acceleration A is turned into
+// reel torque with the inertia model used by the STOP brake. The takeup is
+// driven k * A harder to keep pace with the capstan and the supply relaxes
+// by k * A so the capstan isn't left dragging the supply pack up to speed
+// through the heads. The play PI then only trims the tach error against the
+// reference speed. Returns false if the model is disabled or the radius
+// estimates weren't valid from the start of the boost, leaving the PI to
+// boost on its own against the play speed.
+//*****************************************************************************
+
+static bool PlayBoostFeedforward(float* ff_supply, float* ff_takeup)
+{
+    float rs, rt;
+    float accel;
+
+    if ((g_sys.play_accel_time <= 0.0f) || (g_sys.reel_inertia <= 0.0f))
+        return false;
+
+    /* Reference tape speed follows the capstan spin up */
+    accel = ((float)g_servo.play_boost_end - g_servo.play_ref_velocity) / g_sys.play_accel_time;
+
+    if (accel < 0.0f)
+        accel = 0.0f;
+
+    g_servo.play_ref_velocity += fminf(accel * PROFILE_TS,
+                                       (float)g_servo.play_boost_end - g_servo.play_ref_velocity);
+
+    /* Feedforward only runs for a boost that starts with radius estimates */
+    if (!g_servo.est_radius_supply.valid || !g_servo.est_radius_takeup.valid)
+        g_servo.play_ff_active = false;
+
+    if (!g_servo.play_ff_active)
+        return false;
+
+    rs = g_servo.est_radius_supply.x;
+    rt = g_servo.est_radius_takeup.x;
+
+    if ((rs <= 0.0f) || (rt <= 0.0f))
+    {
+        g_servo.play_ff_active = false;
+        return false;
+    }
+
+    /* DAC counts per unit of tape accel, reel velocity = tape * 10 / r */
+    *ff_takeup = ((ReelInertia(rt) * 10.0f) / rt) * accel;
+
+    /* Relax the supply only until its reel catches up with the reference,
+     * past that the tension sensor term brings the arm back to center.
+     */
+    if ((g_servo.velocity_supply * rs * 0.1f) < g_servo.play_ref_velocity)
+        *ff_supply = ((ReelInertia(rs) * 10.0f) / rs) * accel;
+
+    return true;
+}
+
+//*****************************************************************************
+// Reset PLAY servo parameters. This gets called every time prior to the
+// transport controller entering play mode. Here we reset all the play boost
+// ramp up counters that control play boost logic before the play servo mode
+// begins.
+//*****************************************************************************
+
+static void ResetPlayServo(void)
+{
+    /* Initialize the PID used for play boost */
+
+    g_servo.play_boost_count = 1000;
+
+    /* Feedforward reference starts with the tape at rest */
+    g_servo.play_ref_velocity = 0.0f;
+    g_servo.play_boost_ff     = 0.0f;
+    g_servo.play_ff_active    = true;
+
+    /* Initialize the play servo data items */
+    if (g_high_speed_flag)
+    {
+        /* Reset the tension values */
+        g_servo.play_supply_tension    = (float)g_sys.play_hi_supply_tension;
+        g_servo.play_takeup_tension    = (float)g_sys.play_hi_takeup_tension;
+        g_servo.play_boost_end         = g_sys.play_hi_boost_end;
+
+        PID_INIT(PID_PLAY_ENGINE, &g_servo.pid_play,
+                 g_sys.play_hi_boost_pgain,   	// P-gain
+                 g_sys.play_hi_boost_igain,   	// I-gain
+                 0.0f,     						// D-gain
+                 PID_CV_MAX_F,
+                 PID_CV_MIN_F,
+                 1.0f);              			// PID deadband
+    }
+    else
+    {
+        /* Reset the tension values */
+        g_servo.play_supply_tension    = (float)g_sys.play_lo_supply_tension;
+        g_servo.play_takeup_tension    = (float)g_sys.play_lo_takeup_tension;
+        g_servo.play_boost_end         = g_sys.play_lo_boost_end;
+
+        PID_INIT(PID_PLAY_ENGINE, &g_servo.pid_play,
+                 g_sys.play_lo_boost_pgain,   	// P-gain
+                 g_sys.play_lo_boost_igain,   	// I-gain
+                 0.0f,     						// D-gain
+                 PID_CV_MAX_F,
+                 PID_CV_MIN_F,
+                 1.0f);              			// PID deadband
+    }
+
+    TapeTach_reset();
+}
+
+//*****************************************************************************
+// Reset shuttle PID servo parameters. This gets called every time prior
+// to the transport controller entering shuttle mode.
+//*****************************************************************************
+
+static void ResetShuttleServo(void)
+{
+    g_servo.shuttle_pgain = g_sys.shuttle_servo_pgain;
+    g_servo.shuttle_igain = g_sys.shuttle_servo_igain;
+    g_servo.shuttle_dgain = g_sys.shuttle_servo_dgain;
+
+    PID_INIT(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle,
+             g_sys.shuttle_servo_pgain,     // P-gain
+             g_sys.shuttle_servo_igain,     // I-gain
+             g_sys.shuttle_servo_dgain,     // D-gain
+             PID_CV_MAX_F,
+             PID_CV_MIN_F,
+             PID_TOLERANCE_F);              // PID deadband
+}
+
+//*****************************************************************************
+// Shuttle PID gain schedule. The gains are interpolated from the SYSPARMS
+// table, bilinear in the supply/takeup reeling radius ratio and the reel
+// velocity, and handed to the running PID every tick. Outside the table
+// the nearest breakpoint is used. The radius ratio is taken as one (half
+// pack) until the radius has been measured.
+//*****************************************************************************
+
+static size_t SchedIndex(const float* bp, size_t n, float x, float* frac)
+{
+    size_t i;
+    float span;
+
+    for (i=0; i < (n - 2); i++)
+    {
+        if (x < bp[i + 1])
+            break;
+    }
+
+    span = bp[i + 1] - bp[i];
+
+    if ((x <= bp[i]) || (span <= 0.0f))
+        *frac = 0.0f;
+    else if (x >= bp[i + 1])
+        *frac = 1.0f;
+    else
+        *frac = (x - bp[i]) / span;
+
+    return i;
+}
+
+static float SchedLookup(float tab[][SCHED_NUM_VELS], size_t i, float fi, size_t j, float fj)
+{
+    float lo = tab[i][j] + ((tab[i + 1][j] - tab[i][j]) * fi);
+    float hi = tab[i][j + 1] + ((tab[i + 1][j + 1] - tab[i][j + 1]) * fi);
+
+    return lo + ((hi - lo) * fj);
+}
+
+static void ShuttleGainSchedule(void)
+{
+    size_t i, j;
+    float fi, fj;
+    float ratio = 1.0f;
+
+    if (!(g_sys.sysflags & SF_GAIN_SCHEDULE))
+        return;
+
+    if ((g_servo.radius_supply > 0.0f) && (g_servo.radius_takeup > 0.0f))
+        ratio = g_servo.radius_supply / g_servo.radius_takeup;
+
+    i = SchedIndex(g_sys.sched_ratio, SCHED_NUM_RATIOS, ratio, &fi);
+    j = SchedIndex(g_sys.sched_velocity, SCHED_NUM_VELS, g_servo.velocity, &fj);
+
+    g_servo.shuttle_pgain = SchedLookup(g_sys.sched_pgain, i, fi, j, fj);
+    g_servo.shuttle_igain = SchedLookup(g_sys.sched_igain, i, fi, j, fj);
+    g_servo.shuttle_dgain = SchedLookup(g_sys.sched_dgain, i, fi, j, fj);
+
+    PID_GAINS(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle,
+              g_servo.shuttle_pgain,
+              g_servo.shuttle_igain,
+              g_servo.shuttle_dgain);
+}
+
+//*****************************************************************************
+// Accumulate the servo tick period (time between successive loop releases)
+// and loop execution time statistics. Each histogram bin counts the ticks
+// that fell in its range, the last bin also counts anything beyond it.
+//*****************************************************************************
 
-    /* Initialize the QEI interface and interrupts */
-    ReelQEI_initialize();
+static uint32_t HistogramBin(uint32_t usec, uint32_t base, uint32_t width)
+{
+    uint32_t bin = (usec > base) ? ((usec - base) / width) : 0;
 
-    /* Initialize tape roller tach timers and interrupt */
-    TapeTach_initialize();
+    return (bin < SERVO_HIST_BINS) ? bin : (SERVO_HIST_BINS - 1);
+}
 
-    /*** ENTER SERVO LOOP FOREVER ***/
+static void ServoTimingUpdate(uint32_t start, uint32_t end)
+{
+    uint32_t exec;
+    uint32_t period;
 
-    while (1)
+    if (s_timing_reset)
     {
-        /* Toggle I/O pin for debug timing measurement*/
-        GPIO_write(DTC1200_EXPANSION_PF3, PIN_HIGH);
+        memset(&s_timing, 0, sizeof(SERVOTIMING));
 
-        /***********************************************************
-         * GET THE SUPPLY AND TAKEUP REEL VELOCITY AND DIRECTION
-         ***********************************************************/
+        s_timing.period_min = s_timing.exec_min = UNDEFINED;
+        s_tick_prev = start;
+        s_timing_reset = false;
+        return;
+    }
 
-        /* Read the tape roller tachometer count */
-        g_servo.tape_tach = TapeTach_read();
+    period = (start - s_tick_prev) / s_cycles_per_usec;
+    exec   = (end - start) / s_cycles_per_usec;
 
-        uint32_t supply = QEIVelocityGet(QEI_BASE_SUPPLY);
-        uint32_t takeup = QEIVelocityGet(QEI_BASE_TAKEUP);
-#if 0
-        if (!(g_dip_switch & M_DIPSW3))
-        {
-            supply = supply << 1;
-            takeup = takeup << 1;
-        }
-#endif
-        /* Read the takeup and supply reel motor velocity values */
-        g_servo.velocity_supply = (float)supply;
-        g_servo.velocity_takeup = (float)takeup;
+    s_tick_prev = start;
 
-        /* Sum the two for current total reel velocity */
-        g_servo.velocity = (g_servo.velocity_supply + g_servo.velocity_takeup);
+    if (period < s_timing.period_min)
+        s_timing.period_min = period;
+    if (period > s_timing.period_max)
+        s_timing.period_max = period;
 
-        /* Set the motion active status flag */
-        g_servo.motion = (g_servo.velocity > g_sys.vel_detect_threshold) ? 1 : 0;
+    if (exec < s_timing.exec_min)
+        s_timing.exec_min = exec;
+    if (exec > s_timing.exec_max)
+        s_timing.exec_max = exec;
 
-        /* Read the current direction and make sure both reels are
-         * moving and moving in the same direction before changing
-         * state to avoid jitter at near stopped conditions.
-         */
-        int32_t sdir = QEIDirectionGet(QEI_BASE_SUPPLY);
-        int32_t tdir = QEIDirectionGet(QEI_BASE_TAKEUP);
+    /* A late release means a servo tick was missed or delayed */
+    if (period > (SERVO_PERIOD_USEC + (SERVO_PERIOD_USEC / 2)))
+        ++s_timing.overruns;
 
-        if ((sdir == tdir) && g_servo.motion)
-            g_servo.direction = sdir;
-        else
-        	g_servo.direction = 0;
+    ++s_timing.period_hist[HistogramBin(period, SERVO_HIST_PERIOD_BASE, SERVO_HIST_PERIOD_WIDTH)];
+    ++s_timing.exec_hist[HistogramBin(exec, 0, SERVO_HIST_EXEC_WIDTH)];
 
-        /* Read all ADC values which includes the tape tension sensor
-         * Step[0] ADC2 - Tension Sensor Arm
-         * Step[1] ADC0 - Supply Motor Current Option
-         * Step[2] ADC1 - Takeup Motor Current Option
-         * Step[3] ADC3 - Expansion Port ADC input option
-         * Step[4] Internal CPU temperature sensor
-         */
-        Board_readADC(g_servo.adc);
+    ++s_timing.ticks;
+}
 
-        /* Accumulate the CPU temperature */
+//*****************************************************************************
+// Accumulate the cycle counts spent in each stage of the servo tick. The
+// motor DAC write is timed separately inside the mode handler and taken
+// out of the dispatch stage. The stage counts of the tick with the largest
+// total are kept as the worst case trace.
+//*****************************************************************************
 
-        g_servo.cpu_temp_accum += (float)g_servo.adc[4];
+static void ServoProfileUpdate(uint32_t* cycles)
+{
+    size_t i;
+    uint32_t count[SERVO_NUM_STAGES];
 
-        ++g_servo.cpu_temp_cnt;
+    if (s_profile_reset)
+    {
+        memset(&s_profile, 0, sizeof(SERVOPROFILE));
+        memset(s_profile_sum, 0, sizeof(s_profile_sum));
 
-        if (g_servo.cpu_temp_cnt >= TEMP_AVG_COUNT)
-        {
-            /* divide accumulator and store avg temp value */
-            g_servo.cpu_temp = g_servo.cpu_temp_accum * (1.0f/(float)TEMP_AVG_COUNT);
+        for (i=0; i < SERVO_NUM_STAGES; i++)
+            s_profile.stage[i].min = UNDEFINED;
 
-            /* reset accumulator and count */
-            g_servo.cpu_temp_accum = 0.0f;
-            g_servo.cpu_temp_cnt = 0;
-        }
+        s_profile.cpu_freq = s_cpu_freq;
+        s_worst_total = 0;
+        s_profile_reset = false;
+    }
 
-        /* Calculate signed tension sensor value from 12-bit ADC reading. Since
-         * the ADC is 12-bit, we use 2047 as mids-cale. We allow the offset to be
-         * adjusted in software so the tension sensor can be offset for 1" tape.
-         * Mid-scale of the ADC should equate to tension sensor reading with tape
-         * under proper tension with mid pack on both reels.
-         */
+    count[SERVO_STAGE_TACH]     = cycles[1] - cycles[0];
+    count[SERVO_STAGE_QEI]      = cycles[2] - cycles[1];
+    count[SERVO_STAGE_ADC]      = cycles[3] - cycles[2];
+    count[SERVO_STAGE_RADIUS]   = cycles[4] - cycles[3];
+    count[SERVO_STAGE_DISPATCH] = (cycles[5] - cycles[4]) - s_dac_cycles;
+    count[SERVO_STAGE_DAC]      = s_dac_cycles;
+    count[SERVO_STAGE_TOTAL]    = cycles[5] - cycles[0];
 
-        float midscale;
+    for (i=0; i < SERVO_NUM_STAGES; i++)
+    {
+        if (count[i] < s_profile.stage[i].min)
+            s_profile.stage[i].min = count[i];
+        if (count[i] > s_profile.stage[i].max)
+            s_profile.stage[i].max = count[i];
 
-        if (g_tape_width)
-            midscale = g_sys.tension_sensor_midscale2;   /* ADC mid-scale for 2" tape */
-        else
-            midscale = g_sys.tension_sensor_midscale1;   /* ADC mid-scale for 1" tape */
+        s_profile_sum[i] += count[i];
+    }
 
-        /* Calculate the tension sensor position from mid-scale */
-        g_servo.tsense = ((midscale - (float)g_servo.adc[0])) * g_sys.tension_sensor_gain;
+    if (count[SERVO_STAGE_TOTAL] > s_worst_total)
+    {
+        s_worst_total = count[SERVO_STAGE_TOTAL];
+        s_profile.worst_tick = s_profile.ticks;
+        s_profile.worst_mode = g_servo.mode;
+        memcpy(s_profile.worst, count, sizeof(s_profile.worst));
+    }
 
-        /***********************************************************
-         * BEGIN REELING RADIUS CALCULATIONS
-         ***********************************************************/
+    ++s_profile.ticks;
+}
 
-        /* Calculate the servo null offset value. The servo null offset
-         * is the difference in velocity of the takeup and supply reel.
-         * The reel with more pack turns more slowly due to larger radius and
-         * visa versa. We calculate the offset as the velocity ratio of the
-         * takeup and supply reel velocity by simply dividing the two reel
-         * velocity tach values.
-         */
+//*****************************************************************************
+// Motor DAC write from the mode handlers, timed for the stage profile.
+//*****************************************************************************
 
-        float delta = 0.0f;
+static void ServoDACWrite(float supply, float takeup)
+{
+    uint32_t start;
 
-        float veldetect = (g_high_speed_flag) ? 40.0f : 20.0f;
+    /* HALT drives the DAC directly, the diagnostics ramp it open loop */
+    if ((g_servo.mode & MODE_MASK) == MODE_HALT)
+    {
+        CurrentLoopReset(&g_servo.current_supply);
+        CurrentLoopReset(&g_servo.current_takeup);
 
-        if ((g_servo.velocity_takeup > veldetect) && (g_servo.velocity_supply > veldetect))
-        {
-            /* Calculate the current reeling radius as tape speed divided by
-             * the reel speed. Takeup and supply velocity must not be zero!
-             */
+        g_servo.dac_residue_supply = 0.0f;
+        g_servo.dac_residue_takeup = 0.0f;
+    }
+    else
+    {
+        supply = CurrentLoop(&g_servo.current_supply, supply);
+        takeup = CurrentLoop(&g_servo.current_takeup, takeup);
 
-            float radius_takeup = RADIUS_F(g_servo.tape_tach, g_servo.velocity_takeup);
-            float radius_supply = RADIUS_F(g_servo.tape_tach, g_servo.velocity_supply);
+        supply = DACShape(g_sys.dac_cal_supply, &g_servo.dac_residue_supply, supply);
+        takeup = DACShape(g_sys.dac_cal_takeup, &g_servo.dac_residue_takeup, takeup);
+    }
 
-            /* Calculate the delta factor between the two reel motor tach's */
-            if (g_servo.velocity_takeup > g_servo.velocity_supply)
-            {
-                delta = ((g_servo.velocity_takeup * OFFSET_SCALE_F) / g_servo.velocity_supply) - OFFSET_SCALE_F;
-            }
-            else if (g_servo.velocity_supply > g_servo.velocity_takeup)
-            {
-                delta = ((g_servo.velocity_supply * OFFSET_SCALE_F) / g_servo.velocity_takeup) - OFFSET_SCALE_F;
-            }
-            else
-            {
-                delta = 0.0f;
-            }
+    start = CPU_CYCLES();
 
-            if (delta > 1000.0f)
-                delta = 1000.0f;
+    MotorDAC_write(supply, takeup);
 
-            /* Accumulate the delta for averaging over 1 second */
-            g_servo.offset_null_accum += delta;
+    s_dac_cycles += CPU_CYCLES() - start;
+}
 
-            g_servo.radius_takeup_accum += radius_takeup;
-            g_servo.radius_supply_accum += radius_supply;
+/*****************************************************************************
+ * Inner torque loop on the measured motor current. The servo modes command
+ * reel torque in DAC counts, but the motor amp doesn't deliver exactly that
+ * current: its gain and offset vary, and at high shuttle speed the back-EMF
+ * eats into its headroom. The current sensed over the last tick is compared
+ * with the torque commanded for it, and a PI correction is added to the DAC
+ * so the delivered current tracks the command. The integrator is held while
+ * the DAC is clamped, so it doesn't wind up when the amp is out of headroom.
+ *
+ * With a current limit set, any current over it cuts the torque back, and
+ * the cutback is released slowly once the current is back under the limit.
+ * The limit works whether or not the loop is closed with SF_CURRENT_LOOP.
+ *****************************************************************************/
 
-            ++g_servo.offset_sample_cnt;
+static void CurrentLoopReset(CURRENTLOOP* cl)
+{
+    cl->reference = 0.0f;
+    cl->iState    = 0.0f;
+    cl->cutback   = 0.0f;
+}
 
-            if (g_servo.offset_sample_cnt >= OFFSET_CALC_PERIOD)
-            {
-                /* Calculate the averaged offset */
-                float offset = g_servo.offset_null_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
+static float CurrentLoop(CURRENTLOOP* cl, float torque)
+{
+    float error = cl->reference - cl->current;
+    float dac;
 
-                /* Calculate the averaged null offset value */
-                g_servo.offset_null = offset * g_sys.reel_offset_gain;
+    /* Overcurrent cutback */
+    if (g_sys.current_limit > 0)
+    {
+        float over = cl->current - (float)g_sys.current_limit;
 
-                /* Reset the accumulator */
-                g_servo.offset_null_accum = 0.0f;
+        if (over > 0.0f)
+        {
+            cl->cutback += over * CURRENT_CUT_GAIN;
+            ++cl->overcurrent;
+        }
+        else
+        {
+            cl->cutback -= CURRENT_CUT_RECOVER;
+        }
 
-                /* Calculate the averaged reeling radius */
-                radius_takeup = g_servo.radius_takeup_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
-                radius_supply = g_servo.radius_supply_accum * (1.0f / (float)OFFSET_CALC_PERIOD);
+        DAC_CLAMP(cl->cutback, 0.0f, DAC_MAX_F);
 
-                g_servo.radius_takeup = radius_takeup * g_sys.reel_radius_gain;
-                g_servo.radius_supply = radius_supply * g_sys.reel_radius_gain;
+        torque -= cl->cutback;
 
-                /* Reset the accumulators */
-                g_servo.radius_takeup_accum = g_servo.radius_supply_accum = 0.0f;
+        if (torque < 0.0f)
+            torque = 0.0f;
+    }
+    else
+    {
+        cl->cutback = 0.0f;
+    }
 
-                /* Reset the sample counter */
-                g_servo.offset_sample_cnt = 0;
-            }
+    dac = torque;
 
-            /* Now store the calculated offset for each reel motor that is added
-             * or subtracted to compensate the torque applied for the current
-             * reel radius offset. These values are used to adjust the torque on
-             * each reel based on the reel velocity to compensate for the constantly
-             * changing reel hub radius.
-             */
+    if (g_sys.sysflags & SF_CURRENT_LOOP)
+    {
+        dac += cl->iState + (g_sys.current_pgain * error);
 
-            if (g_sys.reel_offset_gain <= 0.0f)
-            {
-                /* for debugging & aligning system */
-                g_servo.offset_supply = 0.0f;
-                g_servo.offset_takeup = 0.0f;
-            }
-            else
-            {
-                if (g_servo.velocity_takeup > g_servo.velocity_supply)
-                {
-                    /* TAKEUP reel is turning faster than the SUPPLY reel!
-                     * ADD to the TAKEUP reel torque.
-                     * SUBTRACT from the SUPPLLY reel torque.
-                     */
-                    g_servo.offset_supply =  (g_servo.offset_null);
-                    g_servo.offset_takeup = -(g_servo.offset_null);
-                }
-                else if (g_servo.velocity_supply > g_servo.velocity_takeup)
-                {
-                    /* SUPPLY reel is turning faster than the TAKE-UP reel!
-                     * ADD to the SUPPLY reel torque.
-                     * SUBTRACT from the TAKEUP reel torque.
-                     */
-                    g_servo.offset_supply = -(g_servo.offset_null);
-                    g_servo.offset_takeup =  (g_servo.offset_null);
-                }
-                else
-                {
-                    g_servo.offset_supply = 0.0f;
-                    g_servo.offset_takeup = 0.0f;
-                }
-            }
+        /* Only integrate away from a clamped DAC */
+        if (!((dac >= DAC_MAX_F) && (error > 0.0f)) && !((dac <= 0.0f) && (error < 0.0f)))
+        {
+            cl->iState += g_sys.current_igain * error;
+
+            DAC_CLAMP(cl->iState, -CURRENT_INT_MAX, CURRENT_INT_MAX);
         }
 
-        /**********************************************
-         * DISPATCH TO THE CURRENT SERVO MODE HANDLER
-         **********************************************/
+        DAC_CLAMP(dac, 0.0f, DAC_MAX_F);
+    }
+    else
+    {
+        cl->iState = 0.0f;
+    }
+
+    cl->reference = torque;
+
+    return dac;
+}
 
-        (*jmptab[Servo_GetMode()])();
+/*****************************************************************************
+ * Torque to motor DAC code. With SF_DAC_LINEARIZE the torque is looked up
+ * in the reel calibration table built by the DAC ramp diagnostic. The DAC
+ * only has 10 bits, so low stop and play tensions move in coarse steps, and
+ * the driver truncates the fraction. With SF_DAC_DITHER the code is rounded
+ * and the rounding error is carried into the next tick (first order error
+ * feedback), so the mean torque over a few ticks has the fraction too. The
+ * dither is at up to half the servo rate, well above what the reels follow.
+ *****************************************************************************/
+
+static float DACShape(const float* table, float* residue, float torque)
+{
+    float level = torque;
+    float code;
 
-        /* Toggle I/O pin for debug timing measurement*/
-        GPIO_write(DTC1200_EXPANSION_PF3, PIN_LOW);
+    if (g_sys.sysflags & SF_DAC_LINEARIZE)
+        level = MotorDAC_linearize(table, torque);
 
-        /* 500 Hz (2ms) sample rate */
-        Task_sleep(2);
+    if (!(g_sys.sysflags & SF_DAC_DITHER))
+    {
+        *residue = 0.0f;
+        return level;
     }
+
+    level += *residue;
+
+    code = floorf(level + 0.5f);
+
+    DAC_CLAMP(code, 0.0f, DAC_MAX_F);
+
+    /* Error pinned at a rail isn't carried, it can't be paid back */
+    *residue = level - code;
+
+    DAC_CLAMP(*residue, -0.5f, 0.5f);
+
+    return code;
 }
 
 //*****************************************************************************
@@ -450,8 +2121,8 @@ Void ServoLoopTask(UArg a0, UArg a1)
 
 static void Service_HaltMode(void)
 {
-    MotorDAC_write((float)g_servo.dac_halt_supply,
-                   (float)g_servo.dac_halt_takeup);
+    ServoDACWrite((float)g_servo.dac_halt_supply,
+                  (float)g_servo.dac_halt_takeup);
 }
 
 //*****************************************************************************
@@ -461,8 +2132,8 @@ static void Service_HaltMode(void)
 
 static void Service_ThreadMode(void)
 {
-    MotorDAC_write((float)g_sys.thread_supply_tension,
-                   (float)g_sys.thread_takeup_tension);
+    ServoDACWrite((float)g_sys.thread_supply_tension,
+                  (float)g_sys.thread_takeup_tension);
 }
 
 //*****************************************************************************
@@ -477,6 +2148,9 @@ static void Service_PlayMode(void)
     float dac_t;
     float target_velocity;
     float cv = 0.0f;
+    float ff_s = 0.0f;
+    float ff_t = 0.0f;
+    bool ff;
 
     /* Calculate the "reeling radius" for each reel */
     //float rad_t = g_servo.radius_takeup;
@@ -484,8 +2158,6 @@ static void Service_PlayMode(void)
 
     /* Play acceleration boost state? */
 
-    Semaphore_pend(g_semaServo, BIOS_WAIT_FOREVER);
-
     if (g_servo.play_boost_count)
     {
         --g_servo.play_boost_count;
@@ -493,26 +2165,42 @@ static void Service_PlayMode(void)
         /* Boost status LED on */
         g_lamp_mask |= L_STAT3;
 
+        /* Reel torque to follow the capstan, PI trims to the reference */
+        ff = PlayBoostFeedforward(&ff_s, &ff_t);
+
         /* Get the PID current CV value based on the velocity */
 
-        target_velocity = (float)g_servo.play_boost_end;
+        if (ff)
+            target_velocity = g_servo.play_ref_velocity;
+        else
+            target_velocity = (float)g_servo.play_boost_end;
 
-        cv = fpid_calc(
+        cv = PID_CALC(PID_PLAY_ENGINE,
                 &g_servo.pid_play,      /* play boost PID accumulator      */
         		target_velocity,        /* desired velocity for play speed */
 				g_servo.tape_tach);     /* current tape roller velocity    */
 
         /* DECREASE SUPPLY Motor Torque */
-        dac_s = (((float)g_servo.play_supply_tension + g_servo.tsense)) + g_servo.offset_supply;
+        dac_s = (((float)g_servo.play_supply_tension + g_servo.tsense) - ff_s) + g_servo.offset_supply;
 
         /* INCREASE TAKEUP Motor Torque */
-        dac_t = ((float)g_servo.play_takeup_tension + cv) + g_servo.offset_takeup;
+        dac_t = ((float)g_servo.play_takeup_tension + ff_t + cv) + g_servo.offset_takeup;
+
+        /* Let the PID know if the takeup DAC limited the boost torque */
+        if (dac_t > DAC_MAX_F)
+            PID_TRACK(PID_PLAY_ENGINE, &g_servo.pid_play, cv - (dac_t - DAC_MAX_F));
 
         if (!g_servo.play_boost_count)
         	g_lamp_mask &= ~(L_STAT3);
 
-        /* Has tape roller tach reached the correct speed yet? */
-        if (cv <= 0.0f)
+        g_servo.play_boost_ff = ff_t;
+
+        /* Has tape roller tach reached the correct speed yet? With the
+         * feedforward the PI only trims, so wait for the reference to
+         * finish its ramp and the tach to reach play speed instead.
+         */
+        if (ff ? ((target_velocity >= ((float)g_servo.play_boost_end - 1.0f)) &&
+                  (g_servo.tape_tach >= (float)g_servo.play_boost_end)) : (cv <= 0.0f))
         {
             /* End play boost mode */
             g_servo.play_boost_count = 0;
@@ -522,7 +2210,7 @@ static void Service_PlayMode(void)
 
         // DEBUG
         g_servo.db_cv    = cv;
-        g_servo.db_error = g_servo.pid_play.error;
+        g_servo.db_error = PID_ERROR(PID_PLAY_ENGINE, &g_servo.pid_play);
         g_servo.db_debug = target_velocity;
     }
     else
@@ -534,8 +2222,6 @@ static void Service_PlayMode(void)
         dac_t = (g_servo.play_takeup_tension + g_servo.tsense) + g_servo.offset_takeup;
     }
 
-    Semaphore_post(g_semaServo);
-
     /* Clamp the DAC values within range if needed */
 
     DAC_CLAMP(dac_s, 0.0f, DAC_MAX_F);
@@ -543,7 +2229,7 @@ static void Service_PlayMode(void)
 
     /* Set the servo DAC levels */
 
-    MotorDAC_write(dac_s, dac_t);
+    ServoDACWrite(dac_s, dac_t);
 }
 
 //*****************************************************************************
@@ -559,11 +2245,11 @@ static void Service_StopMode(void)
     float dac_s;
     float dac_t;
     float braketorque = 0.0f;
+    float brake_s;
+    float brake_t;
 
     /*** Calculate the dynamic braking torque from velocity ***/
 
-	Semaphore_pend(g_semaTransportMode, BIOS_WAIT_FOREVER);
-
 	/* Is dynamic braking enabled for STOP servo mode? */
 	if (g_servo.stop_brake_state)
 	{
@@ -572,9 +2258,15 @@ static void Service_StopMode(void)
 	    {
 	    	/* Disable dynamic brake state */
 	        g_servo.stop_brake_state = 0;
+
+	        /* Report the time to stop for this event */
+	        g_servo.stop_time = g_servo.stop_brake_ticks * 2;
+	        ++g_servo.stop_count;
 	    }
 	    else
 	    {
+	        ++g_servo.stop_brake_ticks;
+
     		/* Calculate dynamic braking torque from current velocity */
 	    	if (g_servo.stop_brake_state > 1)
 	    		braketorque = (g_servo.velocity * 5.0f);
@@ -590,11 +2282,15 @@ static void Service_StopMode(void)
 	    }
 	}
 
-	Semaphore_post(g_semaTransportMode);
+    brake_s = brake_t = braketorque;
+
+    /* Use the reel inertia model in place of the fixed brake if we can */
+    if (g_servo.stop_brake_state == 1)
+        StopBrakeModel(&brake_s, &brake_t);
 
 	/* Save brake torque for debug purposes */
-    g_servo.stop_torque_takeup = braketorque;
-    g_servo.stop_torque_supply = braketorque;
+    g_servo.stop_torque_takeup = brake_t;
+    g_servo.stop_torque_supply = brake_s;
 
 	/*
 	 * DYNAMIC BRAKING: Apply the braking torque required to null motion.
@@ -603,18 +2299,18 @@ static void Service_StopMode(void)
     if (g_servo.direction == TAPE_DIR_FWD)
     {
         /* FORWARD DIR MOTION - increase supply torque */
-        dac_s = ((((float)g_sys.stop_supply_tension + g_servo.tsense) + braketorque) + g_servo.offset_supply);
+        dac_s = ((((float)g_sys.stop_supply_tension + g_servo.tsense) + brake_s) + g_servo.offset_supply);
 
         /* decrease takeup torque */
-        dac_t = ((((float)g_sys.stop_takeup_tension + g_servo.tsense) - braketorque) + g_servo.offset_takeup);
+        dac_t = ((((float)g_sys.stop_takeup_tension + g_servo.tsense) - brake_t) + g_servo.offset_takeup);
     }
     else if (g_servo.direction == TAPE_DIR_REW)
     {
         /* REWIND DIR MOTION - decrease supply torque */
-        dac_s = ((((float)g_sys.stop_supply_tension + g_servo.tsense) - braketorque) + g_servo.offset_supply);
+        dac_s = ((((float)g_sys.stop_supply_tension + g_servo.tsense) - brake_s) + g_servo.offset_supply);
 
         /* increase takeup torque */
-        dac_t = ((((float)g_sys.stop_takeup_tension + g_servo.tsense) + braketorque) + g_servo.offset_takeup);
+        dac_t = ((((float)g_sys.stop_takeup_tension + g_servo.tsense) + brake_t) + g_servo.offset_takeup);
     }
     else
     {
@@ -630,7 +2326,7 @@ static void Service_StopMode(void)
 
     /* Set the DAC levels to the servos */
 
-    MotorDAC_write(dac_s, dac_t);
+    ServoDACWrite(dac_s, dac_t);
 }
 
 //*****************************************************************************
@@ -643,21 +2339,33 @@ static void Service_FwdMode(void)
 {
     float dac_s;
     float dac_t;
+    bool relay;
 
     static float cv = 0.0f;
 
-    /* Get the PID current CV value based on the velocity */
+    /* Get the PID current CV value based on the profiled velocity */
 
-    Semaphore_pend(g_semaServo, BIOS_WAIT_FOREVER);
+    float target_velocity = ShuttleProfileUpdate();
+
+    /* Play boost autotune runs the play loop in place of the shuttle */
+    if (Autotune_Loop() == TUNE_LOOP_PLAY)
+    {
+        Service_PlayTune();
+        return;
+    }
 
-    float target_velocity = (float)g_servo.shuttle_velocity;
+    /* Scheduled gains for the current reel packs and velocity */
+    ShuttleGainSchedule();
 
-    cv = fpid_calc(
+    cv = PID_CALC(PID_SHUTTLE_ENGINE,
         &g_servo.pid_shuttle,	/* PID accumulator  */
         target_velocity,		/* desired velocity */
         g_servo.velocity   		/* current velocity */
         );
 
+    /* A relay autotune replaces the CV while identifying the loop */
+    relay = Autotune_Service(TUNE_LOOP_SHUTTLE, g_servo.velocity, &cv);
+
     /* If shuttle direction changed and we were over speed,
      * then don't allow CV to be negative as this would
      * cause speed to *increase* when direction changed!
@@ -671,8 +2379,6 @@ static void Service_FwdMode(void)
             cv = fabs(cv);
     }
 
-    Semaphore_post(g_semaServo);
-
     /* Back tension compensates for decreasing motor torque as the motors
      * gain velocity and free wheel. Initially the motor current is high
      * as torque is first applied, but the current drops as the motor
@@ -686,7 +2392,7 @@ static void Service_FwdMode(void)
 
     // DEBUG
     g_servo.db_cv    = cv;
-    g_servo.db_error = g_servo.pid_shuttle.error;
+    g_servo.db_error = PID_ERROR(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle);
     g_servo.db_debug = target_velocity;
     g_servo.holdback = holdback;
 
@@ -696,12 +2402,62 @@ static void Service_FwdMode(void)
     /* INCREASE TAKEUP Motor Torque */
     dac_t = (((float)g_sys.shuttle_takeup_tension + g_servo.tsense) + cv) + g_servo.offset_takeup;
 
+    /* Let the PID know if the takeup DAC limited the drive torque */
+    if ((dac_t > DAC_MAX_F) && !relay)
+        PID_TRACK(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle, cv - (dac_t - DAC_MAX_F));
+
+    /* Safety Clamp */
+    DAC_CLAMP(dac_s, 0.0f, DAC_MAX_F);
+    DAC_CLAMP(dac_t, 0.0f, DAC_MAX_F);
+
+    /* Set the servo DAC levels */
+    ServoDACWrite(dac_s, dac_t);
+}
+
+//*****************************************************************************
+// PLAY BOOST AUTOTUNE - Runs in FWD mode in place of the shuttle servo
+// while the play boost loop is identified. The play boost PI holds the tape
+// roller tach at the boost end velocity. The capstan is not engaged, so
+// the reels are driven with the shuttle torque split to brake as well as
+// drive the tape and the relay sees the reel and tape dynamics alone.
+//*****************************************************************************
+
+static void Service_PlayTune(void)
+{
+    float dac_s;
+    float dac_t;
+    float cv;
+    float tach;
+
+    /* The tach has no direction, so sign it from the reels in case the
+     * braking torque pulls the tape back toward the supply reel.
+     */
+    tach = (g_servo.direction == TAPE_DIR_REW) ? -g_servo.tape_tach : g_servo.tape_tach;
+
+    cv = PID_CALC(PID_PLAY_ENGINE,
+            &g_servo.pid_play,                  /* play boost PID accumulator */
+            (float)g_servo.play_boost_end,      /* play boost end velocity    */
+            tach);                              /* current tape roller tach   */
+
+    Autotune_Service(TUNE_LOOP_PLAY, tach, &cv);
+
+    // DEBUG
+    g_servo.db_cv    = cv;
+    g_servo.db_error = PID_ERROR(PID_PLAY_ENGINE, &g_servo.pid_play);
+    g_servo.db_debug = (float)g_servo.play_boost_end;
+
+    /* DECREASE SUPPLY Motor Torque */
+    dac_s = (((float)g_sys.shuttle_supply_tension + g_servo.tsense) - (cv * 0.5f)) + g_servo.offset_supply;
+
+    /* INCREASE TAKEUP Motor Torque */
+    dac_t = (((float)g_sys.shuttle_takeup_tension + g_servo.tsense) + cv) + g_servo.offset_takeup;
+
     /* Safety Clamp */
     DAC_CLAMP(dac_s, 0.0f, DAC_MAX_F);
     DAC_CLAMP(dac_t, 0.0f, DAC_MAX_F);
 
     /* Set the servo DAC levels */
-    MotorDAC_write(dac_s, dac_t);
+    ServoDACWrite(dac_s, dac_t);
 }
 
 //*****************************************************************************
@@ -717,13 +2473,14 @@ static void Service_RewMode(void)
 
     static float cv = 0.0f;
 
-    /* Get the PID current CV value based on the velocity */
+    /* Get the PID current CV value based on the profiled velocity */
 
-    Semaphore_pend(g_semaServo, BIOS_WAIT_FOREVER);
+    float target_velocity = ShuttleProfileUpdate();
 
-    float target_velocity = (float)g_servo.shuttle_velocity;
+    /* Scheduled gains for the current reel packs and velocity */
+    ShuttleGainSchedule();
 
-    cv = fpid_calc(
+    cv = PID_CALC(PID_SHUTTLE_ENGINE,
         &g_servo.pid_shuttle,   /* PID accumulator  */
         target_velocity,		/* desired velocity */
         g_servo.velocity   		/* current velocity */
@@ -742,8 +2499,6 @@ static void Service_RewMode(void)
             cv = fabs(cv);
     }
 
-    Semaphore_post(g_semaServo);
-
     /* Back tension compensates for decreasing motor torque as the motors
      * gains velocity and free wheels. Initially the motor current is high
      * as torque is first applied, but the current/torque drops as the motor
@@ -761,7 +2516,7 @@ static void Service_RewMode(void)
 
     // DEBUG
     g_servo.db_cv    = cv;
-    g_servo.db_error = g_servo.pid_shuttle.error;
+    g_servo.db_error = PID_ERROR(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle);
     g_servo.db_debug = target_velocity;
     g_servo.holdback = holdback;
 
@@ -771,12 +2526,16 @@ static void Service_RewMode(void)
     /* DECREASE TAKEUP Motor Torque */
     dac_t = (((float)g_sys.shuttle_takeup_tension + g_servo.tsense + holdback) - (cv * 0.5f)) + g_servo.offset_takeup;
 
+    /* Let the PID know if the supply DAC limited the drive torque */
+    if (dac_s > DAC_MAX_F)
+        PID_TRACK(PID_SHUTTLE_ENGINE, &g_servo.pid_shuttle, cv - (dac_s - DAC_MAX_F));
+
     /* Safety clamp */
     DAC_CLAMP(dac_s, 0.0f, DAC_MAX_F);
     DAC_CLAMP(dac_t, 0.0f, DAC_MAX_F);
 
     /* Set the servo DAC levels */
-    MotorDAC_write(dac_s, dac_t);
+    ServoDACWrite(dac_s, dac_t);
 }
 
 /* End-Of-File */
@@ -61,6 +61,11 @@
 
 #define MODE_MASK			0x07
 
+/* Servo loop tick rate */
+
+#define SERVO_TICK_PERIOD   2               /* clock ticks per servo tick   */
+#define SERVO_PERIOD_USEC   2000            /* 500 Hz servo loop period     */
+
 /* General Purpose Defines and Macros */
 
 #define TAPE_DIR_FWD		(-1)			/* play, fwd direction */
@@ -76,6 +81,19 @@ uint32_t Servo_GetMode(void);
 int32_t Servo_IsMode(uint32_t mode);
 int32_t Servo_IsMotion(void);
 
+void Servo_ResetPlay(void);
+void Servo_ResetShuttle(void);
+
+void Servo_Locate(int32_t target);
+void Servo_CancelLocate(void);
+uint32_t Servo_GetLocateState(void);
+
+void Servo_GetTiming(SERVOTIMING* timing);
+void Servo_ResetTiming(void);
+
+void Servo_GetProfile(SERVOPROFILE* profile);
+void Servo_ResetProfile(void);
+
 Void ServoLoopTask(UArg a0, UArg a1);
 
 /*** Inline Prototypes *****************************************************/
@@ -47,21 +47,74 @@
 
 #define TACH_AVG_QTY			100
 
+/* Tape position is counted in tach roller edges from the point the counter
+ * was last zeroed, positive in the forward direction. The timer roller
+ * gives approximately 8 edges per inch (240 Hz with tape moving at 30 IPS).
+ */
+#define TACH_EDGES_PER_INCH     8
+
+//*****************************************************************************
+//  Tach Filter Data
+//*****************************************************************************
+
+/* The tach interrupt measures the period of each edge, or group of edges,
+ * in 80MHz timer counts. The tach reading is half the edge rate, or 120
+ * with tape moving at 30 IPS.
+ */
+#define TACH_CLOCK_HZ           80000000.0f
+
+#define TACH_FILT_WINDOW        0       /* adaptive window average       */
+#define TACH_FILT_ALPHABETA     1       /* alpha-beta speed and accel    */
+
+#define TACH_FILT_SIZE          TACH_AVG_QTY /* longest window in edges  */
+#define TACH_FILT_STEP          0.02f   /* speed change that shrinks it  */
+#define TACH_FILT_SMOOTH        0.50f   /* change detect smoothing       */
+#define TACH_FILT_BW            30.0f   /* alpha-beta bandwidth (rad/sec)*/
+
+typedef struct _TACHFILT
+{
+    uint32_t type;                      /* filter output to read         */
+    uint32_t edges;                     /* tach edges per period         */
+    float    scale;                     /* tach units times period       */
+    uint32_t period[TACH_FILT_SIZE];    /* recent periods (counts)       */
+    size_t   index;                     /* ring index of the newest      */
+    size_t   window;                    /* periods in the window average */
+    size_t   window_max;                /* longest window in periods     */
+    uint64_t sum;                       /* sum of the window periods     */
+    float    change;                    /* smoothed change from average  */
+    float    average;                   /* window average tach           */
+    float    speed;                     /* alpha-beta tach at last period*/
+    float    accel;                     /* alpha-beta tach per second    */
+    uint32_t last;                      /* last period (counts)          */
+    bool     seeded;                    /* accel seeded from two periods */
+    bool     valid;
+} TACHFILT;
+
 //*****************************************************************************
 //  Wide Timer Tach Data
 //*****************************************************************************
 
+/* Edge capture times are queued by the interrupt handler and taken off by
+ * TapeTach_read() at the servo rate. The size must be a power of two and
+ * hold more than the edges in a servo period at top shuttle speed.
+ */
+#define TACH_RING_SIZE          64
+
 typedef struct _TACHDATA
 {
 	/* Interrupt edge data */
+    uint32_t stamp[TACH_RING_SIZE];     /* edge capture times            */
+    volatile uint32_t head;             /* edges queued by the ISR       */
+    volatile uint32_t timeouts;         /* edge timeouts and resets      */
+    /* Servo task edge data */
+    uint32_t tail;                      /* edges taken off the ring      */
+    uint32_t timeoutsSeen;
     uint32_t previousCount;
-    uint32_t averageCount[TACH_AVG_QTY];
-    uint32_t averageSum;
-    size_t   averageIdx;
+    bool     previousValid;
+    TACHFILT filter;
     /* Sampled data */
 	float	frequencyRawHz;
-    float	frequencyAvgHz;
-    bool	tachAlive;
+    volatile bool tachAlive;
 } TACHDATA;
 
 //*****************************************************************************
@@ -71,5 +124,13 @@ typedef struct _TACHDATA
 void TapeTach_initialize(void);
 float TapeTach_read(void);
 void TapeTach_reset(void);
+int32_t TapeTach_getPosition(void);
+void TapeTach_setPosition(int32_t position);
+float TapeTach_getAccel(void);
+
+void TachFilter_init(TACHFILT* tf, uint32_t edges);
+void TachFilter_reset(TACHFILT* tf);
+void TachFilter_update(TACHFILT* tf, uint32_t period);
+float TachFilter_read(TACHFILT* tf, uint32_t elapsed);
 
 #endif
@@ -0,0 +1,193 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Tape roller tach filter. The tach interrupt hands over the period of each
+ * edge, or group of edges, and the servo loop reads the filter every tick.
+ * Two outputs are kept side by side from the same periods:
+ *
+ * TACH_FILT_WINDOW averages the speed over the last TACH_FILT_SIZE edges at
+ * steady speed, as the edge width tach always did. The window drops back
+ * to a single period as soon as the speed moves away from the average by
+ * more than TACH_FILT_STEP, so it follows the tape while accelerating, and
+ * grows back one period at a time as the speed settles.
+ *
+ * TACH_FILT_ALPHABETA tracks the speed and acceleration. Each period gives
+ * the average speed over it, so it is compared against the tracked speed
+ * at the middle of the period. Between periods the speed is carried forward
+ * on the acceleration to the current tick.
+ *
+ * The acceleration is always available from the alpha-beta tracker. With
+ * no edge in longer than the last period the tape must be slowing, so both
+ * outputs are bounded to one period over the time since the last edge,
+ * rather than holding the last speed until the tach times out.
+ *
+ * ============================================================================ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "TapeTach.h"
+
+/*****************************************************************************
+ * Set up the filter for the tach edges counted in each period.
+ *****************************************************************************/
+
+void TachFilter_init(TACHFILT* tf, uint32_t edges)
+{
+    tf->type       = TACH_FILT_WINDOW;
+    tf->edges      = edges ? edges : 1;
+    tf->scale      = (TACH_CLOCK_HZ * 0.5f) * (float)tf->edges;
+    tf->window_max = TACH_FILT_SIZE / tf->edges;
+
+    if (tf->window_max < 1)
+        tf->window_max = 1;
+
+    TachFilter_reset(tf);
+}
+
+/*****************************************************************************
+ * Clear the filter history, the next period starts it over.
+ *****************************************************************************/
+
+void TachFilter_reset(TACHFILT* tf)
+{
+    tf->index   = 0;
+    tf->window  = 0;
+    tf->sum     = 0;
+    tf->change  = 0.0f;
+    tf->average = 0.0f;
+    tf->speed   = 0.0f;
+    tf->accel   = 0.0f;
+    tf->last    = 0;
+    tf->seeded  = false;
+    tf->valid   = false;
+}
+
+/*****************************************************************************
+ * Feed the period of the edge or edge group just completed, in timer counts.
+ *****************************************************************************/
+
+void TachFilter_update(TACHFILT* tf, uint32_t period)
+{
+    float raw;
+    float dt;
+    float residual;
+    float theta;
+    float alpha;
+    float beta;
+
+    if (!period)
+        return;
+
+    raw = tf->scale / (float)period;
+    dt  = (float)period / TACH_CLOCK_HZ;
+
+    if (!tf->valid)
+    {
+        tf->speed = raw;
+        tf->accel = 0.0f;
+        tf->valid = true;
+    }
+    else if (!tf->seeded)
+    {
+        /* Seed the acceleration from the first two periods */
+        tf->accel = (raw - tf->speed) / ((dt + ((float)tf->last / TACH_CLOCK_HZ)) * 0.5f);
+        tf->speed  = raw + (tf->accel * dt * 0.5f);
+        tf->seeded = true;
+    }
+    else
+    {
+        /* Critically damped gains for the tracker bandwidth over
+         * this period, so it responds the same in time whatever the
+         * tape speed and edges per period.
+         */
+        theta = expf(-TACH_FILT_BW * dt);
+        alpha = 1.0f - (theta * theta);
+        beta  = (1.0f - theta) * (1.0f - theta);
+
+        /* Predict to the middle of this period and correct */
+        residual = raw - (tf->speed + (tf->accel * dt * 0.5f));
+
+        tf->speed += (tf->accel * dt) + (alpha * residual);
+        tf->accel += (beta * residual) / dt;
+    }
+
+    /* Restart the window on a speed change, otherwise let it grow */
+    tf->change += ((raw - tf->average) - tf->change) * TACH_FILT_SMOOTH;
+
+    if (fabsf(tf->change) > (tf->average * TACH_FILT_STEP))
+    {
+        tf->window = 1;
+        tf->sum    = period;
+        tf->change = 0.0f;
+    }
+    else if (tf->window < tf->window_max)
+    {
+        ++tf->window;
+        tf->sum += period;
+    }
+    else
+    {
+        /* Full window, the oldest period drops out */
+        size_t oldest = (tf->index + TACH_FILT_SIZE + 1 - tf->window) % TACH_FILT_SIZE;
+
+        tf->sum += period;
+        tf->sum -= tf->period[oldest];
+    }
+
+    tf->index = (tf->index + 1) % TACH_FILT_SIZE;
+    tf->period[tf->index] = period;
+
+    /* Total edges over total time for the window average */
+    tf->average = (tf->scale * (float)tf->window) / (float)tf->sum;
+    tf->last    = period;
+}
+
+/*****************************************************************************
+ * Read the filter output selected by the type, given the timer counts
+ * elapsed since the last period.
+ *****************************************************************************/
+
+float TachFilter_read(TACHFILT* tf, uint32_t elapsed)
+{
+    float tach;
+    float bound;
+
+    if (!tf->valid)
+        return 0.0f;
+
+    if (tf->type == TACH_FILT_ALPHABETA)
+    {
+        /* Carry the speed forward, but no further than one period */
+        uint32_t ahead = (elapsed < tf->last) ? elapsed : tf->last;
+
+        tach = tf->speed + (tf->accel * ((float)ahead / TACH_CLOCK_HZ));
+    }
+    else
+    {
+        tach = tf->average;
+    }
+
+    /* A period not yet complete bounds the speed since the last one */
+    if (elapsed > tf->last)
+    {
+        bound = tf->scale / (float)elapsed;
+
+        if (tach > bound)
+            tach = bound;
+    }
+
+    return (tach > 0.0f) ? tach : 0.0f;
+}
+
+/* End-Of-File */
@@ -82,6 +82,9 @@
 
 /* Project specific includes */
 #include "DTC1200.h"
+#include "Globals.h"
+#include "ServoTask.h"
+#include "ReelQEI.h"
 #include "TapeTach.h"
 
 
@@ -91,6 +94,44 @@
 
 static uint32_t g_systemClock = 1;
 
+/* Tape position in tach edges and the last direction both reels agreed on */
+static volatile int32_t g_tapePosition = 0;
+static int32_t g_tapeDirection = TAPE_DIR_FWD;
+
+/****************************************************************************
+ * The tach roller only counts edges, so the sign comes from the reel QEI
+ * direction. Both reels must agree, otherwise the last known direction is
+ * kept to avoid counting the wrong way on jitter near stopped.
+ *
+ * Called from the WTIMER1A tach interrupt handler and, in the edge group
+ * build, from TapeTach_getPosition() in the servo task. The task side call
+ * is made with interrupts disabled, so it can't interleave with the
+ * handler's update of the direction and position. The QEI direction reads
+ * have no side effects.
+ *
+ * When TapeTach_getPosition() sees the direction flip, it commits the
+ * partial group and reloads the WTIMER1A edge count. Both steps happen in
+ * the same critical section as the read of the count, so the handler can't
+ * run between them. If the group completed before interrupts were
+ * disabled, the edge count timer has stopped at its zero match value. The
+ * partial count then reads as a whole group and is taken as zero, so the
+ * task commits nothing. The reload doesn't clear the pending match
+ * interrupt, so the handler adds that group once when interrupts are
+ * restored. Edges arriving between the read and the reload are lost, not
+ * counted twice.
+ ****************************************************************************/
+
+static int32_t TapeDirection(void)
+{
+    int32_t sdir = QEIDirectionGet(QEI_BASE_SUPPLY);
+    int32_t tdir = QEIDirectionGet(QEI_BASE_TAKEUP);
+
+    if (sdir == tdir)
+        g_tapeDirection = sdir;
+
+    return g_tapeDirection;
+}
+
 /* Hardware Interrupt Handlers */
 static Void WTimer1AIntHandler(void);
 static Void WTimer1BIntHandler(void);
@@ -148,6 +189,9 @@ void TapeTach_initialize(void)
     /* Configure the timeout count on timer B for half a second */
     TimerLoadSet(WTIMER1_BASE, TIMER_B, g_systemClock/2);
 
+    /* Tach filter on the single edge periods */
+    TachFilter_init(&g_tach.filter, 1);
+
     /* Enable interrupt on timer A for capture event and timer B for timeout */
     TimerIntEnable(WTIMER1_BASE, TIMER_CAPA_EVENT | TIMER_TIMB_TIMEOUT);
 
@@ -164,109 +208,146 @@ void TapeTach_initialize(void)
 
 /****************************************************************************
  * WTIMER1A FALLING EDGE CAPTURE TIMER INTERRUPT HANDLER
+ *
+ * Integer only, the capture time is queued and the period worked out at
+ * the servo rate in TapeTach_read(). This is the only writer of the ring
+ * head, so no critical section is needed.
  ****************************************************************************/
 
 Void WTimer1AIntHandler(void)
 {
-    uint32_t thisCount;
-    uint32_t thisPeriod;
-    uint32_t key;
-
     TimerIntClear(WTIMER1_BASE, TIMER_CAPA_EVENT);
 
-    /* ENTER - Critical Section */
-    key = Hwi_disable();
-
-    thisCount = TimerValueGet(WTIMER1_BASE, TIMER_A);
-    thisPeriod = g_tach.previousCount - thisCount;
-    g_tach.previousCount = thisCount;
+    /* Queue the edge capture time */
+    g_tach.stamp[g_tach.head & (TACH_RING_SIZE - 1)] = TimerValueGet(WTIMER1_BASE, TIMER_A);
+    g_tach.head++;
 
-    if (thisPeriod)       /* Shield from dividing by zero */
-    {
-        /* Calculates and store averaged value */
-        g_tach.averageSum -= g_tach.averageCount[g_tach.averageIdx];
-        g_tach.averageSum += thisPeriod;
-        g_tach.averageCount[g_tach.averageIdx] = thisPeriod;
-        g_tach.averageIdx++;
-        g_tach.averageIdx %= TACH_AVG_QTY;
+    /* Sets the status to indicate tach is alive */
+    g_tach.tachAlive = true;
 
-        /* Sets the status to indicate tach is alive */
-        g_tach.tachAlive = true;
+    /* Count the edge into the tape position */
+    g_tapePosition += (TapeDirection() == TAPE_DIR_FWD) ? 1 : -1;
 
-        /* Store RAW value, which refers to one measurement only */
-        g_tach.frequencyRawHz = (float)g_systemClock / (float)thisPeriod;
+    /* Resets timeout timer */
+    HWREG(WTIMER1_BASE + TIMER_O_TBV) = g_systemClock / 2;
+}
 
-        /* Update the average sum */
-        if (g_tach.averageSum)
-            g_tach.frequencyAvgHz = (float)g_systemClock / ((float)g_tach.averageSum / (float)TACH_AVG_QTY);
+/****************************************************************************
+ * WTIMER1B 1/2 SECOND EDGE DETECT TIMEOUT TIMER INTERRUPT HANDLER
+ ****************************************************************************/
 
-        /* Resets timeout timer */
-        HWREG(WTIMER1_BASE + TIMER_O_TBV) = g_systemClock / 2;
-    }
+Void WTimer1BIntHandler(void)
+{
+    TimerIntClear(WTIMER1_BASE, TIMER_TIMB_TIMEOUT);
 
-    /* EXIT - Critical Section */
-    Hwi_restore(key);
+    /* The next read clears the tach filter */
+    g_tach.tachAlive = false;
+    g_tach.timeouts++;
 }
 
 /****************************************************************************
- * WTIMER1B 1/2 SECOND EDGE DETECT TIMEOUT TIMER INTERRUPT HANDLER
+ * Read the current tape tachometer count. Called from the servo task each
+ * tick, the edges queued since the last read are taken off the ring and
+ * their periods passed on to the tach filter.
  ****************************************************************************/
 
-Void WTimer1BIntHandler(void)
+float TapeTach_read(void)
 {
-    uint32_t key;
+    uint32_t head;
+    uint32_t stamp;
+    uint32_t period;
+    uint32_t elapsed;
 
-    TimerIntClear(WTIMER1_BASE, TIMER_TIMB_TIMEOUT);
+    g_tach.filter.type = (g_sys.sysflags & SF_TACH_ALPHABETA) ? TACH_FILT_ALPHABETA : TACH_FILT_WINDOW;
 
-    key = Hwi_disable();
+    /* Edge timeout or reset, start over from the next edge */
+    if (g_tach.timeouts != g_tach.timeoutsSeen)
     {
-        g_tach.tachAlive      = false;
-        g_tach.frequencyAvgHz = 0.0f;
+        g_tach.timeoutsSeen   = g_tach.timeouts;
+        g_tach.previousValid  = false;
         g_tach.frequencyRawHz = 0.0f;
+
+        TachFilter_reset(&g_tach.filter);
     }
-    Hwi_restore(key);
+
+    head = g_tach.head;
+
+    /* Fell behind the ring, the period over the gap is lost */
+    if ((head - g_tach.tail) > TACH_RING_SIZE)
+    {
+        g_tach.tail = head - TACH_RING_SIZE;
+        g_tach.previousValid = false;
+    }
+
+    while (g_tach.tail != head)
+    {
+        stamp = g_tach.stamp[g_tach.tail & (TACH_RING_SIZE - 1)];
+        g_tach.tail++;
+
+        /* The capture timer counts down */
+        period = g_tach.previousCount - stamp;
+
+        if (g_tach.previousValid && period)
+        {
+            TachFilter_update(&g_tach.filter, period);
+
+            /* Store RAW value, which refers to one measurement only */
+            g_tach.frequencyRawHz = (float)g_systemClock / (float)period;
+        }
+
+        g_tach.previousCount = stamp;
+        g_tach.previousValid = true;
+    }
+
+    if (!g_tach.previousValid)
+        return 0.0f;
+
+    /* Timer counts since the last edge was captured */
+    elapsed = g_tach.previousCount - HWREG(WTIMER1_BASE + TIMER_O_TAV);
+
+    return TachFilter_read(&g_tach.filter, elapsed);
 }
 
 /****************************************************************************
- * Read the current tape tachometer count.
+ * Tape tach acceleration in tach units per second from the last read.
  ****************************************************************************/
 
-float TapeTach_read(void)
+float TapeTach_getAccel(void)
 {
-    uint32_t key;
-	float avg;
-
-	key = Hwi_disable();
-	{
-	    avg = g_tach.frequencyAvgHz;
-	}
-	Hwi_restore(key);
-
-	return avg;
+    return g_tach.filter.valid ? g_tach.filter.accel : 0.0f;
 }
 
 /****************************************************************************
- * Reset the tach data.
+ * Reset the tach data. The servo task owns the filter, so this is passed
+ * on to the next read the same as an edge timeout.
  ****************************************************************************/
 
 void TapeTach_reset(void)
 {
-    size_t i;
     uint32_t key;
 
     key = Hwi_disable();
     {
-        for(i=0; i < TACH_AVG_QTY; i++)
-            g_tach.averageCount[i] = 0;
+        g_tach.tachAlive = false;
+        g_tach.timeouts++;
+    }
+    Hwi_restore(key);
+}
 
-        g_tach.previousCount  = 0;
-        g_tach.averageSum     = 0;
-        g_tach.averageIdx     = 0;
+/****************************************************************************
+  ****************************************************************************/
 
-        g_tach.tachAlive      = false;
-        g_tach.frequencyAvgHz = 0.0f;
-        g_tach.frequencyRawHz = 0.0f;
-    }
+int32_t TapeTach_getPosition(void)
+{
+    return g_tapePosition;
+}
+
+void TapeTach_setPosition(int32_t position)
+{
+    uint32_t key;
+
+    key = Hwi_disable();
+    g_tapePosition = position;
     Hwi_restore(key);
 }
 
@@ -283,8 +364,13 @@ void TapeTach_reset(void)
 
 static uint32_t g_prevCount = 0xFFFFFFFF;
 static uint32_t g_thisPeriod;
+static volatile uint32_t g_groupCount = 0;
 //static uint32_t g_frequencyRawHz = 0;
 
+/* Tach filter, run from the servo task on each new group period */
+static TACHFILT g_tachFilter;
+static uint32_t g_filterGroups = 0;
+
 
 void TapeTach_initialize(void)
 {
@@ -342,6 +428,9 @@ void TapeTach_initialize(void)
     /* Enable master interrupts */
     IntMasterEnable();
 
+    /* Tach filter on the edge group periods */
+    TachFilter_init(&g_tachFilter, TACH_EDGE_COUNT);
+
     /* Setup standard timer1 as 32-bit periodic timer */
 	TimerConfigure(TIMER1_BASE, TIMER_CFG_PERIODIC);
 	/* Load timer value (TIMER_A for 32-bit operation) */
@@ -378,6 +467,15 @@ Void WTimer1AIntHandler(void)
 
     g_prevCount = TimerValueGet(TIMER1_BASE, TIMER_A);
 
+    /* Flag a new group period for the tach filter */
+    ++g_groupCount;
+
+    /* Count the edge group into the tape position */
+    if (TapeDirection() == TAPE_DIR_FWD)
+        g_tapePosition += TACH_EDGE_COUNT;
+    else
+        g_tapePosition -= TACH_EDGE_COUNT;
+
     /* Store RAW value, which refers to one measurement only
      * while avoiding divide by zero!
      */
@@ -412,26 +510,52 @@ Void WTimer1BIntHandler(void)
 }
 
 /****************************************************************************
- * Read the current tape tachometer count.
+ * Read the current tape tachometer count. Called from the servo task each
+ * tick, any group period completed since the last read is passed on to
+ * the tach filter and the output selected by SF_TACH_ALPHABETA returned.
  ****************************************************************************/
 
 float TapeTach_read(void)
 {
-	float a;
     uint32_t key;
+    uint32_t period;
+    uint32_t groups;
+    uint32_t elapsed;
 
     key = Hwi_disable();
 
-    //a = (float)g_systemClock / (float)g_thisPeriod;
-
-    if (g_thisPeriod)
-    	a = 800000000.0f / (float)g_thisPeriod;
-    else
-    	a = 0.0f;
+    period  = g_thisPeriod;
+    groups  = g_groupCount;
+    elapsed = g_prevCount - TimerValueGet(TIMER1_BASE, TIMER_A);
 
     Hwi_restore(key);
 
-	return a;
+    g_tachFilter.type = (g_sys.sysflags & SF_TACH_ALPHABETA) ? TACH_FILT_ALPHABETA : TACH_FILT_WINDOW;
+
+    /* Cleared on the edge timeout with the tape stopped */
+    if (!period)
+    {
+        TachFilter_reset(&g_tachFilter);
+        g_filterGroups = groups;
+        return 0.0f;
+    }
+
+    if (groups != g_filterGroups)
+    {
+        g_filterGroups = groups;
+        TachFilter_update(&g_tachFilter, period);
+    }
+
+    return TachFilter_read(&g_tachFilter, elapsed);
+}
+
+/****************************************************************************
+ * Tape tach acceleration in tach units per second from the last read.
+ ****************************************************************************/
+
+float TapeTach_getAccel(void)
+{
+    return g_tachFilter.valid ? g_tachFilter.accel : 0.0f;
 }
 
 /****************************************************************************
@@ -446,6 +570,73 @@ void TapeTach_reset(void)
     //g_frequencyRawHz = 0;
     g_thisPeriod = 0;
     Hwi_restore(key);
+
+    /* The next read then clears the tach filter from the servo task */
+}
+
+/****************************************************************************
+ * Read the current tape position in tach edges. The edges counted since the
+ * last group interrupt are added from the edge count timer so the position
+ * resolves to a single edge rather than a whole group. If the tape has
+ * reversed part way through a group, the partial count is committed with
+ * the old direction and a new group started, otherwise those edges would
+ * be counted the wrong way when the group completes.
+ ****************************************************************************/
+
+int32_t TapeTach_getPosition(void)
+{
+    int32_t position;
+    int32_t direction;
+    uint32_t edges;
+    uint32_t key;
+
+    key = Hwi_disable();
+
+    edges = TACH_EDGE_COUNT - TimerValueGet(WTIMER1_BASE, TIMER_A);
+
+    if (edges >= TACH_EDGE_COUNT)
+        edges = 0;
+
+    direction = g_tapeDirection;
+
+    if (TapeDirection() != direction)
+    {
+        if (direction == TAPE_DIR_FWD)
+            g_tapePosition += (int32_t)edges;
+        else
+            g_tapePosition -= (int32_t)edges;
+
+        TimerLoadSet(WTIMER1_BASE, TIMER_A, TACH_EDGE_COUNT);
+
+        edges = 0;
+    }
+
+    if (g_tapeDirection == TAPE_DIR_FWD)
+        position = g_tapePosition + (int32_t)edges;
+    else
+        position = g_tapePosition - (int32_t)edges;
+
+    Hwi_restore(key);
+
+    return position;
+}
+
+/****************************************************************************
+ * Preset or zero the tape position counter.
+ ****************************************************************************/
+
+void TapeTach_setPosition(int32_t position)
+{
+    uint32_t key;
+
+    key = Hwi_disable();
+
+    /* Restart the edge group so the partial count is not added */
+    TimerLoadSet(WTIMER1_BASE, TIMER_A, TACH_EDGE_COUNT);
+
+    g_tapePosition = position;
+
+    Hwi_restore(key);
 }
 
 #endif
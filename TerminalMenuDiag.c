@@ -77,6 +77,11 @@ static MENUITEM diag_items[] = {
         .param2.U = 1,
         NULL, diag_servo, 0, 0 },
 
+{ 10, 2, "6", "Servo PID Autotune", MI_EXEC,
+        .param1.U = 0,
+        .param2.U = 1,
+        NULL, diag_autotune, 0, 0 },
+
 { 11, 6, NULL, "MOTOR DRIVE AMP", MI_TEXT,
         .param1.U = 1,
         .param2.U = 0,
@@ -92,12 +97,25 @@ static MENUITEM diag_items[] = {
 		.param2.U = 1,
 		NULL, diag_dac_adjust, 0, 0 },
 
-#if (CAPDATA_SIZE > 0)
-{ 16, 2, "12", "Dump Capture Data", MI_EXEC,
-		.param1.U = 0,
-		.param2.U = 1,
-		NULL, diag_dump_capture, 0, 0 },
-#endif
+{ 15, 2, "12", "Servo Loop Timing", MI_EXEC,
+        .param1.U = 0,
+        .param2.U = 1,
+        NULL, diag_servo_timing, 0, 0 },
+
+{ 16, 2, "13", "Servo Stage Profile", MI_EXEC,
+        .param1.U = 0,
+        .param2.U = 1,
+        NULL, diag_servo_profile, 0, 0 },
+
+{ 17, 2, "14", "Servo Capture Buffer", MI_EXEC,
+        .param1.U = 0,
+        .param2.U = 1,
+        NULL, diag_dump_capture, 0, 0 },
+
+{ 18, 2, "15", "Reel Radius Estimator", MI_EXEC,
+        .param1.U = 0,
+        .param2.U = 1,
+        NULL, diag_reel_radius, 0, 0 },
 
 { PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
 		.param1.U = 0,
@@ -67,11 +67,66 @@ static MENUITEM general_items[] = {
 		.param2.U = 10,
 		NULL, put_idata, DT_LONG, &g_sys.rechold_settle_time },
 
-{ 8, 2, "4", "Transport Button Debounce", MI_NUMERIC,
+{ 8, 2, "4", "Switch Debounce Time (ms)", MI_NUMERIC,
 		.param1.U = 2,
-		.param2.U = 10,
+		.param2.U = DEBOUNCE_MAX,
 		NULL, put_idata, DT_LONG, &g_sys.debounce },
 
+{ 9, 2, "5", "Use 10ms QEI Velocity Capture", MI_BITFLAG,
+		.param1.U = SF_QEI_VELCAP,
+		.param2.U = SF_QEI_VELCAP,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
+{ 11, 6, "", "MOTOR CURRENT", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 13, 2, "6", "Closed Loop Motor Current", MI_BITFLAG,
+		.param1.U = SF_CURRENT_LOOP,
+		.param2.U = SF_CURRENT_LOOP,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
+{ 14, 2, "7", "Current Sense Scale      ", MI_NUMERIC,
+		.param1.F = 0.01f,
+		.param2.F = 2.00f,
+		NULL, put_idata, DT_FLOAT, &g_sys.current_scale },
+
+{ 15, 2, "8", "Current Sense Offset     ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 2047.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.current_offset },
+
+{ 16, 2, "9", "Current Loop P-Gain      ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 1.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.current_pgain },
+
+{ 17, 2, "10", "Current Loop I-Gain      ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 1.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.current_igain },
+
+{ 18, 2, "11", "Overcurrent Limit (0=off)", MI_NUMERIC,
+		.param1.U = 0,
+		.param2.U = DAC_MAX,
+		NULL, put_idata, DT_LONG, &g_sys.current_limit },
+
+{ 11, 48, "", "MOTOR DAC", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 13, 44, "12", "Linearize DAC Table", MI_BITFLAG,
+		.param1.U = SF_DAC_LINEARIZE,
+		.param2.U = SF_DAC_LINEARIZE,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
+{ 14, 44, "13", "Dither DAC Sub-LSB ", MI_BITFLAG,
+		.param1.U = SF_DAC_DITHER,
+		.param2.U = SF_DAC_DITHER,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
 { PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
 		.param1.U = 0,
 		.param1.U = 0,
@@ -117,6 +117,16 @@ static MENUITEM play_items[] = {
 		.param2.U = SF_ENGAGE_PINCH_ROLLER,
         NULL, NULL, DT_LONG, &g_sys.sysflags },
 
+{ 18, 2, "15", "Capstan Spin Up Time (sec)   ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 1.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.play_accel_time },
+
+{ 19, 2, "16", "Alpha-Beta Tape Tach Filter  ", MI_BITFLAG,
+		.param1.U = SF_TACH_ALPHABETA,
+		.param2.U = SF_TACH_ALPHABETA,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
 { PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
 		0,
 		0,
@@ -67,6 +67,26 @@ static MENUITEM shuttle_items[] = {
 		.param2.F = 5.0f,
 		NULL, put_idata, DT_FLOAT, &g_sys.shuttle_servo_dgain },
 
+{ 8, 2, "4", "Gain Schedule", MI_NMENU,
+		.param1.U = MENU_SHUTTLE_SCHED,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 3, 42, NULL, "SHUTTLE PROFILE", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 5, 38, "18", "Accel Limit        ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5000.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.shuttle_accel },
+
+{ 6, 38, "19", "Jerk Limit         ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 50000.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.shuttle_jerk },
+
 { 10, 6, NULL, "SHUTTLE SETTINGS", MI_TEXT,
 		.param1.U = 1,
 		.param2.U = 0,
@@ -112,6 +132,36 @@ static MENUITEM shuttle_items[] = {
 		.param2.U = 2000,
 		NULL, put_idata, DT_LONG, &g_sys.lifter_settle_time },
 
+{ 10, 42, NULL, "TAPE LOCATE", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 12, 38, "13", "Locate Velocity    ", MI_NUMERIC,
+		.param1.U = 100,
+		.param2.U = 1200,
+		NULL, put_idata, DT_LONG, &g_sys.locate_velocity },
+
+{ 13, 38, "14", "Approach Velocity  ", MI_NUMERIC,
+		.param1.U = 20,
+		.param2.U = 300,
+		NULL, put_idata, DT_LONG, &g_sys.locate_approach_velocity },
+
+{ 14, 38, "15", "Approach Distance  ", MI_NUMERIC,
+		.param1.U = 8,
+		.param2.U = 800,
+		NULL, put_idata, DT_LONG, &g_sys.locate_approach_dist },
+
+{ 15, 38, "16", "Locate Window      ", MI_NUMERIC,
+		.param1.U = 1,
+		.param2.U = 40,
+		NULL, put_idata, DT_LONG, &g_sys.locate_window },
+
+{ 16, 38, "17", "Locate Decel       ", MI_NUMERIC,
+		.param1.F = 50.0f,
+		.param2.F = 5000.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.locate_decel },
+
 { PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
 		.param1.U = 0,
 		.param2.U = 0,
@@ -127,4 +177,185 @@ MENU menu_shuttle = {
     "SHUTTLE MENU"
 };
 
+/*****************************************************************************
+ * SHUTTLE GAIN SCHEDULE MENU ITEMS
+ *****************************************************************************/
+
+static MENUITEM shuttle_sched_items[] = {
+
+{ 3, 6, NULL, "GAIN SCHEDULE", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 5, 2, "1", "Enable Gain Schedule", MI_BITFLAG,
+		.param1.U = SF_GAIN_SCHEDULE,
+		.param2.U = SF_GAIN_SCHEDULE,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
+{ 7, 2, "2", "Low Velocity      ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 1200.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_velocity[0] },
+
+{ 8, 2, "3", "High Velocity     ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 1200.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_velocity[1] },
+
+{ 3, 42, NULL, "SUPPLY/TAKEUP RADIUS", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 5, 38, "4", "Supply Empty Ratio", MI_NUMERIC,
+		.param1.F = 0.1f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_ratio[0] },
+
+{ 6, 38, "5", "Half Pack Ratio   ", MI_NUMERIC,
+		.param1.F = 0.1f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_ratio[1] },
+
+{ 7, 38, "6", "Supply Full Ratio ", MI_NUMERIC,
+		.param1.F = 0.1f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_ratio[2] },
+
+{ 10, 6, NULL, "SUPPLY EMPTY LOW VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 10, 42, NULL, "SUPPLY EMPTY HIGH VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 11, 2, "7", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[0][0] },
+
+{ 12, 2, "8", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[0][0] },
+
+{ 13, 2, "9", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[0][0] },
+
+{ 11, 38, "10", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[0][1] },
+
+{ 12, 38, "11", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[0][1] },
+
+{ 13, 38, "12", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[0][1] },
+
+{ 14, 6, NULL, "HALF PACK LOW VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 14, 42, NULL, "HALF PACK HIGH VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 15, 2, "13", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[1][0] },
+
+{ 16, 2, "14", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[1][0] },
+
+{ 17, 2, "15", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[1][0] },
+
+{ 15, 38, "16", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[1][1] },
+
+{ 16, 38, "17", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[1][1] },
+
+{ 17, 38, "18", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[1][1] },
+
+{ 18, 6, NULL, "SUPPLY FULL LOW VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 18, 42, NULL, "SUPPLY FULL HIGH VELOCITY", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 19, 2, "19", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[2][0] },
+
+{ 20, 2, "20", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[2][0] },
+
+{ 21, 2, "21", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[2][0] },
+
+{ 19, 38, "22", "P-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 10.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_pgain[2][1] },
+
+{ 20, 38, "23", "I-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_igain[2][1] },
+
+{ 21, 38, "24", "D-Gain", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 5.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.sched_dgain[2][1] },
+
+{ PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
+		.param1.U = 0,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 }
+};
+
+/** SHUTTLE GAIN SCHEDULE MENU **/
+
+MENU menu_shuttle_sched = {
+    MENU_SHUTTLE_SCHED,
+    shuttle_sched_items,
+    sizeof(shuttle_sched_items) / sizeof(MENUITEM),
+    "SHUTTLE GAIN SCHEDULE"
+};
+
 /* End-Of-File */
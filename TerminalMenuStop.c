@@ -57,6 +57,26 @@ static MENUITEM stop_items[] = {
 		.param2.U = 900,
 		NULL, put_idata, DT_LONG, &g_sys.stop_brake_torque },
 
+{ 3, 42, "", "REEL INERTIA MODEL", MI_TEXT,
+		.param1.U = 1,
+		.param2.U = 0,
+		NULL, NULL, 0, 0 },
+
+{ 5, 38, "5", "Reel Inertia (0=off)", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 20.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.reel_inertia },
+
+{ 6, 38, "6", "Pack Inertia        ", MI_NUMERIC,
+		.param1.F = 0.0f,
+		.param2.F = 20.0f,
+		NULL, put_idata, DT_FLOAT, &g_sys.pack_inertia },
+
+{ 7, 38, "7", "Use Identified Inertia", MI_BITFLAG,
+		.param1.U = SF_REEL_IDENT,
+		.param2.U = SF_REEL_IDENT,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
 {  7, 6, "", "STOP SETTINGS", MI_TEXT,
 		.param1.U = 1,
 		.param2.U = 0,
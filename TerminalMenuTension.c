@@ -139,6 +139,36 @@ static MENUITEM tension_items[] = {
         .param2.F = 2500.0f,
         NULL, put_idata, DT_FLOAT, &g_sys.tension_sensor_midscale2 },
 
+{ 14, 30, "20", "Radius Time Const  ", MI_NUMERIC,
+        .param1.F = 0.01f,
+        .param2.F = 5.00f,
+        NULL, put_idata, DT_FLOAT, &g_sys.reel_radius_tc },
+
+{ 15, 30, "21", "Offset Time Const  ", MI_NUMERIC,
+        .param1.F = 0.01f,
+        .param2.F = 5.00f,
+        NULL, put_idata, DT_FLOAT, &g_sys.reel_offset_tc },
+
+{ 16, 30, "22", "1 Sec Avg Radius   ", MI_BITFLAG,
+        .param1.U = SF_RADIUS_BOXCAR,
+        .param2.U = SF_RADIUS_BOXCAR,
+        NULL, NULL, DT_LONG, &g_sys.sysflags },
+
+{ 17, 30, "23", "Tension Filter 0-4 ", MI_NUMERIC,
+        .param1.U = TFILT_OFF,
+        .param2.U = TFILT_NUM_PRESETS - 1,
+        NULL, put_idata, DT_LONG, &g_sys.tension_filter },
+
+{ 18, 30, "24", "Filter Low Pass Hz ", MI_NUMERIC,
+        .param1.F = 5.0f,
+        .param2.F = 200.0f,
+        NULL, put_idata, DT_FLOAT, &g_sys.tension_lp_freq },
+
+{ 19, 30, "25", "Reel Notch Q       ", MI_NUMERIC,
+        .param1.F = 0.5f,
+        .param2.F = 10.0f,
+        NULL, put_idata, DT_FLOAT, &g_sys.tension_notch_q },
+
 { PROMPT_ROW, PROMPT_COL, "", "", MI_PROMPT,
 		.param1.U = 0,
 		.param2.U = 0,
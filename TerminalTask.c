@@ -154,6 +154,7 @@ extern MENU menu_tension;
 extern MENU menu_stop;
 extern MENU menu_shuttle;
 extern MENU menu_play;
+extern MENU menu_shuttle_sched;
 
 /* MUST BE IN ORDER OF MENU_XX ID DEFINES! */
 
@@ -164,7 +165,8 @@ static MENU* menu_tab[] = {
     &menu_tension,
     &menu_stop,
     &menu_shuttle,
-    &menu_play
+    &menu_play,
+    &menu_shuttle_sched
 };
 
 #define NUM_MENUS   (sizeof(menu_tab) / sizeof(MENU*))
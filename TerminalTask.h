@@ -175,6 +175,7 @@ typedef struct _MENU {
 #define MENU_STOP           4
 #define MENU_SHUTTLE        5
 #define MENU_PLAY           6
+#define MENU_SHUTTLE_SCHED  7
 
 /* Function Prototypes */
 
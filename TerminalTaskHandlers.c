@@ -222,6 +222,8 @@ void show_monitor_screen()
         tty_puts("Offset");
         tty_pos(9, 2);
         tty_puts("Radius");
+        tty_pos(10, 2);
+        tty_puts("Current");
 
         tty_pos(3, 35);
         tty_printf("%sTAKEUP REEL%s", g_ul_on, g_ul_off);
@@ -237,6 +239,8 @@ void show_monitor_screen()
         tty_puts("Offset");
         tty_pos(9, 35);
         tty_puts("Radius");
+        tty_pos(10, 35);
+        tty_puts("Current");
 
         tty_pos(11, 2);
         tty_printf("%sSHUTTLE PID%s", g_ul_on, g_ul_off);
@@ -265,6 +269,11 @@ void show_monitor_screen()
         //tty_pos(13, 35);
         //tty_puts("CPU Temp F");
 
+        tty_pos(14, 35);
+        tty_printf("%sREEL MODEL%s", g_ul_on, g_ul_off);
+        tty_pos(15, 35);
+        tty_puts("Inertia S/T");
+
         tty_pos(23, 2);
         tty_puts(g_escstr);
     }
@@ -312,6 +321,9 @@ void show_monitor_data()
         tty_printf(": %-8.2f", g_servo.offset_supply);
         tty_pos(9, 14);
         tty_printf(": %-8.2f", g_servo.radius_supply);
+        tty_pos(10, 14);
+        tty_printf(": %-8.2f%c", g_servo.current_supply.current,
+                   (g_servo.current_supply.cutback > 0.0f) ? '!' : ' ');
 
         /* TAKEUP */
         tty_pos(4, 47);
@@ -326,6 +338,9 @@ void show_monitor_data()
         tty_printf(": %-8.2f", g_servo.offset_takeup);
         tty_pos(9, 47);
         tty_printf(": %-8.2f", g_servo.radius_takeup);
+        tty_pos(10, 47);
+        tty_printf(": %-8.2f%c", g_servo.current_takeup.current,
+                   (g_servo.current_takeup.cutback > 0.0f) ? '!' : ' ');
 
         /* PID SERVO */
         tty_pos(12, 14);
@@ -345,6 +360,11 @@ void show_monitor_data()
         tty_pos(20, 14);
         tty_printf(": %-8.2f", g_servo.tsense);
 
+        /* REEL MODEL, '*' until the estimate converges */
+        tty_pos(15, 47);
+        tty_printf(": %-7.2f %-7.2f%c", g_servo.reel_ident.inertia_supply,
+                   g_servo.reel_ident.inertia_takeup, g_servo.reel_ident.valid ? ' ' : '*');
+
         /* SYSTEM */
 
         /* Display Current Transport State */
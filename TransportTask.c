@@ -80,102 +80,10 @@
 #include "IPCServer.h"
 
 /* Static Function Prototypes */
-static void ResetPlayPID(void);
-static void ResetShuttlePID(void);
 static bool HandleAutoSlow(void);
 static void HandleImmediateCommand(CMDMSG *p);
 static void IPCNotify_TransportState(uint32_t mode, uint32_t flags);
-
-extern Semaphore_Handle g_semaServo;
-
-//*****************************************************************************
-// Reset PLAY servo parameters. This gets called every time prior to the
-// transport controller entering play mode. Here we reset all the play boost
-// ramp up counters that control play boost logic before the play servo mode
-// begins in the servo task.
-//*****************************************************************************
-
-void ResetPlayPID(void)
-{
-    Semaphore_pend(g_semaServo, BIOS_WAIT_FOREVER);
-
-    /* Reset play mode capture data buffer to zeros */
-#if (CAPDATA_SIZE > 0)
-    size_t i;
-    for (i=0; i < CAPDATA_SIZE; i++)
-    {
-        g_capdata[i].dac_takeup = 0.0f;
-        g_capdata[i].dac_supply = 0.0f;
-        g_capdata[i].vel_takeup = 0.0f;
-        g_capdata[i].vel_supply = 0.0f;
-        g_capdata[i].rad_supply = 0.0f;
-        g_capdata[i].rad_takeup = 0.0f;
-        g_capdata[i].tape_tach  = 0.0f;
-        g_capdata[i].tension    = 0.0f;
-    }
-    g_capdata_count = 0;
-#endif
-
-    /* Initialize the PID used for play boost */
-
-    g_servo.play_boost_count = 1000;
-
-    /* Initialize the play servo data items */
-    if (g_high_speed_flag)
-    {
-        /* Reset the tension values */
-        g_servo.play_supply_tension    = (float)g_sys.play_hi_supply_tension;
-        g_servo.play_takeup_tension    = (float)g_sys.play_hi_takeup_tension;
-        g_servo.play_boost_end         = g_sys.play_hi_boost_end;
-
-        fpid_init(&g_servo.pid_play,
-                 g_sys.play_hi_boost_pgain,   	// P-gain
-                 g_sys.play_hi_boost_igain,   	// I-gain
-                 0.0f,     						// D-gain
-                 PID_CV_MAX_F,
-                 PID_CV_MIN_F,
-                 1.0f);              			// PID deadband
-    }
-    else
-    {
-        /* Reset the tension values */
-        g_servo.play_supply_tension    = (float)g_sys.play_lo_supply_tension;
-        g_servo.play_takeup_tension    = (float)g_sys.play_lo_takeup_tension;
-        g_servo.play_boost_end         = g_sys.play_lo_boost_end;
-
-        fpid_init(&g_servo.pid_play,
-                 g_sys.play_lo_boost_pgain,   	// P-gain
-                 g_sys.play_lo_boost_igain,   	// I-gain
-                 0.0f,     						// D-gain
-                 PID_CV_MAX_F,
-                 PID_CV_MIN_F,
-                 1.0f);              			// PID deadband
-    }
-
-    TapeTach_reset();
-
-    Semaphore_post(g_semaServo);
-}
-
-//*****************************************************************************
-// Reset shuttle PID servo parameters. This gets called every time prior
-// to the transport controller entering shuttle mode.
-//*****************************************************************************
-
-void ResetShuttlePID(void)
-{
-    Semaphore_pend(g_semaServo, BIOS_WAIT_FOREVER);
-
-    fpid_init(&g_servo.pid_shuttle,
-             g_sys.shuttle_servo_pgain,     // P-gain
-             g_sys.shuttle_servo_igain,     // I-gain
-             g_sys.shuttle_servo_dgain,     // D-gain
-             PID_CV_MAX_F,
-             PID_CV_MIN_F,
-             PID_TOLERANCE_F);              // PID deadband
-
-    Semaphore_post(g_semaServo);
-}
+static void IPCNotify_StopTime(void);
 
 //*****************************************************************************
 // Enable record mode! This function is called to enable record mode on the
@@ -209,7 +117,7 @@ void RecordEnable(void)
         g_lamp_mask |= L_REC;
 
         /* IPC notify STC record bit set */
-        IPCNotify_TransportState(g_servo.mode, M_RECORD);
+        IPCNotify_TransportState(Servo_GetMode(), M_RECORD);
     }
 }
 
@@ -232,7 +140,7 @@ void RecordDisable(void)
         g_lamp_mask &= ~(L_REC);
 
         /* IPC notify STC record bit cleared */
-        IPCNotify_TransportState(g_servo.mode, 0);
+        IPCNotify_TransportState(Servo_GetMode(), 0);
     }
 }
 
@@ -247,6 +155,24 @@ Bool QueueTransportCommand(uint8_t command, uint8_t opcode, uint16_t param1)
     msg.command = command;      /* Set the command message type */
     msg.opcode  = opcode;       /* Set any cmd specfic op-code  */
     msg.param1  = param1;
+    msg.param2  = 0;
+
+    return Mailbox_post(g_mailboxController, &msg, 10);
+}
+
+//*****************************************************************************
+// Queue a locate to an absolute tape position in tach edges. The attempt
+// number is zero for a new locate and counts the corrective retries.
+//*****************************************************************************
+
+Bool QueueTransportLocate(int32_t position, uint16_t attempt)
+{
+    CMDMSG msg;
+
+    msg.command = CMD_LOCATE;
+    msg.opcode  = 0;
+    msg.param1  = attempt;
+    msg.param2  = position;
 
     return Mailbox_post(g_mailboxController, &msg, 10);
 }
@@ -398,8 +324,13 @@ Void TransportControllerTask(UArg a0, UArg a1)
     uint8_t prev_mode_requested = 0xFF;
     uint8_t mode_pending = 0;
     uint32_t stoptimer = 0;
+    uint32_t stop_count = 0;
     bool shuttling = FALSE;
     bool autoslow = FALSE;
+    bool locating = FALSE;
+    bool locate_stop = FALSE;
+    int32_t locate_target = 0;
+    uint16_t locate_attempt = 0;
     CMDMSG msg;
 
     for(;;)
@@ -408,6 +339,53 @@ Void TransportControllerTask(UArg a0, UArg a1)
 
         if (Mailbox_pend(g_mailboxController, &msg, 25) == TRUE)
         {
+            /* A locate becomes a shuttle toward the target position,
+             * the servo loop profiles the velocity from there on.
+             */
+
+            if (msg.command == CMD_LOCATE)
+            {
+                if (Servo_IsMode(MODE_HALT) || Servo_IsMode(MODE_THREAD))
+                    continue;
+
+                int32_t dist = msg.param2 - g_servo.tape_position;
+
+                if (abs(dist) <= g_sys.locate_window)
+                    continue;
+
+                locating       = TRUE;
+                locate_stop    = FALSE;
+                locate_target  = msg.param2;
+                locate_attempt = msg.param1;
+
+                mode = (dist > 0) ? MODE_FWD : MODE_REW;
+
+                /* Already shuttling the right way, just arm the locate */
+                if (Servo_IsMode(mode) && (mode_pending == 0))
+                {
+                    autoslow = FALSE;
+                    Servo_Locate(locate_target);
+                    continue;
+                }
+
+                msg.command = CMD_TRANSPORT_MODE;
+                msg.opcode  = mode | M_NOSLOW;
+                msg.param1  = (uint16_t)g_sys.locate_approach_velocity;
+            }
+            else if (msg.command == CMD_TRANSPORT_MODE)
+            {
+                /* Any other mode change cancels a locate, except the
+                 * stop we requested ourselves at the end of one.
+                 */
+                if (!(locate_stop && ((msg.opcode & MODE_MASK) == MODE_STOP)))
+                {
+                    if (locating)
+                        Servo_CancelLocate();
+
+                    locating = locate_stop = FALSE;
+                }
+            }
+
             /* Process immediate command messages first */
 
             if (msg.command != CMD_TRANSPORT_MODE)
@@ -600,7 +578,7 @@ Void TransportControllerTask(UArg a0, UArg a1)
                     SetTransportMask(T_TLIFT, T_SERVO | T_PROL | T_RECH | T_BRAKE);
 
                     /* Initialize shuttle mode PID values */
-                    ResetShuttlePID();
+                    Servo_ResetShuttle();
 
                     /* Set the servo velocity parameter */
                     if (msg.param1)
@@ -653,7 +631,7 @@ Void TransportControllerTask(UArg a0, UArg a1)
                     SetTransportMask(T_TLIFT, T_SERVO | T_PROL | T_RECH | T_BRAKE);
 
                      /* Initialize the shuttle tension sensor and velocity PID data */
-                    ResetShuttlePID();
+                    Servo_ResetShuttle();
 
                     /* Set the servo velocity parameter */
                     if (msg.param1)
@@ -680,9 +658,25 @@ Void TransportControllerTask(UArg a0, UArg a1)
                     g_lamp_mask |= L_STAT3;
                     break;
             }
+
+            /* Arm the servo locate once the shuttle mode is set */
+            if (locating && ((mode == MODE_FWD) || (mode == MODE_REW)))
+                Servo_Locate(locate_target);
         }
         else
         {
+            /* The servo reports the locate is done when it reaches the
+             * target window, then we stop the transport normally.
+             */
+
+            if (locating && (Servo_GetLocateState() == LOCATE_DONE))
+            {
+                locating    = FALSE;
+                locate_stop = TRUE;
+
+                QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_STOP, 0);
+            }
+
             /*
              * Perform shuttle mode auto-slow logic if enabled
              */
@@ -846,7 +840,7 @@ Void TransportControllerTask(UArg a0, UArg a1)
                         SetTransportMask(0, T_SERVO | T_TLIFT | T_PROL | T_RECH);
 
                         /* IPC notify STC lifters released */
-                        IPCNotify_TransportState(g_servo.mode, msg.opcode);
+                        IPCNotify_TransportState(Servo_GetMode(), msg.opcode);
 
                         /* Tape lifter settling Time */
                         if (mask & T_TLIFT)
@@ -862,9 +856,27 @@ Void TransportControllerTask(UArg a0, UArg a1)
                     /* IPC notify STC stop mode set */
                     IPCNotify_TransportState(mode, msg.opcode);
 
+                    /* Report the time to stop if dynamic braking completed */
+                    if (g_servo.stop_count != stop_count)
+                    {
+                        stop_count = g_servo.stop_count;
+                        IPCNotify_StopTime();
+                    }
+
                     last_mode_completed = MODE_STOP;
                     mode_pending = 0;
                     shuttling = FALSE;
+
+                    /* Correct a locate that coasted outside the window */
+                    if (locate_stop)
+                    {
+                        locate_stop = FALSE;
+
+                        int32_t error = locate_target - g_servo.tape_position;
+
+                        if ((abs(error) > g_sys.locate_window) && (locate_attempt < LOCATE_MAX_RETRY))
+                            QueueTransportLocate(locate_target, locate_attempt + 1);
+                    }
                     break;
 
                 case MODE_PLAY:
@@ -918,7 +930,7 @@ Void TransportControllerTask(UArg a0, UArg a1)
                     }
 
                     /* Set the play mode velocity */
-                    ResetPlayPID();
+                    Servo_ResetPlay();
 
                     /* [3] Now start the capstan servo motor */
                     SetTransportMask(T_SERVO, 0);
@@ -1065,13 +1077,13 @@ void HandleImmediateCommand(CMDMSG *p)
                 {
                     SetTransportMask(0, T_TLIFT);
                     /* IPC notify STC lifters released */
-                    IPCNotify_TransportState(g_servo.mode, 0);
+                    IPCNotify_TransportState(Servo_GetMode(), 0);
                 }
                 else
                 {
                     SetTransportMask(T_TLIFT, 0);
                     /* IPC notify STC lifters engaged */
-                    IPCNotify_TransportState(g_servo.mode, M_LIFTER);
+                    IPCNotify_TransportState(Servo_GetMode(), M_LIFTER);
                 }
             }
             break;
@@ -1082,6 +1094,22 @@ void HandleImmediateCommand(CMDMSG *p)
     }
 }
 
+/*****************************************************************************
+ * IPC Notify - Send the last dynamic braking time to stop to the STC.
+ *****************************************************************************/
+
+void IPCNotify_StopTime(void)
+{
+    IPC_MSG ipc;
+
+    ipc.type     = IPC_TYPE_NOTIFY;
+    ipc.opcode   = OP_NOTIFY_STOP_TIME;
+    ipc.param1.U = g_servo.stop_time;
+    ipc.param2.U = (uint32_t)g_servo.stop_velocity;
+
+    IPC_Notify(&ipc, 0);
+}
+
 /*****************************************************************************
  * IPC Notify - Send transport mode change events to STC.
  *****************************************************************************/
@@ -48,12 +48,17 @@ typedef struct _CMDMSG {
     uint8_t     command;        /* command code   */
     uint8_t     opcode;         /* operation code */
     uint16_t    param1;         /* 16-bit param   */
+    int32_t     param2;         /* 32-bit param   */
 } CMDMSG;
 
 /* Transport Control Command Codes */
 #define CMD_TRANSPORT_MODE		1		/* set the current transport mode */
 #define CMD_STROBE_RECORD		2		/* op=1 punch-in, op=0 punch out */
 #define CMD_TOGGLE_LIFTER		3		/* toggle tape lifter state */
+#define CMD_LOCATE              4       /* locate to tape position param2 */
+
+/* Locate attempts allowed to correct a stop outside the window */
+#define LOCATE_MAX_RETRY        3
 
 /* Transport Controller Function Prototypes */
 
@@ -61,5 +66,6 @@ Void TransportCommandTask(UArg a0, UArg a1);
 void TransportControllerTask(UArg a0, UArg a1);
 
 Bool QueueTransportCommand(uint8_t command, uint8_t opcode, uint16_t param1);
+Bool QueueTransportLocate(int32_t position, uint16_t attempt);
 
 #endif /* DTC1200_TIVATM4C123AE6PMI_TRANSPORTTASK_H_ */
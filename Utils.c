@@ -78,6 +78,7 @@
 #include "DTC1200.h"
 #include "Globals.h"
 #include "IOExpander.h"
+#include "MotorDAC.h"
 #include "Utils.h"
 
 /* External Data Items */
@@ -178,6 +179,8 @@ void FlashLEDError(void)
 
 void InitSysDefaults(SYSPARMS* p)
 {
+    int i, j;
+
     /* default servo parameters */
     p->version                   = MAKEREV(FIRMWARE_VER, FIRMWARE_REV);
     p->build                     = FIRMWARE_BUILD;
@@ -191,8 +194,32 @@ void InitSysDefaults(SYSPARMS* p)
     p->tension_sensor_gain       = 0.25f;	    /* tension sensor arm gain          */
     p->tension_sensor_midscale1  = 2047.0f;     /* tensions sensor ADC 1" mid-scale */
     p->tension_sensor_midscale2  = 2047.0f;     /* tensions sensor ADC 2" mid-scale */
+    p->reel_radius_tc            = 0.250f;      /* radius estimator time constant   */
+    p->reel_offset_tc            = 0.250f;      /* offset estimator time constant   */
+
+    p->tension_filter            = TFILT_OFF;   /* raw tension sensor               */
+    p->tension_lp_freq           = 40.0f;       /* low pass corner frequency (Hz)   */
+    p->tension_notch_q           = 2.0f;        /* reel notch Q                     */
+
+    /* Custom filter sections start out passing the sensor through */
+    for (i=0; i < TFILT_STAGES; i++)
+    {
+        p->tension_coeff[i][0] = 1.0f;
+        for (j=1; j < BIQUAD_COEFFS; j++)
+            p->tension_coeff[i][j] = 0.0f;
+    }
+
+    p->current_scale             = (float)DAC_MAX / (float)ADC_MAX; /* full scale */
+    p->current_offset            = 0.0f;        /* current ADC at zero torque       */
+    p->current_pgain             = 0.200f;      /* current loop P-gain              */
+    p->current_igain             = 0.150f;      /* current loop I-gain              */
+    p->current_limit             = 0;           /* overcurrent limit off            */
 
-    p->debounce                  = DEBOUNCE;    /* button debounce time             */
+    /* DAC calibration tables start out linear */
+    MotorDAC_initCal(p->dac_cal_supply);
+    MotorDAC_initCal(p->dac_cal_takeup);
+
+    p->debounce                  = DEBOUNCE;    /* switch settle time in ms         */
     p->lifter_settle_time        = 600;         /* tape lifter settling delay in ms */
     p->brake_settle_time         = 100;
     p->play_settle_time			 = 800;		    /* play after shuttle settle time   */
@@ -206,6 +233,8 @@ void InitSysDefaults(SYSPARMS* p)
     p->stop_supply_tension       = 360;         /* supply tension level (0-DAC_MAX) */
     p->stop_takeup_tension       = 385;         /* takeup tension level (0-DAC_MAX) */
     p->stop_brake_torque         = 650;    	    /* max dynamic stop brake torque    */
+    p->reel_inertia              = 2.10f;       /* DAC per reel velocity/sec        */
+    p->pack_inertia              = 4.50f;       /* DAC per velocity/sec, x1e-6 r^4  */
 
     p->shuttle_supply_tension    = 360;         /* shuttle supply reel tension      */
     p->shuttle_takeup_tension    = 385;         /* shuttle takeup reel tension      */
@@ -221,6 +250,34 @@ void InitSysDefaults(SYSPARMS* p)
     p->shuttle_servo_igain       = PID_Ki;      /* shuttle mode servo I-gain        */
     p->shuttle_servo_dgain       = PID_Kd;      /* shuttle mode servo D-gain        */
 
+    p->shuttle_accel             = 500.0f;      /* shuttle profile accel limit      */
+    p->shuttle_jerk              = 1600.0f;     /* shuttle profile jerk limit       */
+
+    /* Gain schedule breakpoints, supply reel near empty, half and near
+     * full. Each table entry starts out at the fixed shuttle gains.
+     */
+    p->sched_ratio[0]            = 0.500f;      /* supply/takeup radius ratio       */
+    p->sched_ratio[1]            = 1.000f;
+    p->sched_ratio[2]            = 2.000f;
+    p->sched_velocity[0]         = 100.0f;      /* shuttle reel velocity            */
+    p->sched_velocity[1]         = 1000.0f;
+
+    for (i=0; i < SCHED_NUM_RATIOS; i++)
+    {
+        for (j=0; j < SCHED_NUM_VELS; j++)
+        {
+            p->sched_pgain[i][j] = PID_Kp;
+            p->sched_igain[i][j] = PID_Ki;
+            p->sched_dgain[i][j] = PID_Kd;
+        }
+    }
+
+    p->locate_velocity           = 1000;        /* max locate shuttle velocity      */
+    p->locate_approach_velocity  = 100;         /* final approach velocity          */
+    p->locate_approach_dist      = 80;          /* final approach 10 inches         */
+    p->locate_window             = 4;           /* locate done within 1/2 inch      */
+    p->locate_decel              = 500.0f;     /* decel in tach edges/sec^2        */
+
     p->play_lo_takeup_tension    = 375;         /* takeup tension level             */
     p->play_lo_supply_tension    = 350;         /* supply tension level             */
     p->play_lo_boost_pgain       = 1.350f;      /* P-gain */
@@ -233,6 +290,8 @@ void InitSysDefaults(SYSPARMS* p)
     p->play_hi_boost_igain       = 0.250f;      /* I-gain */
     p->play_hi_boost_end         = 115;         /* target play velocity */
 
+    p->play_accel_time           = 0.100f;      /* capstan spin up time const (sec) */
+
     /* If running 1" tape width headstack, overwrite any members
      * that require different default values for 1" tape transport.
      */
@@ -240,6 +299,8 @@ void InitSysDefaults(SYSPARMS* p)
     if (g_tape_width == 1)
     {
         p->stop_brake_torque         = 600;		/* max dynamic stop brake torque   */
+        p->reel_inertia              = 1.40f;   /* DAC per reel velocity/sec       */
+        p->pack_inertia              = 2.25f;   /* DAC per velocity/sec, x1e-6 r^4 */
 
         p->stop_supply_tension       = 180;     /* supply tension level (0-DAC_MAX) */
         p->shuttle_supply_tension    = 180;     /* shuttle supply reel tension      */
@@ -348,8 +409,8 @@ int32_t SysParamsRead(SYSPARMS* sp)
         return -1;
     }
 
-    if (sp->debounce  > DEBOUNCE)
-        sp->debounce = DEBOUNCE;
+    if (sp->debounce  > DEBOUNCE_MAX)
+        sp->debounce = DEBOUNCE_MAX;
 
     System_printf("System Parameters Loaded (size=%d)\n", sizeof(SYSPARMS));
     System_flush();
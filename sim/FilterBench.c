@@ -0,0 +1,368 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Host response test and benchmark for the biquad filter sections in
+ * Biquad.c used on the tension sensor.
+ *
+ * The response test runs sine waves through the low pass and notch designs
+ * at the servo sample rate and checks the steady state gain at DC, at the
+ * design frequency and away from it. A notch is then retuned the way the
+ * servo loop tracks a reel, to a once-around sweeping from 1 to 20 Hz, and
+ * the ripple left over is checked. The reset test checks a section starts
+ * settled on a constant input, and the stability test that a custom table
+ * outside the biquad stability triangle is refused.
+ *
+ * The benchmark times a servo tick of each tension filter preset. Host
+ * timings only compare the presets relative to each other, on the target
+ * the cost shows up in the adc stage of the servo loop profile.
+ *
+ * ============================================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+
+#include "Biquad.h"
+
+#define FS                  500.0f      /* servo loop sample rate (Hz)   */
+#define TWO_PI_F            6.2831853f
+#define NOTCH_Q             2.0f        /* tension_notch_q default       */
+#define LOWPASS_FC          40.0f       /* tension_lp_freq default       */
+#define RETUNE              0.02f       /* TFILT_RETUNE in ServoTask.c   */
+#define SETTLE_SAMPLES      5000
+#define MEASURE_SAMPLES     5000
+#define SWEEP_SAMPLES       5000        /* 10 seconds at 500 Hz          */
+#define BENCH_SAMPLES       4096
+#define BENCH_PASSES        2000
+
+#define NUM_SECTIONS        3           /* low pass, supply, takeup      */
+
+static float s_tsense[BENCH_SAMPLES];
+static float s_freq_s[BENCH_SAMPLES];
+static float s_freq_t[BENCH_SAMPLES];
+
+static volatile float s_sink_f;
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+static uint32_t s_rand = 0x1200;
+
+static float Noise(void)
+{
+    s_rand = (s_rand * 1664525u) + 1013904223u;
+
+    return ((float)(s_rand >> 8) * (1.0f / 16777216.0f)) - 0.5f;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e-9);
+}
+
+/* Steady state gain of a section at freq, a zero frequency is DC */
+
+static float Gain(BIQUAD* bq, float freq)
+{
+    size_t i;
+    double in2 = 0.0;
+    double out2 = 0.0;
+
+    bq->z1 = bq->z2 = 0.0f;
+
+    for (i=0; i < (SETTLE_SAMPLES + MEASURE_SAMPLES); i++)
+    {
+        float x = (freq > 0.0f) ? sinf((TWO_PI_F * freq * (float)i) / FS) : 1.0f;
+        float y = biquad_calc(bq, x);
+
+        if (i >= SETTLE_SAMPLES)
+        {
+            in2  += (double)x * (double)x;
+            out2 += (double)y * (double)y;
+        }
+    }
+
+    return (float)sqrt(out2 / in2);
+}
+
+static bool Check(const char* name, float value, float lo, float hi)
+{
+    bool pass = ((value >= lo) && (value <= hi)) ? true : false;
+
+    printf("  %-26s %8.5f  (%.4f to %.4f)  %s\n", name, value, lo, hi,
+           pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/* Move a notch to a reel rotation rate like TensionNotchTrack() does */
+
+static void Track(BIQUAD* bq, float freq)
+{
+    if (bq->bypass || (fabsf(freq - bq->freq) > (bq->freq * RETUNE)))
+        biquad_notch(bq, freq, NOTCH_Q, FS);
+}
+
+/*****************************************************************************
+ * Response tests
+ *****************************************************************************/
+
+static int TestResponse(void)
+{
+    BIQUAD bq;
+    int failures = 0;
+
+    biquad_init(&bq);
+    biquad_lowpass(&bq, LOWPASS_FC, BIQUAD_Q_BUTTERWORTH, FS);
+
+    failures += !Check("low pass gain at DC", Gain(&bq, 0.0f), 0.999f, 1.001f);
+    failures += !Check("low pass gain at corner", Gain(&bq, LOWPASS_FC), 0.690f, 0.725f);
+    failures += !Check("low pass gain at 150 Hz", Gain(&bq, 150.0f), 0.0f, 0.10f);
+
+    biquad_init(&bq);
+    biquad_notch(&bq, 5.0f, NOTCH_Q, FS);
+
+    failures += !Check("notch gain at DC", Gain(&bq, 0.0f), 0.999f, 1.001f);
+    failures += !Check("notch gain at 5 Hz", Gain(&bq, 5.0f), 0.0f, 0.01f);
+    failures += !Check("notch gain at 50 Hz", Gain(&bq, 50.0f), 0.98f, 1.001f);
+
+    biquad_init(&bq);
+    biquad_notch(&bq, 300.0f, NOTCH_Q, FS);
+
+    failures += !Check("notch over Nyquist bypass", (float)bq.bypass, 1.0f, 1.0f);
+
+    return failures;
+}
+
+/*****************************************************************************
+ * Track a once-around sweeping from 1 to 20 Hz over ten seconds with the
+ * notch retuned on a RETUNE change, and compare the ripple left over in
+ * the second half of the sweep to the ripple in.
+ *****************************************************************************/
+
+static int TestTracking(void)
+{
+    BIQUAD bq;
+    size_t i;
+    double phase = 0.0;
+    double in2 = 0.0;
+    double out2 = 0.0;
+    uint32_t retunes = 0;
+
+    biquad_init(&bq);
+
+    for (i=0; i < SWEEP_SAMPLES; i++)
+    {
+        float freq = 1.0f + ((19.0f * (float)i) / (float)SWEEP_SAMPLES);
+        float last = bq.freq;
+
+        Track(&bq, freq);
+
+        if (bq.freq != last)
+            ++retunes;
+
+        phase += ((double)TWO_PI_F * (double)freq) / (double)FS;
+
+        if (i == 0)
+            biquad_reset(&bq, 10.0f);
+
+        float ripple = (float)sin(phase);
+        float y = biquad_calc(&bq, 10.0f + ripple) - 10.0f;
+
+        if (i >= (SWEEP_SAMPLES / 2))
+        {
+            in2  += (double)ripple * (double)ripple;
+            out2 += (double)y * (double)y;
+        }
+    }
+
+    printf("  %-26s %8u\n", "notch retunes", retunes);
+
+    /* A RETUNE step off the notch leaves about 2 * Q * RETUNE */
+    return !Check("tracked ripple left", (float)sqrt(out2 / in2), 0.0f, 2.0f * NOTCH_Q * RETUNE);
+}
+
+/*****************************************************************************
+ * A section reset on a constant input starts out settled.
+ *****************************************************************************/
+
+static int TestReset(void)
+{
+    BIQUAD bq[NUM_SECTIONS];
+    static const float pass[BIQUAD_COEFFS] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    size_t i;
+    float err = 0.0f;
+    int failures = 0;
+
+    biquad_lowpass(&bq[0], LOWPASS_FC, BIQUAD_Q_BUTTERWORTH, FS);
+    biquad_notch(&bq[1], 2.0f, NOTCH_Q, FS);
+    biquad_notch(&bq[2], 3.0f, NOTCH_Q, FS);
+
+    for (i=0; i < NUM_SECTIONS; i++)
+        biquad_reset(&bq[i], 25.0f);
+
+    for (i=0; i < 1000; i++)
+    {
+        float y = biquad_cascade(bq, NUM_SECTIONS, 25.0f);
+
+        if (fabsf(y - 25.0f) > err)
+            err = fabsf(y - 25.0f);
+    }
+
+    failures += !Check("reset max step", err, 0.0f, 0.001f);
+
+    biquad_coeffs(&bq[0], pass);
+
+    failures += !Check("pass through table bypass", (float)bq[0].bypass, 1.0f, 1.0f);
+
+    return failures;
+}
+
+/*****************************************************************************
+ * A custom table with poles on or outside the unit circle is refused and
+ * the section bypassed, a stable one is loaded.
+ *****************************************************************************/
+
+static int TestStability(void)
+{
+    static const float tables[][BIQUAD_COEFFS] = {
+        { 0.2f, 0.4f, 0.2f, -0.50f, 0.30f },    /* stable              */
+        { 1.0f, 0.0f, 0.0f, -1.99f, 0.995f },   /* stable, near z = 1  */
+        { 1.0f, 0.0f, 0.0f, -2.00f, 1.05f },    /* |a2| > 1            */
+        { 1.0f, 0.0f, 0.0f,  0.00f, 1.00f },    /* poles on the circle */
+        { 1.0f, 0.0f, 0.0f,  1.90f, 0.80f },    /* |a1| > 1 + a2       */
+        { 1.0f, 0.0f, 0.0f, -1.90f, 0.80f },
+    };
+    static const bool stable[] = { true, true, false, false, false, false };
+    BIQUAD bq;
+    size_t i, n;
+    int failures = 0;
+
+    for (i=0; i < (sizeof(stable) / sizeof(bool)); i++)
+    {
+        char name[32];
+        float y = 0.0f;
+
+        snprintf(name, sizeof(name), "table %u %s", (unsigned)i, stable[i] ? "loaded" : "refused");
+
+        failures += !Check(name, (float)(biquad_coeffs(&bq, tables[i]) == stable[i]), 1.0f, 1.0f);
+
+        /* Either way the step response stays bounded */
+        biquad_reset(&bq, 0.0f);
+
+        for (n=0; n < 1000; n++)
+            y = biquad_calc(&bq, 1.0f);
+
+        failures += !Check("  step response", fabsf(y), 0.0f, 1000.0f);
+    }
+
+    return failures;
+}
+
+/*****************************************************************************
+ * Time a servo tick of each preset. The once-around of each reel sweeps
+ * slowly as the packs change, the worst case retunes both notches every
+ * tick.
+ *****************************************************************************/
+
+static void Benchmark(void)
+{
+    BIQUAD bq[NUM_SECTIONS];
+    size_t i, n, p;
+    double t0, t1;
+    double calls = (double)BENCH_SAMPLES * (double)BENCH_PASSES;
+
+    static const char* names[] = {
+        "low pass", "reel notches", "low pass + notches", "notches retuned/tick"
+    };
+
+    for (i=0; i < BENCH_SAMPLES; i++)
+    {
+        s_freq_s[i] = 2.0f + ((float)i * (4.0f / (float)BENCH_SAMPLES));
+        s_freq_t[i] = 6.0f - ((float)i * (4.0f / (float)BENCH_SAMPLES));
+        s_tsense[i] = (Noise() * 8.0f) + sinf((TWO_PI_F * 3.0f * (float)i) / FS);
+    }
+
+    for (p=0; p < 4; p++)
+    {
+        for (i=0; i < NUM_SECTIONS; i++)
+            biquad_init(&bq[i]);
+
+        if (p != 1)
+            biquad_lowpass(&bq[0], LOWPASS_FC, BIQUAD_Q_BUTTERWORTH, FS);
+
+        t0 = Seconds();
+
+        for (n=0; n < BENCH_PASSES; n++)
+        {
+            for (i=0; i < BENCH_SAMPLES; i++)
+            {
+                if (p == 3)
+                {
+                    biquad_notch(&bq[1], s_freq_s[i], NOTCH_Q, FS);
+                    biquad_notch(&bq[2], s_freq_t[i], NOTCH_Q, FS);
+                }
+                else if (p != 0)
+                {
+                    Track(&bq[1], s_freq_s[i]);
+                    Track(&bq[2], s_freq_t[i]);
+                }
+
+                s_sink_f = biquad_cascade(bq, NUM_SECTIONS, s_tsense[i]);
+            }
+        }
+
+        t1 = Seconds();
+
+        printf("  %-22s %6.2f ns/tick\n", names[p], ((t1 - t0) * 1.0e9) / calls);
+    }
+}
+
+/*****************************************************************************
+ * Main entry point. Returns non-zero if any response test fails.
+ *****************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    int failures = 0;
+    bool bench = true;
+
+    if ((argc > 1) && (strcmp(argv[1], "-t") == 0))
+        bench = false;
+
+    printf("Tension filter response at %.0f Hz\n", FS);
+
+    failures += TestResponse();
+    failures += TestTracking();
+    failures += TestReset();
+    failures += TestStability();
+
+    if (bench)
+    {
+        printf("\nTension filter benchmark, %u ticks each\n",
+               BENCH_SAMPLES * BENCH_PASSES);
+
+        Benchmark();
+    }
+
+    return failures ? 1 : 0;
+}
+
+/* End-Of-File */
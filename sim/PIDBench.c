@@ -0,0 +1,489 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Host equivalence test and benchmark for the floating point (fpid) and
+ * fixed point (qpid) PID engines in PID.c, and response tests for the
+ * improved floating point (ipid) engine.
+ *
+ * The equivalence test runs each servo PID gain set in a closed loop with a
+ * simple first order reel velocity model driven by the float engine, feeds
+ * the identical setpoint and measurement sequence to the fixed point engine
+ * and checks the CV outputs agree to within PID_EQUIV_TOL DAC counts. The
+ * scheduled test does the same while stepping through all the gain sets
+ * with fpid_gains() and qpid_gains() on the running engines.
+ *
+ * The ipid tests check that a setpoint step doesn't kick the output
+ * through the derivative, that the derivative of a measurement step
+ * follows the first order filter, that ipid_gains() moves the filter and
+ * tracking times with the gains. The windup recovery of both float
+ * engines after holding the output in saturation is printed for each gain
+ * set but not checked. These gains were tuned against the fpid integral
+ * clamp and the ipid, with its integral term over the full CV range,
+ * recovers with more overshoot than the fpid on every set.
+ *
+ * The benchmark times the engines over the same recorded sequence. Host
+ * timings only compare the engines relative to each other, the target
+ * Cortex-M4F has a single precision FPU so the ratio there will differ.
+ *
+ * ============================================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+
+#include "DTC1200_TivaTM4C123AE6PMI.h"
+#include "PID.h"
+
+#define PID_EQUIV_TOL       0.05f       /* max CV difference (DAC counts) */
+#define IPID_DFILT_TOL      1.0e-3f     /* D filter response rel error    */
+#define WINDUP_STEPS        1000        /* 2 seconds held in saturation   */
+#define WINDUP_SETPOINT     1500.0f     /* beyond the plant at CV max     */
+#define RECOVER_SETPOINT    150.0f      /* within the integral term reach */
+#define RECOVER_BAND        20.0f       /* settled within +/- counts      */
+#define TEST_STEPS          200000      /* 400 seconds at 500 Hz          */
+#define BENCH_SAMPLES       4096
+#define BENCH_PASSES        2000
+
+typedef struct _GAINSET {
+    const char* name;
+    float       Kp;
+    float       Ki;
+    float       Kd;
+    float       tolerance;
+} GAINSET;
+
+/* Default shuttle and play boost gains from InitSysDefaults() */
+static const GAINSET s_gains[] = {
+    { "shuttle",    PID_Kp, PID_Ki, PID_Kd, PID_TOLERANCE_F },
+    { "play lo 2\"", 1.350f, 0.300f, 0.0f,   1.0f },
+    { "play hi 2\"", 1.350f, 0.250f, 0.0f,   1.0f },
+    { "play lo 1\"", 1.400f, 0.250f, 0.0f,   1.0f },
+    { "play hi 1\"", 1.800f, 0.200f, 0.0f,   1.0f },
+};
+
+#define NUM_GAINS   (sizeof(s_gains) / sizeof(GAINSET))
+
+/* Setpoint schedule, velocity counts per sample, changed every 2 seconds */
+static const float s_setpoints[] = { 0.0f, 400.0f, 120.0f, 800.0f, 300.0f, 1000.0f, 60.0f };
+
+#define NUM_SETPOINTS   (sizeof(s_setpoints) / sizeof(float))
+
+static float s_sp[TEST_STEPS];
+static float s_pv[TEST_STEPS];
+
+static volatile float s_sink_f;
+static volatile int32_t s_sink_q;
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+static uint32_t s_rand = 0x1200;
+
+static float Noise(void)
+{
+    s_rand = (s_rand * 1664525u) + 1013904223u;
+
+    return ((float)(s_rand >> 8) * (1.0f / 16777216.0f)) - 0.5f;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e-9);
+}
+
+/*****************************************************************************
+ * Closed loop equivalence test for one gain set. The reel velocity responds
+ * to the CV with a first order lag and the measurement carries quantization
+ * noise like the QEI velocity counts.
+ *****************************************************************************/
+
+static bool TestGainSet(const GAINSET* g)
+{
+    FPID fpid;
+    QPID qpid;
+    size_t i;
+    float v = 0.0f;
+    float maxdiff = 0.0f;
+    size_t maxstep = 0;
+    uint32_t clamped = 0;
+
+    fpid_init(&fpid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+    qpid_init(&qpid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+
+    for (i=0; i < TEST_STEPS; i++)
+    {
+        float sp = s_setpoints[(i / 1000) % NUM_SETPOINTS];
+        float pv = floorf(v + (Noise() * 4.0f));
+
+        s_sp[i] = sp;
+        s_pv[i] = pv;
+
+        float cvf = fpid_calc(&fpid, sp, pv);
+        float cvq = qpid_calcf(&qpid, sp, pv);
+
+        float diff = fabsf(cvf - cvq);
+
+        if (diff > maxdiff)
+        {
+            maxdiff = diff;
+            maxstep = i;
+        }
+
+        if ((cvf >= PID_CV_MAX_F) || (cvf <= PID_CV_MIN_F))
+            ++clamped;
+
+        /* Velocity follows the float CV with a ~100ms time constant */
+        v += ((cvf * 1.2f) - v) * 0.02f;
+
+        if (v < 0.0f)
+            v = 0.0f;
+    }
+
+    bool pass = (maxdiff <= PID_EQUIV_TOL) ? true : false;
+
+    printf("  %-12s max |cv diff| %.5f at step %-7zu clamped %5.1f%%  %s\n",
+           g->name, maxdiff, maxstep, (100.0f * (float)clamped) / (float)TEST_STEPS,
+           pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/*****************************************************************************
+ * Closed loop equivalence test with the gains changed on the fly. Each
+ * setpoint change moves on to the next gain set, like the shuttle gain
+ * schedule does as the reel packs and velocity change.
+ *****************************************************************************/
+
+static bool TestSchedule(void)
+{
+    FPID fpid;
+    QPID qpid;
+    size_t i;
+    size_t set = 0;
+    float v = 0.0f;
+    float maxdiff = 0.0f;
+    size_t maxstep = 0;
+
+    fpid_init(&fpid, s_gains[0].Kp, s_gains[0].Ki, s_gains[0].Kd, PID_CV_MAX_F, PID_CV_MIN_F, s_gains[0].tolerance);
+    qpid_init(&qpid, s_gains[0].Kp, s_gains[0].Ki, s_gains[0].Kd, PID_CV_MAX_F, PID_CV_MIN_F, s_gains[0].tolerance);
+
+    for (i=0; i < TEST_STEPS; i++)
+    {
+        float sp = s_setpoints[(i / 1000) % NUM_SETPOINTS];
+        float pv = floorf(v + (Noise() * 4.0f));
+
+        if (i && ((i % 1000) == 0))
+        {
+            const GAINSET* g = &s_gains[++set % NUM_GAINS];
+
+            fpid_gains(&fpid, g->Kp, g->Ki, g->Kd);
+            qpid_gains(&qpid, g->Kp, g->Ki, g->Kd);
+        }
+
+        float cvf = fpid_calc(&fpid, sp, pv);
+        float cvq = qpid_calcf(&qpid, sp, pv);
+
+        float diff = fabsf(cvf - cvq);
+
+        if (diff > maxdiff)
+        {
+            maxdiff = diff;
+            maxstep = i;
+        }
+
+        v += ((cvf * 1.2f) - v) * 0.02f;
+
+        if (v < 0.0f)
+            v = 0.0f;
+    }
+
+    bool pass = (maxdiff <= PID_EQUIV_TOL) ? true : false;
+
+    printf("  %-12s max |cv diff| %.5f at step %-7zu %s\n",
+           "scheduled", maxdiff, maxstep, pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/*****************************************************************************
+ * A setpoint step with the measurement held must only move the ipid output
+ * by the proportional and integral terms, the derivative acts on the
+ * measurement alone.
+ *****************************************************************************/
+
+static bool TestIpidKick(const GAINSET* g)
+{
+    IPID ipid;
+    size_t i;
+    float cv0, cv1, step;
+    float pv = 300.0f;
+    float sp = 300.0f;
+    float expect;
+
+    ipid_init(&ipid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+
+    for (i=0; i < 100; i++)
+        cv0 = ipid_calc(&ipid, sp, pv);
+
+    sp += 100.0f;
+    cv1 = ipid_calc(&ipid, sp, pv);
+
+    step = cv1 - cv0;
+    expect = (g->Kp + g->Ki) * 100.0f;
+
+    bool pass = (fabsf(step - expect) <= (expect * 1.0e-4f)) ? true : false;
+
+    printf("  %-12s setpoint step cv %+8.3f, P+I %+8.3f  %s\n",
+           "no D kick", step, expect, pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/*****************************************************************************
+ * The derivative of a measurement step decays with the filter time
+ * constant from a peak of Kd/(Tf+Ts) times the step, with no P or I.
+ *****************************************************************************/
+
+static bool TestIpidFilter(void)
+{
+    IPID ipid;
+    size_t i;
+    float Ts = PID_SAMPLE_TIME_F;
+    float Tf = 0.010f;
+    float Kd = 1.0f;
+    float err;
+    float maxerr = 0.0f;
+
+    ipid_init(&ipid, 0.0f, 0.0f, Kd, PID_CV_MAX_F, PID_CV_MIN_F, 1.0f);
+    ipid_setup(&ipid, Ts, Tf, 0.0f);
+
+    ipid_calc(&ipid, 0.0f, 0.0f);
+
+    for (i=0; i < 50; i++)
+    {
+        /* Kd per sample is Kd*Ts continuous, the filter pole Tf/(Tf+Ts) */
+        float expect = -((Kd * Ts) / (Tf + Ts)) * 100.0f * powf(Tf / (Tf + Ts), (float)i);
+        float cv = ipid_calc(&ipid, 0.0f, 100.0f);
+
+        err = fabsf(cv - expect) / fabsf(expect);
+
+        if (err > maxerr)
+            maxerr = err;
+    }
+
+    bool pass = (maxerr <= IPID_DFILT_TOL) ? true : false;
+
+    printf("  %-12s measurement step, max rel error %.6f  %s\n",
+           "filtered D", maxerr, pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/*****************************************************************************
+ * Changing the gains on a running ipid moves the derivative filter and
+ * tracking times to the defaults for the new gains, as if the PID had
+ * been initialized with them.
+ *****************************************************************************/
+
+static bool TestIpidGains(void)
+{
+    IPID run, ref;
+    size_t i;
+    bool pass = true;
+
+    ipid_init(&run, s_gains[0].Kp, s_gains[0].Ki, s_gains[0].Kd, PID_CV_MAX_F, PID_CV_MIN_F, 1.0f);
+
+    for (i=0; i < 8; i++)
+    {
+        float Kp = s_gains[0].Kp * (1.0f + (0.25f * (float)i));
+        float Ki = s_gains[0].Ki * (1.0f + (0.50f * (float)i));
+        float Kd = s_gains[0].Kd * (1.0f + (1.00f * (float)i));
+
+        ipid_gains(&run, Kp, Ki, Kd);
+        ipid_init(&ref, Kp, Ki, Kd, PID_CV_MAX_F, PID_CV_MIN_F, 1.0f);
+
+        if ((run.Tf != ref.Tf) || (run.Tt != ref.Tt) || (run.ad != ref.ad) ||
+            (run.bd != ref.bd) || (run.bt != ref.bt) || (run.iMax != ref.iMax))
+        {
+            pass = false;
+        }
+    }
+
+    printf("  %-12s Tf %.6f Tt %.6f after the last change  %s\n",
+           "gains", run.Tf, run.Tt, pass ? "PASS" : "FAIL");
+
+    return pass;
+}
+
+/*****************************************************************************
+ * Hold the output in saturation with a setpoint the reel can't reach, then
+ * step down to one the integral term alone can hold. Returns the overshoot
+ * below the new setpoint and the steps until it stays within RECOVER_BAND.
+ *****************************************************************************/
+
+static void WindupRun(void* pid, bool ipid, float* overshoot, size_t* settle)
+{
+    size_t i;
+    float v = 0.0f;
+    float cv;
+
+    *overshoot = 0.0f;
+    *settle = 0;
+
+    for (i=0; i < (WINDUP_STEPS * 3); i++)
+    {
+        float sp = (i < WINDUP_STEPS) ? WINDUP_SETPOINT : RECOVER_SETPOINT;
+        float pv = floorf(v);
+
+        cv = ipid ? ipid_calc((IPID*)pid, sp, pv) : fpid_calc((FPID*)pid, sp, pv);
+
+        v += ((cv * 1.2f) - v) * 0.02f;
+
+        if (v < 0.0f)
+            v = 0.0f;
+
+        if (i < WINDUP_STEPS)
+            continue;
+
+        if ((RECOVER_SETPOINT - v) > *overshoot)
+            *overshoot = RECOVER_SETPOINT - v;
+
+        if (fabsf(v - RECOVER_SETPOINT) > RECOVER_BAND)
+            *settle = i - WINDUP_STEPS + 1;
+    }
+}
+
+static void ReportIpidWindup(const GAINSET* g)
+{
+    FPID fpid;
+    IPID ipid;
+    float os_f, os_i;
+    size_t st_f, st_i;
+
+    fpid_init(&fpid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+    ipid_init(&ipid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+
+    WindupRun(&fpid, false, &os_f, &st_f);
+    WindupRun(&ipid, true, &os_i, &st_i);
+
+    printf("  %-12s windup recovery, overshoot fpid %6.1f ipid %6.1f, settle fpid %4zu ipid %4zu\n",
+           g->name, os_f, os_i, st_f, st_i);
+}
+
+/*****************************************************************************
+ * Time each engine over the first BENCH_SAMPLES of the recorded sequence.
+ *****************************************************************************/
+
+static void Benchmark(const GAINSET* g)
+{
+    static int32_t sp_q[BENCH_SAMPLES];
+    static int32_t pv_q[BENCH_SAMPLES];
+    FPID fpid;
+    QPID qpid;
+    size_t i, n;
+    double t0, t1, t2, t3;
+    double calls = (double)BENCH_SAMPLES * (double)BENCH_PASSES;
+
+    for (i=0; i < BENCH_SAMPLES; i++)
+    {
+        sp_q[i] = PID_F_TO_Q15(s_sp[i]);
+        pv_q[i] = PID_F_TO_Q15(s_pv[i]);
+    }
+
+    fpid_init(&fpid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+    qpid_init(&qpid, g->Kp, g->Ki, g->Kd, PID_CV_MAX_F, PID_CV_MIN_F, g->tolerance);
+
+    t0 = Seconds();
+
+    for (n=0; n < BENCH_PASSES; n++)
+        for (i=0; i < BENCH_SAMPLES; i++)
+            s_sink_f = fpid_calc(&fpid, s_sp[i], s_pv[i]);
+
+    t1 = Seconds();
+
+    for (n=0; n < BENCH_PASSES; n++)
+        for (i=0; i < BENCH_SAMPLES; i++)
+            s_sink_q = qpid_calc(&qpid, sp_q[i], pv_q[i]);
+
+    t2 = Seconds();
+
+    for (n=0; n < BENCH_PASSES; n++)
+        for (i=0; i < BENCH_SAMPLES; i++)
+            s_sink_f = qpid_calcf(&qpid, s_sp[i], s_pv[i]);
+
+    t3 = Seconds();
+
+    printf("  fpid_calc  %6.2f ns/call\n", ((t1 - t0) * 1.0e9) / calls);
+    printf("  qpid_calc  %6.2f ns/call (Q15 in/out)\n", ((t2 - t1) * 1.0e9) / calls);
+    printf("  qpid_calcf %6.2f ns/call (float in/out)\n", ((t3 - t2) * 1.0e9) / calls);
+}
+
+/*****************************************************************************
+ * Main entry point. Returns non-zero if any gain set fails equivalence.
+ *****************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    size_t i;
+    int failures = 0;
+    bool bench = true;
+
+    if ((argc > 1) && (strcmp(argv[1], "-t") == 0))
+        bench = false;
+
+    printf("PID engine equivalence, fpid vs qpid over %u steps (tolerance %.2f)\n",
+           TEST_STEPS, PID_EQUIV_TOL);
+
+    for (i=0; i < NUM_GAINS; i++)
+    {
+        if (!TestGainSet(&s_gains[i]))
+            ++failures;
+    }
+
+    if (!TestSchedule())
+        ++failures;
+
+    printf("\nImproved PID engine (ipid) response\n");
+
+    if (!TestIpidKick(&s_gains[0]))
+        ++failures;
+
+    if (!TestIpidFilter())
+        ++failures;
+
+    if (!TestIpidGains())
+        ++failures;
+
+    for (i=0; i < NUM_GAINS; i++)
+        ReportIpidWindup(&s_gains[i]);
+
+    /* Benchmark on the last recorded closed loop sequence */
+    if (bench)
+    {
+        printf("\nPID engine benchmark, %s gains, %u calls each\n",
+               s_gains[0].name, BENCH_SAMPLES * BENCH_PASSES);
+
+        Benchmark(&s_gains[0]);
+    }
+
+    return failures ? 1 : 0;
+}
+
+/* End-Of-File */
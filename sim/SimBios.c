@@ -0,0 +1,579 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Minimal cooperative SYS/BIOS kernel for the host simulator. Each BIOS task
+ * runs on its own ucontext stack and all time is virtual; one Clock tick is
+ * one millisecond just as in the firmware configuration. Tasks run in
+ * priority order until they block, so a whole servo tick executes in zero
+ * simulated time and the plant model advances between ticks.
+ *
+ * ============================================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "SimBios.h"
+#include "SimKernel.h"
+
+#define SIM_MAX_TASKS       16
+#define SIM_MAX_CLOCKS      8
+#define SIM_STACK_SIZE      (256 * 1024)
+
+#define TASK_READY          0
+#define TASK_BLOCKED        1
+#define TASK_TERMINATED     2
+
+typedef struct SimTask {
+    ucontext_t      ctx;
+    void*           stack;
+    Task_FuncPtr    fxn;
+    UArg            arg0;
+    UArg            arg1;
+    Int             priority;
+    const char*     name;
+    int             state;
+    void*           waitObj;        /* object blocked on, NULL for sleep */
+    uint32_t        wakeTick;       /* tick to wake at, if timed         */
+    bool            timed;          /* true if block has a timeout       */
+    bool            timedOut;       /* set when woken by the timeout     */
+    uint32_t        readySeq;       /* FIFO order among equal priority   */
+} SimTask;
+
+typedef struct SimSemaphore {
+    Int             count;
+    Int             mode;
+} SimSemaphore;
+
+typedef struct SimClock {
+    Clock_FuncPtr   fxn;
+    UArg            arg;
+    UInt32          period;
+    uint32_t        fireTick;       /* tick the clock function runs at   */
+    bool            active;
+} SimClock;
+
+typedef struct SimMailbox {
+    size_t          msgSize;
+    UInt            numMsgs;
+    UInt            head;
+    UInt            count;
+    uint8_t*        buf;
+} SimMailbox;
+
+/*** Static Data Items ******************************************************/
+
+static SimTask      s_tasks[SIM_MAX_TASKS];
+static int          s_numTasks = 0;
+static SimClock     s_clocks[SIM_MAX_CLOCKS];
+static int          s_numClocks = 0;
+static SimTask*     s_current = NULL;
+static ucontext_t   s_schedCtx;
+static uint32_t     s_ticks = 0;
+static uint32_t     s_readySeq = 0;
+static int          s_verbose = 0;
+
+/*****************************************************************************
+ * Kernel control interface used by the simulator main loop
+ *****************************************************************************/
+
+void SimKernel_setVerbose(int level)
+{
+    s_verbose = level;
+}
+
+uint32_t SimKernel_getTicks(void)
+{
+    return s_ticks;
+}
+
+/* Wake any task whose sleep or pend timeout has expired and run every
+ * ready task, highest priority first, until all are blocked again.
+ */
+
+void SimKernel_schedule(void)
+{
+    int i;
+
+    for (i=0; i < s_numTasks; i++)
+    {
+        SimTask* t = &s_tasks[i];
+
+        if ((t->state == TASK_BLOCKED) && t->timed && ((int32_t)(s_ticks - t->wakeTick) >= 0))
+        {
+            t->state    = TASK_READY;
+            t->timedOut = (t->waitObj != NULL);
+            t->readySeq = s_readySeq++;
+        }
+    }
+
+    for (;;)
+    {
+        SimTask* next = NULL;
+
+        for (i=0; i < s_numTasks; i++)
+        {
+            SimTask* t = &s_tasks[i];
+
+            if (t->state != TASK_READY)
+                continue;
+
+            if (!next || (t->priority > next->priority) ||
+                ((t->priority == next->priority) && (t->readySeq < next->readySeq)))
+                next = t;
+        }
+
+        if (!next)
+            break;
+
+        s_current = next;
+        swapcontext(&s_schedCtx, &next->ctx);
+        s_current = NULL;
+    }
+}
+
+/* Advance the system tick and run any clock functions that are due.
+ * Clock functions run outside of any task, like a SWI on the target.
+ */
+
+void SimKernel_tick(void)
+{
+    int i;
+
+    ++s_ticks;
+
+    for (i=0; i < s_numClocks; i++)
+    {
+        SimClock* c = &s_clocks[i];
+
+        if (!c->active || ((int32_t)(s_ticks - c->fireTick) < 0))
+            continue;
+
+        if (c->period)
+            c->fireTick += c->period;
+        else
+            c->active = false;
+
+        c->fxn(c->arg);
+    }
+}
+
+/*****************************************************************************
+ * Internal blocking helpers
+ *****************************************************************************/
+
+/* Block the current task on an object (or just sleep if obj is NULL).
+ * Returns false if the wait ended because the timeout expired.
+ */
+
+static bool BlockCurrent(void* obj, UInt32 timeout)
+{
+    SimTask* self = s_current;
+
+    self->state    = TASK_BLOCKED;
+    self->waitObj  = obj;
+    self->timed    = (timeout != BIOS_WAIT_FOREVER);
+    self->wakeTick = s_ticks + timeout;
+    self->timedOut = false;
+
+    swapcontext(&self->ctx, &s_schedCtx);
+
+    self->waitObj = NULL;
+
+    return !self->timedOut;
+}
+
+/* Ready every task pending on an object. Each one re-checks its
+ * condition when it runs, higher priority tasks get there first.
+ */
+
+static void WakeWaiters(void* obj)
+{
+    int i;
+
+    for (i=0; i < s_numTasks; i++)
+    {
+        SimTask* t = &s_tasks[i];
+
+        if ((t->state == TASK_BLOCKED) && (t->waitObj == obj))
+        {
+            t->state    = TASK_READY;
+            t->timedOut = false;
+            t->readySeq = s_readySeq++;
+        }
+    }
+}
+
+/* Common wait loop. Returns false on timeout or if the caller is not a
+ * task (the simulator main loop can never block).
+ */
+
+static bool WaitFor(void* obj, UInt32 timeout, bool (*ready)(void*))
+{
+    uint32_t deadline = s_ticks + timeout;
+
+    while (!ready(obj))
+    {
+        if ((timeout == BIOS_NO_WAIT) || (s_current == NULL))
+            return false;
+
+        if (timeout == BIOS_WAIT_FOREVER)
+        {
+            BlockCurrent(obj, BIOS_WAIT_FOREVER);
+        }
+        else
+        {
+            if ((int32_t)(deadline - s_ticks) <= 0)
+                return false;
+
+            if (!BlockCurrent(obj, deadline - s_ticks))
+                return ready(obj);
+        }
+    }
+
+    return true;
+}
+
+/*****************************************************************************
+ * xdc/runtime/System
+ *****************************************************************************/
+
+void System_printf(const char* fmt, ...)
+{
+    va_list args;
+
+    if (!s_verbose)
+        return;
+
+    va_start(args, fmt);
+    fprintf(stderr, "[%8u] ", s_ticks);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void System_flush(void)
+{
+    fflush(stderr);
+}
+
+void System_abort(const char* str)
+{
+    fprintf(stderr, "System_abort: %s\n", str);
+    exit(2);
+}
+
+/*****************************************************************************
+ * ti/sysbios/knl/Task
+ *****************************************************************************/
+
+static void TaskEntry(void)
+{
+    SimTask* self = s_current;
+
+    (*self->fxn)(self->arg0, self->arg1);
+
+    self->state = TASK_TERMINATED;
+
+    swapcontext(&self->ctx, &s_schedCtx);
+}
+
+void Task_Params_init(Task_Params* params)
+{
+    memset(params, 0, sizeof(Task_Params));
+    params->priority  = 1;
+    params->stackSize = SIM_STACK_SIZE;
+}
+
+Task_Handle Task_create(Task_FuncPtr fxn, Task_Params* params, Error_Block* eb)
+{
+    SimTask* t;
+
+    if (s_numTasks >= SIM_MAX_TASKS)
+    {
+        if (eb)
+            eb->code = 1;
+        return NULL;
+    }
+
+    t = &s_tasks[s_numTasks++];
+
+    memset(t, 0, sizeof(SimTask));
+
+    t->fxn      = fxn;
+    t->arg0     = params ? params->arg0 : 0;
+    t->arg1     = params ? params->arg1 : 0;
+    t->priority = params ? params->priority : 1;
+    t->name     = params ? params->instance_name : NULL;
+    t->state    = TASK_READY;
+    t->readySeq = s_readySeq++;
+    t->stack    = malloc(SIM_STACK_SIZE);
+
+    if (!t->stack)
+        System_abort("Task stack allocation failed");
+
+    getcontext(&t->ctx);
+
+    t->ctx.uc_stack.ss_sp   = t->stack;
+    t->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+    t->ctx.uc_link          = NULL;
+
+    makecontext(&t->ctx, TaskEntry, 0);
+
+    return t;
+}
+
+void Task_sleep(UInt32 nticks)
+{
+    if (s_current == NULL)
+        return;
+
+    if (nticks == 0)
+    {
+        Task_yield();
+        return;
+    }
+
+    BlockCurrent(NULL, nticks);
+}
+
+void Task_yield(void)
+{
+    SimTask* self = s_current;
+
+    if (self == NULL)
+        return;
+
+    self->readySeq = s_readySeq++;
+
+    swapcontext(&self->ctx, &s_schedCtx);
+}
+
+/*****************************************************************************
+ * ti/sysbios/knl/Semaphore
+ *****************************************************************************/
+
+static bool SemaphoreReady(void* obj)
+{
+    return ((SimSemaphore*)obj)->count > 0;
+}
+
+void Semaphore_Params_init(Semaphore_Params* params)
+{
+    params->mode = 0;
+}
+
+Semaphore_Handle Semaphore_create(Int count, Semaphore_Params* params, Error_Block* eb)
+{
+    SimSemaphore* sem = calloc(1, sizeof(SimSemaphore));
+
+    if (!sem && eb)
+        eb->code = 1;
+    else if (sem)
+    {
+        sem->count = count;
+        sem->mode  = (params) ? params->mode : Semaphore_Mode_COUNTING;
+    }
+
+    return sem;
+}
+
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout)
+{
+    if (!WaitFor(handle, timeout, SemaphoreReady))
+        return FALSE;
+
+    --handle->count;
+
+    return TRUE;
+}
+
+void Semaphore_post(Semaphore_Handle handle)
+{
+    if ((handle->mode != Semaphore_Mode_BINARY) || (handle->count == 0))
+        ++handle->count;
+
+    WakeWaiters(handle);
+}
+
+/*****************************************************************************
+ * ti/sysbios/knl/Mailbox
+ *****************************************************************************/
+
+static bool MailboxHasMsg(void* obj)
+{
+    return ((SimMailbox*)obj)->count > 0;
+}
+
+static bool MailboxHasRoom(void* obj)
+{
+    SimMailbox* mbx = obj;
+    return mbx->count < mbx->numMsgs;
+}
+
+void Mailbox_Params_init(Mailbox_Params* params)
+{
+    params->reserved = 0;
+}
+
+Mailbox_Handle Mailbox_create(size_t msgSize, UInt numMsgs, Mailbox_Params* params, Error_Block* eb)
+{
+    SimMailbox* mbx = calloc(1, sizeof(SimMailbox));
+
+    if (mbx)
+    {
+        mbx->msgSize = msgSize;
+        mbx->numMsgs = numMsgs;
+        mbx->buf     = calloc(numMsgs, msgSize);
+    }
+
+    if ((!mbx || !mbx->buf) && eb)
+        eb->code = 1;
+
+    return mbx;
+}
+
+Bool Mailbox_pend(Mailbox_Handle handle, Ptr msg, UInt32 timeout)
+{
+    if (!WaitFor(handle, timeout, MailboxHasMsg))
+        return FALSE;
+
+    memcpy(msg, handle->buf + (handle->head * handle->msgSize), handle->msgSize);
+
+    handle->head = (handle->head + 1) % handle->numMsgs;
+    --handle->count;
+
+    WakeWaiters(handle);
+
+    return TRUE;
+}
+
+Bool Mailbox_post(Mailbox_Handle handle, Ptr msg, UInt32 timeout)
+{
+    UInt tail;
+
+    if (!WaitFor(handle, timeout, MailboxHasRoom))
+        return FALSE;
+
+    tail = (handle->head + handle->count) % handle->numMsgs;
+
+    memcpy(handle->buf + (tail * handle->msgSize), msg, handle->msgSize);
+
+    ++handle->count;
+
+    WakeWaiters(handle);
+
+    return TRUE;
+}
+
+/*****************************************************************************
+ * ti/sysbios/knl/Clock
+ *****************************************************************************/
+
+void Clock_Params_init(Clock_Params* params)
+{
+    memset(params, 0, sizeof(Clock_Params));
+}
+
+Clock_Handle Clock_create(Clock_FuncPtr fxn, UInt32 timeout, Clock_Params* params, Error_Block* eb)
+{
+    SimClock* c;
+
+    if (s_numClocks >= SIM_MAX_CLOCKS)
+    {
+        if (eb)
+            eb->code = 1;
+        return NULL;
+    }
+
+    c = &s_clocks[s_numClocks++];
+
+    c->fxn      = fxn;
+    c->arg      = (params) ? params->arg : 0;
+    c->period   = (params) ? params->period : 0;
+    c->fireTick = s_ticks + timeout;
+    c->active   = (params) ? (params->startFlag != 0) : false;
+
+    return c;
+}
+
+UInt32 Clock_getTicks(void)
+{
+    return s_ticks;
+}
+
+/*****************************************************************************
+ * xdc/runtime/Timestamp - counts CPU cycles of simulated time
+ *****************************************************************************/
+
+UInt32 Timestamp_get32(void)
+{
+    return s_ticks * (SIM_TIMESTAMP_FREQ / 1000);
+}
+
+void Timestamp_getFreq(Types_FreqHz* freq)
+{
+    freq->hi = 0;
+    freq->lo = SIM_TIMESTAMP_FREQ;
+}
+
+void BIOS_getCpuFreq(Types_FreqHz* freq)
+{
+    freq->hi = 0;
+    freq->lo = SIM_TIMESTAMP_FREQ;
+}
+
+/*****************************************************************************
+ * inc/hw_types.h HWREG() - simulated register file
+ *****************************************************************************/
+
+#define SIM_NUM_REGS        16
+#define SIM_DWT_CYCCNT      0xE0001004
+
+static uint32_t s_reg_addr[SIM_NUM_REGS];
+static volatile uint32_t s_reg_data[SIM_NUM_REGS];
+static size_t s_reg_count;
+
+volatile uint32_t* SimBios_hwreg(uint32_t addr)
+{
+    size_t i;
+
+    for (i=0; i < s_reg_count; i++)
+    {
+        if (s_reg_addr[i] == addr)
+            break;
+    }
+
+    if (i == s_reg_count)
+    {
+        if (s_reg_count == SIM_NUM_REGS)
+            System_abort("SimBios_hwreg: register file full\n");
+
+        s_reg_addr[s_reg_count++] = addr;
+        s_reg_data[i] = 0;
+    }
+
+    /* Host time in simulated CPU cycles */
+    if (addr == SIM_DWT_CYCCNT)
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        s_reg_data[i] = (uint32_t)((((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec) *
+                                   (SIM_TIMESTAMP_FREQ / 1000000) / 1000);
+    }
+
+    return &s_reg_data[i];
+}
+
+/* End-Of-File */
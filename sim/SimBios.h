@@ -0,0 +1,245 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Host simulator shim for the XDC/SYS-BIOS, TI-RTOS driver and Tivaware
+ * headers used by the servo loop sources. Every stub include path listed in
+ * the simulator Makefile resolves to this one header, so the firmware sources
+ * build unmodified on a Linux host. Only the types, constants and functions
+ * actually referenced by the simulated modules are provided here.
+ *
+ * ============================================================================ */
+
+#ifndef _SIMBIOS_H_
+#define _SIMBIOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/*** XDC Standard Types ****************************************************/
+
+typedef void            Void;
+typedef char            Char;
+typedef int             Int;
+typedef unsigned int    UInt;
+typedef short           Short;
+typedef unsigned short  UShort;
+typedef unsigned short  Bool;
+typedef int8_t          Int8;
+typedef int16_t         Int16;
+typedef int32_t         Int32;
+typedef uint8_t         UInt8;
+typedef uint16_t        UInt16;
+typedef uint32_t        UInt32;
+typedef uintptr_t       UArg;
+typedef void*           Ptr;
+typedef char*           String;
+typedef float           Float;
+typedef double          Double;
+
+#ifndef TRUE
+#define TRUE            1
+#endif
+#ifndef FALSE
+#define FALSE           0
+#endif
+
+/*** xdc/runtime ***********************************************************/
+
+typedef struct Error_Block {
+    int         code;
+} Error_Block;
+
+#define Error_init(eb)          ((eb)->code = 0)
+#define Error_check(eb)         ((eb) != NULL && (eb)->code != 0)
+
+void System_printf(const char* fmt, ...);
+void System_flush(void);
+void System_abort(const char* str);
+
+typedef struct Types_FreqHz {
+    UInt32      hi;
+    UInt32      lo;
+} Types_FreqHz;
+
+#define SIM_TIMESTAMP_FREQ      80000000    /* 80 MHz CPU clock */
+
+UInt32 Timestamp_get32(void);
+void Timestamp_getFreq(Types_FreqHz* freq);
+
+/*** ti/sysbios ************************************************************/
+
+#define BIOS_WAIT_FOREVER       (~(UInt)0)
+#define BIOS_NO_WAIT            ((UInt)0)
+
+void BIOS_getCpuFreq(Types_FreqHz* freq);
+
+typedef struct SimTask*         Task_Handle;
+typedef struct SimSemaphore*    Semaphore_Handle;
+typedef struct SimMailbox*      Mailbox_Handle;
+typedef struct SimEvent*        Event_Handle;
+typedef struct SimQueue*        Queue_Handle;
+
+typedef void (*Task_FuncPtr)(UArg a0, UArg a1);
+
+typedef struct Task_Params {
+    UArg        arg0;
+    UArg        arg1;
+    Int         priority;
+    size_t      stackSize;
+    const char* instance_name;
+} Task_Params;
+
+#define Semaphore_Mode_COUNTING 0
+#define Semaphore_Mode_BINARY   1
+
+typedef struct Semaphore_Params {
+    Int         mode;
+} Semaphore_Params;
+
+typedef struct SimClock*        Clock_Handle;
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct Clock_Params {
+    UInt32      period;
+    Bool        startFlag;
+    UArg        arg;
+} Clock_Params;
+
+typedef struct Mailbox_Params {
+    Int         reserved;
+} Mailbox_Params;
+
+typedef struct Queue_Elem {
+    struct Queue_Elem* next;
+    struct Queue_Elem* prev;
+} Queue_Elem;
+
+void Task_Params_init(Task_Params* params);
+Task_Handle Task_create(Task_FuncPtr fxn, Task_Params* params, Error_Block* eb);
+void Task_sleep(UInt32 nticks);
+void Task_yield(void);
+
+#define Task_disable()              ((UInt)0)
+#define Task_restore(key)           ((void)(key))
+
+void Semaphore_Params_init(Semaphore_Params* params);
+Semaphore_Handle Semaphore_create(Int count, Semaphore_Params* params, Error_Block* eb);
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout);
+void Semaphore_post(Semaphore_Handle handle);
+
+void Mailbox_Params_init(Mailbox_Params* params);
+Mailbox_Handle Mailbox_create(size_t msgSize, UInt numMsgs, Mailbox_Params* params, Error_Block* eb);
+Bool Mailbox_pend(Mailbox_Handle handle, Ptr msg, UInt32 timeout);
+Bool Mailbox_post(Mailbox_Handle handle, Ptr msg, UInt32 timeout);
+
+void Clock_Params_init(Clock_Params* params);
+Clock_Handle Clock_create(Clock_FuncPtr fxn, UInt32 timeout, Clock_Params* params, Error_Block* eb);
+UInt32 Clock_getTicks(void);
+
+/*** ti/sysbios/family/arm/m3/Hwi *******************************************/
+
+typedef struct Hwi_Struct { int reserved; } Hwi_Struct;
+typedef struct Hwi_Params { int priority; } Hwi_Params;
+typedef void (*Hwi_FuncPtr)(UArg arg);
+typedef void (*Hwi_PlugFuncPtr)(void);
+
+#define Hwi_disable()               ((UInt)0)
+#define Hwi_restore(key)            ((void)(key))
+#define Hwi_plug(intnum, fxn)       ((void)(intnum), (void)(fxn))
+#define Hwi_Params_init(params)     ((params)->priority = 0)
+#define Hwi_construct(s, n, f, p, eb) ((void)(s), (void)(n), (void)(f), (void)(p), (void)(eb))
+
+/*** ti/drivers ************************************************************/
+
+typedef void*   UART_Handle;
+typedef void*   SPI_Handle;
+typedef void*   I2C_Handle;
+
+typedef enum SPI_Status {
+    SPI_TRANSFER_COMPLETED = 0,
+    SPI_TRANSFER_STARTED,
+    SPI_TRANSFER_CANCELED,
+    SPI_TRANSFER_FAILED
+} SPI_Status;
+
+typedef enum SPI_TransferMode {
+    SPI_MODE_BLOCKING,
+    SPI_MODE_CALLBACK
+} SPI_TransferMode;
+
+typedef enum SPI_Mode { SPI_MASTER, SPI_SLAVE } SPI_Mode;
+
+typedef enum SPI_FrameFormat {
+    SPI_POL0_PHA0, SPI_POL0_PHA1, SPI_POL1_PHA0, SPI_POL1_PHA1
+} SPI_FrameFormat;
+
+typedef struct SPI_Transaction {
+    size_t      count;
+    void*       txBuf;
+    void*       rxBuf;
+    void*       arg;
+    SPI_Status  status;
+} SPI_Transaction;
+
+typedef void (*SPI_CallbackFxn)(SPI_Handle handle, SPI_Transaction* transaction);
+
+typedef struct SPI_Params {
+    SPI_TransferMode transferMode;
+    UInt32          transferTimeout;
+    SPI_CallbackFxn transferCallbackFxn;
+    SPI_Mode        mode;
+    UInt32          bitRate;
+    UInt32          dataSize;
+    SPI_FrameFormat frameFormat;
+} SPI_Params;
+
+void SPI_Params_init(SPI_Params* params);
+SPI_Handle SPI_open(UInt index, SPI_Params* params);
+Bool SPI_transfer(SPI_Handle handle, SPI_Transaction* transaction);
+
+typedef struct I2C_Transaction {
+    void*       writeBuf;
+    size_t      writeCount;
+    void*       readBuf;
+    size_t      readCount;
+    uint8_t     slaveAddress;
+    void*       arg;
+} I2C_Transaction;
+
+Bool I2C_transfer(I2C_Handle handle, I2C_Transaction* transaction);
+
+#define GPIO_write(index, value)    ((void)(index), (void)(value))
+#define GPIO_read(index)            ((void)(index), 0)
+
+/*** driverlib & inc *******************************************************/
+
+/* Register access goes to a small simulated register file. The DWT cycle
+ * counter reads back host time scaled to the simulated CPU clock.
+ */
+#define HWREG(x)                (*SimBios_hwreg((uint32_t)(x)))
+
+volatile uint32_t* SimBios_hwreg(uint32_t addr);
+
+#define QEI0_BASE               0x4002C000
+#define QEI1_BASE               0x4002D000
+
+uint32_t QEIPositionGet(uint32_t ui32Base);
+uint32_t QEIVelocityGet(uint32_t ui32Base);
+int32_t QEIDirectionGet(uint32_t ui32Base);
+
+void EEPROMRead(uint32_t* pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t* pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+
+#endif /* _SIMBIOS_H_ */
+
+/* End-Of-File */
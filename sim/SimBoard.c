@@ -0,0 +1,317 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Host simulator replacements for the board level drivers. The QEI, tape
+ * tach and ADC functions read the plant model, and the SSI-0 driver models
+ * the TLV5637 motor DAC driving it. The I/O expander and IPC functions just
+ * track transport state.
+ *
+ * ============================================================================ */
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include <ti/drivers/I2C.h>
+
+#include <driverlib/qei.h>
+#include <driverlib/eeprom.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "DTC1200.h"
+#include "Globals.h"
+#include "IOExpander.h"
+#include "MotorDAC.h"
+#include "ReelQEI.h"
+#include "TapeTach.h"
+#include "IPCServer.h"
+
+#include "SimPlant.h"
+
+/* Simulated IPC notify counter */
+uint32_t g_sim_notify_count = 0;
+
+/*****************************************************************************
+ * Reel QEI
+ *****************************************************************************/
+
+void ReelQEI_initialize(void)
+{
+}
+
+/* The position register counts down for forward tape motion, which the
+ * QEI reports as direction -1, and wraps once per revolution.
+ */
+
+uint32_t QEIPositionGet(uint32_t ui32Base)
+{
+    int reel = (ui32Base == QEI_BASE_SUPPLY) ? REEL_SUPPLY : REEL_TAKEUP;
+
+    int64_t count = -(int64_t)floor(g_plant.reel[reel].edges);
+
+    return (uint32_t)count & (QE_AS5047P_EDGES - 1);
+}
+
+uint32_t QEIVelocityGet(uint32_t ui32Base)
+{
+    int reel = (ui32Base == QEI_BASE_SUPPLY) ? REEL_SUPPLY : REEL_TAKEUP;
+
+    return g_plant.reel[reel].qei_velocity;
+}
+
+int32_t QEIDirectionGet(uint32_t ui32Base)
+{
+    int reel = (ui32Base == QEI_BASE_SUPPLY) ? REEL_SUPPLY : REEL_TAKEUP;
+
+    return g_plant.reel[reel].qei_direction;
+}
+
+/*****************************************************************************
+ * Tape Roller Tach
+ *****************************************************************************/
+
+static TACHFILT s_tach_filter;
+static uint32_t s_tach_groups;
+
+void TapeTach_initialize(void)
+{
+    TachFilter_init(&s_tach_filter, TACH_EDGE_GROUP);
+}
+
+/* Feeds the tach filter on each new group like the tach driver does */
+
+float TapeTach_read(void)
+{
+    uint32_t period = Plant_tachPeriod(&g_plant);
+    uint32_t elapsed = (uint32_t)((g_plant.time - g_plant.tach_last_time) * 80000000.0);
+
+    s_tach_filter.type = (g_sys.sysflags & SF_TACH_ALPHABETA) ? TACH_FILT_ALPHABETA : TACH_FILT_WINDOW;
+
+    if (!period)
+    {
+        TachFilter_reset(&s_tach_filter);
+        s_tach_groups = g_plant.tach_groups;
+        return 0.0f;
+    }
+
+    if (g_plant.tach_groups != s_tach_groups)
+    {
+        s_tach_groups = g_plant.tach_groups;
+        TachFilter_update(&s_tach_filter, period);
+    }
+
+    return TachFilter_read(&s_tach_filter, elapsed);
+}
+
+float TapeTach_getAccel(void)
+{
+    return s_tach_filter.valid ? s_tach_filter.accel : 0.0f;
+}
+
+void TapeTach_reset(void)
+{
+    g_plant.tach_period = 0.0;
+}
+
+int32_t TapeTach_getPosition(void)
+{
+    REELSTATE* s = &g_plant.reel[REEL_SUPPLY];
+    REELSTATE* t = &g_plant.reel[REEL_TAKEUP];
+
+    /* Commit a partial group on reversal like the tach driver does */
+    if ((s->qei_direction == t->qei_direction) && (s->qei_direction != g_plant.tach_direction))
+    {
+        g_plant.tach_position = Plant_tapePosition(&g_plant);
+        g_plant.tach_direction = s->qei_direction;
+        g_plant.tach_edges -= floor(g_plant.tach_edges);
+    }
+
+    return Plant_tapePosition(&g_plant);
+}
+
+void TapeTach_setPosition(int32_t position)
+{
+    g_plant.tach_position = position;
+    g_plant.tach_edges = 0.0;
+}
+
+/*****************************************************************************
+ * ADC - Step[0] tension arm, Step[1..2] motor current, Step[4] CPU temp
+ *****************************************************************************/
+
+/* Motor current sense, full scale torque reads ADC_MAX */
+
+static uint32_t CurrentADC(REELSTATE* r)
+{
+    float adc = (r->torque / g_plant.parms.torque_full_scale) * (float)ADC_MAX;
+
+    if (adc > (float)ADC_MAX)
+        adc = (float)ADC_MAX;
+
+    return (adc > 0.0f) ? (uint32_t)(adc + 0.5f) : 0;
+}
+
+int32_t DTC1200_readADC(uint32_t* pui32Buffer)
+{
+    pui32Buffer[0] = (uint32_t)Plant_tensionADC(&g_plant);
+    pui32Buffer[1] = CurrentADC(&g_plant.reel[REEL_SUPPLY]);
+    pui32Buffer[2] = CurrentADC(&g_plant.reel[REEL_TAKEUP]);
+    pui32Buffer[3] = 0;
+    pui32Buffer[4] = 1944;          /* ~30C internal temperature */
+
+    return 5;
+}
+
+/*****************************************************************************
+ * SSI-0 and the TLV5637 motor DAC. Each transfer is one chip select frame
+ * and completes at once, calling back before SPI_transfer() returns. Every
+ * fault_period transfer fails without reaching the DAC.
+ *****************************************************************************/
+
+typedef struct _TLV5637 {
+    uint16_t    control;
+    uint16_t    buffer;
+    uint16_t    dac_a;
+    uint16_t    dac_b;
+} TLV5637;
+
+static TLV5637 s_tlv;
+static SPI_Params s_spi_params;
+static uint32_t s_spi_transfers;
+static uint32_t s_spi_fault_period;
+
+/* Power on the DAC with all latches zero */
+
+void SimBoard_resetDAC(uint32_t fault_period)
+{
+    memset(&s_tlv, 0, sizeof(s_tlv));
+
+    s_spi_transfers    = 0;
+    s_spi_fault_period = fault_period;
+
+    g_plant.dac[REEL_SUPPLY] = (float)DAC_MAX;
+    g_plant.dac[REEL_TAKEUP] = (float)DAC_MAX;
+}
+
+void SPI_Params_init(SPI_Params* params)
+{
+    memset(params, 0, sizeof(SPI_Params));
+}
+
+SPI_Handle SPI_open(UInt index, SPI_Params* params)
+{
+    s_spi_params = *params;
+
+    return (SPI_Handle)&s_spi_params;
+}
+
+Bool SPI_transfer(SPI_Handle handle, SPI_Transaction* transaction)
+{
+    uint16_t word = *(uint16_t*)transaction->txBuf;
+
+    transaction->status = SPI_TRANSFER_COMPLETED;
+
+    if (s_spi_fault_period && ((++s_spi_transfers % s_spi_fault_period) == 0))
+    {
+        transaction->status = SPI_TRANSFER_FAILED;
+    }
+    else
+    {
+        /* R1 is bit 15 and R0 bit 12, data in D11-D2 */
+        uint16_t data = (word >> 2) & 0x3FF;
+
+        switch (word & 0x9000)
+        {
+            case 0x0000: s_tlv.dac_b = s_tlv.buffer = data; break;
+            case 0x1000: s_tlv.buffer = data; break;
+            case 0x8000: s_tlv.dac_a = data; s_tlv.dac_b = s_tlv.buffer; break;
+            case 0x9000: s_tlv.control = word & 0x0FFF; break;
+        }
+
+        /* The amp gives full torque at the low end of the DAC */
+        g_plant.dac[REEL_SUPPLY] = (float)(DAC_MAX - s_tlv.dac_a);
+        g_plant.dac[REEL_TAKEUP] = (float)(DAC_MAX - s_tlv.dac_b);
+    }
+
+    /* A queued transfer reports its status in the callback */
+    if (s_spi_params.transferMode == SPI_MODE_CALLBACK)
+    {
+        s_spi_params.transferCallbackFxn(handle, transaction);
+        return TRUE;
+    }
+
+    return (transaction->status == SPI_TRANSFER_COMPLETED) ? TRUE : FALSE;
+}
+
+/*****************************************************************************
+ * I/O Expanders - solenoids drive the plant brakes, pinch roller & capstan
+ *****************************************************************************/
+
+uint32_t SetTransportMask(uint8_t ucSetMask, uint8_t ucClearMask)
+{
+    g_plant.transport_mask &= ~(ucClearMask);
+    g_plant.transport_mask |= ucSetMask;
+
+    return 1;
+}
+
+uint8_t GetTransportMask(void)
+{
+    return g_plant.transport_mask;
+}
+
+bool IsTransportLifters(void)
+{
+    return (g_plant.transport_mask & T_TLIFT) ? true : false;
+}
+
+uint32_t SetLamp(uint8_t ucBitMask)
+{
+    g_lamp_mask = ucBitMask;
+    return 1;
+}
+
+/*****************************************************************************
+ * IPC, EEPROM and I2C
+ *****************************************************************************/
+
+Bool IPC_Notify(IPC_MSG* msg, UInt32 timeout)
+{
+    ++g_sim_notify_count;
+
+    System_printf("IPC notify op=%u param1=%x\n", msg->opcode, msg->param1.U);
+
+    return TRUE;
+}
+
+void EEPROMRead(uint32_t* pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    memset(pui32Data, 0xFF, ui32Count);
+}
+
+uint32_t EEPROMProgram(uint32_t* pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    return 0;
+}
+
+Bool I2C_transfer(I2C_Handle handle, I2C_Transaction* transaction)
+{
+    return FALSE;
+}
+
+/* End-Of-File */
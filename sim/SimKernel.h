@@ -0,0 +1,22 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================ */
+
+#ifndef _SIMKERNEL_H_
+#define _SIMKERNEL_H_
+
+/* Simulated kernel clock control. One tick equals one millisecond. */
+
+void SimKernel_setVerbose(int level);
+uint32_t SimKernel_getTicks(void);
+void SimKernel_schedule(void);
+void SimKernel_tick(void);
+
+#endif /* _SIMKERNEL_H_ */
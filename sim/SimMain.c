@@ -0,0 +1,1025 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Host side reel transport simulator. The unmodified servo loop, PID and
+ * transport controller sources run on a simulated kernel clock against the
+ * plant model in SimPlant.c, many times faster than real time. A fixed
+ * sequence of transport commands is issued and each servo mode is scored
+ * for settling time, overshoot and tape tension variance. The locate
+ * phases report the final tape position error in tach edges in place of
+ * the overshoot, and the stop phases report the servo dynamic braking
+ * time to stop.
+ *
+ * Usage: dtcsim [-w 1|2] [-l] [-p fraction] [-s seed] [-n runs]
+ *               [-b] [-q] [-f] [-g] [-i] [-t] [-o counts] [-r preset]
+ *               [-m] [-k] [-d] [-j] [-x period] [-a rule] [-c trace.csv]
+ *               [-e edges.txt] [-v]
+ *
+ *      -w  tape width in inches (1 or 2, default 2)
+ *      -l  low tape speed (default high speed)
+ *      -p  fraction of tape on the supply reel (default 0.5)
+ *      -s  sensor noise seed
+ *      -n  repeat the whole sequence n times (benchmark)
+ *      -b  servo on the 1 second boxcar radius/offset (SF_RADIUS_BOXCAR)
+ *      -q  servo on the 10ms QEI velocity capture (SF_QEI_VELCAP)
+ *      -f  fixed STOP brake torque in place of the reel inertia model
+ *      -g  shuttle PID gain schedule (SF_GAIN_SCHEDULE)
+ *      -i  STOP brake and play boost on the identified reel inertia
+ *          (SF_REEL_IDENT)
+ *      -t  alpha-beta tape tach filter (SF_TACH_ALPHABETA)
+ *      -o  reel once-around on the tension sensor, peak ADC counts
+ *      -r  tension sensor filter preset 0-4 (TFILT_xxx)
+ *      -m  motor amp with 15% low gain, a 25 count deadband, a 5% bow and
+ *          back-EMF taking its headroom at speed
+ *      -k  close the reel torque on the motor current (SF_CURRENT_LOOP)
+ *      -d  calibrate the motor DACs on the brakes first (SF_DAC_LINEARIZE)
+ *      -j  dither the motor DACs below one LSB (SF_DAC_DITHER)
+ *      -x  fail every period'th motor DAC SPI transfer
+ *      -a  relay autotune both loops with rule 0-3 before the last run
+ *      -c  write a per-tick CSV trace of the last run
+ *      -e  write the tach edge times of the last run for tachtest
+ *      -v  print firmware System_printf() output
+ *
+ * The exit status is non-zero if any mode fails to settle, or the reel
+ * identification flags an inertia estimate valid that is off the plant by
+ * more than its tolerance.
+ *
+ * ============================================================================ */
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Error.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Mailbox.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "DTC1200.h"
+#include "Globals.h"
+#include "ServoTask.h"
+#include "ServoAutotune.h"
+#include "TransportTask.h"
+#include "IOExpander.h"
+#include "MotorDAC.h"
+#include "ReelQEI.h"
+#include "Utils.h"
+
+#include "SimKernel.h"
+#include "SimPlant.h"
+
+/* Semaphore normally created in DTC1200.c main() */
+Semaphore_Handle g_semaSPI;
+
+/*** Scenario Definitions ***************************************************/
+
+#define METRIC_HOLD         0       /* stationary tension hold      */
+#define METRIC_PLAY         1       /* tape speed to capstan speed  */
+#define METRIC_SHUTTLE      2       /* reel velocity to target      */
+#define METRIC_STOP         3       /* time to null all motion      */
+#define METRIC_LOCATE       4       /* time to stop within window   */
+
+#define SLACK_TENSION       0.5f    /* below this the tape is loose */
+#define VEL_SLOW_LIMIT      40.0f   /* reel velocity near stop      */
+#define IDENT_INERTIA_TOL   0.15f   /* valid reel inertia error     */
+
+typedef struct _PHASE {
+    const char* name;
+    uint8_t     mode;               /* transport mode command       */
+    uint32_t    duration;           /* phase length in ms           */
+    int         metric;             /* how the phase is scored      */
+    float       band;               /* settling band (fraction)     */
+    int32_t     locate;             /* locate distance (tach edges) */
+} PHASE;
+
+static const PHASE s_phases[] = {
+    { "STOP",          MODE_STOP,  3000,  METRIC_HOLD,    0.00f },
+    { "PLAY",          MODE_PLAY,  8000,  METRIC_PLAY,    0.02f },
+    { "STOP<PLAY",     MODE_STOP,  4000,  METRIC_STOP,    0.00f },
+    { "FWD",           MODE_FWD,   15000, METRIC_SHUTTLE, 0.05f },
+    { "STOP<FWD",      MODE_STOP,  10000, METRIC_STOP,    0.00f },
+    { "REW",           MODE_REW,   15000, METRIC_SHUTTLE, 0.05f },
+    { "STOP<REW",      MODE_STOP,  10000, METRIC_STOP,    0.00f },
+    { "PLAY<STOP",     MODE_PLAY,  8000,  METRIC_PLAY,    0.02f },
+    { "STOP",          MODE_STOP,  4000,  METRIC_STOP,    0.00f },
+    { "LOC +2000",     MODE_STOP,  20000, METRIC_LOCATE,  0.00f,  2000 },
+    { "LOC -9000",     MODE_STOP,  30000, METRIC_LOCATE,  0.00f, -9000 },
+    { "LOC +40",       MODE_STOP,  10000, METRIC_LOCATE,  0.00f,    40 },
+    { "LOC -300",      MODE_STOP,  10000, METRIC_LOCATE,  0.00f,  -300 },
+};
+
+#define NUM_PHASES  (sizeof(s_phases) / sizeof(PHASE))
+
+static const char* s_stage_names[SERVO_NUM_STAGES] = {
+    "tach", "qei", "adc", "radius", "dispatch", "dac", "total"
+};
+
+/* Per phase results */
+
+typedef struct _RESULT {
+    bool        settled;
+    float       settle_time;        /* seconds from command         */
+    float       overshoot;          /* percent of target            */
+    double      tsum;               /* steady state tension stats   */
+    double      tsum2;
+    uint32_t    tcount;
+    float       tmin;               /* whole phase tension range    */
+    float       tmax;
+    uint32_t    slack_ms;           /* ms with tape tension lost    */
+    int32_t     locate_error;       /* final locate error (edges)   */
+    uint32_t    stop_time;          /* dynamic brake time (ms)      */
+    uint32_t    boost_ms;           /* ms in the play boost stage   */
+    REELIDENT   ident;              /* reel identification at end   */
+    float       truth[2];           /* plant reel inertias          */
+} RESULT;
+
+/*** Static Data Items ******************************************************/
+
+static FILE* s_trace = NULL;
+static FILE* s_edges = NULL;
+static double s_edge_count;
+
+/* Reel radius ratio tracking error, recursive estimate vs boxcar */
+static double s_ratio_est_err2;
+static double s_ratio_avg_err2;
+static uint32_t s_ratio_count;
+
+/* Servo reel velocity error, at speed and near stop */
+static double s_vel_err2[2];
+static uint32_t s_vel_count[2];
+
+/* Motor current against the torque commanded, both reels */
+static double s_cur_err;
+static double s_cur_err2;
+static uint32_t s_cur_count;
+
+/* Ticks the DAC outputs differ from the last codes written */
+static uint32_t s_dac_stale;
+
+/*****************************************************************************
+ * Helper functions
+ *****************************************************************************/
+
+/* Reel velocity in firmware QEI units (edges per 10ms) without quantization */
+
+static float TrueVelocity(void)
+{
+    float w = fabsf(g_plant.reel[REEL_SUPPLY].omega) + fabsf(g_plant.reel[REEL_TAKEUP].omega);
+
+    return (w / 6.28318530718f) * (float)QE_AS5047P_EDGES * 0.01f;
+}
+
+static void TraceHeader(void)
+{
+    if (!s_trace)
+        return;
+
+    fprintf(s_trace, "ms,mode,dac_s,dac_t,tsense,tension_s,tension_t,vel_s,vel_t,"
+                     "velocity,target,profile,tape_tach,tape_ips,radius_s,radius_t,position,locate\n");
+}
+
+static void TraceTick(uint32_t ms)
+{
+    if (!s_trace)
+        return;
+
+    fprintf(s_trace, "%u,%u,%.1f,%.1f,%.2f,%.3f,%.3f,%.0f,%.0f,%.1f,%u,%.1f,%.2f,%.3f,%.4f,%.4f,%d,%u\n",
+            ms, g_servo.mode,
+            g_servo.dac_supply, g_servo.dac_takeup, g_servo.tsense,
+            g_plant.reel[REEL_SUPPLY].tension, g_plant.reel[REEL_TAKEUP].tension,
+            g_servo.velocity_supply, g_servo.velocity_takeup,
+            TrueVelocity(), g_servo.shuttle_velocity, g_servo.shuttle_profile.velocity,
+            g_servo.tape_tach, g_plant.tape_speed / 0.0254f,
+            g_plant.reel[REEL_SUPPLY].radius, g_plant.reel[REEL_TAKEUP].radius,
+            g_servo.tape_position, g_servo.locate_state);
+}
+
+/*****************************************************************************
+ * Compare the takeup/supply radius ratio from the recursive estimators and
+ * the one second boxcar against the plant. The firmware radius units are
+ * arbitrary so only the ratio is checked. Both run side by side each tick
+ * regardless of which one the servo loop is using.
+ *****************************************************************************/
+
+static void RadiusCompare(void)
+{
+    if (!g_servo.est_radius_takeup.valid || (g_servo.radius_supply_avg <= 0.0f))
+        return;
+
+    if ((g_servo.mode != MODE_PLAY) && (g_servo.mode != MODE_FWD) && (g_servo.mode != MODE_REW))
+        return;
+
+    double truth = g_plant.reel[REEL_TAKEUP].radius / g_plant.reel[REEL_SUPPLY].radius;
+    double est   = g_servo.est_radius_takeup.x / g_servo.est_radius_supply.x;
+    double avg   = g_servo.radius_takeup_avg / g_servo.radius_supply_avg;
+
+    s_ratio_est_err2 += ((est - truth) / truth) * ((est - truth) / truth);
+    s_ratio_avg_err2 += ((avg - truth) / truth) * ((avg - truth) / truth);
+
+    ++s_ratio_count;
+}
+
+/*****************************************************************************
+ * Compare the summed reel velocity the servo loop acts on against the plant,
+ * split at VEL_SLOW_LIMIT so the error near stop is seen on its own.
+ *****************************************************************************/
+
+static void VelocityCompare(void)
+{
+    double err = g_servo.velocity - TrueVelocity();
+    int bin = (TrueVelocity() < VEL_SLOW_LIMIT) ? 1 : 0;
+
+    /* Reels at rest read zero either way */
+    if (TrueVelocity() == 0.0f)
+        return;
+
+    s_vel_err2[bin] += err * err;
+    ++s_vel_count[bin];
+}
+
+/*****************************************************************************
+ * Compare the torque each amp delivers with the torque the servo commanded
+ * for it, in DAC counts.
+ *****************************************************************************/
+
+static void CurrentCompare(void)
+{
+    int i;
+    float dac_per_nm = (float)DAC_MAX / g_plant.parms.torque_full_scale;
+    CURRENTLOOP* cl[2] = { &g_servo.current_supply, &g_servo.current_takeup };
+
+    if ((g_servo.mode & MODE_MASK) == MODE_HALT)
+        return;
+
+    for (i=0; i < 2; i++)
+    {
+        double err = (double)((g_plant.reel[i].torque * dac_per_nm) - cl[i]->reference);
+
+        s_cur_err  += err;
+        s_cur_err2 += err * err;
+        ++s_cur_count;
+    }
+}
+
+/*****************************************************************************
+ * Check the DAC outputs follow the codes the servo wrote, the motor DAC
+ * driver only sends the words for the channels that changed.
+ *****************************************************************************/
+
+static void DACCompare(void)
+{
+    if ((g_plant.dac[REEL_SUPPLY] != (float)((uint32_t)g_servo.dac_supply & DAC_MAX)) ||
+        (g_plant.dac[REEL_TAKEUP] != (float)((uint32_t)g_servo.dac_takeup & DAC_MAX)))
+    {
+        ++s_dac_stale;
+    }
+}
+
+/*****************************************************************************
+ * Snapshot the reel identification and the plant reel inertias in the
+ * firmware units: DAC counts of torque through the amp gain and QEI edges
+ * per 10ms of reel velocity.
+ *****************************************************************************/
+
+static void ReelTruth(RESULT* res)
+{
+    int i;
+    float dac_per_nm = (float)DAC_MAX / (g_plant.parms.torque_full_scale * g_plant.parms.amp_gain);
+    float vel_per_rad = ((float)QE_AS5047P_EDGES * 0.01f) / 6.28318530718f;
+
+    res->ident = g_servo.reel_ident;
+
+    for (i=0; i < 2; i++)
+        res->truth[i] = (g_plant.reel[i].inertia * dac_per_nm) / vel_per_rad;
+}
+
+/*****************************************************************************
+ * Write the time of each tach roller edge in the last plant step, placed
+ * within the step at the tape speed.
+ *****************************************************************************/
+
+static void EdgeTimes(void)
+{
+    double rate = fabs((double)g_plant.tape_speed * (double)g_plant.parms.tach_edges_per_m);
+
+    while ((g_plant.tach_count - s_edge_count) >= 1.0)
+    {
+        s_edge_count += 1.0;
+
+        fprintf(s_edges, "%.7f\n", g_plant.time - ((g_plant.tach_count - s_edge_count) / rate));
+    }
+}
+
+/*****************************************************************************
+ * Run the kernel and the plant for one millisecond
+ *****************************************************************************/
+
+static void SimStep(void)
+{
+    uint32_t substep;
+
+    SimKernel_schedule();
+
+    for (substep=0; substep < PLANT_SUBSTEPS; substep++)
+    {
+        Plant_step(&g_plant, 0.001f / (float)PLANT_SUBSTEPS);
+
+        if (s_edges)
+            EdgeTimes();
+    }
+
+    SimKernel_tick();
+
+    TraceTick(SimKernel_getTicks());
+
+    RadiusCompare();
+
+    VelocityCompare();
+
+    CurrentCompare();
+
+    DACCompare();
+}
+
+/*****************************************************************************
+ * Sweep the motor DAC codes in HALT with the brakes holding the reels, as
+ * the DAC ramp diagnostic does, and build the calibration tables from the
+ * motor current sensed.
+ *****************************************************************************/
+
+#define DAC_CAL_STEPS       33
+#define DAC_CAL_SETTLE      40
+#define DAC_CAL_SAMPLES     10
+
+static bool RunDACCalibration(void)
+{
+    uint32_t i, n, ms;
+    bool ok;
+    float supply[DAC_CAL_STEPS];
+    float takeup[DAC_CAL_STEPS];
+    uint8_t mask = GetTransportMask();
+
+    QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_HALT, 0);
+
+    SetTransportMask(T_BRAKE, 0);
+
+    for (i=0; i < DAC_CAL_STEPS; i++)
+    {
+        g_servo.dac_halt_supply = g_servo.dac_halt_takeup = (i * DAC_MAX) / (DAC_CAL_STEPS - 1);
+
+        for (ms=0; ms < DAC_CAL_SETTLE; ms++)
+            SimStep();
+
+        supply[i] = takeup[i] = 0.0f;
+
+        for (n=0; n < DAC_CAL_SAMPLES; n++)
+        {
+            supply[i] += g_servo.current_supply.current;
+            takeup[i] += g_servo.current_takeup.current;
+
+            SimStep();
+            SimStep();
+        }
+
+        supply[i] /= (float)DAC_CAL_SAMPLES;
+        takeup[i] /= (float)DAC_CAL_SAMPLES;
+    }
+
+    g_servo.dac_halt_supply = g_servo.dac_halt_takeup = DAC_MIN;
+
+    SetTransportMask(mask, (uint8_t)~mask);
+
+    ok = MotorDAC_buildCal(supply, DAC_CAL_STEPS, g_sys.dac_cal_supply) &&
+         MotorDAC_buildCal(takeup, DAC_CAL_STEPS, g_sys.dac_cal_takeup);
+
+    if (ok)
+        g_sys.sysflags |= SF_DAC_LINEARIZE;
+
+    return ok;
+}
+
+/*****************************************************************************
+ * Identify a loop with the relay autotune and apply the gains from the
+ * tuning rule, the same sequence the diag menu autotune runs on the machine.
+ *****************************************************************************/
+
+static const char* s_rule_names[TUNE_NUM_RULES] = {
+    "ZN PID", "ZN PI", "TL PI", "ZN no overshoot"
+};
+
+static bool RunAutotune(uint32_t loop, uint32_t rule)
+{
+    uint32_t ms;
+    float kp, ki, kd;
+    AUTOTUNE_CONFIG config;
+    AUTOTUNE_STATUS status;
+
+    memset(&config, 0, sizeof(config));
+
+    config.loop    = loop;
+    config.cycles  = 4;
+    config.timeout = 15000;
+
+    if (loop == TUNE_LOOP_PLAY)
+    {
+        config.setpoint   = (float)(g_high_speed_flag ? g_sys.play_hi_boost_end : g_sys.play_lo_boost_end);
+        config.amplitude  = config.setpoint * 0.4f;
+        config.hysteresis = 1.0f;
+
+        Servo_ResetPlay();
+    }
+    else
+    {
+        config.setpoint   = (float)(g_sys.shuttle_velocity / 2);
+        config.amplitude  = 100.0f;
+        config.hysteresis = config.setpoint * 0.01f;
+    }
+
+    config.limit = config.setpoint * 0.5f;
+
+    /* The experiment starts from STOP with the tape tensioned */
+    QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_STOP, 0);
+
+    for (ms=0; ms < 1000; ms++)
+        SimStep();
+
+    int32_t position = g_servo.tape_position;
+
+    Autotune_Start(&config);
+
+    QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_FWD | M_NOSLOW,
+                          (loop == TUNE_LOOP_SHUTTLE) ? (uint16_t)config.setpoint : 0);
+
+    for (ms=0; ms < 30000; ms++)
+    {
+        SimStep();
+
+        Autotune_GetStatus(&status);
+
+        if ((status.state == TUNE_STATE_DONE) || (status.state == TUNE_STATE_FAILED))
+            break;
+    }
+
+    Autotune_Stop();
+
+    QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_STOP, 0);
+
+    for (ms=0; ms < 10000; ms++)
+        SimStep();
+
+    /* Wind back to where we started so the phases see the same packs */
+    QueueTransportLocate(position, 0);
+
+    for (ms=0; ms < 60000; ms++)
+    {
+        SimStep();
+
+        if ((ms > 1000) && (g_servo.mode == MODE_STOP) && !g_servo.motion)
+            break;
+    }
+
+    printf("Autotune %-7s ", (loop == TUNE_LOOP_PLAY) ? "play" : "shuttle");
+
+    if (status.state != TUNE_STATE_DONE)
+    {
+        printf("FAILED fault %u after %u cycles\n", status.fault, status.cycles);
+        return false;
+    }
+
+    Autotune_Gains(rule, status.ku, status.tu, &kp, &ki, &kd);
+
+    printf("bias %.1f amplitude %.2f Ku %.3f Tu %.3f s, %s Kp %.3f Ki %.4f Kd %.4f\n",
+           status.bias, status.amplitude, status.ku, status.tu, s_rule_names[rule], kp, ki, kd);
+
+    if (loop == TUNE_LOOP_PLAY)
+    {
+        if (g_high_speed_flag)
+        {
+            g_sys.play_hi_boost_pgain = kp;
+            g_sys.play_hi_boost_igain = ki;
+        }
+        else
+        {
+            g_sys.play_lo_boost_pgain = kp;
+            g_sys.play_lo_boost_igain = ki;
+        }
+    }
+    else
+    {
+        g_sys.shuttle_servo_pgain = kp;
+        g_sys.shuttle_servo_igain = ki;
+        g_sys.shuttle_servo_dgain = kd;
+    }
+
+    return true;
+}
+
+/*****************************************************************************
+ * Run one phase of the scenario and collect its metrics
+ *****************************************************************************/
+
+static void RunPhase(const PHASE* ph, RESULT* res)
+{
+    uint32_t ms;
+    uint32_t last_out = 0;
+    bool     ever_in = false;
+    float    peak = 0.0f;
+    float    target = 0.0f;
+
+    /* Tension samples are buffered so the steady state part can be
+     * selected once the settling time is known.
+     */
+    float* tension = malloc(sizeof(float) * ph->duration);
+
+    memset(res, 0, sizeof(RESULT));
+
+    res->tmin = 1.0e9f;
+    res->tmax = 0.0f;
+
+    int32_t locate_target = g_servo.tape_position + ph->locate;
+    uint32_t stop_count = g_servo.stop_count;
+
+    if (ph->metric == METRIC_LOCATE)
+        QueueTransportLocate(locate_target, 0);
+    else
+        QueueTransportCommand(CMD_TRANSPORT_MODE, ph->mode, 0);
+
+    for (ms=0; ms < ph->duration; ms++)
+    {
+        float value = 0.0f;
+        bool inband = true;
+
+        SimStep();
+
+        /* Score the phase by its controlled variable */
+        switch(ph->metric)
+        {
+            case METRIC_PLAY:
+                target = g_plant.parms.capstan_speed;
+                value  = fabsf(g_plant.tape_speed);
+                inband = (g_servo.mode == MODE_PLAY) && (fabsf(value - target) <= (target * ph->band));
+                break;
+
+            case METRIC_SHUTTLE:
+                target = (float)g_servo.shuttle_velocity;
+                value  = TrueVelocity();
+                inband = (g_servo.mode == ph->mode) && (fabsf(value - target) <= (target * ph->band));
+                break;
+
+            case METRIC_STOP:
+                value  = TrueVelocity();
+                inband = (value < (float)g_sys.vel_detect_threshold);
+                break;
+
+            case METRIC_LOCATE:
+                res->locate_error = g_servo.tape_position - locate_target;
+                inband = (g_servo.mode == MODE_STOP) && !g_servo.motion &&
+                         (abs(res->locate_error) <= g_sys.locate_window);
+                break;
+
+            default:
+                break;
+        }
+
+        if (!inband)
+            last_out = ms + 1;
+        else
+            ever_in = true;
+
+        if ((ph->metric == METRIC_PLAY) || (ph->metric == METRIC_SHUTTLE))
+        {
+            if (target > 0.0f && value > peak)
+                peak = value;
+        }
+
+        float t = g_plant.tension;
+
+        tension[ms] = t;
+
+        if (t < res->tmin)
+            res->tmin = t;
+        if (t > res->tmax)
+            res->tmax = t;
+        if (t < SLACK_TENSION)
+            ++res->slack_ms;
+
+        if ((g_servo.mode == MODE_PLAY) && g_servo.play_boost_count)
+            ++res->boost_ms;
+    }
+
+    if (g_servo.stop_count != stop_count)
+        res->stop_time = g_servo.stop_time;
+
+    ReelTruth(res);
+
+    res->settled     = ever_in && (last_out < ph->duration);
+    res->settle_time = (float)last_out * 0.001f;
+
+    if ((target > 0.0f) && (peak > target))
+        res->overshoot = ((peak - target) / target) * 100.0f;
+
+    /* Steady state tension statistics after settling */
+    for (ms=(res->settled ? last_out : 0); ms < ph->duration; ms++)
+    {
+        res->tsum  += tension[ms];
+        res->tsum2 += (double)tension[ms] * (double)tension[ms];
+        ++res->tcount;
+    }
+
+    free(tension);
+}
+
+/*****************************************************************************
+ * Main simulator entry
+ *****************************************************************************/
+
+int main(int argc, char** argv)
+{
+    int opt;
+    int run;
+    int runs = 1;
+    int failures = 0;
+    uint32_t seed = 1;
+    uint32_t width = 2;
+    bool high_speed = true;
+    bool boxcar = false;
+    bool velcap = false;
+    bool fixed_brake = false;
+    bool gain_schedule = false;
+    bool reel_ident = false;
+    bool tach_alphabeta = false;
+    float runout = 0.0f;
+    int tension_filter = TFILT_OFF;
+    bool amp_error = false;
+    bool current_loop = false;
+    uint32_t dac_fault = 0;
+    bool dac_cal = false;
+    bool dac_dither = false;
+    int tune_rule = -1;
+    float supply_fraction = 0.5f;
+    const char* trace_name = NULL;
+    const char* edge_name = NULL;
+    RESULT results[NUM_PHASES];
+    Error_Block eb;
+    Task_Params taskParams;
+    size_t i;
+
+    while ((opt = getopt(argc, argv, "w:lp:s:n:bqfgito:r:mkdjx:a:c:e:v")) != -1)
+    {
+        switch(opt)
+        {
+            case 'w': width = (atoi(optarg) == 1) ? 1 : 2; break;
+            case 'l': high_speed = false; break;
+            case 'p': supply_fraction = (float)atof(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': runs = atoi(optarg); break;
+            case 'b': boxcar = true; break;
+            case 'q': velcap = true; break;
+            case 'f': fixed_brake = true; break;
+            case 'g': gain_schedule = true; break;
+            case 'i': reel_ident = true; break;
+            case 't': tach_alphabeta = true; break;
+            case 'o': runout = (float)atof(optarg); break;
+            case 'r': tension_filter = atoi(optarg); break;
+            case 'm': amp_error = true; break;
+            case 'k': current_loop = true; break;
+            case 'd': dac_cal = true; break;
+            case 'j': dac_dither = true; break;
+            case 'x': dac_fault = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'a': tune_rule = atoi(optarg); break;
+            case 'c': trace_name = optarg; break;
+            case 'e': edge_name = optarg; break;
+            case 'v': SimKernel_setVerbose(1); break;
+            default:
+                fprintf(stderr, "usage: %s [-w 1|2] [-l] [-p fraction] [-s seed] [-n runs] [-b] [-q] [-f] [-g] [-i] [-t] [-o counts] [-r preset] [-m] [-k] [-d] [-j] [-x period] [-a rule] [-c trace.csv] [-e edges.txt] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if ((supply_fraction < 0.05f) || (supply_fraction > 0.95f))
+    {
+        fprintf(stderr, "supply fraction must be within 0.05 to 0.95\n");
+        return 2;
+    }
+
+    if (tune_rule >= TUNE_NUM_RULES)
+    {
+        fprintf(stderr, "autotune rule must be 0 to %d\n", TUNE_NUM_RULES - 1);
+        return 2;
+    }
+
+    if ((tension_filter < 0) || (tension_filter >= TFILT_NUM_PRESETS))
+    {
+        fprintf(stderr, "tension filter preset must be 0 to %d\n", TFILT_NUM_PRESETS - 1);
+        return 2;
+    }
+
+    if (runs < 1)
+        runs = 1;
+
+    clock_t start = clock();
+
+    for (run=0; run < runs; run++)
+    {
+        /* Each run starts from a fresh plant and firmware state, the
+         * kernel tasks simply carry on from where the last run left them.
+         */
+        g_tape_width      = width;
+        g_high_speed_flag = high_speed ? 1 : 0;
+        g_dip_switch      = 0;
+
+        InitSysDefaults(&g_sys);
+
+        if (boxcar)
+            g_sys.sysflags |= SF_RADIUS_BOXCAR;
+
+        if (velcap)
+            g_sys.sysflags |= SF_QEI_VELCAP;
+
+        if (fixed_brake)
+            g_sys.reel_inertia = 0.0f;
+
+        if (gain_schedule)
+            g_sys.sysflags |= SF_GAIN_SCHEDULE;
+
+        if (reel_ident)
+            g_sys.sysflags |= SF_REEL_IDENT;
+
+        if (tach_alphabeta)
+            g_sys.sysflags |= SF_TACH_ALPHABETA;
+
+        g_sys.tension_filter = tension_filter;
+
+        if (current_loop)
+            g_sys.sysflags |= SF_CURRENT_LOOP;
+
+        if (dac_dither)
+            g_sys.sysflags |= SF_DAC_DITHER;
+
+        s_ratio_est_err2 = s_ratio_avg_err2 = 0.0;
+        s_ratio_count = 0;
+
+        memset(s_vel_err2, 0, sizeof(s_vel_err2));
+        memset(s_vel_count, 0, sizeof(s_vel_count));
+
+        s_cur_err   = 0.0;
+        s_cur_err2  = 0.0;
+        s_cur_count = 0;
+        s_dac_stale = 0;
+
+        Plant_init(&g_plant, width, high_speed, supply_fraction, seed);
+
+        g_plant.parms.arm_adc_runout = runout;
+
+        if (amp_error)
+        {
+            g_plant.parms.amp_gain      = 0.85f;
+            g_plant.parms.amp_deadband  = 25.0f;
+            g_plant.parms.amp_bow       = 0.05f;
+            g_plant.parms.amp_emf_speed = 300.0f;
+        }
+
+        /* Power up the DAC and open the driver to it */
+        SimBoard_resetDAC(dac_fault);
+
+        MotorDAC_initialize();
+
+        if (run == 0)
+        {
+            Error_init(&eb);
+
+            g_mailboxController = Mailbox_create(sizeof(CMDMSG), 8, NULL, &eb);
+            g_semaSPI           = Semaphore_create(1, NULL, &eb);
+
+            if (Error_check(&eb))
+                System_abort("kernel object create failed");
+
+            Task_Params_init(&taskParams);
+            taskParams.priority = 15;
+            Task_create((Task_FuncPtr)ServoLoopTask, &taskParams, &eb);
+
+            Task_Params_init(&taskParams);
+            taskParams.priority = 10;
+            Task_create((Task_FuncPtr)TransportControllerTask, &taskParams, &eb);
+        }
+
+        if ((run == runs - 1) && trace_name)
+        {
+            if ((s_trace = fopen(trace_name, "w")) == NULL)
+            {
+                perror(trace_name);
+                return 2;
+            }
+
+            TraceHeader();
+        }
+
+        if ((run == runs - 1) && edge_name)
+        {
+            if ((s_edges = fopen(edge_name, "w")) == NULL)
+            {
+                perror(edge_name);
+                return 2;
+            }
+
+            s_edge_count = floor(g_plant.tach_count);
+
+            fprintf(s_edges, "# dtcsim tach edge times (sec)\n");
+        }
+
+        /* Calibrate the motor DACs on the brakes before anything runs */
+        if (dac_cal && !RunDACCalibration())
+        {
+            fprintf(stderr, "motor DAC calibration failed\n");
+            ++failures;
+        }
+
+        /* Autotune both loops first, the phases then run on the result */
+        if ((tune_rule >= 0) && (run == runs - 1))
+        {
+            if (!RunAutotune(TUNE_LOOP_SHUTTLE, (uint32_t)tune_rule))
+                ++failures;
+
+            if (!RunAutotune(TUNE_LOOP_PLAY, (uint32_t)tune_rule))
+                ++failures;
+        }
+
+        for (i=0; i < NUM_PHASES; i++)
+            RunPhase(&s_phases[i], &results[i]);
+
+        /* Park the transport in HALT between runs */
+        QueueTransportCommand(CMD_TRANSPORT_MODE, MODE_HALT, 0);
+
+        for (i=0; i < 100; i++)
+        {
+            SimKernel_schedule();
+            SimKernel_tick();
+        }
+    }
+
+    double wall = (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+    double simulated = (double)SimKernel_getTicks() * 0.001;
+
+    if (s_trace)
+        fclose(s_trace);
+
+    if (s_edges)
+        fclose(s_edges);
+
+    /* Report the results of the last run */
+
+    printf("DTC-1200 transport simulation: %s tape, %s speed, supply pack %.0f%%\n",
+           (width == 1) ? "1\"" : "2\"", high_speed ? "high" : "low", supply_fraction * 100.0f);
+
+    printf("\n%-10s %8s %9s %9s %9s %9s %8s %8s %7s %8s\n",
+           "Phase", "Settle s", "Overshoot", "T mean N", "T std N", "T var N2", "T min N", "T max N", "Slack ms", "Boost ms");
+
+    for (i=0; i < NUM_PHASES; i++)
+    {
+        const PHASE* ph = &s_phases[i];
+        RESULT* r = &results[i];
+
+        double mean = r->tcount ? (r->tsum / (double)r->tcount) : 0.0;
+        double var  = r->tcount ? ((r->tsum2 / (double)r->tcount) - (mean * mean)) : 0.0;
+
+        if (var < 0.0)
+            var = 0.0;
+
+        char settle[16];
+        char overshoot[16];
+
+        if (ph->metric == METRIC_HOLD)
+            snprintf(settle, sizeof(settle), "-");
+        else if (r->settled)
+            snprintf(settle, sizeof(settle), "%.3f", r->settle_time);
+        else
+            snprintf(settle, sizeof(settle), "FAIL");
+
+        if ((ph->metric == METRIC_PLAY) || (ph->metric == METRIC_SHUTTLE))
+            snprintf(overshoot, sizeof(overshoot), "%.2f%%", r->overshoot);
+        else if (ph->metric == METRIC_LOCATE)
+            snprintf(overshoot, sizeof(overshoot), "%+d ed", (int)r->locate_error);
+        else if ((ph->metric == METRIC_STOP) && r->stop_time)
+            snprintf(overshoot, sizeof(overshoot), "%u ms", r->stop_time);
+        else
+            snprintf(overshoot, sizeof(overshoot), "-");
+
+        char boost[16];
+
+        if (ph->metric == METRIC_PLAY)
+            snprintf(boost, sizeof(boost), "%u", r->boost_ms);
+        else
+            snprintf(boost, sizeof(boost), "-");
+
+        printf("%-10s %8s %9s %9.3f %9.4f %9.5f %8.3f %8.3f %8u %8s\n",
+               ph->name, settle, overshoot, mean, sqrt(var), var, r->tmin, r->tmax, r->slack_ms, boost);
+
+        if ((ph->metric != METRIC_HOLD) && !r->settled)
+            ++failures;
+    }
+
+    printf("\n%-10s %-6s %17s %5s %6s\n", "Reel ident", "Reel",
+           "Inertia/true", "Valid", "Sigma");
+
+    for (i=0; i < NUM_PHASES; i++)
+    {
+        int j;
+
+        /* After each shuttle and at the end of the sequence */
+        if ((s_phases[i].metric != METRIC_SHUTTLE) && (i != (NUM_PHASES - 1)))
+            continue;
+
+        for (j=0; j < 2; j++)
+        {
+            REELIDENT* id = &results[i].ident;
+            float truth = results[i].truth[j];
+
+            float inertia = (j == REEL_SUPPLY) ? id->inertia_supply : id->inertia_takeup;
+            bool bad = false;
+
+            if (id->valid && (fabsf(inertia - truth) > (truth * IDENT_INERTIA_TOL)))
+                bad = true;
+
+            printf("%-10s %-6s %8.3f/%-8.3f %5s %6.3f%s\n",
+                   s_phases[i].name, (j == REEL_SUPPLY) ? "supply" : "takeup",
+                   inertia, truth, id->valid ? "yes" : "no",
+                   id->sigma_inertia, bad ? " FAIL" : "");
+
+            if (bad)
+                ++failures;
+        }
+    }
+
+    SERVOTIMING timing;
+    SERVOPROFILE profile;
+
+    Servo_GetTiming(&timing);
+
+    printf("\nServo ticks %u, period %u-%u us, %u overruns\n",
+           timing.ticks, timing.period_min, timing.period_max, timing.overruns);
+
+    /* Stage profile cycles are host time scaled to the target clock */
+    Servo_GetProfile(&profile);
+
+    printf("Host stage cycles mean/max:");
+
+    for (i=0; i < SERVO_NUM_STAGES; i++)
+        printf(" %s %u/%u", s_stage_names[i], profile.stage[i].mean, profile.stage[i].max);
+
+    printf("\n");
+
+    if (s_ratio_count)
+    {
+        printf("Radius ratio rms error: estimator %.3f%% boxcar %.3f%% (%s in loop)\n",
+               sqrt(s_ratio_est_err2 / (double)s_ratio_count) * 100.0,
+               sqrt(s_ratio_avg_err2 / (double)s_ratio_count) * 100.0,
+               boxcar ? "boxcar" : "estimator");
+    }
+
+    printf("Reel velocity rms error: %.3f above %.0f, %.3f below (%s)\n",
+           s_vel_count[0] ? sqrt(s_vel_err2[0] / (double)s_vel_count[0]) : 0.0, VEL_SLOW_LIMIT,
+           s_vel_count[1] ? sqrt(s_vel_err2[1] / (double)s_vel_count[1]) : 0.0,
+           velcap ? "10ms capture" : "observer");
+
+    printf("Motor current rms error: %.2f DAC, mean %+.3f (%s%s%s)\n",
+           s_cur_count ? sqrt(s_cur_err2 / (double)s_cur_count) : 0.0,
+           s_cur_count ? (s_cur_err / (double)s_cur_count) : 0.0,
+           current_loop ? "current loop" : "open loop",
+           (g_sys.sysflags & SF_DAC_LINEARIZE) ? ", calibrated" : "",
+           dac_dither ? ", dithered" : "");
+
+    MOTORDAC_STATS dac;
+
+    MotorDAC_getStats(&dac);
+
+    printf("Motor DAC: %u writes, %u unchanged, %u words, %u errors, %u ticks stale\n",
+           dac.writes, dac.unchanged, dac.words, dac.errors, s_dac_stale);
+
+    /* Without faults the outputs never lag the codes written */
+    if (!dac_fault && s_dac_stale)
+        ++failures;
+
+    printf("Simulated %.1f s in %.3f s CPU (%.0fx real time), %d run(s)\n",
+           simulated, wall, (wall > 0.0) ? (simulated / wall) : 0.0, runs);
+
+    return failures ? 1 : 0;
+}
+
+/* End-Of-File */
@@ -0,0 +1,417 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Physical model of the MM-1200 reel transport used by the host simulator.
+ *
+ * Two torque motor driven reels carry a tape pack whose radius and inertia
+ * change as tape winds from one reel to the other. The tape path is split
+ * at the head block into a supply span running over the spring loaded
+ * tension arm and a short stiff span running on to the takeup reel. With
+ * the pinch roller engaged the capstan sets the tape speed through the head
+ * block. Otherwise the tape slides over the heads and guides against wrap
+ * friction, which is much lower with the tape lifters engaged and lets the
+ * two reels hold different tensions when the tape is at rest.
+ *
+ * The sensors are modeled the way the firmware sees them: the QEI velocity
+ * registers latch edge counts every 10ms, the tape roller tach reports the
+ * period of every 20 edges and the tension arm position is read by the ADC.
+ *
+ * ============================================================================ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "SimBios.h"
+#include "DTC1200.h"
+#include "ReelQEI.h"
+#include "SimPlant.h"
+
+#define TWO_PI                  6.28318530718
+#define QEI_PERIOD_SEC          ((double)QE_TIMER_PERIOD / 80000000.0)
+#define TACH_TIMEOUT_SEC        0.5         /* tach edge detect timeout    */
+
+PLANT g_plant;
+
+/*****************************************************************************
+ * Sensor noise generator (xorshift32 + Box-Muller)
+ *****************************************************************************/
+
+static float RandUniform(PLANT* p)
+{
+    uint32_t x = p->rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    p->rand_state = x;
+
+    return ((float)(x >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+static float RandGauss(PLANT* p)
+{
+    float u1 = RandUniform(p);
+    float u2 = RandUniform(p);
+
+    return sqrtf(-2.0f * logf(u1)) * cosf((float)TWO_PI * u2);
+}
+
+/*****************************************************************************
+ * Initialize the plant for a given tape width (1 or 2 inch), speed and pack
+ * distribution. The supply fraction is the portion of the tape wound on the
+ * supply reel.
+ *****************************************************************************/
+
+void Plant_init(PLANT* p, uint32_t tape_width, bool high_speed, float supply_fraction, uint32_t seed)
+{
+    PLANTPARMS* k = &p->parms;
+
+    memset(p, 0, sizeof(PLANT));
+
+    k->hub_radius         = 0.0572f;        /* 4.5" NAB hub             */
+    k->tape_thickness     = 38.1e-6f;       /* 1.5 mil tape             */
+    k->tape_width         = (tape_width == 1) ? 0.0254f : 0.0508f;
+    k->tape_density       = 1400.0f;
+    k->tape_length        = 762.0f;         /* 2500 ft                  */
+    k->reel_inertia       = (tape_width == 1) ? 0.008f : 0.012f;
+    k->torque_full_scale  = 0.90f;
+    k->amp_time_const     = 0.0005f;
+    k->amp_gain           = 1.0f;
+    k->amp_deadband       = 0.0f;
+    k->amp_bow            = 0.0f;
+    k->amp_emf_speed      = 0.0f;
+    k->friction_coulomb   = 0.015f;
+    k->friction_viscous   = 0.0005f;
+    k->brake_torque       = 4.0f;
+    k->arm_rate           = (tape_width == 1) ? 130.0f : 250.0f;
+    k->arm_damping        = 4.0f;
+    k->arm_travel         = 0.030f;
+    k->arm_stop_rate      = 20000.0f;
+    k->arm_adc_per_m      = 20000.0f;
+    k->arm_adc_noise      = 2.0f;
+    k->arm_adc_runout     = 0.0f;
+    k->span_rate          = 5000.0f;
+    k->span_damping       = 20.0f;
+    k->path_mass          = 0.02f;
+    k->path_wrap_heads    = 0.50f;
+    k->path_wrap_lifted   = 0.05f;
+    k->capstan_speed      = (high_speed) ? 0.762f : 0.381f;
+    k->capstan_time_const = 0.100f;
+    k->tach_edges_per_m   = 8.0f / 0.0254f; /* 240 Hz at 30 IPS         */
+
+    p->reel[REEL_SUPPLY].length = k->tape_length * supply_fraction;
+    p->reel[REEL_TAKEUP].length = k->tape_length * (1.0f - supply_fraction);
+
+    p->reel[REEL_SUPPLY].qei_direction = -1;
+    p->reel[REEL_TAKEUP].qei_direction = -1;
+    p->tach_direction = -1;
+
+    /* Threaded tape resting with the arm at mid travel, brakes on */
+    p->arm            = k->arm_travel * 0.5f;
+    p->span           = (k->arm_rate * p->arm) / k->span_rate;
+    p->transport_mask = T_BRAKE;
+    p->rand_state     = seed ? seed : 0x1200;
+}
+
+/*****************************************************************************
+ * Model helpers
+ *****************************************************************************/
+
+static void UpdateGeometry(PLANT* p, REELSTATE* r)
+{
+    PLANTPARMS* k = &p->parms;
+
+    float rh = k->hub_radius;
+
+    if (r->length < 0.0f)
+        r->length = 0.0f;
+
+    r->radius = sqrtf((rh * rh) + (r->length * k->tape_thickness / (float)M_PI));
+
+    float r2  = r->radius * r->radius;
+    float rh2 = rh * rh;
+
+    r->inertia = k->reel_inertia + ((float)M_PI * 0.5f * k->tape_density * k->tape_width * ((r2 * r2) - (rh2 * rh2)));
+}
+
+/* Tension arm spring. Tape goes slack below zero deflection and stretches
+ * against the hard stop beyond full arm travel.
+ */
+
+static float ArmTension(PLANT* p, float d, float ddot)
+{
+    PLANTPARMS* k = &p->parms;
+    float t;
+
+    if (d <= 0.0f)
+        return 0.0f;
+
+    if (d <= k->arm_travel)
+        t = (k->arm_rate * d) + (k->arm_damping * ddot);
+    else
+        t = (k->arm_rate * k->arm_travel) + (k->arm_stop_rate * (d - k->arm_travel)) + (k->arm_damping * ddot);
+
+    return (t > 0.0f) ? t : 0.0f;
+}
+
+/* Integrate one reel with Coulomb friction (including the brake) which
+ * holds the reel stationary until the net torque breaks it free.
+ */
+
+static void IntegrateReel(PLANT* p, REELSTATE* r, float net, bool brake, float dt)
+{
+    PLANTPARMS* k = &p->parms;
+
+    float fc = k->friction_coulomb + (brake ? k->brake_torque : 0.0f);
+
+    if (r->omega == 0.0f)
+    {
+        if (fabsf(net) > fc)
+            r->omega = ((net - copysignf(fc, net)) / r->inertia) * dt;
+    }
+    else
+    {
+        float acc   = (net - copysignf(fc, r->omega) - (k->friction_viscous * r->omega)) / r->inertia;
+        float omega = r->omega + (acc * dt);
+
+        /* Friction can stop a reel but never reverse it */
+        r->omega = ((omega * r->omega) < 0.0f) ? 0.0f : omega;
+    }
+
+    r->edges += ((double)r->omega / TWO_PI) * (double)QE_AS5047P_EDGES * (double)dt;
+}
+
+/*****************************************************************************
+ * Advance the plant by one integration step.
+ *****************************************************************************/
+
+void Plant_step(PLANT* p, float dt)
+{
+    PLANTPARMS* k = &p->parms;
+    REELSTATE* s = &p->reel[REEL_SUPPLY];
+    REELSTATE* t = &p->reel[REEL_TAKEUP];
+    size_t i;
+
+    bool brake = (p->transport_mask & T_BRAKE) ? true : false;
+    bool pinch = (p->transport_mask & T_PROL) ? true : false;
+    bool servo = (p->transport_mask & T_SERVO) ? true : false;
+
+    UpdateGeometry(p, s);
+    UpdateGeometry(p, t);
+
+    /* First order lag factors, exact for any step size */
+    if (dt != p->step_dt)
+    {
+        p->step_dt     = dt;
+        p->amp_alpha   = 1.0f - expf(-dt / k->amp_time_const);
+        p->cap_alpha   = 1.0f - expf(-dt / k->capstan_time_const);
+    }
+
+    /* Motor current amplifier response */
+    for (i=0; i < 2; i++)
+    {
+        float x = (p->dac[i] - k->amp_deadband) / DAC_MAX_F;
+
+        if (x < 0.0f)
+            x = 0.0f;
+
+        /* Transfer curve sags by amp_bow of full scale at mid-scale */
+        float target = (x - (4.0f * k->amp_bow * x * (1.0f - x))) * k->torque_full_scale * k->amp_gain;
+
+        if (target < 0.0f)
+            target = 0.0f;
+
+        /* The back-EMF takes the amp headroom as the reel speeds up,
+         * with 20% over full scale to spare at rest.
+         */
+        if (k->amp_emf_speed > 0.0f)
+        {
+            float headroom = 1.2f * k->torque_full_scale * (1.0f - (fabsf(p->reel[i].omega) / k->amp_emf_speed));
+
+            if (headroom < 0.0f)
+                headroom = 0.0f;
+
+            if (target > headroom)
+                target = headroom;
+        }
+
+        p->reel[i].torque += (target - p->reel[i].torque) * p->amp_alpha;
+    }
+
+    /* Capstan spins up when the capstan servo is enabled */
+    float target_speed = (pinch && servo) ? k->capstan_speed : 0.0f;
+    p->capstan += (target_speed - p->capstan) * p->cap_alpha;
+
+    float vs = s->omega * s->radius;
+    float vt = t->omega * t->radius;
+
+    if (pinch)
+    {
+        /* Capstan clamps the tape at the head block */
+        p->path_speed = p->capstan;
+    }
+    else
+    {
+        /* Tape slides through the head block against wrap friction */
+        float wrap = (p->transport_mask & T_TLIFT) ? k->path_wrap_lifted : k->path_wrap_heads;
+        float net  = t->tension - s->tension;
+        float fc   = wrap * 0.5f * (s->tension + t->tension);
+
+        if (p->path_speed == 0.0f)
+        {
+            if (fabsf(net) > fc)
+                p->path_speed = ((net - copysignf(fc, net)) / k->path_mass) * dt;
+        }
+        else
+        {
+            float speed = p->path_speed + (((net - copysignf(fc, p->path_speed)) / k->path_mass) * dt);
+
+            p->path_speed = ((speed * p->path_speed) < 0.0f) ? 0.0f : speed;
+        }
+    }
+
+    /* Supply span over the arm and the head block to takeup span */
+    p->arm_rate = p->path_speed - vs;
+    float span_rate = vt - p->path_speed;
+
+    p->arm  += p->arm_rate * dt;
+    p->span += span_rate * dt;
+
+    s->tension = ArmTension(p, p->arm, p->arm_rate);
+
+    if (p->span > 0.0f)
+        t->tension = (k->span_rate * p->span) + (k->span_damping * span_rate);
+    else
+        t->tension = 0.0f;
+
+    if (t->tension < 0.0f)
+        t->tension = 0.0f;
+
+    p->tape_speed = p->path_speed;
+
+    p->tension = s->tension;
+
+    /* Reel dynamics, forward tape motion is positive for both reels */
+    IntegrateReel(p, s, (s->tension * s->radius) - s->torque, brake, dt);
+    IntegrateReel(p, t, t->torque - (t->tension * t->radius), brake, dt);
+
+    s->length -= vs * dt;
+    t->length += vt * dt;
+
+    p->time += dt;
+
+    /* QEI velocity capture latches the edge count every period */
+    if ((p->time - p->qei_latch_time) >= (QEI_PERIOD_SEC - 1.0e-9))
+    {
+        p->qei_latch_time += QEI_PERIOD_SEC;
+
+        for (i=0; i < 2; i++)
+        {
+            REELSTATE* r = &p->reel[i];
+
+            int32_t count = (int32_t)floor(r->edges);
+            int32_t diff  = count - r->qei_count;
+
+            r->qei_count    = count;
+            r->qei_velocity = (uint32_t)abs(diff);
+
+            if (diff)
+                r->qei_direction = (diff > 0) ? -1 : 1;
+        }
+    }
+
+    /* Tape roller tach measures the period of every edge group */
+    float v = fabsf(p->tape_speed);
+
+    p->tach_edges += (double)(v * dt * k->tach_edges_per_m);
+    p->tach_count += (double)(v * dt * k->tach_edges_per_m);
+
+    p->tape_position += (double)(p->tape_speed * dt);
+
+    while (p->tach_edges >= (double)TACH_EDGE_GROUP)
+    {
+        p->tach_edges -= (double)TACH_EDGE_GROUP;
+
+        /* The tach ISR signs each group by the reel QEI direction */
+        if (s->qei_direction == t->qei_direction)
+            p->tach_direction = s->qei_direction;
+
+        p->tach_position += (p->tach_direction < 0) ? TACH_EDGE_GROUP : -TACH_EDGE_GROUP;
+
+        /* Interpolate the edge time within this step */
+        double back  = p->tach_edges / (double)(v * k->tach_edges_per_m);
+        double edge  = p->time - back;
+
+        p->tach_period    = edge - p->tach_last_time;
+        p->tach_last_time = edge;
+
+        ++p->tach_groups;
+    }
+
+    if ((p->time - p->tach_last_time) > TACH_TIMEOUT_SEC)
+    {
+        p->tach_period    = 0.0;
+        p->tach_last_time = p->time;
+    }
+}
+
+/*****************************************************************************
+ * Sensor readings as seen by the firmware.
+ *****************************************************************************/
+
+float Plant_tensionADC(PLANT* p)
+{
+    PLANTPARMS* k = &p->parms;
+
+    float adc = 2047.0f + ((p->arm - (k->arm_travel * 0.5f)) * k->arm_adc_per_m);
+
+    adc += RandGauss(p) * k->arm_adc_noise;
+
+    /* Once-around of each reel, peak ADC counts */
+    if (k->arm_adc_runout > 0.0f)
+    {
+        double turns_s = p->reel[REEL_SUPPLY].edges / (double)QE_AS5047P_EDGES;
+        double turns_t = p->reel[REEL_TAKEUP].edges / (double)QE_AS5047P_EDGES;
+
+        adc += k->arm_adc_runout * (float)(sin(TWO_PI * turns_s) + sin(TWO_PI * turns_t));
+    }
+
+    if (adc < 0.0f)
+        adc = 0.0f;
+    else if (adc > (float)ADC_MAX)
+        adc = (float)ADC_MAX;
+
+    return floorf(adc + 0.5f);
+}
+
+/* Tape position in tach edges as read by TapeTach_getPosition(), the
+ * whole groups plus the partial count in the edge count timer.
+ */
+
+int32_t Plant_tapePosition(PLANT* p)
+{
+    int32_t edges = (int32_t)p->tach_edges;
+
+    return p->tach_position + ((p->tach_direction < 0) ? edges : -edges);
+}
+
+/* Last tach group period in the 80MHz timer counts the tach ISR reads */
+
+uint32_t Plant_tachPeriod(PLANT* p)
+{
+    return (uint32_t)(p->tach_period * 80000000.0);
+}
+
+/* End-Of-File */
@@ -0,0 +1,124 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================ */
+
+#ifndef _SIMPLANT_H_
+#define _SIMPLANT_H_
+
+/*** Plant Model Constants **************************************************/
+
+#define REEL_SUPPLY             0
+#define REEL_TAKEUP             1
+
+#define PLANT_SUBSTEPS          4           /* integration steps per 1ms tick */
+#define TACH_EDGE_GROUP         20          /* edges per tach interrupt       */
+
+/*** Plant Model Structures *************************************************/
+
+/* Physical parameters of the MM-1200 reel transport. All values are SI
+ * units. Forward tape motion (supply paying out, takeup winding in) is
+ * taken as positive reel velocity for both reels.
+ */
+
+typedef struct _PLANTPARMS
+{
+    float   hub_radius;             /* empty reel hub radius (m)          */
+    float   tape_thickness;         /* tape base+oxide thickness (m)      */
+    float   tape_width;             /* tape width (m)                     */
+    float   tape_density;           /* tape mass density (kg/m^3)         */
+    float   tape_length;            /* total tape length on both reels    */
+    float   reel_inertia;           /* motor rotor + empty reel (kg*m^2)  */
+    float   torque_full_scale;      /* motor torque at DAC_MAX (N*m)      */
+    float   amp_time_const;         /* motor current amp lag (s)          */
+    float   amp_gain;               /* amp current per commanded current  */
+    float   amp_deadband;           /* DAC counts before current flows    */
+    float   amp_bow;                /* sag below linear at mid-scale (FS) */
+    float   amp_emf_speed;          /* reel speed with no headroom, 0=off */
+    float   friction_coulomb;       /* bearing drag per reel (N*m)        */
+    float   friction_viscous;       /* viscous drag per reel (N*m*s/rad)  */
+    float   brake_torque;           /* mechanical brake torque (N*m)      */
+    float   arm_rate;               /* tension arm spring rate (N/m)      */
+    float   arm_damping;            /* tension arm damping (N*s/m)        */
+    float   arm_travel;             /* tension arm full travel (m)        */
+    float   arm_stop_rate;          /* tape stretch rate at arm stop      */
+    float   arm_adc_per_m;          /* tension sensor ADC counts per m    */
+    float   arm_adc_noise;          /* tension sensor noise (ADC rms)     */
+    float   arm_adc_runout;         /* reel once-around at the sensor     */
+    float   span_rate;              /* head block to takeup stiffness     */
+    float   span_damping;           /* head block to takeup damping       */
+    float   path_mass;              /* tape mass through the head block   */
+    float   path_wrap_heads;        /* head block wrap friction (mu*theta)*/
+    float   path_wrap_lifted;       /* wrap friction with tape lifted     */
+    float   capstan_speed;          /* capstan play speed (m/s)           */
+    float   capstan_time_const;     /* capstan servo spin up lag (s)      */
+    float   tach_edges_per_m;       /* tape roller tach edges per meter   */
+} PLANTPARMS;
+
+/* Reel state */
+
+typedef struct _REELSTATE
+{
+    float   length;                 /* tape length wound on reel (m)      */
+    float   radius;                 /* current pack radius (m)            */
+    float   inertia;                /* total inertia incl. pack           */
+    float   omega;                  /* angular velocity (rad/s)           */
+    float   torque;                 /* current motor torque (N*m)         */
+    float   tension;                /* tape tension acting on reel (N)    */
+    double  edges;                  /* encoder edge position              */
+    int32_t qei_count;              /* edge count at last velocity latch  */
+    uint32_t qei_velocity;          /* latched QEI velocity per period    */
+    int32_t qei_direction;          /* QEI direction bit, -1 = forward    */
+} REELSTATE;
+
+typedef struct _PLANT
+{
+    PLANTPARMS  parms;
+    REELSTATE   reel[2];
+    float       dac[2];             /* commanded DAC levels (0-DAC_MAX)   */
+    uint8_t     transport_mask;     /* brake, lifter, pinch, servo bits   */
+    float       arm;                /* arm deflection, stored path (m)    */
+    float       arm_rate;           /* arm deflection rate (m/s)          */
+    float       span;               /* head block to takeup stretch (m)   */
+    float       path_speed;         /* tape speed through the head block  */
+    float       capstan;            /* capstan tape speed (m/s)           */
+    float       tape_speed;         /* tape speed at the tach roller      */
+    float       tension;            /* supply side (arm) tape tension (N) */
+    double      time;               /* simulated time in seconds          */
+    double      qei_latch_time;     /* time of last QEI velocity latch    */
+    double      tach_edges;         /* tach roller edge accumulator       */
+    double      tach_last_time;     /* time of last tach edge group       */
+    double      tach_period;        /* last tach group period (s)         */
+    uint32_t    tach_groups;        /* edge groups counted                */
+    double      tach_count;         /* tach roller edges since init       */
+    int32_t     tach_position;      /* signed edge count at last group    */
+    int32_t     tach_direction;     /* QEI direction the groups count in  */
+    double      tape_position;      /* true tape travel at the tach (m)   */
+    uint32_t    rand_state;         /* sensor noise generator state       */
+    float       step_dt;            /* step size the lag factors are for  */
+    float       amp_alpha;          /* amp current lag factor per step    */
+    float       cap_alpha;          /* capstan speed lag factor per step  */
+} PLANT;
+
+extern PLANT g_plant;
+
+/*** Function Prototypes ****************************************************/
+
+void Plant_init(PLANT* p, uint32_t tape_width, bool high_speed, float supply_fraction, uint32_t seed);
+void Plant_step(PLANT* p, float dt);
+
+float Plant_tensionADC(PLANT* p);
+uint32_t Plant_tachPeriod(PLANT* p);
+int32_t Plant_tapePosition(PLANT* p);
+
+/* Simulated board, SimBoard.c */
+
+void SimBoard_resetDAC(uint32_t fault_period);
+
+#endif /* _SIMPLANT_H_ */
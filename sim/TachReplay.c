@@ -0,0 +1,435 @@
+/* ============================================================================
+ *
+ * DTC-1200 Digital Transport Controller for Ampex MM-1200 Tape Machines
+ *
+ * Copyright (C) 2016, RTZ Professional Audio, LLC
+ * All Rights Reserved
+ *
+ * RTZ is registered trademark of RTZ Professional Audio, LLC
+ *
+ * ============================================================================
+ *
+ * Tape tach filter comparison. Replays tape roller tach edge timestamps
+ * through the tach readings the servo loop could use and scores each one
+ * every 2ms servo tick against a reference tape speed.
+ *
+ *      group     the last edge group period, the tach driver reading
+ *      avg100    the 100 edge moving average of the edge width tach
+ *      window    the adaptive window average (TACH_FILT_WINDOW)
+ *      alphabeta the alpha-beta tracker (TACH_FILT_ALPHABETA)
+ *
+ * The edge file holds one edge time in seconds per line, as captured on
+ * the tach input with a logic analyzer or written by dtcsim -e. Lines
+ * starting with '#' are skipped. The reference speed for a capture is the
+ * centred edge rate over REF_SPAN_SEC either side of each tick, which
+ * can't be had in real time. With no file a spin up, speed change and
+ * stop profile is generated with roller flutter and edge timing jitter,
+ * and the profile speed is the reference.
+ *
+ * Usage: tachtest [-t] [-g edges] [-c trace.csv] [edges.txt]
+ *
+ *      -t  test mode, fail unless both filters beat the 100 edge average
+ *          while accelerating and the window is as steady as the reading
+ *          it replaces (generated profile only)
+ *      -g  edges per tach group (default 20)
+ *      -c  write a per-tick CSV trace
+ *
+ * ============================================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "TapeTach.h"
+
+#define TICK_SEC        0.002       /* servo loop period                  */
+#define TIMEOUT_SEC     0.5         /* tach edge timeout                  */
+#define REF_SPAN_SEC    0.025       /* reference edge rate half span      */
+#define ACCEL_LIMIT     20.0        /* tach/sec counted as accelerating   */
+#define AVG_EDGES       100         /* edge width tach TACH_AVG_QTY       */
+#define MAX_EDGES       1000000
+
+/* Generated profile, tach units (120 at 30 IPS) */
+#define GEN_STEP_SEC    1.0e-5
+#define GEN_FLUTTER     0.003       /* roller flutter fraction of speed   */
+#define GEN_FLUTTER_HZ  5.0
+#define GEN_JITTER_SEC  1.0e-5      /* edge timing jitter, uniform +/-    */
+
+enum { EST_GROUP, EST_AVG100, EST_WINDOW, EST_ALPHABETA, NUM_EST };
+
+static const char* s_est_names[NUM_EST] = {
+    "group", "avg100", "window", "alphabeta"
+};
+
+typedef struct _SCORE {
+    double  err2[2];                /* squared error, steady and accel    */
+    double  peak;                   /* largest error with tape moving     */
+    size_t  count[2];
+} SCORE;
+
+static double s_edges[MAX_EDGES];
+static size_t s_num_edges = 0;
+static bool   s_generated = false;
+
+/*****************************************************************************
+ * Generated profile speed in tach units at time t
+ *****************************************************************************/
+
+typedef struct _SEGMENT {
+    double  end;                    /* segment end time (sec)             */
+    double  speed;                  /* speed at the end of the segment    */
+} SEGMENT;
+
+/* Stopped, capstan spin up to 30 IPS, hold, down to 15 IPS, hold, stop */
+static const SEGMENT s_profile[] = {
+    { 0.30,   0.0 },
+    { 0.80, 120.0 },
+    { 3.00, 120.0 },
+    { 3.50,  60.0 },
+    { 6.00,  60.0 },
+    { 6.50,   0.0 },
+    { 7.00,   0.0 },
+};
+
+#define NUM_SEGMENTS    (sizeof(s_profile) / sizeof(SEGMENT))
+
+static double ProfileSpeed(double t)
+{
+    size_t i;
+    double start = 0.0;
+    double from = 0.0;
+
+    for (i=0; i < NUM_SEGMENTS; i++)
+    {
+        if (t < s_profile[i].end)
+        {
+            double f = (t - start) / (s_profile[i].end - start);
+            double v = from + ((s_profile[i].speed - from) * f);
+
+            return v * (1.0 + (GEN_FLUTTER * sin(2.0 * M_PI * GEN_FLUTTER_HZ * t)));
+        }
+
+        start = s_profile[i].end;
+        from  = s_profile[i].speed;
+    }
+
+    return 0.0;
+}
+
+static uint32_t s_rand = 0x1200;
+
+static double Noise(void)
+{
+    s_rand = (s_rand * 1664525u) + 1013904223u;
+
+    return ((double)(s_rand >> 8) * (1.0 / 16777216.0)) - 0.5;
+}
+
+/* The tach reads half the edge rate, so two edges per tach unit second */
+
+static void GenerateEdges(void)
+{
+    double t;
+    double edges = 0.0;
+    double end = s_profile[NUM_SEGMENTS - 1].end;
+
+    for (t=0.0; (t < end) && (s_num_edges < MAX_EDGES); t += GEN_STEP_SEC)
+    {
+        double v = ProfileSpeed(t) * 2.0;
+
+        edges += v * GEN_STEP_SEC;
+
+        if (edges >= 1.0)
+        {
+            edges -= 1.0;
+
+            /* Interpolate the edge time within the step */
+            double edge = t + GEN_STEP_SEC - (edges / v);
+
+            s_edges[s_num_edges++] = edge + (Noise() * 2.0 * GEN_JITTER_SEC);
+        }
+    }
+
+    s_generated = true;
+}
+
+static bool LoadEdges(const char* name)
+{
+    char line[128];
+    FILE* fp;
+
+    if ((fp = fopen(name, "r")) == NULL)
+    {
+        perror(name);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp) && (s_num_edges < MAX_EDGES))
+    {
+        if ((line[0] == '#') || (line[0] == '\n'))
+            continue;
+
+        s_edges[s_num_edges++] = atof(line);
+    }
+
+    fclose(fp);
+
+    return (s_num_edges > 1) ? true : false;
+}
+
+/*****************************************************************************
+ * Reference speed from the capture, the edges within REF_SPAN_SEC either
+ * side of t with the fractional edge at each end interpolated.
+ *****************************************************************************/
+
+static double EdgePosition(double t, size_t* hint)
+{
+    size_t i = *hint;
+
+    while ((i + 1 < s_num_edges) && (s_edges[i + 1] <= t))
+        ++i;
+
+    *hint = i;
+
+    if ((t < s_edges[0]) || (i + 1 >= s_num_edges))
+        return (double)i;
+
+    return (double)i + ((t - s_edges[i]) / (s_edges[i + 1] - s_edges[i]));
+}
+
+static double CaptureSpeed(double t)
+{
+    static size_t lo = 0;
+    static size_t hi = 0;
+
+    double a = EdgePosition(t - REF_SPAN_SEC, &lo);
+    double b = EdgePosition(t + REF_SPAN_SEC, &hi);
+
+    return ((b - a) / (2.0 * REF_SPAN_SEC)) * 0.5;
+}
+
+static double ReferenceSpeed(double t)
+{
+    return s_generated ? ProfileSpeed(t) : CaptureSpeed(t);
+}
+
+/*****************************************************************************
+ * Replay the edges tick by tick through all the tach readings
+ *****************************************************************************/
+
+static void Score(SCORE* sc, double est, double ref, int accel)
+{
+    sc->err2[accel] += (est - ref) * (est - ref);
+
+    if (fabs(est - ref) > sc->peak)
+        sc->peak = fabs(est - ref);
+
+    ++sc->count[accel];
+}
+
+static void Replay(size_t group_edges, FILE* trace, SCORE* scores, double* accel_rms)
+{
+    TACHFILT window;
+    TACHFILT alphabeta;
+    size_t edge = 0;
+    size_t groups = 0;
+    double last_group = -1.0;
+    double group_period = 0.0;
+    double prev_ref = 0.0;
+    double accel_err2 = 0.0;
+    size_t accel_count = 0;
+    double t;
+    double end = s_edges[s_num_edges - 1] + TIMEOUT_SEC;
+    int i;
+
+    TachFilter_init(&window, (uint32_t)group_edges);
+    TachFilter_init(&alphabeta, (uint32_t)group_edges);
+
+    window.type    = TACH_FILT_WINDOW;
+    alphabeta.type = TACH_FILT_ALPHABETA;
+
+    if (trace)
+        fprintf(trace, "sec,reference,group,avg100,window,alphabeta,accel_ref,accel\n");
+
+    for (t=s_edges[0]; t < end; t += TICK_SEC)
+    {
+        double est[NUM_EST];
+
+        /* Edge groups completed since the last tick */
+        while ((edge < s_num_edges) && (s_edges[edge] <= t))
+        {
+            if ((++edge % group_edges) == 0)
+            {
+                double when = s_edges[edge - 1];
+
+                if (last_group >= 0.0)
+                {
+                    uint32_t period = (uint32_t)((when - last_group) * (double)TACH_CLOCK_HZ);
+
+                    group_period = when - last_group;
+
+                    TachFilter_update(&window, period);
+                    TachFilter_update(&alphabeta, period);
+                }
+
+                last_group = when;
+                ++groups;
+            }
+        }
+
+        /* The tach driver times out without an edge */
+        if ((last_group >= 0.0) && ((t - last_group) > TIMEOUT_SEC))
+        {
+            TachFilter_reset(&window);
+            TachFilter_reset(&alphabeta);
+
+            group_period = 0.0;
+            last_group   = -1.0;
+        }
+
+        uint32_t elapsed = (last_group >= 0.0) ? (uint32_t)((t - last_group) * (double)TACH_CLOCK_HZ) : 0;
+
+        est[EST_GROUP]     = (group_period > 0.0) ? ((0.5 * (double)group_edges) / group_period) : 0.0;
+        est[EST_WINDOW]    = TachFilter_read(&window, elapsed);
+        est[EST_ALPHABETA] = TachFilter_read(&alphabeta, elapsed);
+
+        /* Edge width tach, half the rate over the last AVG_EDGES edges */
+        if ((edge > AVG_EDGES) && ((t - s_edges[edge - 1]) <= TIMEOUT_SEC))
+            est[EST_AVG100] = (0.5 * (double)AVG_EDGES) / (s_edges[edge - 1] - s_edges[edge - 1 - AVG_EDGES]);
+        else
+            est[EST_AVG100] = 0.0;
+
+        double ref = ReferenceSpeed(t);
+        double ref_accel = (t > s_edges[0]) ? ((ref - prev_ref) / TICK_SEC) : 0.0;
+        int accel = (fabs(ReferenceSpeed(t + TICK_SEC) - ReferenceSpeed(t - TICK_SEC)) > (ACCEL_LIMIT * 2.0 * TICK_SEC)) ? 1 : 0;
+
+        prev_ref = ref;
+
+        /* Only score with the tape moving */
+        if (ref > 1.0)
+        {
+            for (i=0; i < NUM_EST; i++)
+                Score(&scores[i], est[i], ref, accel);
+
+            double ab_accel = alphabeta.valid ? (double)alphabeta.accel : 0.0;
+
+            accel_err2 += (ab_accel - ref_accel) * (ab_accel - ref_accel);
+            ++accel_count;
+        }
+
+        if (trace)
+            fprintf(trace, "%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f\n", t, ref,
+                    est[EST_GROUP], est[EST_AVG100], est[EST_WINDOW], est[EST_ALPHABETA],
+                    ref_accel, alphabeta.valid ? (double)alphabeta.accel : 0.0);
+    }
+
+    *accel_rms = accel_count ? sqrt(accel_err2 / (double)accel_count) : 0.0;
+}
+
+static double Rms(const SCORE* sc, int accel)
+{
+    return sc->count[accel] ? sqrt(sc->err2[accel] / (double)sc->count[accel]) : 0.0;
+}
+
+/*****************************************************************************
+ * Main entry point
+ *****************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    int opt;
+    int i;
+    bool test = false;
+    size_t group_edges = 20;
+    const char* trace_name = NULL;
+    FILE* trace = NULL;
+    SCORE scores[NUM_EST];
+    double accel_rms;
+
+    while ((opt = getopt(argc, argv, "tg:c:")) != -1)
+    {
+        switch(opt)
+        {
+            case 't': test = true; break;
+            case 'g': group_edges = (size_t)atoi(optarg); break;
+            case 'c': trace_name = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-t] [-g edges] [-c trace.csv] [edges.txt]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (group_edges < 1)
+        group_edges = 1;
+
+    if (optind < argc)
+    {
+        if (!LoadEdges(argv[optind]))
+        {
+            fprintf(stderr, "%s: no edges\n", argv[optind]);
+            return 2;
+        }
+    }
+    else
+    {
+        GenerateEdges();
+    }
+
+    if (trace_name && ((trace = fopen(trace_name, "w")) == NULL))
+    {
+        perror(trace_name);
+        return 2;
+    }
+
+    memset(scores, 0, sizeof(scores));
+
+    Replay(group_edges, trace, scores, &accel_rms);
+
+    if (trace)
+        fclose(trace);
+
+    printf("Tape tach filter replay, %zu edges (%s), %zu edges per group\n",
+           s_num_edges, s_generated ? "generated profile" : argv[optind], group_edges);
+
+    printf("\n%-10s %12s %12s %12s %12s\n", "Reading", "Steady rms", "Accel rms", "Peak error", "Ticks");
+
+    for (i=0; i < NUM_EST; i++)
+    {
+        printf("%-10s %12.3f %12.3f %12.3f %12zu\n", s_est_names[i],
+               Rms(&scores[i], 0), Rms(&scores[i], 1), scores[i].peak,
+               scores[i].count[0] + scores[i].count[1]);
+    }
+
+    printf("\nAlpha-beta acceleration rms error %.1f tach/sec\n", accel_rms);
+
+    if (!test)
+        return 0;
+
+    bool pass = s_generated ? true : false;
+
+    /* Both must beat the 100 edge average while accelerating */
+    for (i=EST_WINDOW; i < NUM_EST; i++)
+    {
+        if (Rms(&scores[i], 1) >= Rms(&scores[EST_AVG100], 1))
+            pass = false;
+    }
+
+    /* The window must also be as steady as the driver reading it replaces,
+     * the group period or the 100 edge average with single edges.
+     */
+    int legacy = (group_edges > 1) ? EST_GROUP : EST_AVG100;
+
+    if (Rms(&scores[EST_WINDOW], 0) > Rms(&scores[legacy], 0))
+        pass = false;
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    return pass ? 0 : 1;
+}
+
+/* End-Of-File */